@@ -0,0 +1,335 @@
+#include "Accelerator.h"
+
+#include <algorithm>
+#include <utility>
+#include <omp.h>
+
+using namespace kd;
+
+namespace {
+
+    const unsigned int BatchSortThreshold     = 256;    //!< The number of rays below which a batch is traced in its own order.
+    const unsigned int BatchParallelThreshold = 256;    //!< The number of rays below which a batch is traced by a single thread.
+    const unsigned int BatchCellBits          = 9;      //!< The number of bits of the origin cell along each axis.
+    const unsigned int BatchChunkSize         = 64;     //!< The number of consecutive rays handed to a thread at once.
+
+    /*!
+     *  \brief  Spreads the lowest 10 bits of a value so that two zero bits
+     *          separate each of them.
+     */
+    inline unsigned int SpreadBits (
+        unsigned int            iValue
+    ) {
+        iValue = ( iValue | ( iValue << 16 ) ) & 0x030000FFu;
+        iValue = ( iValue | ( iValue <<  8 ) ) & 0x0300F00Fu;
+        iValue = ( iValue | ( iValue <<  4 ) ) & 0x030C30C3u;
+        iValue = ( iValue | ( iValue <<  2 ) ) & 0x09249249u;
+        return iValue;
+    }
+
+}
+
+/*!
+ * \inheaderfile
+ */
+Accelerator::Accelerator (
+    const std::vector< Object >&    iObjects
+)   :   m_cache ( (CacheReader*)0x0 )
+{
+    double start = omp_get_wtime ();
+
+    m_triangles = TriangleStore ( iObjects );
+
+    m_buildTimes.primitives = omp_get_wtime () - start;
+}
+
+/*!
+ * \inheaderfile
+ */
+Accelerator::Accelerator (
+    const Object&                   iObject
+)   :   m_cache ( (CacheReader*)0x0 )
+{
+    double start = omp_get_wtime ();
+
+    m_triangles = TriangleStore ( iObject );
+
+    m_buildTimes.primitives = omp_get_wtime () - start;
+}
+
+/*!
+ * \inheaderfile
+ */
+Accelerator::Accelerator (
+    const std::vector< Object >&    iObjects,
+    CacheReader*                    ioCache
+)   :   m_cache ( ioCache )
+{
+    double start = omp_get_wtime ();
+
+    if ( !m_triangles.Map ( *m_cache, iObjects ) ) {
+        m_cache->Invalidate ();
+    }
+
+    m_buildTimes.primitives = omp_get_wtime () - start;
+}
+
+/*!
+ * \inheaderfile
+ */
+Accelerator::~Accelerator ()
+{
+    delete m_cache;
+}
+
+/*!
+ * \inheaderfile
+ */
+unsigned int Accelerator::IntersectPacket (
+    const RayPacket&        iPacket,
+    KdIntersectionData*     oIntersections,
+    const float&            iNear,
+    const float&            iFar
+) const {
+    unsigned int hits = 0u;
+    for ( unsigned int lane = 0; lane < iPacket.GetCount (); lane++ ) {
+        if ( Intersect ( iPacket.GetRay ( lane ), oIntersections[lane], iNear, iFar ) ) {
+            hits |= 1u << lane;
+        }
+    }
+
+    return hits;
+}
+
+/*!
+ * \inheaderfile
+ */
+void Accelerator::SortBatch (
+    const Ray*                      iRays,
+    const unsigned int&             iCount,
+    std::vector< unsigned int >&    oOrder
+) const {
+    const BoundingBox& region = GetRegion ();
+    const float        cells  = (float) ( 1u << BatchCellBits );
+
+    // The key of a ray is its direction octant, followed by the Morton
+    // code of the cell holding its origin.
+    std::vector< std::pair< unsigned int, unsigned int > > keys ( iCount );
+    for ( unsigned int i = 0; i < iCount; i++ ) {
+        const Ray& ray = iRays[i];
+
+        unsigned int key = ( ray.getSign ( 0 ) << 2 ) | ( ray.getSign ( 1 ) << 1 ) | ray.getSign ( 2 );
+        unsigned int code = 0u;
+        for ( unsigned int axis = 0; axis < 3; axis++ ) {
+            const float size = region.getMax ()[axis] - region.getMin ()[axis];
+            float cell = ( size > 0.0f )
+                ? ( ray.getOrigin ()[axis] - region.getMin ()[axis] ) / size * cells
+                : 0.0f;
+
+            // Origins outside of the region go to the closest cell.
+            cell = std::min ( std::max ( cell, 0.0f ), cells - 1.0f );
+            code |= SpreadBits ( (unsigned int) cell ) << axis;
+        }
+
+        keys[i].first  = ( key << ( 3 * BatchCellBits ) ) | code;
+        keys[i].second = i;
+    }
+    std::sort ( keys.begin (), keys.end () );
+
+    oOrder.resize ( iCount );
+    for ( unsigned int i = 0; i < iCount; i++ ) {
+        oOrder[i] = keys[i].second;
+    }
+}
+
+/*!
+ * \inheaderfile
+ */
+void Accelerator::IntersectBatch (
+    const Ray*              iRays,
+    const unsigned int&     iCount,
+    KdIntersectionData*     oIntersections,
+    char*                   oHits,
+    const float&            iNear,
+    const float&            iFar
+) const {
+    // Packets need the sorted rays next to each other; small
+    // batches aren't worth sorting.
+    const bool sort = ( iCount >= BatchSortThreshold );
+    std::vector< unsigned int > order;
+    std::vector< Ray > sorted;
+    if ( sort ) {
+        SortBatch ( iRays, iCount, order );
+        sorted.resize ( iCount );
+        for ( unsigned int i = 0; i < iCount; i++ ) {
+            sorted[i] = iRays[order[i]];
+        }
+    }
+    const Ray* rays = sort ? &sorted[0] : iRays;
+
+    const int packetCount = ( iCount + RayPacket::Size - 1 ) / RayPacket::Size;
+
+    #pragma omp parallel for schedule(dynamic) if(iCount >= BatchParallelThreshold && !omp_in_parallel ())
+    for ( int p = 0; p < packetCount; p++ ) {
+        const unsigned int first = p * RayPacket::Size;
+        const unsigned int count = std::min ( RayPacket::Size, iCount - first );
+
+        const RayPacket packet ( &rays[first], count );
+        KdIntersectionData intersections[RayPacket::Size];
+        const unsigned int hits = IntersectPacket ( packet, intersections, iNear, iFar );
+
+        for ( unsigned int lane = 0; lane < count; lane++ ) {
+            const unsigned int index = sort ? order[first + lane] : first + lane;
+            oHits[index] = ( hits >> lane ) & 1u;
+            if ( oHits[index] ) {
+                oIntersections[index] = intersections[lane];
+            }
+        }
+    }
+}
+
+/*!
+ * \inheaderfile
+ */
+void Accelerator::OccludedBatch (
+    const Ray*              iRays,
+    const unsigned int&     iCount,
+    char*                   oOccluded,
+    const float&            iNear,
+    const float&            iFar
+) const {
+    const int count = iCount;
+    if ( iCount < BatchSortThreshold ) {
+        for ( int i = 0; i < count; i++ ) {
+            oOccluded[i] = Occluded ( iRays[i], iNear, iFar );
+        }
+        return;
+    }
+
+    std::vector< unsigned int > order;
+    SortBatch ( iRays, iCount, order );
+
+    #pragma omp parallel for schedule(dynamic, BatchChunkSize) if(iCount >= BatchParallelThreshold && !omp_in_parallel ())
+    for ( int i = 0; i < count; i++ ) {
+        const unsigned int index = order[i];
+        oOccluded[index] = Occluded ( iRays[index], iNear, iFar );
+    }
+}
+
+/*!
+ * \inheaderfile
+ */
+bool Accelerator::Intersect (
+    const Ray&              iRay,
+    KdIntersectionData&     oIntersection,
+    const float&            iNear,
+    const float&            iFar
+) const {
+    KdHit hit;
+    if ( !IntersectHit ( iRay, hit, iNear, iFar ) ) {
+        return false;
+    }
+
+    ResolveHit ( iRay, hit, oIntersection );
+    return true;
+}
+
+/*!
+ * \inheaderfile
+ */
+void Accelerator::ResolveHit (
+    const Ray&              iRay,
+    const KdHit&            iHit,
+    KdIntersectionData&     oIntersection
+) const {
+    const Object*       object          = m_triangles.GetObject ( iHit.triangle );
+    const unsigned int& triangleIndex   = m_triangles.GetTriangleIndex ( iHit.triangle );
+
+    // The intersection point occurs at R(t) = O + t * d
+    // where t is the distance from the ray's origin along it's
+    // direction d.
+    oIntersection = KdIntersectionData (
+        object,
+        triangleIndex,
+        object->getBumpedNormal ( triangleIndex, iHit.u, iHit.v ),
+        iRay.getOrigin () + iHit.t * iRay.getDirection (),
+        iHit.t,
+        iHit.u,
+        iHit.v
+    );
+}
+
+/*!
+ * \inheaderfile
+ */
+bool Accelerator::IntersectPrimitive (
+    const unsigned int&     iTriangle,
+    const Ray&              iRay,
+    KdHit&                  oHit,
+    const float&            iNear,
+    const float&            iFar,
+    float&                  ioMinDist
+) const {
+    // Tests for ray-triangle intersection, closer than the
+    // closest intersection found so far.
+    float t, u, v;
+    if (
+        !m_triangles.Intersect (
+            iTriangle,
+            iRay,
+            iNear,
+            std::min ( iFar, ioMinDist ),
+            t,
+            u,
+            v
+        )
+    ) {
+        return false;
+    }
+
+    // The normal at the intersection point is the barycentric interpolation
+    // of the normals of all vertices in the triangle. Only its orientation
+    // matters here: the shading normal is computed once, for the final hit.
+    const Vec3Df normal = m_triangles.GetInterpolatedNormal ( iTriangle, u, v );
+
+    //  If the distance t is between the minimum and maximum distances   AND
+    //  If the distance t is smaller than the smallest distance found    AND
+    //  If the triangle is not backfacing the ray.
+    if (
+            ( t >= iNear )
+        &&  ( t <= iFar )
+        &&  ( t < ioMinDist )
+        &&  ( Vec3Df::dotProduct ( normal, iRay.getDirection () ) < 0.0f )
+    ) {
+        ioMinDist = t;
+
+        oHit.t        = t;
+        oHit.u        = u;
+        oHit.v        = v;
+        oHit.triangle = iTriangle;
+
+        return true;
+    }
+
+    return false;
+}
+
+/*!
+ * \inheaderfile
+ */
+bool Accelerator::OccludedByPrimitive (
+    const unsigned int&     iTriangle,
+    const Ray&              iRay,
+    const float&            iNear,
+    const float&            iFar
+) const {
+    float t, u, v;
+    if ( !m_triangles.Intersect ( iTriangle, iRay, iNear, iFar, t, u, v ) ) {
+        return false;
+    }
+
+    // Backfacing triangles are ignored, as in IntersectPrimitive.
+    const Vec3Df normal = m_triangles.GetInterpolatedNormal ( iTriangle, u, v );
+
+    return Vec3Df::dotProduct ( normal, iRay.getDirection () ) < 0.0f;
+}
@@ -0,0 +1,401 @@
+#ifndef _ACCELERATOR_H_
+#define _ACCELERATOR_H_
+
+#include <algorithm>
+#include <vector>
+#include "BoundingBox.h"
+#include "CacheFile.h"
+#include "Object.h"
+#include "Ray.h"
+#include "RayPacket.h"
+#include "TriangleStore.h"
+#include "kd/KdHit.h"
+#include "kd/KdIntersectionData.h"
+
+/*!
+ *  \brief  The acceleration structures available to index the scene's geometry.
+ */
+enum AcceleratorType {
+    ACCELERATOR_KD_TREE         = 0,    //!< A KD-Tree, see kd::KdTree.
+    ACCELERATOR_BVH             = 1,    //!< A bounding volume hierarchy, see bvh::BvhTree.
+    ACCELERATOR_QUANTIZED_BVH   = 2,    //!< A compact bounding volume hierarchy, see bvh::QuantizedBvhTree.
+    ACCELERATOR_LAZY_KD_TREE    = 3     //!< A KD-Tree refined as rays first enter its nodes, see kd::LazyKdTree.
+};
+
+/*!
+ *  \brief  The time spent, in seconds, in each phase of the construction of
+ *          an acceleration structure.
+ */
+struct AcceleratorBuildTimes {
+    double  primitives;     //!< Copying the scene's triangles into the triangle store.
+    double  hierarchy;      //!< Building the hierarchy of nodes over the primitives.
+    double  layout;         //!< Laying the hierarchy out in its final, flat form.
+
+    inline AcceleratorBuildTimes ()
+        :   primitives ( 0.0 ),
+            hierarchy ( 0.0 ),
+            layout ( 0.0 )
+    {}
+};
+
+/*!
+ *  \brief  The interface shared by all structures that speed up ray
+ *          intersection queries against the scene's triangles.
+ *
+ *  All implementations index the triangles of a TriangleStore, built from the
+ *  scene's objects, by their index in the store. They also share the tests of a
+ *  ray against a single triangle, so that all of them report exactly the same
+ *  intersections.
+ */
+class Accelerator {
+protected:
+    TriangleStore           m_triangles;    //!< The triangles indexed by the structure.
+    AcceleratorBuildTimes   m_buildTimes;   //!< The time spent building the structure.
+    CacheReader*            m_cache;        //!< The cache file the structure is mapped from, if any.
+
+    /*!
+     *  \brief  Copies the triangles of a set of objects into the structure's
+     *          triangle store.
+     *
+     *  \param  iObjects    The objects whose triangles should be indexed. They must
+     *                      outlive the structure.
+     */
+    Accelerator (
+        const std::vector< Object >&    iObjects
+    );
+
+    /*!
+     *  \brief  Copies the triangles of a single object, in the object's own space,
+     *          into the structure's triangle store.
+     *
+     *  \param  iObject     The object whose triangles should be indexed. It must
+     *                      outlive the structure.
+     */
+    Accelerator (
+        const Object&                   iObject
+    );
+
+    /*!
+     *  \brief  Maps the triangles of a set of objects from a cache file written
+     *          by Save. Derived structures then map their own data from it.
+     *
+     *  \param  iObjects    The objects the cache file was written from. They must
+     *                      outlive the structure.
+     *  \param  ioCache     The cache file, owned by the structure from now on. It is
+     *                      invalidated if its content doesn't match the objects.
+     */
+    Accelerator (
+        const std::vector< Object >&    iObjects,
+        CacheReader*                    ioCache
+    );
+
+    /*!
+     *  \brief  Creates a structure with an empty triangle store, for structures
+     *          that index other structures instead of triangles.
+     */
+    inline Accelerator ()
+        :   m_cache ( (CacheReader*)0x0 )
+    {}
+
+public:
+    /*!
+     *  \brief  Destroys the structure and all data it contains.
+     */
+    virtual ~Accelerator ();
+
+    /*!
+     *  \return true iff the structure was either built, or entirely mapped
+     *          from a valid cache file.
+     */
+    inline bool IsValid () const
+    {
+        return !m_cache || m_cache->IsValid ();
+    }
+
+    /*!
+     *  \brief  Writes the structure to a cache file, so that it can later be mapped
+     *          in memory instead of being built again.
+     *
+     *  \param  ioWriter    The cache file being written.
+     *  \return true iff the structure supports caching.
+     */
+    inline virtual bool Save (
+        CacheWriter&            /*ioWriter*/
+    ) const {
+        return false;
+    }
+
+    /*!
+     *  \brief  Accesses the time spent in each phase of the structure's construction.
+     *
+     *  \return A constant reference to the build times.
+     */
+    inline const AcceleratorBuildTimes& GetBuildTimes () const
+    {
+        return m_buildTimes;
+    }
+
+    /*!
+     *  \brief  Accesses the triangles indexed by the structure.
+     *
+     *  \return A constant reference to the triangle store.
+     */
+    inline const TriangleStore& GetTriangles () const
+    {
+        return m_triangles;
+    }
+
+    /*!
+     *  \brief  Accesses the region surrounding all data in the structure.
+     *
+     *  \return A constant reference to the bounding box of all primitives.
+     */
+    virtual const BoundingBox& GetRegion () const = 0;
+
+    /*!
+     *  \return The number of bytes used by the structure, its triangles included.
+     */
+    inline virtual std::size_t GetMemoryUsage () const
+    {
+        return m_triangles.GetMemoryUsage ();
+    }
+
+    /*!
+     *  \brief  Updates the structure after objects have been moved with Object::setTrans.
+     *
+     *  Structures that bake the objects' translations into their triangles can't be
+     *  updated and have to be rebuilt.
+     *
+     *  \return true iff the structure was updated, false if it must be rebuilt.
+     */
+    inline virtual bool Refit ()
+    {
+        return false;
+    }
+
+    /*!
+     *  \brief  Searches the closest intersection of a ray with the primitives.
+     *
+     *  Finds the closest hit with IntersectHit, then resolves it with ResolveHit.
+     *
+     *  \param  iRay            The ray to be tested.
+     *  \param  oIntersection   Where to place the intersection descriptor.
+     *  \param  iNear           The minimum distance an intersection can occur (defaults to 0).
+     *  \param  iFar            The maximum distance an intersection can occur (defaults to infinity).
+     *  \return true iff there is an intersection.
+     */
+    bool Intersect (
+        const Ray&                  iRay,
+        kd::KdIntersectionData&     oIntersection,
+        const float&                iNear=-1.0f,
+        const float&                iFar=-1.0f
+    ) const;
+
+    /*!
+     *  \brief  Searches the closest intersection of a ray with the primitives,
+     *          without computing its point nor its normal.
+     *
+     *  \param  iRay            The ray to be tested.
+     *  \param  oHit            Where to place the hit record.
+     *  \param  iNear           The minimum distance an intersection can occur (defaults to 0).
+     *  \param  iFar            The maximum distance an intersection can occur (defaults to infinity).
+     *  \return true iff there is an intersection.
+     */
+    virtual bool IntersectHit (
+        const Ray&                  iRay,
+        kd::KdHit&                  oHit,
+        const float&                iNear=-1.0f,
+        const float&                iFar=-1.0f
+    ) const = 0;
+
+    /*!
+     *  \brief  Builds the intersection descriptor of a hit found by IntersectHit:
+     *          the intersection point and the bumped normal of the surface.
+     *
+     *  \param  iRay            The ray that was tested.
+     *  \param  iHit            The hit record.
+     *  \param  oIntersection   Where to place the intersection descriptor.
+     */
+    virtual void ResolveHit (
+        const Ray&                  iRay,
+        const kd::KdHit&            iHit,
+        kd::KdIntersectionData&     oIntersection
+    ) const;
+
+    /*!
+     *  \brief  Tests whether a ray hits any of the primitives between two distances.
+     *
+     *  Returns on the first intersection found, whichever it is, and builds
+     *  no intersection descriptor.
+     *
+     *  \param  iRay            The ray to be tested.
+     *  \param  iNear           The minimum distance an intersection can occur (defaults to 0).
+     *  \param  iFar            The maximum distance an intersection can occur (defaults to infinity).
+     *  \return true iff there is an intersection.
+     */
+    virtual bool Occluded (
+        const Ray&                  iRay,
+        const float&                iNear=-1.0f,
+        const float&                iFar=-1.0f
+    ) const = 0;
+
+    /*!
+     *  \brief  Searches the closest intersection of every ray of a packet with
+     *          the primitives.
+     *
+     *  Reports the same intersections as Intersect on every ray. This implementation
+     *  traces the rays one at a time; structures with a packet traversal override it.
+     *
+     *  \param  iPacket         The rays to be tested.
+     *  \param  oIntersections  Where to place the intersection descriptor of every ray,
+     *                          an array of at least iPacket.GetCount () descriptors.
+     *  \param  iNear           The minimum distance an intersection can occur (defaults to 0).
+     *  \param  iFar            The maximum distance an intersection can occur (defaults to infinity).
+     *  \return One bit per ray of the packet, set iff the ray hits a primitive.
+     */
+    virtual unsigned int IntersectPacket (
+        const RayPacket&            iPacket,
+        kd::KdIntersectionData*     oIntersections,
+        const float&                iNear=-1.0f,
+        const float&                iFar=-1.0f
+    ) const;
+
+    /*!
+     *  \brief  Searches the closest intersection of every ray of a batch with the
+     *          primitives.
+     *
+     *  Rays are sorted by direction octant, then by the cell of the structure's region
+     *  their origin lies in, so that neighboring rays traverse the same nodes; small
+     *  batches are traced in their own order. The rays are traced in packets with
+     *  IntersectPacket, spread across threads for large batches submitted from outside
+     *  of a parallel region. Results are reported in the order of the batch.
+     *
+     *  \param  iRays           The rays to be tested.
+     *  \param  iCount          The number of rays.
+     *  \param  oIntersections  Where to place the intersection descriptor of every ray
+     *                          hitting a primitive, an array of iCount descriptors.
+     *  \param  oHits           Where to place, for every ray, whether it hits a primitive;
+     *                          an array of chars, so that callers can use std::vector.
+     *  \param  iNear           The minimum distance an intersection can occur (defaults to 0).
+     *  \param  iFar            The maximum distance an intersection can occur (defaults to infinity).
+     */
+    void IntersectBatch (
+        const Ray*                  iRays,
+        const unsigned int&         iCount,
+        kd::KdIntersectionData*     oIntersections,
+        char*                       oHits,
+        const float&                iNear=-1.0f,
+        const float&                iFar=-1.0f
+    ) const;
+
+    /*!
+     *  \brief  Tests whether every ray of a batch hits any of the primitives between
+     *          two distances.
+     *
+     *  Rays are sorted as in IntersectBatch, then tested one at a time with Occluded.
+     *
+     *  \param  iRays           The rays to be tested.
+     *  \param  iCount          The number of rays.
+     *  \param  oOccluded       Where to place, for every ray, whether it hits a primitive.
+     *  \param  iNear           The minimum distance an intersection can occur (defaults to 0).
+     *  \param  iFar            The maximum distance an intersection can occur (defaults to infinity).
+     */
+    void OccludedBatch (
+        const Ray*                  iRays,
+        const unsigned int&         iCount,
+        char*                       oOccluded,
+        const float&                iNear=-1.0f,
+        const float&                iFar=-1.0f
+    ) const;
+
+protected:
+    /*!
+     *  \brief  Sorts the rays of a batch so that neighboring rays take similar paths
+     *          through the structure.
+     *
+     *  \param  iRays           The rays to be sorted.
+     *  \param  iCount          The number of rays.
+     *  \param  oOrder          Where to place the indices of the rays, in traversal order.
+     */
+    void SortBatch (
+        const Ray*                      iRays,
+        const unsigned int&             iCount,
+        std::vector< unsigned int >&    oOrder
+    ) const;
+
+    /*!
+     *  \brief  Clips the segments of all rays of a packet against a bounding box,
+     *          with the same operations as Ray::intersect.
+     *
+     *  \param  iPacket     The rays to be clipped.
+     *  \param  iRegion     The bounding box.
+     *  \param  ioMin       The start of every segment, moved to the entry point.
+     *  \param  ioMax       The end of every segment, moved to the exit point.
+     *  \return One bit per lane, set iff part of the lane's segment lies inside
+     *          the bounding box.
+     */
+    static inline unsigned int ClipPacket (
+        const RayPacket&        iPacket,
+        const BoundingBox&      iRegion,
+        SimdFloat&              ioMin,
+        SimdFloat&              ioMax
+    ) {
+        for ( unsigned int axis = 0; axis < 3; axis++ ) {
+            const SimdFloat& invDir = iPacket.GetInverseDirection ( axis );
+            const SimdFloat& origin = iPacket.GetOrigin ( axis );
+            const SimdFloat  t0     = ( SimdFloat::Broadcast ( iRegion.getMin ()[axis] ) - origin ) * invDir;
+            const SimdFloat  t1     = ( SimdFloat::Broadcast ( iRegion.getMax ()[axis] ) - origin ) * invDir;
+
+            // Rays going backwards enter through the upper slab.
+            const SimdFloat backwards = invDir < SimdFloat::Broadcast ( 0.0f );
+            const SimdFloat tNear     = SimdFloat::Select ( backwards, t1, t0 );
+            const SimdFloat tFar      = SimdFloat::Select ( backwards, t0, t1 );
+
+            ioMin = SimdFloat::Select ( tNear > ioMin, tNear, ioMin );
+            ioMax = SimdFloat::Select ( tFar < ioMax, tFar, ioMax );
+        }
+
+        return ( ( ioMin <= ioMax ) & iPacket.GetActive () ).GetMask ();
+    }
+
+    /*!
+     *  \brief  Tests a ray against a triangle and keeps the intersection if it is
+     *          the closest found so far.
+     *
+     *  Backfacing triangles, according to the interpolated vertex normals, are ignored.
+     *
+     *  \param  iTriangle       The index of the triangle to be tested in the store.
+     *  \param  iRay            The ray to be tested.
+     *  \param  oHit            Where to place the hit record.
+     *  \param  iNear           The minimum distance an intersection can occur.
+     *  \param  iFar            The maximum distance an intersection can occur.
+     *  \param  ioMinDist       The distance of the closest intersection found so far.
+     *  \return true iff a closer intersection was found.
+     */
+    bool IntersectPrimitive (
+        const unsigned int&         iTriangle,
+        const Ray&                  iRay,
+        kd::KdHit&                  oHit,
+        const float&                iNear,
+        const float&                iFar,
+        float&                      ioMinDist
+    ) const;
+
+    /*!
+     *  \brief  Tests whether a ray hits a front-facing triangle between two distances.
+     *
+     *  \param  iTriangle       The index of the triangle to be tested in the store.
+     *  \param  iRay            The ray to be tested.
+     *  \param  iNear           The minimum distance an intersection can occur.
+     *  \param  iFar            The maximum distance an intersection can occur.
+     *  \return true iff there is an intersection.
+     */
+    bool OccludedByPrimitive (
+        const unsigned int&         iTriangle,
+        const Ray&                  iRay,
+        const float&                iNear,
+        const float&                iFar
+    ) const;
+};
+
+#endif // _ACCELERATOR_H_
@@ -0,0 +1,328 @@
+#include "AcceleratorCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <iomanip>
+#include "bvh/BvhTree.h"
+#include "bvh/QuantizedBvhTree.h"
+#include "kd/KdTree.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#include <sys/utime.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <utime.h>
+#endif
+
+namespace {
+
+    const unsigned int CacheMagic       = 0x52414343;   //!< Identifies cache files ("RACC").
+    const unsigned int CacheVersion     = 2;            //!< Changes whenever the layout of a structure changes.
+    const unsigned int CacheByteOrder   = 0x01020304;   //!< Written as is, to detect files from other machines.
+
+    const unsigned long long FnvOffset  = 0xcbf29ce484222325ull;    //!< The initial value of FNV-1a hashes.
+    const unsigned long long FnvPrime   = 0x100000001b3ull;         //!< The multiplier of FNV-1a hashes.
+
+    /*!
+     *  \brief  Adds bytes to a FNV-1a hash.
+     */
+    inline void Hash (
+        unsigned long long&     ioHash,
+        const void*             iData,
+        const unsigned int&     iSize
+    ) {
+        const unsigned char* bytes = static_cast< const unsigned char* > ( iData );
+        for ( unsigned int i = 0; i < iSize; i++ ) {
+            ioHash ^= bytes[i];
+            ioHash *= FnvPrime;
+        }
+    }
+
+    /*!
+     *  \brief  Adds a plain value to a FNV-1a hash.
+     */
+    template< class T >
+    inline void Hash (
+        unsigned long long&     ioHash,
+        const T&                iValue
+    ) {
+        Hash ( ioHash, &iValue, sizeof ( T ) );
+    }
+
+    /*!
+     *  \brief  A file of the cache, as found on disk.
+     */
+    struct CacheEntry {
+        std::string         path;   //!< The path of the file.
+        unsigned long long  size;   //!< The size of the file, in bytes.
+        long long           time;   //!< The last time the file was used.
+    };
+
+    /*!
+     *  \brief  Orders cache files from the least to the most recently used.
+     */
+    struct LessRecentlyUsed {
+        bool operator() (
+            const CacheEntry&   iLeft,
+            const CacheEntry&   iRight
+        ) const {
+            return iLeft.time < iRight.time;
+        }
+    };
+
+    /*!
+     *  \brief  Lists the structure files of a directory.
+     */
+    void ListEntries (
+        const std::string&          iDirectory,
+        std::vector< CacheEntry >&  oEntries
+    ) {
+        oEntries.clear ();
+#ifdef _WIN32
+        _finddata_t data;
+        const intptr_t handle = _findfirst ( ( iDirectory + "/*.accel" ).c_str (), &data );
+        if ( handle == -1 ) {
+            return;
+        }
+        do {
+            CacheEntry entry;
+            entry.path = iDirectory + "/" + data.name;
+            entry.size = data.size;
+            entry.time = data.time_write;
+            oEntries.push_back ( entry );
+        } while ( _findnext ( handle, &data ) == 0 );
+        _findclose ( handle );
+#else
+        DIR* directory = opendir ( iDirectory.c_str () );
+        if ( directory == 0x0 ) {
+            return;
+        }
+        const std::string extension = ".accel";
+        for ( dirent* file = readdir ( directory ); file != 0x0; file = readdir ( directory ) ) {
+            const std::string name = file->d_name;
+            if (
+                    ( name.size () <= extension.size () )
+                ||  ( name.compare ( name.size () - extension.size (), extension.size (), extension ) != 0 )
+            ) {
+                continue;
+            }
+
+            CacheEntry entry;
+            entry.path = iDirectory + "/" + name;
+            struct stat status;
+            if ( stat ( entry.path.c_str (), &status ) != 0 ) {
+                continue;
+            }
+            entry.size = status.st_size;
+            entry.time = status.st_mtime;
+            oEntries.push_back ( entry );
+        }
+        closedir ( directory );
+#endif
+    }
+
+    /*!
+     *  \brief  Marks a file as used now.
+     */
+    inline void Touch (
+        const std::string&  iPath
+    ) {
+#ifdef _WIN32
+        _utime ( iPath.c_str (), 0x0 );
+#else
+        utime ( iPath.c_str (), 0x0 );
+#endif
+    }
+
+}
+
+/*!
+ * \inheaderfile
+ */
+AcceleratorCache::AcceleratorCache (
+    const std::string&          iDirectory,
+    const unsigned long long&   iMaxSize
+)   :   m_directory ( iDirectory ),
+        m_maxSize ( iMaxSize )
+{}
+
+/*!
+ * \inheaderfile
+ */
+std::string AcceleratorCache::GetPath (
+    const unsigned long long&   iKey
+) const {
+    std::ostringstream path;
+    path << m_directory << "/" << std::hex << std::setw ( 16 ) << std::setfill ( '0' ) << iKey << ".accel";
+    return path.str ();
+}
+
+/*!
+ * \inheaderfile
+ */
+void AcceleratorCache::Trim (
+    const std::string&          iKeep
+) const {
+    std::vector< CacheEntry > entries;
+    ListEntries ( m_directory, entries );
+
+    unsigned long long size = 0;
+    for ( unsigned int i = 0; i < entries.size (); i++ ) {
+        size += entries[i].size;
+    }
+
+    std::sort ( entries.begin (), entries.end (), LessRecentlyUsed () );
+    for ( unsigned int i = 0; ( i < entries.size () ) && ( size > m_maxSize ); i++ ) {
+        if ( ( entries[i].path != iKeep ) && ( std::remove ( entries[i].path.c_str () ) == 0 ) ) {
+            size -= entries[i].size;
+        }
+    }
+}
+
+/*!
+ * \inheaderfile
+ */
+unsigned long long AcceleratorCache::GetKey (
+    const std::vector< Object >&    iObjects,
+    const AcceleratorType&          iType,
+    const int&                      iBuildMode
+) {
+    unsigned long long key = FnvOffset;
+
+    Hash ( key, CacheVersion );
+    Hash ( key, (int) iType );
+
+    // The build mode only matters to KD-Trees.
+    Hash ( key, ( iType == ACCELERATOR_KD_TREE ) ? iBuildMode : 0 );
+
+    Hash ( key, (unsigned int) iObjects.size () );
+    for ( unsigned int obj = 0; obj < iObjects.size (); obj++ ) {
+        const Mesh& mesh = iObjects[obj].getMesh ();
+        const std::vector< Vertex >&   vertices  = mesh.getVertices ();
+        const std::vector< Triangle >& triangles = mesh.getTriangles ();
+
+        Hash ( key, (unsigned int) vertices.size () );
+        for ( unsigned int i = 0; i < vertices.size (); i++ ) {
+            Hash ( key, vertices[i].getPos () );
+        }
+
+        Hash ( key, (unsigned int) triangles.size () );
+        for ( unsigned int i = 0; i < triangles.size (); i++ ) {
+            for ( unsigned int vertex = 0; vertex < 3; vertex++ ) {
+                Hash ( key, triangles[i].getVertex ( vertex ) );
+            }
+        }
+
+        Hash ( key, iObjects[obj].getTrans () );
+    }
+
+    return key;
+}
+
+/*!
+ * \inheaderfile
+ */
+Accelerator* AcceleratorCache::Load (
+    const std::vector< Object >&    iObjects,
+    const AcceleratorType&          iType,
+    const int&                      iBuildMode
+) const {
+    const unsigned long long key = GetKey ( iObjects, iType, iBuildMode );
+    const std::string path = GetPath ( key );
+
+    CacheReader* reader = new CacheReader ( path );
+
+    // Checks the header before mapping anything.
+    unsigned int magic = 0, version = 0, byteOrder = 0, type = 0;
+    unsigned long long fileKey = 0;
+    reader->Read ( magic );
+    reader->Read ( version );
+    reader->Read ( byteOrder );
+    reader->Read ( fileKey );
+    reader->Read ( type );
+    if (
+            !reader->IsValid ()
+        ||  ( magic != CacheMagic )
+        ||  ( version != CacheVersion )
+        ||  ( byteOrder != CacheByteOrder )
+        ||  ( fileKey != key )
+        ||  ( type != (unsigned int) iType )
+    ) {
+        delete reader;
+        return (Accelerator*)0x0;
+    }
+
+    // The structure owns the reader from now on.
+    Accelerator* accelerator = (Accelerator*)0x0;
+    if ( iType == ACCELERATOR_BVH ) {
+        accelerator = new bvh::BvhTree ( iObjects, reader );
+    } else if ( iType == ACCELERATOR_QUANTIZED_BVH ) {
+        accelerator = new bvh::QuantizedBvhTree ( iObjects, reader );
+    } else {
+        accelerator = new kd::KdTree ( iObjects, reader );
+    }
+
+    if ( !accelerator->IsValid () ) {
+        delete accelerator;
+        return (Accelerator*)0x0;
+    }
+
+    // Keeps the file from being trimmed.
+    Touch ( path );
+
+    return accelerator;
+}
+
+/*!
+ * \inheaderfile
+ */
+bool AcceleratorCache::Store (
+    const Accelerator&              iAccelerator,
+    const std::vector< Object >&    iObjects,
+    const AcceleratorType&          iType,
+    const int&                      iBuildMode
+) const {
+#ifdef _WIN32
+    _mkdir ( m_directory.c_str () );
+#else
+    mkdir ( m_directory.c_str (), 0755 );
+#endif
+
+    const unsigned long long key = GetKey ( iObjects, iType, iBuildMode );
+    const std::string path = GetPath ( key );
+
+    // The file is written aside, then renamed: a reader never
+    // sees it partially written.
+    const std::string temporaryPath = path + ".tmp";
+    bool written = false;
+    {
+        CacheWriter writer ( temporaryPath );
+        writer.Write ( CacheMagic );
+        writer.Write ( CacheVersion );
+        writer.Write ( CacheByteOrder );
+        writer.Write ( key );
+        writer.Write ( (unsigned int) iType );
+
+        written = iAccelerator.Save ( writer ) && writer.IsValid ();
+    }
+
+    if ( !written ) {
+        std::remove ( temporaryPath.c_str () );
+        return false;
+    }
+
+    // Windows doesn't replace existing files on rename.
+    std::remove ( path.c_str () );
+    if ( std::rename ( temporaryPath.c_str (), path.c_str () ) != 0 ) {
+        std::remove ( temporaryPath.c_str () );
+        return false;
+    }
+
+    Trim ( path );
+
+    return true;
+}
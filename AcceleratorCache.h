@@ -0,0 +1,104 @@
+#ifndef _ACCELERATORCACHE_H_
+#define _ACCELERATORCACHE_H_
+
+#include <string>
+#include <vector>
+#include "Accelerator.h"
+#include "Object.h"
+
+/*!
+ *  \brief  Keeps built acceleration structures on disk, so that a scene opened
+ *          again maps its structure in memory instead of building it.
+ *
+ *  Every file holds a single structure and is named after a hash of everything
+ *  the structure depends on: the format version, the type of structure, its build
+ *  mode, and the vertices, triangles and translation of every object. Any change
+ *  to the scene thus leads to a different file, and stale files are never read.
+ *  Files are written in the machine's own layout and are checked for it on load.
+ *
+ *  Since stale files are never read, they would pile up: whenever a structure is
+ *  stored, the least recently used files are removed until the directory fits
+ *  within a size limit. Mapping a file marks it as used.
+ */
+class AcceleratorCache {
+private:
+    std::string         m_directory;    //!< The directory holding the cache files.
+    unsigned long long  m_maxSize;      //!< The size the cache files may take up, in bytes.
+
+    /*!
+     *  \brief  Builds the path of the cache file of a structure.
+     */
+    std::string GetPath (
+        const unsigned long long&   iKey
+    ) const;
+
+    /*!
+     *  \brief  Removes the least recently used files until the cache fits
+     *          within its size limit.
+     *
+     *  \param  iKeep   A file that is never removed.
+     */
+    void Trim (
+        const std::string&          iKeep
+    ) const;
+
+public:
+    /*!
+     *  \brief  Creates a cache stored in a directory, which is created on demand.
+     *
+     *  \param  iDirectory  The directory holding the cache files.
+     *  \param  iMaxSize    The size the cache files may take up, in bytes. A
+     *                      single structure larger than that is still kept.
+     */
+    AcceleratorCache (
+        const std::string&          iDirectory="cache",
+        const unsigned long long&   iMaxSize=1ull << 30
+    );
+
+    /*!
+     *  \brief  Hashes everything a structure depends on.
+     *
+     *  \param  iObjects    The objects indexed by the structure.
+     *  \param  iType       The type of structure.
+     *  \param  iBuildMode  The build mode of the structure.
+     *  \return The key of the structure in the cache.
+     */
+    static unsigned long long GetKey (
+        const std::vector< Object >&    iObjects,
+        const AcceleratorType&          iType,
+        const int&                      iBuildMode
+    );
+
+    /*!
+     *  \brief  Maps a structure from the cache.
+     *
+     *  \param  iObjects    The objects indexed by the structure. They must outlive it.
+     *  \param  iType       The type of structure.
+     *  \param  iBuildMode  The build mode of the structure.
+     *  \return A new structure, owned by the caller, or 0 if the cache holds no
+     *          valid file for it.
+     */
+    Accelerator* Load (
+        const std::vector< Object >&    iObjects,
+        const AcceleratorType&          iType,
+        const int&                      iBuildMode
+    ) const;
+
+    /*!
+     *  \brief  Writes a structure to the cache.
+     *
+     *  \param  iAccelerator    The structure to be written.
+     *  \param  iObjects        The objects indexed by the structure.
+     *  \param  iType           The type of structure.
+     *  \param  iBuildMode      The build mode of the structure.
+     *  \return true iff the structure was written.
+     */
+    bool Store (
+        const Accelerator&              iAccelerator,
+        const std::vector< Object >&    iObjects,
+        const AcceleratorType&          iType,
+        const int&                      iBuildMode
+    ) const;
+};
+
+#endif // _ACCELERATORCACHE_H_
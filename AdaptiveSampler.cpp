@@ -0,0 +1,178 @@
+#include "AdaptiveSampler.h"
+
+#include <algorithm>
+
+namespace {
+
+    /*!
+     *  \brief  Mirrors the digits of an index in some base around the radix point,
+     *          giving the element of that index of the van der Corput sequence.
+     */
+    inline float RadicalInverse (
+        unsigned int            iIndex,
+        const unsigned int&     iBase
+    ) {
+        const float inverseBase = 1.0f / iBase;
+        float scale  = inverseBase;
+        float result = 0.0f;
+        while ( iIndex > 0 ) {
+            result += ( iIndex % iBase ) * scale;
+            iIndex /= iBase;
+            scale  *= inverseBase;
+        }
+        return result;
+    }
+
+    /*!
+     *  \brief  Orders tiles from the noisiest to the least noisy.
+     */
+    struct NoisierFirst {
+        const std::vector< float >& errors;
+
+        inline bool operator() (
+            const unsigned int& iA,
+            const unsigned int& iB
+        ) const {
+            return errors[iA] > errors[iB];
+        }
+    };
+
+    /*!
+     *  \return The number of pixels of a tile.
+     */
+    inline unsigned int GetPixelCount (
+        const RenderTile&       iTile
+    ) {
+        return ( iTile.x1 - iTile.x0 ) * ( iTile.y1 - iTile.y0 );
+    }
+
+}
+
+/*!
+ * \inheaderfile
+ */
+AdaptiveSampler::AdaptiveSampler (
+    const unsigned int&     iWidth,
+    const unsigned int&     iHeight,
+    const unsigned int&     iGridSize,
+    const unsigned int&     iMeanSamples,
+    const bool&             iAdaptive
+)   :   m_tiles ( TileScheduler::CutImage ( iWidth, iHeight ) ),
+        m_errors ( m_tiles.size (), 0.0f ),
+        m_active ( m_tiles.size () ),
+        m_budget ( std::size_t ( iWidth ) * iHeight * iMeanSamples ),
+        m_used ( 0u ),
+        m_gridSize ( std::max ( iGridSize, 1u ) ),
+        m_minPasses ( iMeanSamples ),
+        m_maxPasses ( iMeanSamples ),
+        m_pass ( 0u ),
+        m_adaptive ( iAdaptive )
+{
+    for ( unsigned int i = 0; i < m_active.size (); i++ ) {
+        m_active[i] = i;
+    }
+
+    // Converged tiles leave room for more samples on the others.
+    if ( m_adaptive ) {
+        m_minPasses = std::min ( iMeanSamples, AdaptiveMinSamples );
+        m_maxPasses = AdaptiveMaxSampleFactor * iMeanSamples;
+    }
+}
+
+/*!
+ * \inheaderfile
+ */
+float AdaptiveSampler::GetTileError (
+    const FrameBuffer&      iFrameBuffer,
+    const RenderTile&       iTile
+) {
+    float error = 0.0f;
+    for ( unsigned int y = iTile.y0; y < iTile.y1; y++ ) {
+        for ( unsigned int x = iTile.x0; x < iTile.x1; x++ ) {
+            const float tolerance = AdaptiveAbsoluteTolerance
+                                  + AdaptiveRelativeTolerance * iFrameBuffer.GetLuminance ( x, y );
+            error = std::max ( error, iFrameBuffer.GetError ( x, y ) / tolerance );
+        }
+    }
+    return error;
+}
+
+/*!
+ * \inheaderfile
+ */
+bool AdaptiveSampler::NextPass (
+    const FrameBuffer&          iFrameBuffer,
+    std::vector< RenderTile >&  oTiles
+) {
+    oTiles.clear ();
+    if ( m_pass >= m_maxPasses ) {
+        return false;
+    }
+
+    // Converged tiles are never sampled again.
+    if ( m_adaptive && m_pass >= m_minPasses ) {
+        unsigned int kept = 0;
+        for ( unsigned int i = 0; i < m_active.size (); i++ ) {
+            const unsigned int tile = m_active[i];
+            m_errors[tile] = GetTileError ( iFrameBuffer, m_tiles[tile] );
+            if ( m_errors[tile] > 1.0f ) {
+                m_active[kept++] = tile;
+            }
+        }
+        m_active.resize ( kept );
+    }
+
+    std::size_t pixelCount = 0u;
+    for ( unsigned int i = 0; i < m_active.size (); i++ ) {
+        pixelCount += GetPixelCount ( m_tiles[m_active[i]] );
+    }
+
+    // When the budget runs short, the noisiest tiles get the last samples.
+    std::vector< unsigned int > selection ( m_active );
+    if ( m_used + pixelCount > m_budget ) {
+        NoisierFirst noisierFirst = { m_errors };
+        std::stable_sort ( selection.begin (), selection.end (), noisierFirst );
+
+        std::size_t remaining = m_budget - m_used;
+        unsigned int kept = 0;
+        while ( kept < selection.size () && GetPixelCount ( m_tiles[selection[kept]] ) <= remaining ) {
+            remaining -= GetPixelCount ( m_tiles[selection[kept]] );
+            kept++;
+        }
+        selection.resize ( kept );
+        std::sort ( selection.begin (), selection.end () );
+        pixelCount = m_budget - m_used - remaining;
+    }
+
+    if ( selection.empty () ) {
+        return false;
+    }
+
+    for ( unsigned int i = 0; i < selection.size (); i++ ) {
+        oTiles.push_back ( m_tiles[selection[i]] );
+    }
+    m_used += pixelCount;
+    m_pass++;
+
+    return true;
+}
+
+/*!
+ * \inheaderfile
+ */
+void AdaptiveSampler::GetPixelOffset (
+    const unsigned int&     iPass,
+    float&                  oX,
+    float&                  oY
+) const {
+    if ( m_gridSize == 1u ) {
+        oX = 0.0f;
+        oY = 0.0f;
+    } else if ( m_adaptive ) {
+        oX = RadicalInverse ( iPass, 2u );
+        oY = RadicalInverse ( iPass, 3u );
+    } else {
+        oX = float ( iPass % m_gridSize ) / m_gridSize;
+        oY = float ( iPass / m_gridSize ) / m_gridSize;
+    }
+}
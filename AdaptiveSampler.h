@@ -0,0 +1,126 @@
+#ifndef _ADAPTIVESAMPLER_H_
+#define _ADAPTIVESAMPLER_H_
+
+#include <cstddef>
+#include <vector>
+#include "FrameBuffer.h"
+#include "TileScheduler.h"
+
+const unsigned int  AdaptiveMinSamples          = 4;        //!< The samples every pixel gets before its tile may be found converged.
+const unsigned int  AdaptiveMaxSampleFactor     = 4;        //!< The most samples a pixel can get, as a multiple of the mean budget.
+const float         AdaptiveAbsoluteTolerance   = 1.0f;     //!< The standard error of a converged pixel, in 8-bit levels...
+const float         AdaptiveRelativeTolerance   = 0.02f;    //!< ...plus this fraction of its mean.
+
+/*!
+ *  \brief  Decides which tiles of an image get another sample, pass after pass.
+ *
+ *  In uniform mode, every pass covers the whole image, for a fixed number of passes.
+ *  In adaptive mode, once every pixel has AdaptiveMinSamples samples, tiles whose
+ *  pixels all have a standard error within tolerance (see FrameBuffer::GetError)
+ *  are left out of the following passes, and the samples they save go to the tiles
+ *  still noisy: edges, penumbrae, indirect lighting. The total number of samples is
+ *  bounded by the same budget as uniform sampling; when the remaining budget can't
+ *  cover all noisy tiles, the noisiest ones are sampled first.
+ */
+class AdaptiveSampler {
+private:
+    std::vector< RenderTile >   m_tiles;        //!< All tiles of the image, in Morton order.
+    std::vector< float >        m_errors;       //!< The error of every tile over its tolerance, at the last test.
+    std::vector< unsigned int > m_active;       //!< The tiles still being sampled.
+    std::size_t                 m_budget;       //!< The total number of samples allowed.
+    std::size_t                 m_used;         //!< The number of samples handed out so far.
+    unsigned int                m_gridSize;     //!< The number of sub-pixel positions along each axis, 1 for none.
+    unsigned int                m_minPasses;    //!< The number of passes covering the whole image.
+    unsigned int                m_maxPasses;    //!< The largest number of passes.
+    unsigned int                m_pass;         //!< The number of passes handed out so far.
+    bool                        m_adaptive;     //!< false for uniform sampling.
+
+    /*!
+     *  \brief  Measures the error of a tile's pixels over their tolerance.
+     *
+     *  \param  iFrameBuffer    The samples so far.
+     *  \param  iTile           The tile.
+     *  \return The largest ratio of a pixel's standard error to its tolerance.
+     */
+    static float GetTileError (
+        const FrameBuffer&      iFrameBuffer,
+        const RenderTile&       iTile
+    );
+
+public:
+    /*!
+     *  \brief  Plans the sampling of an image.
+     *
+     *  \param  iWidth          The width of the image, in pixels.
+     *  \param  iHeight         The height of the image, in pixels.
+     *  \param  iGridSize       The number of sub-pixel positions along each axis of a
+     *                          pixel (the anti-aliasing factor), 1 to always sample
+     *                          the same position.
+     *  \param  iMeanSamples    The number of samples per pixel of uniform sampling,
+     *                          and the mean number per pixel of adaptive sampling.
+     *  \param  iAdaptive       true to stop sampling converged tiles.
+     */
+    AdaptiveSampler (
+        const unsigned int&     iWidth,
+        const unsigned int&     iHeight,
+        const unsigned int&     iGridSize,
+        const unsigned int&     iMeanSamples,
+        const bool&             iAdaptive
+    );
+
+    /*!
+     *  \brief  Chooses the tiles of the next pass.
+     *
+     *  \param  iFrameBuffer    The samples of the previous passes.
+     *  \param  oTiles          Where to place the tiles to be sampled once more,
+     *                          in Morton order.
+     *  \return false once sampling is over.
+     */
+    bool NextPass (
+        const FrameBuffer&          iFrameBuffer,
+        std::vector< RenderTile >&  oTiles
+    );
+
+    /*!
+     *  \brief  Calculates where, inside its pixels, a pass samples.
+     *
+     *  Uniform sampling goes through a regular grid of sub-pixel positions; adaptive
+     *  sampling, which may take more samples than the grid has positions, follows the
+     *  Halton sequence in bases 2 and 3.
+     *
+     *  \param  iPass       The index of the pass.
+     *  \param  oX          Where to place the horizontal offset, in [0, 1).
+     *  \param  oY          Where to place the vertical offset, in [0, 1).
+     */
+    void GetPixelOffset (
+        const unsigned int&     iPass,
+        float&                  oX,
+        float&                  oY
+    ) const;
+
+    /*!
+     *  \return The number of passes handed out so far.
+     */
+    inline const unsigned int& GetPassCount () const
+    {
+        return m_pass;
+    }
+
+    /*!
+     *  \return The number of samples handed out so far.
+     */
+    inline const std::size_t& GetSampleCount () const
+    {
+        return m_used;
+    }
+
+    /*!
+     *  \return The total number of samples allowed.
+     */
+    inline const std::size_t& GetBudget () const
+    {
+        return m_budget;
+    }
+};
+
+#endif // _ADAPTIVESAMPLER_H_
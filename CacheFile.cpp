@@ -0,0 +1,152 @@
+#include "CacheFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*!
+ * \inheaderfile
+ */
+CacheWriter::CacheWriter (
+    const std::string&      iPath
+)   :   m_file ( iPath.c_str (), std::ios::out | std::ios::binary | std::ios::trunc ),
+        m_offset ( 0u )
+{}
+
+/*!
+ * \inheaderfile
+ */
+void CacheWriter::WriteBytes (
+    const void*             iData,
+    const unsigned int&     iSize
+) {
+    if ( iSize == 0u ) {
+        return;
+    }
+
+    m_file.write ( static_cast< const char* > ( iData ), iSize );
+    m_offset += iSize;
+}
+
+/*!
+ * \inheaderfile
+ */
+CacheReader::CacheReader (
+    const std::string&      iPath
+)   :   m_data ( (const char*)0x0 ),
+        m_size ( 0u ),
+        m_offset ( 0u ),
+        m_valid ( false ),
+        m_handle ( (void*)0x0 )
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA (
+        iPath.c_str (),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL
+    );
+    if ( file == INVALID_HANDLE_VALUE ) {
+        return;
+    }
+
+    LARGE_INTEGER size;
+    if (
+            !GetFileSizeEx ( file, &size )
+        ||  ( size.QuadPart == 0 )
+        ||  ( size.HighPart != 0 )
+    ) {
+        CloseHandle ( file );
+        return;
+    }
+
+    HANDLE mapping = CreateFileMappingA ( file, NULL, PAGE_READONLY, 0, 0, NULL );
+    CloseHandle ( file );
+    if ( !mapping ) {
+        return;
+    }
+
+    const void* data = MapViewOfFile ( mapping, FILE_MAP_READ, 0, 0, 0 );
+    if ( !data ) {
+        CloseHandle ( mapping );
+        return;
+    }
+
+    m_handle = mapping;
+    m_data   = static_cast< const char* > ( data );
+    m_size   = size.LowPart;
+#else
+    const int file = open ( iPath.c_str (), O_RDONLY );
+    if ( file < 0 ) {
+        return;
+    }
+
+    struct stat status;
+    if (
+            ( fstat ( file, &status ) != 0 )
+        ||  ( status.st_size <= 0 )
+        ||  ( (unsigned long long) status.st_size > 0xFFFFFFFFull )
+    ) {
+        close ( file );
+        return;
+    }
+
+    void* data = mmap ( NULL, status.st_size, PROT_READ, MAP_PRIVATE, file, 0 );
+
+    // The mapping stays valid once the file is closed.
+    close ( file );
+    if ( data == MAP_FAILED ) {
+        return;
+    }
+
+    m_data = static_cast< const char* > ( data );
+    m_size = status.st_size;
+#endif
+
+    m_valid = true;
+}
+
+/*!
+ * \inheaderfile
+ */
+CacheReader::~CacheReader ()
+{
+    if ( !m_data ) {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile ( m_data );
+    CloseHandle ( static_cast< HANDLE > ( m_handle ) );
+#else
+    munmap ( const_cast< char* > ( m_data ), m_size );
+#endif
+}
+
+/*!
+ * \inheaderfile
+ */
+const char* CacheReader::Consume (
+    const unsigned int&     iSize
+) {
+    if (
+            !m_valid
+        ||  ( iSize > m_size - m_offset )
+    ) {
+        m_valid = false;
+        return (const char*)0x0;
+    }
+
+    const char* data = m_data + m_offset;
+    m_offset += iSize;
+
+    return data;
+}
@@ -0,0 +1,237 @@
+#ifndef _CACHEFILE_H_
+#define _CACHEFILE_H_
+
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include "MappedArray.h"
+#include "Vec3D.h"
+
+/*!
+ *  \brief  The alignment, in bytes, of every array stored in a cache file.
+ */
+const unsigned int CacheAlignment = 16;
+
+/*!
+ *  \brief  Writes values and arrays to a binary cache file, in the same layout
+ *          they have in memory.
+ *
+ *  Every array is preceded by its number of values and starts on a multiple of
+ *  CacheAlignment bytes, so that it can be used in place once the file is mapped.
+ *  Files are only meant to be read back on the machine that wrote them.
+ */
+class CacheWriter {
+private:
+    std::ofstream   m_file;     //!< The file being written.
+    unsigned int    m_offset;   //!< The number of bytes written so far.
+
+    /*!
+     *  \brief  Writes raw bytes.
+     */
+    void WriteBytes (
+        const void*             iData,
+        const unsigned int&     iSize
+    );
+
+public:
+    /*!
+     *  \brief  Creates (or truncates) a cache file.
+     *
+     *  \param  iPath       The path of the file.
+     */
+    CacheWriter (
+        const std::string&      iPath
+    );
+
+    /*!
+     *  \return true iff all writes succeeded so far.
+     */
+    inline bool IsValid () const
+    {
+        return m_file.good ();
+    }
+
+    /*!
+     *  \brief  Writes a single plain value.
+     *
+     *  \param  iValue      The value to be written.
+     */
+    template< class T >
+    inline void Write (
+        const T&                iValue
+    ) {
+        static_assert ( std::is_trivially_copyable< T >::value, "only plain values can be cached" );
+        WriteBytes ( &iValue, sizeof ( T ) );
+    }
+
+    /*!
+     *  \brief  Writes a vector, as three floats.
+     *
+     *  \param  iValue      The vector to be written.
+     */
+    inline void Write (
+        const Vec3Df&           iValue
+    ) {
+        const float coordinates[3] = { iValue[0], iValue[1], iValue[2] };
+        Write ( coordinates );
+    }
+
+    /*!
+     *  \brief  Writes an array of plain values, preceded by its size.
+     *
+     *  \param  iArray      The array to be written.
+     */
+    template< class T >
+    void WriteArray (
+        const MappedArray< T >&     iArray
+    ) {
+        static_assert ( std::is_trivially_copyable< T >::value, "only arrays of plain values can be cached" );
+        Write ( iArray.GetSize () );
+
+        // Pads the file up to the alignment of arrays.
+        static const char padding[CacheAlignment] = { 0 };
+        WriteBytes ( padding, ( CacheAlignment - m_offset % CacheAlignment ) % CacheAlignment );
+
+        WriteBytes ( iArray.GetData (), iArray.GetSize () * sizeof ( T ) );
+    }
+
+};
+
+/*!
+ *  \brief  Reads values and arrays from a memory-mapped cache file written by
+ *          a CacheWriter.
+ *
+ *  Arrays are not copied: they refer to the mapped memory, which stays valid until
+ *  the reader is destroyed. Any read past the end of the file makes the reader
+ *  invalid and leaves its output untouched.
+ */
+class CacheReader {
+private:
+    const char*     m_data;     //!< The first byte of the mapped file.
+    unsigned int    m_size;     //!< The size of the file.
+    unsigned int    m_offset;   //!< The number of bytes read so far.
+    bool            m_valid;    //!< Whether all reads succeeded so far.
+    void*           m_handle;   //!< The platform-specific handle of the mapping.
+
+    /*!
+     *  \brief  Reserves a number of bytes for reading.
+     *
+     *  \param  iSize       The number of bytes to be read.
+     *  \return A pointer to the first byte, or 0 if the file is too short.
+     */
+    const char* Consume (
+        const unsigned int&     iSize
+    );
+
+    // Mappings are not copyable.
+    CacheReader ( const CacheReader& );
+    CacheReader& operator= ( const CacheReader& );
+
+public:
+    /*!
+     *  \brief  Maps a cache file in memory, read-only.
+     *
+     *  \param  iPath       The path of the file.
+     */
+    CacheReader (
+        const std::string&      iPath
+    );
+
+    /*!
+     *  \brief  Unmaps the file. Arrays read from it can no longer be used.
+     */
+    ~CacheReader ();
+
+    /*!
+     *  \return true iff the file was mapped and all reads succeeded so far.
+     */
+    inline bool IsValid () const
+    {
+        return m_valid;
+    }
+
+    /*!
+     *  \brief  Marks the file as invalid, when its content doesn't match what
+     *          was expected.
+     */
+    inline void Invalidate ()
+    {
+        m_valid = false;
+    }
+
+    /*!
+     *  \brief  Reads a single plain value.
+     *
+     *  \param  oValue      Where to place the value.
+     *  \return true iff the value was read.
+     */
+    template< class T >
+    inline bool Read (
+        T&                      oValue
+    ) {
+        static_assert ( std::is_trivially_copyable< T >::value, "only plain values can be cached" );
+        const char* data = Consume ( sizeof ( T ) );
+        if ( !data ) {
+            return false;
+        }
+
+        std::memcpy ( &oValue, data, sizeof ( T ) );
+        return true;
+    }
+
+    /*!
+     *  \brief  Reads a vector, written as three floats.
+     *
+     *  \param  oValue      Where to place the vector.
+     *  \return true iff the vector was read.
+     */
+    inline bool Read (
+        Vec3Df&                 oValue
+    ) {
+        float coordinates[3];
+        if ( !Read ( coordinates ) ) {
+            return false;
+        }
+
+        oValue = Vec3Df ( coordinates[0], coordinates[1], coordinates[2] );
+        return true;
+    }
+
+    /*!
+     *  \brief  Reads an array of plain values, which is mapped in place.
+     *
+     *  \param  oArray      Where to map the array.
+     *  \return true iff the array was read.
+     */
+    template< class T >
+    bool ReadArray (
+        MappedArray< T >&       oArray
+    ) {
+        static_assert ( std::is_trivially_copyable< T >::value, "only arrays of plain values can be cached" );
+        unsigned int size = 0;
+        if (
+                !Read ( size )
+            ||  !Consume ( ( CacheAlignment - m_offset % CacheAlignment ) % CacheAlignment )
+        ) {
+            return false;
+        }
+
+        // Guards against sizes overflowing the byte count.
+        if ( size > m_size / sizeof ( T ) ) {
+            m_valid = false;
+            return false;
+        }
+
+        const char* data = Consume ( size * sizeof ( T ) );
+        if ( !data ) {
+            return false;
+        }
+
+        oArray.Map ( reinterpret_cast< const T* > ( data ), size );
+        return true;
+    }
+
+};
+
+#endif // _CACHEFILE_H_
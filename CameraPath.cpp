@@ -0,0 +1,136 @@
+#include "CameraPath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+    /*!
+     *  \brief  Interpolates between p1 and p2 along the Catmull-Rom spline through
+     *          four points, at a parameter in [0, 1].
+     */
+    inline Vec3Df CatmullRom (
+        const Vec3Df&           iP0,
+        const Vec3Df&           iP1,
+        const Vec3Df&           iP2,
+        const Vec3Df&           iP3,
+        const float&            iT
+    ) {
+        const float t2 = iT * iT;
+        const float t3 = t2 * iT;
+        return 0.5f * (
+                2.0f * iP1
+            +   ( iP2 - iP0 ) * iT
+            +   ( 2.0f * iP0 - 5.0f * iP1 + 4.0f * iP2 - iP3 ) * t2
+            +   ( 3.0f * iP1 - iP0 - 3.0f * iP2 + iP3 ) * t3
+        );
+    }
+
+}
+
+/*!
+ * \inheaderfile
+ */
+void CameraPath::Load (
+    const std::string&      iFileName,
+    const float&            iFieldOfView
+) {
+    std::ifstream file ( iFileName.c_str () );
+    if ( !file ) {
+        throw std::runtime_error ( "cannot read the camera path \"" + iFileName + "\"" );
+    }
+
+    m_keys.clear ();
+    std::string line;
+    unsigned int lineNumber = 0;
+    while ( std::getline ( file, line ) ) {
+        lineNumber++;
+        line = line.substr ( 0, line.find ( '#' ) );
+        for ( unsigned int i = 0; i < line.size (); i++ ) {
+            if ( line[i] == ',' ) {
+                line[i] = ' ';
+            }
+        }
+
+        std::istringstream stream ( line );
+        if ( ( stream >> std::ws ).eof () ) {
+            continue;
+        }
+
+        CameraKey key;
+        key.fieldOfView = iFieldOfView;
+        if (
+                !( stream >> key.eye[0] >> key.eye[1] >> key.eye[2] )
+            ||  !( stream >> key.target[0] >> key.target[1] >> key.target[2] )
+            ||  ( !( stream >> std::ws ).eof () && !( stream >> key.fieldOfView ) )
+            ||  !( stream >> std::ws ).eof ()
+        ) {
+            std::ostringstream message;
+            message << "invalid keyframe at line " << lineNumber << " of \"" << iFileName << "\"";
+            throw std::runtime_error ( message.str () );
+        }
+        m_keys.push_back ( key );
+    }
+
+    if ( m_keys.empty () ) {
+        throw std::runtime_error ( "no keyframe in \"" + iFileName + "\"" );
+    }
+}
+
+/*!
+ * \inheaderfile
+ */
+std::vector< CameraKey > CameraPath::Turntable (
+    const CameraKey&        iStart,
+    const Vec3Df&           iUp,
+    const unsigned int&     iFrameCount
+) {
+    Vec3Df axis ( iUp );
+    axis.normalize ();
+
+    // The eye turns about the axis through the target (Rodrigues' rotation).
+    const Vec3Df offset = iStart.eye - iStart.target;
+    const Vec3Df along  = Vec3Df::dotProduct ( offset, axis ) * axis;
+    const Vec3Df across = offset - along;
+    const Vec3Df normal = Vec3Df::crossProduct ( axis, across );
+
+    std::vector< CameraKey > frames ( iFrameCount, iStart );
+    for ( unsigned int frame = 0; frame < iFrameCount; frame++ ) {
+        const float angle = 2.0f * float ( PI ) * frame / iFrameCount;
+        frames[frame].eye = iStart.target + along + std::cos ( angle ) * across + std::sin ( angle ) * normal;
+    }
+    return frames;
+}
+
+/*!
+ * \inheaderfile
+ */
+std::vector< CameraKey > CameraPath::Sample (
+    const unsigned int&     iFrameCount
+) const {
+    if ( m_keys.size () < 2 || iFrameCount == 0 ) {
+        return m_keys;
+    }
+
+    const unsigned int last = m_keys.size () - 1;
+    std::vector< CameraKey > frames ( iFrameCount );
+    for ( unsigned int frame = 0; frame < iFrameCount; frame++ ) {
+        const float time = ( iFrameCount > 1 ) ? float ( last ) * frame / ( iFrameCount - 1 ) : 0.0f;
+        const unsigned int segment = std::min ( (unsigned int) time, last - 1 );
+        const float t = time - segment;
+
+        // The end keyframes stand for their missing neighbors.
+        const CameraKey& k0 = m_keys[( segment > 0 ) ? segment - 1 : 0];
+        const CameraKey& k1 = m_keys[segment];
+        const CameraKey& k2 = m_keys[segment + 1];
+        const CameraKey& k3 = m_keys[std::min ( segment + 2, last )];
+
+        frames[frame].eye         = CatmullRom ( k0.eye, k1.eye, k2.eye, k3.eye, t );
+        frames[frame].target      = CatmullRom ( k0.target, k1.target, k2.target, k3.target, t );
+        frames[frame].fieldOfView = ( 1.0f - t ) * k1.fieldOfView + t * k2.fieldOfView;
+    }
+    return frames;
+}
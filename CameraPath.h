@@ -0,0 +1,77 @@
+#ifndef _CAMERAPATH_H_
+#define _CAMERAPATH_H_
+
+#include <string>
+#include <vector>
+#include "Vec3D.h"
+
+/*!
+ *  \brief  A camera position along a path.
+ */
+struct CameraKey {
+    Vec3Df  eye;            //!< The position of the camera.
+    Vec3Df  target;         //!< The point the camera looks at.
+    float   fieldOfView;    //!< The vertical field of view, in degrees.
+};
+
+/*!
+ *  \brief  A camera path through keyframes, sampled into the frames of an animation.
+ *
+ *  Eyes and targets follow Catmull-Rom splines through the keyframes, so that the
+ *  camera moves smoothly through every one of them; the field of view is
+ *  interpolated linearly. Keyframes are evenly spaced in time.
+ */
+class CameraPath {
+private:
+    std::vector< CameraKey >    m_keys;     //!< The keyframes, in order.
+
+public:
+    /*!
+     *  \brief  Reads keyframes from a file, one per line: the eye and the target as
+     *          comma-separated coordinates, then an optional field of view in
+     *          degrees. "#" starts a comment.
+     *
+     *  \param  iFileName       The file.
+     *  \param  iFieldOfView    The field of view of keyframes without one.
+     *  \throw  std::runtime_error if the file can't be read or a line is invalid.
+     */
+    void Load (
+        const std::string&      iFileName,
+        const float&            iFieldOfView
+    );
+
+    /*!
+     *  \brief  Makes a full turn around the target, about the up direction.
+     *
+     *  \param  iStart      The camera at the first frame.
+     *  \param  iUp         The axis of the turn.
+     *  \param  iFrameCount The number of frames of the turn; the last one stops a
+     *                      step before the first, so that the turn loops.
+     *  \return The camera at every frame.
+     */
+    static std::vector< CameraKey > Turntable (
+        const CameraKey&        iStart,
+        const Vec3Df&           iUp,
+        const unsigned int&     iFrameCount
+    );
+
+    /*!
+     *  \brief  Samples the path evenly, from its first keyframe to its last.
+     *
+     *  \param  iFrameCount The number of frames, 0 for one per keyframe.
+     *  \return The camera at every frame.
+     */
+    std::vector< CameraKey > Sample (
+        const unsigned int&     iFrameCount
+    ) const;
+
+    /*!
+     *  \return The keyframes.
+     */
+    inline const std::vector< CameraKey >& GetKeys () const
+    {
+        return m_keys;
+    }
+};
+
+#endif // _CAMERAPATH_H_
@@ -0,0 +1,569 @@
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <omp.h>
+#include <QImage>
+
+#include "CameraPath.h"
+#include "FrameWriter.h"
+#include "Mesh.h"
+#include "ParameterHandler.h"
+#include "RayTracer.h"
+#include "Scene.h"
+
+/*!
+ *  \file   CliMain.cpp
+ *  \brief  The headless renderer: renders a scene with no window nor OpenGL context,
+ *          and writes the image to disk.
+ *
+ *  Settings are given as "--key value" or "--key=value" arguments, or as "key = value"
+ *  lines of a settings file, "#" starting a comment. They are applied in order, so
+ *  that arguments after "--settings" override the file. Like the GUI, the renderer
+ *  loads its models from the "models" directory of the working directory.
+ *
+ *  Given a camera path or a turntable, it renders a sequence of frames back to back,
+ *  with the scene and its acceleration structure loaded once, and writes every
+ *  frame while the next one renders.
+ */
+
+namespace {
+
+    /*!
+     *  \brief  The settings of a render that are not held by the ParameterHandler.
+     */
+    struct CliSettings {
+        unsigned int    width;          //!< The width of the image, in pixels.
+        unsigned int    height;         //!< The height of the image, in pixels.
+        std::string     output;         //!< The file the image is written to.
+        bool            hasEye;         //!< false to frame the whole scene, as the GUI does.
+        Vec3Df          eye;            //!< The position of the camera.
+        bool            hasTarget;      //!< false to look at the center of the scene.
+        Vec3Df          target;         //!< The point the camera looks at.
+        Vec3Df          up;             //!< The up direction of the camera.
+        float           fieldOfView;    //!< The vertical field of view, in degrees.
+        Vec3Df          background;     //!< The color of rays hitting nothing, from 0 to 255.
+        unsigned int    repeat;         //!< The number of times the image is rendered.
+        std::string     path;           //!< The keyframes of the camera path, empty for none.
+        unsigned int    frameCount;     //!< The number of frames along the path, 0 for one per keyframe.
+        unsigned int    turntable;      //!< The number of frames of a turn around the target, 0 for none.
+        bool            hasMove;        //!< true to move an object along the frames.
+        unsigned int    moveObject;     //!< The index of the object to move.
+        Vec3Df          move;           //!< The displacement of the object from the first frame to the last.
+
+        CliSettings ()
+            :   width ( 640 ),
+                height ( 480 ),
+                output ( "raymini.png" ),
+                hasEye ( false ),
+                eye ( 0.0f, 0.0f, 0.0f ),
+                hasTarget ( false ),
+                target ( 0.0f, 0.0f, 0.0f ),
+                up ( 0.0f, 1.0f, 0.0f ),
+                fieldOfView ( 45.0f ),
+                background ( 0.0f, 0.0f, 0.0f ),
+                repeat ( 1 ),
+                path (),
+                frameCount ( 0 ),
+                turntable ( 0 ),
+                hasMove ( false ),
+                moveObject ( 0 ),
+                move ( 0.0f, 0.0f, 0.0f )
+        {}
+    };
+
+    /*!
+     *  \brief  Prints the accepted settings.
+     */
+    void PrintUsage (
+        std::ostream&           ioStream
+    ) {
+        ioStream
+            << "Usage: raymini-cli [--key value | --key=value]..." << std::endl
+            << std::endl
+            << "Image and camera:" << std::endl
+            << "  --output FILE         image file, its format given by its extension (raymini.png)" << std::endl
+            << "  --size WxH            resolution, in pixels (640x480)" << std::endl
+            << "  --eye X,Y,Z           camera position (frames the whole scene)" << std::endl
+            << "  --target X,Y,Z        point looked at (center of the scene)" << std::endl
+            << "  --up X,Y,Z            up direction (0,1,0)" << std::endl
+            << "  --fov DEGREES         vertical field of view (45)" << std::endl
+            << "  --background R,G,B    background color, from 0 to 255 (0,0,0)" << std::endl
+            << std::endl
+            << "Rendering:" << std::endl
+            << "  --scene N             0 default, 1 spheres, 2 box, 3 BMW (0)" << std::endl
+            << "  --threads N           0 for all cores (0)" << std::endl
+            << "  --accelerator NAME    kd, bvh, qbvh or lazy-kd (kd)" << std::endl
+            << "  --kd-build NAME       midpoint or sah (sah)" << std::endl
+            << "  --instancing BOOL     index objects by instance (0)" << std::endl
+            << "  --ropes BOOL          stackless KD-Tree traversal (0)" << std::endl
+            << "  --cache BOOL          map acceleration structures from the disk cache (1)" << std::endl
+            << "                        ./cache is capped at 1 GB, least recently used first" << std::endl
+            << "  --aa N                anti-aliasing factor, 1 for none (2)" << std::endl
+            << "  --adaptive BOOL       adaptive sampling (0)" << std::endl
+            << "  --path-tracing BOOL   path tracing instead of ray tracing (0)" << std::endl
+            << "  --diffuse-rays N      diffuse rays per path tracing sample (5)" << std::endl
+            << "  --pbgi BOOL           path tracing gathers diffuse bounces from the lit" << std::endl
+            << "                        point cloud instead of the triangles (0)" << std::endl
+            << "  --depth N             maximum ray depth (3)" << std::endl
+            << "  --ao BOOL             ambient occlusion (0)" << std::endl
+            << "  --shadows NAME        none, hard or soft (soft)" << std::endl
+            << "  --light-radius R      radius of extended lights (0.5)" << std::endl
+            << "  --light-samples N     samples of extended lights (20)" << std::endl
+            << "  --filter BOOL         depth of field filter (0)" << std::endl
+            << std::endl
+            << "Sequences:" << std::endl
+            << "  --path FILE           camera keyframes, one \"eye target [fov]\" per line," << std::endl
+            << "                        as in \"0,1,5  0,0,0  45\"" << std::endl
+            << "  --frames N            frames along the path, 0 for one per keyframe (0)" << std::endl
+            << "  --turntable N         N frames of a full turn around the target" << std::endl
+            << "  --move N:X,Y,Z        moves object N by X,Y,Z from the first frame to the last," << std::endl
+            << "                        refitting the acceleration structure at every frame" << std::endl
+            << "                        (a full rebuild unless --instancing is on)" << std::endl
+            << "  Frames are numbered in place of the \"#\" characters of the output name," << std::endl
+            << "  or before its extension if it has none (raymini-0000.png, ...)." << std::endl
+            << std::endl
+            << "Others:" << std::endl
+            << "  --settings FILE       reads \"key = value\" lines, \"#\" starting a comment" << std::endl
+            << "  --repeat N            renders N times and reports the throughput (1)" << std::endl
+            << "  --help                prints this message" << std::endl;
+    }
+
+    /*!
+     *  \brief  Parses a value, throwing if it is not entirely of the expected type.
+     */
+    template< typename T >
+    T Parse (
+        const std::string&      iKey,
+        const std::string&      iValue
+    ) {
+        std::istringstream stream ( iValue );
+        T value;
+        if ( !( stream >> value ) || !( stream >> std::ws ).eof () ) {
+            throw std::runtime_error ( "invalid value \"" + iValue + "\" for " + iKey );
+        }
+        return value;
+    }
+
+    /*!
+     *  \brief  Parses a boolean, as 0/1, true/false, yes/no or on/off.
+     */
+    bool ParseBool (
+        const std::string&      iKey,
+        const std::string&      iValue
+    ) {
+        if ( iValue == "1" || iValue == "true" || iValue == "yes" || iValue == "on" ) {
+            return true;
+        }
+        if ( iValue == "0" || iValue == "false" || iValue == "no" || iValue == "off" ) {
+            return false;
+        }
+        throw std::runtime_error ( "invalid value \"" + iValue + "\" for " + iKey );
+    }
+
+    /*!
+     *  \brief  Parses a vector, as three comma-separated numbers.
+     */
+    Vec3Df ParseVector (
+        const std::string&      iKey,
+        const std::string&      iValue
+    ) {
+        std::string values ( iValue );
+        for ( unsigned int i = 0; i < values.size (); i++ ) {
+            if ( values[i] == ',' ) {
+                values[i] = ' ';
+            }
+        }
+
+        std::istringstream stream ( values );
+        Vec3Df vector;
+        if ( !( stream >> vector[0] >> vector[1] >> vector[2] ) || !( stream >> std::ws ).eof () ) {
+            throw std::runtime_error ( "invalid vector \"" + iValue + "\" for " + iKey );
+        }
+        return vector;
+    }
+
+    /*!
+     *  \brief  Finds the index of a name among those accepted by a setting.
+     */
+    int ParseName (
+        const std::string&      iKey,
+        const std::string&      iValue,
+        const char* const*      iNames,
+        const int&              iNameCount
+    ) {
+        for ( int i = 0; i < iNameCount; i++ ) {
+            if ( iValue == iNames[i] ) {
+                return i;
+            }
+        }
+        throw std::runtime_error ( "invalid value \"" + iValue + "\" for " + iKey );
+    }
+
+    void ReadSettings (
+        const std::string&      iFileName,
+        CliSettings&            ioSettings
+    );
+
+    /*!
+     *  \brief  Names the file of a frame of a sequence, replacing the run of "#" of
+     *          a pattern with the frame number, padded with zeros to its length.
+     *          Patterns without "#" get "-####" before their extension.
+     */
+    std::string GetFrameFileName (
+        const std::string&      iPattern,
+        const unsigned int&     iFrame
+    ) {
+        std::string pattern ( iPattern );
+        if ( pattern.find ( '#' ) == std::string::npos ) {
+            const std::string::size_type slash = pattern.find_last_of ( "/\\" );
+            const std::string::size_type dot   = pattern.find_last_of ( '.' );
+            const bool hasExtension = ( dot != std::string::npos ) && ( slash == std::string::npos || dot > slash );
+            pattern.insert ( hasExtension ? dot : pattern.size (), "-####" );
+        }
+
+        const std::string::size_type first = pattern.find ( '#' );
+        const std::string::size_type last  = pattern.find_first_not_of ( '#', first );
+        const std::string::size_type width = ( ( last == std::string::npos ) ? pattern.size () : last ) - first;
+
+        std::ostringstream number;
+        number.width ( width );
+        number.fill ( '0' );
+        number << iFrame;
+        return pattern.replace ( first, width, number.str () );
+    }
+
+    /*!
+     *  \brief  Calculates the unit vectors of a camera.
+     *
+     *  \throw  std::runtime_error if the eye, the target and the up direction
+     *          are aligned.
+     */
+    void GetCameraBasis (
+        const CameraKey&        iCamera,
+        const Vec3Df&           iUp,
+        Vec3Df&                 oDirection,
+        Vec3Df&                 oRight,
+        Vec3Df&                 oUp
+    ) {
+        oDirection = iCamera.target - iCamera.eye;
+        oRight = Vec3Df::crossProduct ( oDirection, iUp );
+        if ( oDirection.normalize () == 0.0f || oRight.normalize () == 0.0f ) {
+            throw std::runtime_error ( "the eye, the target and the up direction must not be aligned" );
+        }
+        oUp = Vec3Df::crossProduct ( oRight, oDirection );
+    }
+
+    /*!
+     *  \brief  Applies a setting, to the ParameterHandler or to the CLI settings.
+     *
+     *  \param  iKey        The name of the setting, without leading dashes.
+     *  \param  iValue      Its value.
+     *  \param  ioSettings  The CLI settings.
+     */
+    void ApplySetting (
+        const std::string&      iKey,
+        const std::string&      iValue,
+        CliSettings&            ioSettings
+    ) {
+        static const char* const accelerators[] = { "kd", "bvh", "qbvh", "lazy-kd" };
+        static const char* const kdBuildModes[] = { "midpoint", "sah" };
+        static const char* const shadowModes[]  = { "none", "hard", "soft" };
+
+        ParameterHandler* params = ParameterHandler::Instance ();
+
+        if ( iKey == "output" ) {
+            ioSettings.output = iValue;
+        } else if ( iKey == "size" ) {
+            const std::string::size_type x = iValue.find ( 'x' );
+            if ( x == std::string::npos ) {
+                throw std::runtime_error ( "invalid size \"" + iValue + "\", expected WxH" );
+            }
+            ioSettings.width  = Parse< unsigned int > ( iKey, iValue.substr ( 0, x ) );
+            ioSettings.height = Parse< unsigned int > ( iKey, iValue.substr ( x + 1 ) );
+            if ( ioSettings.width == 0 || ioSettings.height == 0 ) {
+                throw std::runtime_error ( "invalid size \"" + iValue + "\"" );
+            }
+        } else if ( iKey == "eye" ) {
+            ioSettings.eye    = ParseVector ( iKey, iValue );
+            ioSettings.hasEye = true;
+        } else if ( iKey == "target" ) {
+            ioSettings.target    = ParseVector ( iKey, iValue );
+            ioSettings.hasTarget = true;
+        } else if ( iKey == "up" ) {
+            ioSettings.up = ParseVector ( iKey, iValue );
+        } else if ( iKey == "fov" ) {
+            ioSettings.fieldOfView = Parse< float > ( iKey, iValue );
+        } else if ( iKey == "background" ) {
+            ioSettings.background = ParseVector ( iKey, iValue );
+        } else if ( iKey == "repeat" ) {
+            ioSettings.repeat = std::max ( Parse< unsigned int > ( iKey, iValue ), 1u );
+        } else if ( iKey == "path" ) {
+            ioSettings.path = iValue;
+        } else if ( iKey == "frames" ) {
+            ioSettings.frameCount = Parse< unsigned int > ( iKey, iValue );
+        } else if ( iKey == "turntable" ) {
+            ioSettings.turntable = Parse< unsigned int > ( iKey, iValue );
+        } else if ( iKey == "move" ) {
+            const std::string::size_type colon = iValue.find ( ':' );
+            if ( colon == std::string::npos ) {
+                throw std::runtime_error ( "invalid value \"" + iValue + "\" for move, expected N:X,Y,Z" );
+            }
+            ioSettings.moveObject = Parse< unsigned int > ( iKey, iValue.substr ( 0, colon ) );
+            ioSettings.move       = ParseVector ( iKey, iValue.substr ( colon + 1 ) );
+            ioSettings.hasMove    = true;
+        } else if ( iKey == "settings" ) {
+            ReadSettings ( iValue, ioSettings );
+        } else if ( iKey == "scene" ) {
+            const int scene = Parse< int > ( iKey, iValue );
+            if ( scene < 0 || scene > 3 ) {
+                throw std::runtime_error ( "invalid scene \"" + iValue + "\"" );
+            }
+            params->SetScene ( scene );
+        } else if ( iKey == "threads" ) {
+            params->SetThreadCount ( Parse< unsigned int > ( iKey, iValue ) );
+        } else if ( iKey == "accelerator" ) {
+            params->SetAccelerator ( ParseName ( iKey, iValue, accelerators, 4 ) );
+        } else if ( iKey == "kd-build" ) {
+            params->SetKdTreeBuildMode ( ParseName ( iKey, iValue, kdBuildModes, 2 ) );
+        } else if ( iKey == "instancing" ) {
+            params->SetInstancing ( ParseBool ( iKey, iValue ) );
+        } else if ( iKey == "ropes" ) {
+            params->SetKdTreeRopes ( ParseBool ( iKey, iValue ) );
+        } else if ( iKey == "cache" ) {
+            params->SetAcceleratorCache ( ParseBool ( iKey, iValue ) );
+        } else if ( iKey == "aa" ) {
+            const unsigned int factor = std::max ( Parse< unsigned int > ( iKey, iValue ), 1u );
+            params->SetAa ( factor > 1 );
+            params->SetAaFactor ( factor );
+        } else if ( iKey == "adaptive" ) {
+            params->SetAdaptiveSampling ( ParseBool ( iKey, iValue ) );
+        } else if ( iKey == "path-tracing" ) {
+            params->SetPathTracing ( ParseBool ( iKey, iValue ) );
+            params->SetRayTracing ( !params->GetPathTracing () );
+        } else if ( iKey == "diffuse-rays" ) {
+            params->SetPathTracingDiffuseRayCount ( std::max ( Parse< unsigned int > ( iKey, iValue ), 1u ) );
+        } else if ( iKey == "pbgi" ) {
+            params->SetPointBasedGi ( ParseBool ( iKey, iValue ) );
+        } else if ( iKey == "depth" ) {
+            params->SetMaxRayDepth ( Parse< unsigned int > ( iKey, iValue ) );
+        } else if ( iKey == "ao" ) {
+            params->SetAo ( ParseBool ( iKey, iValue ) );
+        } else if ( iKey == "shadows" ) {
+            const int mode = ParseName ( iKey, iValue, shadowModes, 3 );
+            params->SetShadows ( mode != 0 );
+            params->SetHardShadows ( mode == 1 );
+            params->SetSoftShadows ( mode == 2 );
+        } else if ( iKey == "light-radius" ) {
+            params->SetLightRadius ( Parse< float > ( iKey, iValue ) );
+        } else if ( iKey == "light-samples" ) {
+            params->SetLightSamples ( Parse< unsigned int > ( iKey, iValue ) );
+        } else if ( iKey == "filter" ) {
+            params->SetFilter ( ParseBool ( iKey, iValue ) );
+        } else {
+            throw std::runtime_error ( "unknown setting \"" + iKey + "\"" );
+        }
+    }
+
+    /*!
+     *  \brief  Applies the "key = value" lines of a settings file.
+     */
+    void ReadSettings (
+        const std::string&      iFileName,
+        CliSettings&            ioSettings
+    ) {
+        std::ifstream file ( iFileName.c_str () );
+        if ( !file ) {
+            throw std::runtime_error ( "cannot read the settings file \"" + iFileName + "\"" );
+        }
+
+        static const char* const blanks = " \t\r";
+        std::string line;
+        while ( std::getline ( file, line ) ) {
+            line = line.substr ( 0, line.find ( '#' ) );
+            const std::string::size_type equal = line.find ( '=' );
+            if ( line.find_first_not_of ( blanks ) == std::string::npos ) {
+                continue;
+            }
+            if ( equal == std::string::npos ) {
+                throw std::runtime_error ( "invalid line \"" + line + "\" in \"" + iFileName + "\"" );
+            }
+
+            std::string key   = line.substr ( 0, equal );
+            std::string value = line.substr ( equal + 1 );
+            key   = key.substr ( key.find_first_not_of ( blanks ) );
+            key   = key.substr ( 0, key.find_last_not_of ( blanks ) + 1 );
+            value = value.substr ( std::min ( value.find_first_not_of ( blanks ), value.size () ) );
+            value = value.substr ( 0, value.find_last_not_of ( blanks ) + 1 );
+            ApplySetting ( key, value, ioSettings );
+        }
+    }
+
+}
+
+int main (
+    int                     argc,
+    char**                  argv
+) {
+    CliSettings settings;
+
+    try {
+        for ( int i = 1; i < argc; i++ ) {
+            const std::string argument ( argv[i] );
+            if ( argument == "--help" || argument == "-h" ) {
+                PrintUsage ( std::cout );
+                return EXIT_SUCCESS;
+            }
+            if ( argument.compare ( 0, 2, "--" ) != 0 ) {
+                throw std::runtime_error ( "unexpected argument \"" + argument + "\"" );
+            }
+
+            const std::string::size_type equal = argument.find ( '=' );
+            if ( equal != std::string::npos ) {
+                ApplySetting ( argument.substr ( 2, equal - 2 ), argument.substr ( equal + 1 ), settings );
+            } else if ( i + 1 < argc ) {
+                ApplySetting ( argument.substr ( 2 ), argv[++i], settings );
+            } else {
+                throw std::runtime_error ( "missing value for " + argument );
+            }
+        }
+    } catch ( const std::exception& e ) {
+        std::cerr << "raymini-cli: " << e.what () << std::endl << std::endl;
+        PrintUsage ( std::cerr );
+        return EXIT_FAILURE;
+    }
+
+    try {
+        ParameterHandler* params = ParameterHandler::Instance ();
+        Scene* scene = Scene::getInstance ();
+
+        // Builds the acceleration structure apart, so that renders are timed alone.
+        const double buildStart = omp_get_wtime ();
+        scene->buildAccelerator ();
+        params->SetKdTreeBuilt ( true );
+        std::cout << "Acceleration structure ready in "
+                  << ( 1000.0 * ( omp_get_wtime () - buildStart ) ) << "ms" << std::endl;
+
+        // Without an eye, frames the bounding sphere of the scene along -Z, as the
+        // GUI's initial camera does.
+        const BoundingBox& bbox = scene->getBoundingBox ();
+        const float aspectRatio = float ( settings.width ) / settings.height;
+        CameraKey start;
+        start.target      = settings.hasTarget ? settings.target : bbox.getCenter ();
+        start.eye         = settings.eye;
+        start.fieldOfView = settings.fieldOfView;
+        if ( !settings.hasEye ) {
+            const float fieldOfView = settings.fieldOfView * float ( PI ) / 180.0f;
+            const float halfAngle = 0.5f * std::min ( fieldOfView, 2.0f * std::atan ( std::tan ( 0.5f * fieldOfView ) * aspectRatio ) );
+            start.eye = start.target + Vec3Df ( 0.0f, 0.0f, bbox.getRadius () / std::sin ( halfAngle ) );
+        }
+
+        const bool sequence = !settings.path.empty () || settings.turntable > 0;
+        std::vector< CameraKey > cameras;
+        if ( !settings.path.empty () ) {
+            CameraPath path;
+            path.Load ( settings.path, settings.fieldOfView );
+            cameras = path.Sample ( settings.frameCount );
+        } else if ( settings.turntable > 0 ) {
+            cameras = CameraPath::Turntable ( start, settings.up, settings.turntable );
+        } else {
+            cameras.assign ( settings.repeat, start );
+        }
+        const std::string& output = settings.output;
+
+        if ( settings.hasMove && settings.moveObject >= scene->getObjects ().size () ) {
+            std::ostringstream message;
+            message << "no object " << settings.moveObject << " to move, the scene has " << scene->getObjects ().size ();
+            throw std::runtime_error ( message.str () );
+        }
+        const Vec3Df moveStart = settings.hasMove ? scene->getObjects ()[settings.moveObject].getTrans () : Vec3Df ();
+
+        RayTracer* rayTracer = RayTracer::getInstance ();
+        rayTracer->setBackgroundColor ( settings.background );
+
+        // The scene and its acceleration structure stay loaded from frame to frame,
+        // and every frame is written while the next one renders.
+        FrameWriter writer;
+        const double sequenceStart = omp_get_wtime ();
+        QImage image;
+        double totalSeconds = 0.0;
+        std::size_t totalSamples = 0;
+        for ( unsigned int frame = 0; frame < cameras.size (); frame++ ) {
+            Vec3Df direction, right, up;
+            GetCameraBasis ( cameras[frame], settings.up, direction, right, up );
+
+            // Moving an object refits the acceleration structure rather than rebuilding
+            // it, when the structure allows it.
+            double refitSeconds = 0.0;
+            bool refitted = true;
+            if ( settings.hasMove && frame > 0 ) {
+                const float t = float ( frame ) / ( cameras.size () - 1 );
+                const double refitStart = omp_get_wtime ();
+                refitted = scene->moveObject ( settings.moveObject, moveStart + t * settings.move );
+                refitSeconds = omp_get_wtime () - refitStart;
+            }
+
+            const double frameStart = omp_get_wtime ();
+            image = rayTracer->render (
+                cameras[frame].eye,
+                direction,
+                up,
+                right,
+                cameras[frame].fieldOfView * float ( PI ) / 180.0f,
+                aspectRatio,
+                settings.width,
+                settings.height
+            );
+            const double seconds = omp_get_wtime () - frameStart;
+            totalSeconds += seconds;
+            std::cout << rayTracer->getLastStatistics ();
+            totalSamples += rayTracer->getLastSampleCount ();
+
+            std::cout << "Frame " << frame << ": " << ( 1000.0 * seconds ) << "ms, "
+                      << ( rayTracer->getLastSampleCount () / seconds / 1e6 ) << " Msamples/s";
+            if ( settings.hasMove ) {
+                std::cout << ( refitted ? ", refit in " : ", rebuilt in " ) << ( 1000.0 * refitSeconds ) << "ms";
+            }
+            std::cout << std::endl;
+
+            if ( sequence ) {
+                writer.Write ( image, GetFrameFileName ( output, frame ) );
+            }
+        }
+        if ( !sequence ) {
+            writer.Write ( image, output );
+        }
+        const unsigned int failed = writer.Finish ();
+        const double sequenceSeconds = omp_get_wtime () - sequenceStart;
+
+        if ( cameras.size () > 1 ) {
+            std::cout << "Mean over " << cameras.size () << " frames: "
+                      << ( 1000.0 * totalSeconds / cameras.size () ) << "ms, "
+                      << ( totalSamples / totalSeconds / 1e6 ) << " Msamples/s" << std::endl;
+        }
+        if ( sequence ) {
+            std::cout << cameras.size () << " frames in " << sequenceSeconds << "s ("
+                      << ( 3600.0 * cameras.size () / sequenceSeconds ) << " frames/hour)"
+                      << ", " << writer.GetSeconds () << "s of it writing on the side" << std::endl;
+        }
+
+        if ( failed > 0 ) {
+            throw std::runtime_error ( "some images could not be written" );
+        }
+        std::cout << ( sequence ? "Frames written to " : "Image written to " ) << output << std::endl;
+    } catch ( const std::exception& e ) {
+        std::cerr << "raymini-cli: " << e.what () << std::endl;
+        return EXIT_FAILURE;
+    } catch ( const Mesh::Exception& e ) {
+        std::cerr << "raymini-cli: " << e.getMessage () << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    RayTracer::destroyInstance ();
+    Scene::destroyInstance ();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+#include "FrameBuffer.h"
+
+#include <algorithm>
+#include "SimdFloat.h"
+
+/*!
+ * \inheaderfile
+ */
+FrameBuffer::FrameBuffer (
+    const unsigned int&     iWidth,
+    const unsigned int&     iHeight
+)   :   m_width ( iWidth ),
+        m_height ( iHeight ),
+        m_radiance ( 3 * iWidth * iHeight, 0.0f ),
+        m_samples ( iWidth * iHeight, 0u ),
+        m_moments ( 2 * iWidth * iHeight, 0.0f )
+{}
+
+/*!
+ * \inheaderfile
+ */
+void FrameBuffer::Clear ()
+{
+    std::fill ( m_radiance.begin (), m_radiance.end (), 0.0f );
+    std::fill ( m_samples.begin (), m_samples.end (), 0u );
+    std::fill ( m_moments.begin (), m_moments.end (), 0.0f );
+}
+
+/*!
+ * \inheaderfile
+ */
+void FrameBuffer::Resolve (
+    unsigned char*          oPixels,
+    const unsigned int&     iStride
+) const {
+    const unsigned int rowSize = 3 * m_width;
+
+    // The scale of every float of a row, and its tonemapped values.
+    std::vector< float > scales ( rowSize );
+    std::vector< float > values ( rowSize );
+
+    const SimdFloat zero    = SimdFloat::Broadcast ( 0.0f );
+    const SimdFloat highest = SimdFloat::Broadcast ( 255.0f );
+    const SimdFloat half    = SimdFloat::Broadcast ( 0.5f );
+
+    for ( unsigned int y = 0; y < m_height; y++ ) {
+        const float*        radiance = &m_radiance[y * rowSize];
+        const unsigned int* samples  = &m_samples[y * m_width];
+
+        for ( unsigned int x = 0; x < m_width; x++ ) {
+            const float scale = ( samples[x] > 0u ) ? 1.0f / samples[x] : 0.0f;
+            scales[3 * x]     = scale;
+            scales[3 * x + 1] = scale;
+            scales[3 * x + 2] = scale;
+        }
+
+        // Clamps the means, NaNs included, to the displayable range.
+        unsigned int i = 0;
+        for ( ; i + SimdFloat::Width <= rowSize; i += SimdFloat::Width ) {
+            const SimdFloat mean = SimdFloat::Load ( radiance + i ) * SimdFloat::Load ( &scales[i] );
+            ( mean.Max ( zero ).Min ( highest ) + half ).Store ( &values[i] );
+        }
+        for ( ; i < rowSize; i++ ) {
+            const float mean = radiance[i] * scales[i];
+            values[i] = ( ( mean > 0.0f ) ? std::min ( mean, 255.0f ) : 0.0f ) + 0.5f;
+        }
+
+        unsigned char* row = oPixels + y * iStride;
+        for ( i = 0; i < rowSize; i++ ) {
+            row[i] = (unsigned char) values[i];
+        }
+    }
+}
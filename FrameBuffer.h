@@ -0,0 +1,173 @@
+#ifndef _FRAMEBUFFER_H_
+#define _FRAMEBUFFER_H_
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "Vec3D.h"
+
+/*!
+ *  \brief  Accumulates the radiance samples of every pixel of an image in floating
+ *          point, and turns their mean into 8-bit colors once rendering is done.
+ *
+ *  Radiance is summed in a single contiguous RGB array, along with the number of
+ *  samples of every pixel, so that bright samples keep all of their energy until
+ *  they are averaged. Pixels are only ever written by the thread rendering their
+ *  tile, so samples are added without synchronization.
+ *
+ *  The mean and variance of the displayed luminance of every pixel are tracked as
+ *  well, with Welford's update, for adaptive sampling to tell noisy pixels apart.
+ */
+class FrameBuffer {
+private:
+    unsigned int                m_width;        //!< The width of the image, in pixels.
+    unsigned int                m_height;       //!< The height of the image, in pixels.
+    std::vector< float >        m_radiance;     //!< The sum of the samples of every pixel, three floats each, row by row.
+    std::vector< unsigned int > m_samples;      //!< The number of samples of every pixel.
+    std::vector< float >        m_moments;      //!< The mean luminance of every pixel, and the sum of its squared deviations.
+
+public:
+    /*!
+     *  \brief  Creates a buffer with no sample.
+     *
+     *  \param  iWidth      The width of the image, in pixels.
+     *  \param  iHeight     The height of the image, in pixels.
+     */
+    FrameBuffer (
+        const unsigned int&     iWidth,
+        const unsigned int&     iHeight
+    );
+
+    /*!
+     *  \brief  Adds a sample to a pixel.
+     *
+     *  \param  iX          The column of the pixel.
+     *  \param  iY          The row of the pixel.
+     *  \param  iRadiance   The radiance of the sample, 255 being the brightest
+     *                      displayable value. Brighter samples are kept as is.
+     */
+    inline void AddSample (
+        const unsigned int&     iX,
+        const unsigned int&     iY,
+        const Vec3Df&           iRadiance
+    ) {
+        const unsigned int pixel = iY * m_width + iX;
+        float* radiance = &m_radiance[3 * pixel];
+
+        radiance[0] += iRadiance[0];
+        radiance[1] += iRadiance[1];
+        radiance[2] += iRadiance[2];
+        const unsigned int count = ++m_samples[pixel];
+
+        // Only the displayable part of a sample is noise one can see; NaNs count as black.
+        const float luminance = 0.2126f * std::min ( 255.0f, std::max ( 0.0f, iRadiance[0] ) )
+                              + 0.7152f * std::min ( 255.0f, std::max ( 0.0f, iRadiance[1] ) )
+                              + 0.0722f * std::min ( 255.0f, std::max ( 0.0f, iRadiance[2] ) );
+        float* moments = &m_moments[2 * pixel];
+        const float delta = luminance - moments[0];
+        moments[0] += delta / count;
+        moments[1] += delta * ( luminance - moments[0] );
+    }
+
+    /*!
+     *  \return The number of samples of a pixel.
+     */
+    inline const unsigned int& GetSampleCount (
+        const unsigned int&     iX,
+        const unsigned int&     iY
+    ) const {
+        return m_samples[iY * m_width + iX];
+    }
+
+    /*!
+     *  \return The mean of the samples of a pixel, black if it has none.
+     */
+    inline Vec3Df GetMean (
+        const unsigned int&     iX,
+        const unsigned int&     iY
+    ) const {
+        const unsigned int pixel = iY * m_width + iX;
+        if ( m_samples[pixel] == 0u ) {
+            return Vec3Df ( 0.0f, 0.0f, 0.0f );
+        }
+
+        const float* radiance = &m_radiance[3 * pixel];
+        return Vec3Df ( radiance[0], radiance[1], radiance[2] ) / float ( m_samples[pixel] );
+    }
+
+    /*!
+     *  \return The mean displayed luminance of the samples of a pixel, in [0, 255].
+     */
+    inline const float& GetLuminance (
+        const unsigned int&     iX,
+        const unsigned int&     iY
+    ) const {
+        return m_moments[2 * ( iY * m_width + iX )];
+    }
+
+    /*!
+     *  \return The standard error of the mean luminance of a pixel, infinite
+     *          if it has fewer than two samples.
+     */
+    inline float GetError (
+        const unsigned int&     iX,
+        const unsigned int&     iY
+    ) const {
+        const unsigned int pixel = iY * m_width + iX;
+        const unsigned int count = m_samples[pixel];
+        if ( count < 2u ) {
+            return std::numeric_limits< float >::infinity ();
+        }
+
+        return std::sqrt ( m_moments[2 * pixel + 1] / ( float ( count - 1u ) * count ) );
+    }
+
+    /*!
+     *  \return The width of the image, in pixels.
+     */
+    inline const unsigned int& GetWidth () const
+    {
+        return m_width;
+    }
+
+    /*!
+     *  \return The height of the image, in pixels.
+     */
+    inline const unsigned int& GetHeight () const
+    {
+        return m_height;
+    }
+
+    /*!
+     *  \return The number of bytes used by the buffer.
+     */
+    inline std::size_t GetMemoryUsage () const
+    {
+        return m_radiance.size () * sizeof ( float )
+            +  m_samples.size () * sizeof ( unsigned int )
+            +  m_moments.size () * sizeof ( float );
+    }
+
+    /*!
+     *  \brief  Removes all samples.
+     */
+    void Clear ();
+
+    /*!
+     *  \brief  Tonemaps the mean of every pixel and quantizes it to 8-bit RGB.
+     *
+     *  Means are clamped to [0, 255] and rounded, SimdFloat::Width floats at a time.
+     *  Pixels with no sample are black.
+     *
+     *  \param  oPixels     Where to place the first row of 8-bit RGB triplets, as in
+     *                      a QImage of format RGB888.
+     *  \param  iStride     The number of bytes from the start of a row to the next.
+     */
+    void Resolve (
+        unsigned char*          oPixels,
+        const unsigned int&     iStride
+    ) const;
+};
+
+#endif // _FRAMEBUFFER_H_
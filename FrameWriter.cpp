@@ -0,0 +1,102 @@
+#include "FrameWriter.h"
+
+#include <algorithm>
+#include <iostream>
+#include <omp.h>
+
+/*!
+ * \inheaderfile
+ */
+FrameWriter::FrameWriter (
+    const unsigned int&     iMaxPending
+)   :   m_maxPending ( std::max ( iMaxPending, 1u ) ),
+        m_failed ( 0u ),
+        m_seconds ( 0.0 ),
+        m_finished ( false ),
+        m_thread ( &FrameWriter::Run, this )
+{}
+
+/*!
+ * \inheaderfile
+ */
+FrameWriter::~FrameWriter ()
+{
+    Finish ();
+}
+
+/*!
+ * \inheaderfile
+ */
+void FrameWriter::Run ()
+{
+    std::unique_lock< std::mutex > lock ( m_mutex );
+    for ( ;; ) {
+        while ( m_queue.empty () && !m_finished ) {
+            m_changed.wait ( lock );
+        }
+        if ( m_queue.empty () ) {
+            return;
+        }
+
+        // The frame leaves the queue once written, so that Write counts it as pending.
+        const Frame frame = m_queue.front ();
+        lock.unlock ();
+
+        const double start = omp_get_wtime ();
+        const bool saved = frame.first.mirrored ().save ( QString::fromStdString ( frame.second ) );
+        const double seconds = omp_get_wtime () - start;
+        if ( !saved ) {
+            std::cerr << "Cannot write the frame \"" << frame.second << "\"" << std::endl;
+        }
+
+        lock.lock ();
+        m_queue.pop_front ();
+        m_seconds += seconds;
+        if ( !saved ) {
+            m_failed++;
+        }
+        m_changed.notify_all ();
+    }
+}
+
+/*!
+ * \inheaderfile
+ */
+void FrameWriter::Write (
+    const QImage&           iImage,
+    const std::string&      iFileName
+) {
+    std::unique_lock< std::mutex > lock ( m_mutex );
+    while ( m_queue.size () >= m_maxPending ) {
+        m_changed.wait ( lock );
+    }
+    m_queue.push_back ( Frame ( iImage, iFileName ) );
+    m_changed.notify_all ();
+}
+
+/*!
+ * \inheaderfile
+ */
+unsigned int FrameWriter::Finish ()
+{
+    {
+        std::lock_guard< std::mutex > lock ( m_mutex );
+        m_finished = true;
+        m_changed.notify_all ();
+    }
+    if ( m_thread.joinable () ) {
+        m_thread.join ();
+    }
+
+    std::lock_guard< std::mutex > lock ( m_mutex );
+    return m_failed;
+}
+
+/*!
+ * \inheaderfile
+ */
+double FrameWriter::GetSeconds ()
+{
+    std::lock_guard< std::mutex > lock ( m_mutex );
+    return m_seconds;
+}
@@ -0,0 +1,78 @@
+#ifndef _FRAMEWRITER_H_
+#define _FRAMEWRITER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <QImage>
+
+/*!
+ *  \brief  Encodes and writes rendered frames to disk on a thread of its own, so
+ *          that writing a frame overlaps with rendering the next one.
+ *
+ *  Frames wait in a queue of bounded length: when the disk can't keep up, Write
+ *  blocks the renderer rather than letting frames pile up in memory. Images are
+ *  those of RayTracer::render, whose rows run bottom-up; they are flipped upright
+ *  on the writing thread.
+ */
+class FrameWriter {
+private:
+    typedef std::pair< QImage, std::string > Frame;
+
+    std::deque< Frame >         m_queue;        //!< The frames waiting to be written, oldest first.
+    std::mutex                  m_mutex;        //!< Guards the queue and the counters.
+    std::condition_variable     m_changed;      //!< Signals a frame queued or written, or the end.
+    unsigned int                m_maxPending;   //!< The most frames waiting at once.
+    unsigned int                m_failed;       //!< The number of frames that couldn't be written.
+    double                      m_seconds;      //!< The time spent encoding and writing.
+    bool                        m_finished;     //!< true once no frame will be queued anymore.
+    std::thread                 m_thread;       //!< The writing thread.
+
+    /*!
+     *  \brief  Writes frames until the queue is empty and finished.
+     */
+    void Run ();
+
+public:
+    /*!
+     *  \brief  Starts the writing thread.
+     *
+     *  \param  iMaxPending The most frames that may wait to be written at once.
+     */
+    FrameWriter (
+        const unsigned int&     iMaxPending = 2
+    );
+
+    /*!
+     *  \brief  Writes the frames still waiting, then stops the writing thread.
+     */
+    ~FrameWriter ();
+
+    /*!
+     *  \brief  Queues a frame, waiting first if the queue is full.
+     *
+     *  \param  iImage      The frame; QImage shares its pixels, so it isn't copied.
+     *  \param  iFileName   The file to write it to, its format given by its extension.
+     */
+    void Write (
+        const QImage&           iImage,
+        const std::string&      iFileName
+    );
+
+    /*!
+     *  \brief  Waits until all queued frames are written, and stops the thread.
+     *
+     *  \return The number of frames that couldn't be written.
+     */
+    unsigned int Finish ();
+
+    /*!
+     *  \return The time spent encoding and writing frames, in seconds.
+     */
+    double GetSeconds ();
+};
+
+#endif // _FRAMEWRITER_H_
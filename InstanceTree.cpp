@@ -0,0 +1,384 @@
+#include "InstanceTree.h"
+
+#include <algorithm>
+#include <limits>
+#include <omp.h>
+#include "bvh/BvhBuilder.h"
+#include "bvh/BvhTree.h"
+#include "bvh/QuantizedBvhTree.h"
+#include "kd/LazyKdTree.h"
+
+using namespace bvh;
+using namespace kd;
+
+namespace {
+
+    const unsigned int StackSize = BvhMaxDepth + 4;    //!< The maximum number of pending nodes during a traversal.
+
+    /*!
+     *  \brief  Tells whether two meshes hold exactly the same geometry, so that
+     *          they can share a structure.
+     */
+    bool SameMesh (
+        const Mesh&             iFirst,
+        const Mesh&             iSecond
+    ) {
+        const std::vector< Vertex >&   firstVertices    = iFirst.getVertices ();
+        const std::vector< Vertex >&   secondVertices   = iSecond.getVertices ();
+        const std::vector< Triangle >& firstTriangles   = iFirst.getTriangles ();
+        const std::vector< Triangle >& secondTriangles  = iSecond.getTriangles ();
+
+        if (
+                ( firstVertices.size () != secondVertices.size () )
+            ||  ( firstTriangles.size () != secondTriangles.size () )
+        ) {
+            return false;
+        }
+
+        for ( unsigned int i = 0; i < firstTriangles.size (); i++ ) {
+            if ( !( firstTriangles[i] == secondTriangles[i] ) ) {
+                return false;
+            }
+        }
+
+        for ( unsigned int i = 0; i < firstVertices.size (); i++ ) {
+            if (
+                    ( firstVertices[i].getPos () != secondVertices[i].getPos () )
+                ||  ( firstVertices[i].getNormal () != secondVertices[i].getNormal () )
+            ) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+}
+
+/*!
+ * \inheaderfile
+ */
+InstanceTree::InstanceTree (
+    const std::vector< Object >&    iObjects,
+    const AcceleratorType&          iMeshAccelerator,
+    const KdBuildMode&              iKdBuildMode
+) {
+    // The objects whose meshes have a structure.
+    std::vector< const Object* > meshObjects;
+
+    for ( unsigned int obj = 0; obj < iObjects.size (); obj++ ) {
+        const Object& object = iObjects[obj];
+
+        // Objects with no geometry can't be hit.
+        if ( object.getMesh ().getTriangles ().empty () ) {
+            continue;
+        }
+
+        // Looks for an identical mesh that already has a structure.
+        unsigned int tree = 0;
+        while (
+                ( tree < meshObjects.size () )
+            &&  !SameMesh ( meshObjects[tree]->getMesh (), object.getMesh () )
+        ) {
+            tree++;
+        }
+
+        if ( tree == meshObjects.size () ) {
+            Accelerator* meshTree = (Accelerator*)0x0;
+            if ( iMeshAccelerator == ACCELERATOR_BVH ) {
+                meshTree = new BvhTree ( object );
+            } else if ( iMeshAccelerator == ACCELERATOR_QUANTIZED_BVH ) {
+                meshTree = new QuantizedBvhTree ( object );
+            } else if ( iMeshAccelerator == ACCELERATOR_LAZY_KD_TREE ) {
+                meshTree = new LazyKdTree ( object, iKdBuildMode );
+            } else {
+                meshTree = new KdTree ( object, iKdBuildMode );
+            }
+
+            m_meshTrees.push_back ( meshTree );
+            meshObjects.push_back ( &object );
+
+            m_buildTimes.primitives += meshTree->GetBuildTimes ().primitives;
+            m_buildTimes.hierarchy  += meshTree->GetBuildTimes ().hierarchy;
+            m_buildTimes.layout     += meshTree->GetBuildTimes ().layout;
+        }
+
+        m_instances.push_back ( &object );
+        m_instanceTrees.push_back ( tree );
+    }
+
+    double start = omp_get_wtime ();
+
+    // The top-level hierarchy is built over the instances' regions.
+    std::vector< BoundingBox > bounds ( m_instances.size () );
+    for ( unsigned int i = 0; i < bounds.size (); i++ ) {
+        bounds[i] = GetInstanceBounds ( i );
+    }
+
+    BuildBvh (
+        bounds,
+        m_nodes,
+        m_order
+    );
+
+    if ( !m_nodes.empty () ) {
+        m_region = m_nodes[0].GetBounds ();
+    }
+
+    m_buildTimes.hierarchy += omp_get_wtime () - start;
+}
+
+/*!
+ * \inheaderfile
+ */
+InstanceTree::~InstanceTree ()
+{
+    for (
+        unsigned int i = 0;
+        i < m_meshTrees.size ();
+        i++
+    ) {
+        delete m_meshTrees[i];
+        m_meshTrees[i] = (Accelerator*)0x0;
+    }
+}
+
+/*!
+ * \inheaderfile
+ */
+std::size_t InstanceTree::GetMemoryUsage () const
+{
+    std::size_t bytes = m_nodes.size () * sizeof ( BvhNode )
+                      + m_order.size () * sizeof ( unsigned int )
+                      + m_instances.size () * ( sizeof ( const Object* ) + sizeof ( unsigned int ) );
+
+    for ( unsigned int i = 0; i < m_meshTrees.size (); i++ ) {
+        bytes += m_meshTrees[i]->GetMemoryUsage ();
+    }
+
+    return bytes;
+}
+
+/*!
+ * \inheaderfile
+ */
+BoundingBox InstanceTree::GetInstanceBounds (
+    const unsigned int&     iInstance
+) const {
+    const BoundingBox& region = m_meshTrees[m_instanceTrees[iInstance]]->GetRegion ();
+    const Vec3Df& translation = m_instances[iInstance]->getTrans ();
+
+    return BoundingBox (
+        region.getMin () + translation,
+        region.getMax () + translation
+    );
+}
+
+/*!
+ * \inheaderfile
+ */
+bool InstanceTree::Refit ()
+{
+    // Children are stored after their parent: walking the nodes backwards
+    // refits both children of a node before the node itself.
+    for ( unsigned int i = m_nodes.size (); i-- > 0; ) {
+        BvhNode& node = m_nodes[i];
+        BoundingBox bounds;
+
+        if ( node.IsLeaf () ) {
+            const unsigned int offset = node.GetPrimitiveOffset ();
+            const unsigned int count  = node.GetPrimitiveCount ();
+
+            bounds = GetInstanceBounds ( m_order[offset] );
+            for ( unsigned int k = 1; k < count; k++ ) {
+                bounds.extendTo ( GetInstanceBounds ( m_order[offset + k] ) );
+            }
+        } else {
+            bounds = m_nodes[i + 1].GetBounds ();
+            bounds.extendTo ( m_nodes[node.GetSecondChild ()].GetBounds () );
+        }
+
+        node.SetBounds ( bounds );
+    }
+
+    if ( !m_nodes.empty () ) {
+        m_region = m_nodes[0].GetBounds ();
+    }
+
+    return true;
+}
+
+/*!
+ * \inheaderfile
+ */
+bool InstanceTree::IntersectHit (
+    const Ray&              iRay,
+    KdHit&                  oHit,
+    const float&            iNear,
+    const float&            iFar
+) const {
+    if ( m_nodes.empty () ) {
+        return false;
+    }
+
+    // Check for default near and far plane distances.
+    const float nearPlane = ( iNear < 0.0f ) ? EPSILON : iNear;
+    const float farPlane  = ( iFar  < 0.0f ) ? std::numeric_limits<float>::infinity () : iFar;
+
+    const Vec3Df& origin = iRay.getOrigin ();
+
+    // Smallest distance found so far.
+    float minDist = std::numeric_limits<float>::infinity ();
+    bool intersects = false;
+
+    unsigned int stack[StackSize];
+    unsigned int stackSize = 0;
+    stack[stackSize++] = 0u;
+
+    while ( stackSize > 0 ) {
+        const unsigned int index = stack[--stackSize];
+        const BvhNode&     node  = m_nodes[index];
+
+        // Skips nodes the ray only enters past the closest intersection.
+        if ( !node.Intersects ( iRay, nearPlane, std::min ( farPlane, minDist ) ) ) {
+            continue;
+        }
+
+        if ( node.IsLeaf () ) {
+            const unsigned int offset = node.GetPrimitiveOffset ();
+            const unsigned int count  = node.GetPrimitiveCount ();
+
+            for ( unsigned int i = 0; i < count; i++ ) {
+                const unsigned int instance = m_order[offset + i];
+
+                // Translations don't change distances along the ray.
+                const Ray localRay (
+                    origin - m_instances[instance]->getTrans (),
+                    iRay.getDirection ()
+                );
+
+                KdHit localHit;
+                if (
+                        m_meshTrees[m_instanceTrees[instance]]->IntersectHit (
+                            localRay,
+                            localHit,
+                            nearPlane,
+                            std::min ( farPlane, minDist )
+                        )
+                    &&  ( localHit.t < minDist )
+                ) {
+                    minDist = localHit.t;
+                    oHit = localHit;
+                    oHit.instance = instance;
+                    intersects = true;
+                }
+            }
+            continue;
+        }
+
+        // The second child holds the instances further along the axis:
+        // it is visited first when the ray goes backwards on it.
+        if ( iRay.getSign ( node.GetAxis () ) ) {
+            stack[stackSize++] = index + 1;
+            stack[stackSize++] = node.GetSecondChild ();
+        } else {
+            stack[stackSize++] = node.GetSecondChild ();
+            stack[stackSize++] = index + 1;
+        }
+    }
+
+    return intersects;
+}
+
+/*!
+ * \inheaderfile
+ */
+void InstanceTree::ResolveHit (
+    const Ray&              iRay,
+    const KdHit&            iHit,
+    KdIntersectionData&     oIntersection
+) const {
+    const Object*           object          = m_instances[iHit.instance];
+    const TriangleStore&    triangles       = m_meshTrees[m_instanceTrees[iHit.instance]]->GetTriangles ();
+    const unsigned int&     triangleIndex   = triangles.GetTriangleIndex ( iHit.triangle );
+
+    // The mesh structure's store refers to the object it was built from, which
+    // may be another instance of the same mesh with another bump map.
+    oIntersection = KdIntersectionData (
+        object,
+        triangleIndex,
+        object->getBumpedNormal ( triangleIndex, iHit.u, iHit.v ),
+        iRay.getOrigin () + iHit.t * iRay.getDirection (),
+        iHit.t,
+        iHit.u,
+        iHit.v
+    );
+}
+
+/*!
+ * \inheaderfile
+ */
+bool InstanceTree::Occluded (
+    const Ray&              iRay,
+    const float&            iNear,
+    const float&            iFar
+) const {
+    if ( m_nodes.empty () ) {
+        return false;
+    }
+
+    // Check for default near and far plane distances.
+    const float nearPlane = ( iNear < 0.0f ) ? EPSILON : iNear;
+    const float farPlane  = ( iFar  < 0.0f ) ? std::numeric_limits<float>::infinity () : iFar;
+
+    const Vec3Df& origin = iRay.getOrigin ();
+
+    unsigned int stack[StackSize];
+    unsigned int stackSize = 0;
+    stack[stackSize++] = 0u;
+
+    while ( stackSize > 0 ) {
+        const unsigned int index = stack[--stackSize];
+        const BvhNode&     node  = m_nodes[index];
+
+        if ( !node.Intersects ( iRay, nearPlane, farPlane ) ) {
+            continue;
+        }
+
+        if ( node.IsLeaf () ) {
+            const unsigned int offset = node.GetPrimitiveOffset ();
+            const unsigned int count  = node.GetPrimitiveCount ();
+
+            // Any intersection will do.
+            for ( unsigned int i = 0; i < count; i++ ) {
+                const unsigned int instance = m_order[offset + i];
+
+                const Ray localRay (
+                    origin - m_instances[instance]->getTrans (),
+                    iRay.getDirection ()
+                );
+
+                if (
+                    m_meshTrees[m_instanceTrees[instance]]->Occluded (
+                        localRay,
+                        nearPlane,
+                        farPlane
+                    )
+                ) {
+                    return true;
+                }
+            }
+            continue;
+        }
+
+        if ( iRay.getSign ( node.GetAxis () ) ) {
+            stack[stackSize++] = index + 1;
+            stack[stackSize++] = node.GetSecondChild ();
+        } else {
+            stack[stackSize++] = node.GetSecondChild ();
+            stack[stackSize++] = index + 1;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,151 @@
+#ifndef _INSTANCETREE_H_
+#define _INSTANCETREE_H_
+
+#include <vector>
+#include "Accelerator.h"
+#include "BoundingBox.h"
+#include "Object.h"
+#include "Ray.h"
+#include "kd/KdIntersectionData.h"
+#include "kd/KdTree.h"
+#include "bvh/BvhNode.h"
+
+/*!
+ *  \brief  A two-level acceleration structure: one structure per distinct mesh,
+ *          built in the mesh's own space, and a bounding volume hierarchy over
+ *          the objects using them.
+ *
+ *  Objects whose meshes are identical (e.g. several copies of the same sphere) share
+ *  a single bottom-level structure. Rays are moved into an object's space by
+ *  subtracting its translation before being tested against its mesh's structure, and
+ *  intersections are moved back. Since no translation is baked into the triangles,
+ *  moving objects only requires refitting the top-level hierarchy.
+ */
+class InstanceTree
+    :   public Accelerator
+{
+private:
+    BoundingBox                     m_region;           //!< The region surrounding all instances.
+    std::vector< Accelerator* >     m_meshTrees;        //!< The structures of the distinct meshes, which are OWNED.
+    std::vector< const Object* >    m_instances;        //!< The object of every instance.
+    std::vector< unsigned int >     m_instanceTrees;    //!< The index in m_meshTrees of every instance's structure.
+    std::vector< bvh::BvhNode >     m_nodes;            //!< The nodes of the top-level tree, in depth-first order.
+    std::vector< unsigned int >     m_order;            //!< The indices of the instances, in leaf order.
+
+    /*!
+     *  \brief  Calculates the region covered by an instance at its object's
+     *          current position.
+     *
+     *  \param  iInstance   The index of the instance.
+     *  \return The region of the instance's mesh structure, translated.
+     */
+    BoundingBox GetInstanceBounds (
+        const unsigned int&     iInstance
+    ) const;
+
+public:
+    /*!
+     *  \brief  Creates the structures of all distinct meshes and the hierarchy
+     *          of objects using them.
+     *
+     *  \param  iObjects            The objects to be indexed. They must outlive the tree.
+     *  \param  iMeshAccelerator    The kind of structure to build over each mesh.
+     *  \param  iKdBuildMode        The strategy used to split KD-Tree nodes, if meshes use KD-Trees.
+     */
+    InstanceTree (
+        const std::vector< Object >&    iObjects,
+        const AcceleratorType&          iMeshAccelerator,
+        const kd::KdBuildMode&          iKdBuildMode=kd::KD_BUILD_SAH
+    );
+
+    /*!
+     *  \brief  Destroys the tree and the structures of all meshes.
+     */
+    virtual ~InstanceTree ();
+
+    /*!
+     *  \brief  Accesses the region surrounding all data in the tree.
+     *
+     *  \return A constant reference to the bounding box of all instances.
+     */
+    inline virtual const BoundingBox& GetRegion () const
+    {
+        return m_region;
+    }
+
+    /*!
+     *  \return The number of bytes used by the mesh structures and the top-level tree.
+     */
+    virtual std::size_t GetMemoryUsage () const;
+
+    /*!
+     *  \brief  Accesses the number of structures built, one per distinct mesh.
+     *
+     *  \return The number of bottom-level structures.
+     */
+    inline unsigned int GetMeshTreeCount () const
+    {
+        return m_meshTrees.size ();
+    }
+
+    /*!
+     *  \brief  Updates the bounding boxes of the top-level hierarchy to the current
+     *          translation of every object.
+     *
+     *  The hierarchy itself is kept: it degrades as objects move far from where
+     *  they were when it was built, until the tree is rebuilt.
+     *
+     *  \return true, as the tree can always be refitted.
+     */
+    virtual bool Refit ();
+
+    /*!
+     *  \brief  Tests intersection of a ray against the objects contained in the tree.
+     *
+     *  The hit records the instance hit and the triangle in its mesh's structure.
+     *
+     *  \param  iRay            The ray to be tested.
+     *  \param  oHit            Where to place the hit record.
+     *  \param  iNear           The minimum distance an intersection can occur (defaults to 0).
+     *  \param  iFar            The maximum distance an intersection can occur (defaults to infinity).
+     *  \return true iff there is an intersection.
+     */
+    virtual bool IntersectHit (
+        const Ray&                  iRay,
+        kd::KdHit&                  oHit,
+        const float&                iNear=-1.0f,
+        const float&                iFar=-1.0f
+    ) const;
+
+    /*!
+     *  \brief  Builds the intersection descriptor of a hit found by IntersectHit,
+     *          with the bump map of the instance hit.
+     *
+     *  \param  iRay            The ray that was tested, in the scene's space.
+     *  \param  iHit            The hit record.
+     *  \param  oIntersection   Where to place the intersection descriptor.
+     */
+    virtual void ResolveHit (
+        const Ray&                  iRay,
+        const kd::KdHit&            iHit,
+        kd::KdIntersectionData&     oIntersection
+    ) const;
+
+    /*!
+     *  \brief  Tests whether a ray hits any of the objects contained in the tree
+     *          between two distances.
+     *
+     *  \param  iRay            The ray to be tested.
+     *  \param  iNear           The minimum distance an intersection can occur (defaults to 0).
+     *  \param  iFar            The maximum distance an intersection can occur (defaults to infinity).
+     *  \return true iff there is an intersection.
+     */
+    virtual bool Occluded (
+        const Ray&                  iRay,
+        const float&                iNear=-1.0f,
+        const float&                iFar=-1.0f
+    ) const;
+
+};
+
+#endif // _INSTANCETREE_H_
@@ -0,0 +1,169 @@
+#ifndef _MAPPEDARRAY_H_
+#define _MAPPEDARRAY_H_
+
+#include <vector>
+
+/*!
+ *  \brief  An array of plain values that either owns them or refers to values
+ *          stored elsewhere, typically in a memory-mapped file.
+ *
+ *  Acceleration structures keep their flat arrays in this form, so that a structure
+ *  loaded from the cache reads its nodes and triangles straight from the mapped file,
+ *  with no copy. Only arrays that own their values can be resized or modified.
+ */
+template< class T >
+class MappedArray {
+private:
+    std::vector< T >    m_storage;  //!< The values, when owned by the array.
+    const T*            m_data;     //!< The first value, owned or not.
+    unsigned int        m_size;     //!< The number of values.
+
+    /*!
+     *  \brief  Makes the array refer to its own values.
+     */
+    inline void Bind ()
+    {
+        m_data = m_storage.empty () ? (const T*)0x0 : &m_storage[0];
+        m_size = m_storage.size ();
+    }
+
+public:
+    /*!
+     *  \brief  Creates an empty array.
+     */
+    inline MappedArray ()
+        :   m_data ( (const T*)0x0 ),
+            m_size ( 0u )
+    {}
+
+    /*!
+     *  \brief  Copies an array. Values that aren't owned are not copied: both
+     *          arrays refer to the same memory.
+     */
+    inline MappedArray (
+        const MappedArray&      iOther
+    )   :   m_storage ( iOther.m_storage )
+    {
+        if ( iOther.IsMapped () ) {
+            m_data = iOther.m_data;
+            m_size = iOther.m_size;
+        } else {
+            Bind ();
+        }
+    }
+
+    /*!
+     *  \brief  Copies an array. Values that aren't owned are not copied: both
+     *          arrays refer to the same memory.
+     */
+    inline MappedArray& operator= (
+        const MappedArray&      iOther
+    ) {
+        if ( this != &iOther ) {
+            m_storage = iOther.m_storage;
+            if ( iOther.IsMapped () ) {
+                m_data = iOther.m_data;
+                m_size = iOther.m_size;
+            } else {
+                Bind ();
+            }
+        }
+        return *this;
+    }
+
+    /*!
+     *  \brief  Resizes the array, which then owns its values.
+     *
+     *  \param  iSize       The new number of values.
+     */
+    inline void Resize (
+        const unsigned int&     iSize
+    ) {
+        if ( IsMapped () ) {
+            m_storage.assign ( m_data, m_data + m_size );
+        }
+        m_storage.resize ( iSize );
+        Bind ();
+    }
+
+    /*!
+     *  \brief  Takes the values of a vector, which is left empty.
+     *
+     *  \param  ioValues    The values the array should own.
+     */
+    inline void Assign (
+        std::vector< T >&       ioValues
+    ) {
+        m_storage.swap ( ioValues );
+        ioValues.clear ();
+        Bind ();
+    }
+
+    /*!
+     *  \brief  Makes the array refer to values it doesn't own.
+     *
+     *  \param  iData       The first value. It must outlive the array.
+     *  \param  iSize       The number of values.
+     */
+    inline void Map (
+        const T*                iData,
+        const unsigned int&     iSize
+    ) {
+        m_storage.clear ();
+        m_data = iData;
+        m_size = iSize;
+    }
+
+    /*!
+     *  \return true iff the array refers to values it doesn't own.
+     */
+    inline bool IsMapped () const
+    {
+        return ( m_size > 0u ) && m_storage.empty ();
+    }
+
+    /*!
+     *  \return The number of values in the array.
+     */
+    inline unsigned int GetSize () const
+    {
+        return m_size;
+    }
+
+    /*!
+     *  \return true iff the array holds no value.
+     */
+    inline bool IsEmpty () const
+    {
+        return m_size == 0u;
+    }
+
+    /*!
+     *  \return A constant pointer to the first value, or 0 if the array is empty.
+     */
+    inline const T* GetData () const
+    {
+        return m_data;
+    }
+
+    /*!
+     *  \brief  Accessor operator for the values of the array.
+     */
+    inline const T& operator[] (
+        const unsigned int&     iIndex
+    ) const {
+        return m_data[iIndex];
+    }
+
+    /*!
+     *  \brief  Accessor operator for the values of an array that owns them.
+     */
+    inline T& operator[] (
+        const unsigned int&     iIndex
+    ) {
+        return m_storage[iIndex];
+    }
+
+};
+
+#endif // _MAPPEDARRAY_H_
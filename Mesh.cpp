@@ -11,7 +11,9 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#ifndef RAYMINI_HEADLESS
 #include <GL/glew.h>
+#endif
 
 using namespace std;
 
@@ -142,6 +144,7 @@ void Mesh::markBorderEdges (EdgeMapIndex & edgeMap) {
     } 
 }
 
+#ifndef RAYMINI_HEADLESS
 inline void glVertexVec3Df (const Vec3Df & v) {
     glVertex3f (v[0], v[1], v[2]);
 }
@@ -180,6 +183,7 @@ void Mesh::renderGL (bool flat) const {
     }
     glEnd ();
 }
+#endif
 
 void Mesh::loadOFF (const std::string & filename) {
     clear ();
@@ -48,7 +48,9 @@ public:
         Mesh&           oTesselatedMesh
     ) const;
 
-    void renderGL (bool flat) const;
+#ifndef RAYMINI_HEADLESS
+    void renderGL (bool flat) const;    // Headless builds link no OpenGL.
+#endif
     
     void loadOFF (const std::string & filename);
   
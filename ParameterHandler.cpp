@@ -87,6 +87,16 @@ const unsigned int& ParameterHandler::GetPathTracingDiffuseRayCount () const
     return m_pathTracingDiffuseRayCount;
 }
 
+void ParameterHandler::SetPointBasedGi (
+    const bool&             iPointBasedGiFlag
+) {
+    m_pointBasedGi = iPointBasedGiFlag;
+}
+const bool& ParameterHandler::GetPointBasedGi () const
+{
+    return m_pointBasedGi;
+}
+
 void ParameterHandler::SetRayTracing (
     const bool&             iRayTracingFlag
 ) {
@@ -117,6 +127,16 @@ const unsigned short& ParameterHandler::GetAaFactor () const
     return m_antiAliasingFactor;
 }
 
+void ParameterHandler::SetAdaptiveSampling (
+    const bool&              iAdaptiveSamplingFlag
+) {
+    m_adaptiveSampling = iAdaptiveSamplingFlag;
+}
+const bool& ParameterHandler::GetAdaptiveSampling () const
+{
+    return m_adaptiveSampling;
+}
+
 void ParameterHandler::SetShadows (
     const bool&             iShadowsFlag
 ) {
@@ -176,3 +196,57 @@ const bool& ParameterHandler::GetKdTreeBuilt () const
 {
     return m_kdTreeDone;
 }
+
+void ParameterHandler::SetKdTreeBuildMode (
+    const int&              iKdTreeBuildMode
+) {
+    m_kdTreeBuildMode = iKdTreeBuildMode;
+    m_kdTreeDone = false;
+}
+const int& ParameterHandler::GetKdTreeBuildMode () const
+{
+    return m_kdTreeBuildMode;
+}
+
+void ParameterHandler::SetAccelerator (
+    const int&              iAccelerator
+) {
+    m_accelerator = iAccelerator;
+    m_kdTreeDone = false;
+}
+const int& ParameterHandler::GetAccelerator () const
+{
+    return m_accelerator;
+}
+
+void ParameterHandler::SetInstancing (
+    const bool&             iInstancing
+) {
+    m_instancing = iInstancing;
+    m_kdTreeDone = false;
+}
+const bool& ParameterHandler::GetInstancing () const
+{
+    return m_instancing;
+}
+
+void ParameterHandler::SetKdTreeRopes (
+    const bool&             iKdTreeRopes
+) {
+    m_kdTreeRopes = iKdTreeRopes;
+    m_kdTreeDone = false;
+}
+const bool& ParameterHandler::GetKdTreeRopes () const
+{
+    return m_kdTreeRopes;
+}
+
+void ParameterHandler::SetAcceleratorCache (
+    const bool&             iAcceleratorCache
+) {
+    m_acceleratorCache = iAcceleratorCache;
+}
+const bool& ParameterHandler::GetAcceleratorCache () const
+{
+    return m_acceleratorCache;
+}
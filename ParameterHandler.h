@@ -17,9 +17,11 @@ private:
     bool            m_rayTracing;
     unsigned int    m_maxRayDepth;
     unsigned int    m_pathTracingDiffuseRayCount;
+    bool            m_pointBasedGi;
 
     bool            m_antiAliasing;
     unsigned short  m_antiAliasingFactor;
+    bool            m_adaptiveSampling;
 
     bool            m_shadows;
     bool            m_hardShadows;
@@ -28,11 +30,16 @@ private:
     unsigned int    m_lightSamples;
 
     bool            m_kdTreeDone;
+    int             m_kdTreeBuildMode;
+    int             m_accelerator;
+    bool            m_instancing;
+    bool            m_kdTreeRopes;
+    bool            m_acceleratorCache;
 
 private:
     ParameterHandler ()
         :   m_scene(0),
-            m_threadCount(2),
+            m_threadCount(0),
             m_filter(false),
             m_interactiveRender(false),
             m_ambientOcclusion ( false ),
@@ -40,14 +47,21 @@ private:
             m_rayTracing ( true ),
             m_maxRayDepth ( 3 ),
             m_pathTracingDiffuseRayCount ( 5 ),
+            m_pointBasedGi ( false ),
             m_antiAliasing ( true ),
             m_antiAliasingFactor ( 2 ),
+            m_adaptiveSampling ( false ),
             m_shadows ( true ),
             m_hardShadows ( false ),
             m_softShadows ( true ),
             m_lightRadius ( 0.5f ),
             m_lightSamples ( 20u ),
-            m_kdTreeDone ( false )
+            m_kdTreeDone ( false ),
+            m_kdTreeBuildMode ( 1 ),
+            m_accelerator ( 0 ),
+            m_instancing ( false ),
+            m_kdTreeRopes ( false ),
+            m_acceleratorCache ( true )
     {}
     ~ParameterHandler ()
     {}
@@ -101,6 +115,11 @@ public:
     );
     const unsigned int& GetPathTracingDiffuseRayCount () const;
 
+    void SetPointBasedGi (
+        const bool&             iPointBasedGiFlag
+    );
+    const bool& GetPointBasedGi () const;
+
     void SetRayTracing (
         const bool&             iRayTracingFlag
     );
@@ -116,6 +135,11 @@ public:
     );
     const unsigned short &GetAaFactor() const;
 
+    void SetAdaptiveSampling (
+        const bool&             iAdaptiveSamplingFlag
+    );
+    const bool& GetAdaptiveSampling () const;
+
     void SetShadows (
         const bool&             iShadowsFlag
     );
@@ -145,6 +169,31 @@ public:
         const bool&             iKdTreeBuiltFlag
     );
     const bool& GetKdTreeBuilt () const;
+
+    void SetKdTreeBuildMode (
+        const int&              iKdTreeBuildMode
+    );
+    const int& GetKdTreeBuildMode () const;
+
+    void SetAccelerator (
+        const int&              iAccelerator
+    );
+    const int& GetAccelerator () const;
+
+    void SetInstancing (
+        const bool&             iInstancing
+    );
+    const bool& GetInstancing () const;
+
+    void SetKdTreeRopes (
+        const bool&             iKdTreeRopes
+    );
+    const bool& GetKdTreeRopes () const;
+
+    void SetAcceleratorCache (
+        const bool&             iAcceleratorCache
+    );
+    const bool& GetAcceleratorCache () const;
 };
 
 #endif // PARAMETERHANDLER_H
@@ -35,10 +35,13 @@ public:
     ) {
         const RadianceCalculator* rc = RadianceCalculator::Instance ();
         std::vector< Surfel* >& pointCloud = iScene.GetPointCloud ();
+        const int surfelCount = pointCloud.size ();
 
+        // Surfels are lit independently of each other.
+        #pragma omp parallel for schedule(dynamic, 256)
         for (
-            unsigned int surfel = 0;
-            surfel < pointCloud.size ();
+            int surfel = 0;
+            surfel < surfelCount;
             surfel++
         ) {
             const Vec3Df& surfelPos = pointCloud[surfel]->GetPosition ();
@@ -103,6 +106,32 @@ public:
             pointCloud[surfel]->SetColor ( surfelColor );
         }
     }
+
+    /*!
+     *  \brief  Gathers the radiance brought back by a ray from the point cloud,
+     *          lit beforehand by IlluminatePointCloud.
+     *
+     *  \param  iScene  The scene.
+     *  \param  iRay    The ray, typically a diffuse bounce.
+     *  \return The color of the closest surfel hit, black if there is none.
+     */
+    Vec3Df Gather (
+        Scene&      iScene,
+        const Ray&  iRay
+    ) const {
+        const Surfel* surfel = 0x0;
+        Vec3Df point;
+        if (
+            !iScene.IntersectSurfel (
+                iRay,
+                surfel,
+                point
+            )
+        ) {
+            return Vec3Df ( 0.0f, 0.0f, 0.0f );
+        }
+        return surfel->GetColor ();
+    }
 };
 
 #endif // _PBGI_H_
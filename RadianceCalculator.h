@@ -37,31 +37,23 @@ public:
     }
 
     /*!
-     *  \brief  Returns the ambient occlusion value of a point P inside a given scene.
+     *  \brief  Appends the rays cast to compute the ambient occlusion value of a point P,
+     *          so that those of many points can be tested together.
+     *
+     *  The rays are distributed over a hemisphere around the normal of the surface
+     *  containing P, with a cosine distribution.
      *
-     *  Casts N rays distributed over a hemisphere around the normal of the surface containint P
-     *  and counts how many of them hit the surrounding geometry with maximum distance R.
-     *  
      *  \param  iRayCount   Number of samples.
-     *  \param  iRadius     Maximum occluding object's distance.
      *  \param  iNormal     The normal of the surface containing P, on P.
      *  \param  iPoint      The point P.
-     *  \param  iScene      The scene descriptor.
-     *  \return The ratio of rays intersection the surrounding geometry.
+     *  \param  ioRays      The rays, to which the samples are appended.
      */
-    inline float AmbientOcclusion (
-        const int&      iRayCount,
-        const float&    iRadius,
-        const Vec3Df&   iNormal,
-        const Vec3Df&   iPoint,
-        const Scene&    iScene
+    inline void AmbientOcclusionRays (
+        const int&          iRayCount,
+        const Vec3Df&       iNormal,
+        const Vec3Df&       iPoint,
+        std::vector< Ray >& ioRays
     ) const {
-        // The KD-Tree description of the scene.
-        const KdTree& kt = *( iScene.getKdTree () );
-
-        // The number of intersections.
-        int nbIntersection = 0;
-
         // Random uniform number generators for spherical coordinates
         // Radius and Theta of the point on the unit sphere where
         // a ray should be cast.
@@ -105,16 +97,47 @@ public:
                 std::cout << "ERROR: AO Ray Position in wrong direction!!" << std::endl;
             }
 
-            // Intersection descriptor.
-            KdIntersectionData intersectionData;
+            ioRays.push_back ( Ray ( iPoint, refDir ) );
+        }
+    }
+
+    /*!
+     *  \brief  Returns the ambient occlusion value of a point P inside a given scene.
+     *
+     *  Casts N rays distributed over a hemisphere around the normal of the surface containint P
+     *  and counts how many of them hit the surrounding geometry with maximum distance R.
+     *  
+     *  \param  iRayCount   Number of samples.
+     *  \param  iRadius     Maximum occluding object's distance.
+     *  \param  iNormal     The normal of the surface containing P, on P.
+     *  \param  iPoint      The point P.
+     *  \param  iScene      The scene descriptor.
+     *  \return The ratio of rays intersection the surrounding geometry.
+     */
+    inline float AmbientOcclusion (
+        const int&      iRayCount,
+        const float&    iRadius,
+        const Vec3Df&   iNormal,
+        const Vec3Df&   iPoint,
+        const Scene&    iScene
+    ) const {
+        // The acceleration structure indexing the scene.
+        const Accelerator& kt = *( iScene.getAccelerator () );
+
+        std::vector< Ray > rays;
+        AmbientOcclusionRays ( iRayCount, iNormal, iPoint, rays );
+
+        // The number of intersections.
+        int nbIntersection = 0;
+        for (
+            std::vector< Ray >::const_iterator it = rays.begin ();
+            it != rays.end ();
+            it++
+        ) {
             // If the ray intersects the geometry, increase counter.
             if (
-                kt.Intersect (
-                    Ray (
-                        iPoint,
-                        refDir
-                    ),
-                    intersectionData,
+                kt.Occluded (
+                    *it,
                     EPSILON,
                     iRadius
                 )
@@ -221,10 +244,8 @@ public:
         const Vec3Df&       iFromPoint,
         const Vec3Df&       iTargetPoint
     ) const {
-        // The KD-Tree description of the scene.
-        const KdTree* kdTree = iScene.getKdTree ();
-        // Stores the intersection data of the ray cast from P to T.
-        KdIntersectionData intersection;
+        // The acceleration structure indexing the scene.
+        const Accelerator* kdTree = iScene.getAccelerator ();
 
         // The direction of the ray to cast.
         Vec3Df shadowRayDir = iTargetPoint - iFromPoint;
@@ -236,13 +257,13 @@ public:
         // smaller than that of T to P.
         float farPlane  =   shadowRayDir.normalize ();
 
-        // Casts the ray.
-        bool intersects = kdTree->Intersect (
+        // Casts the ray. Any occluder will do, so the closest
+        // one doesn't need to be searched.
+        bool intersects = kdTree->Occluded (
             Ray (
                 iFromPoint,
                 shadowRayDir
             ),
-            intersection,
             nearPlane,
             farPlane
         );
@@ -261,7 +282,7 @@ public:
     inline float PointSetVisibility (
         const Scene&                iScene,
         const Vec3Df&               iPoint,
-        const std::vector< Vec3Df > iPointSet
+        const std::vector< Vec3Df >& iPointSet
     ) const {
         // Counter for the number of points in S that are visible from P.
         unsigned int visible = 0u;
@@ -349,6 +370,49 @@ public:
         return v;
     }
 
+    /*!
+     *  \brief  Appends the shadow rays LightVisibility casts from a point P towards a
+     *          light source, so that those of many points can be tested together.
+     *
+     *  Rays aren't normalized: they reach the light, or the sample of its area, at
+     *  distance 1. No ray is cast unless shadows are enabled.
+     *
+     *  \param  iPoint      The point P.
+     *  \param  iLight      The light source.
+     *  \param  ioRays      The rays, to which the shadow rays are appended.
+     */
+    inline void LightVisibilityRays (
+        const Vec3Df&               iPoint,
+        const Light&                iLight,
+        std::vector< Ray >&         ioRays
+    ) const {
+        const ParameterHandler* params = ParameterHandler::Instance();
+        if ( !params->GetShadows () ) {
+            return;
+        }
+
+        // Extended lights are sampled over their area.
+        std::vector< Vec3Df > lightSamples;
+        if ( params->GetSoftShadows () ) {
+            iLight.getSamples (
+                params->GetLightRadius (),
+                params->GetLightSamples (),
+                Vec3Df ( 0.0f, -1.0f, 0.0f ),
+                lightSamples
+            );
+        } else {
+            lightSamples.push_back ( iLight.getPos () );
+        }
+
+        for (
+            std::vector< Vec3Df >::const_iterator it = lightSamples.begin ();
+            it != lightSamples.end ();
+            it++
+        ) {
+            ioRays.push_back ( Ray ( iPoint, *it - iPoint ) );
+        }
+    }
+
     /*!
      *  \brief  Calculates the direct illumination of a point P contained in a given scene,
      *          from the point of view of an observer O.
@@ -362,6 +426,8 @@ public:
      *  \param  iPoint      The point P.
      *  \param  iNormal     The normal of P's containing surface at P.
      *  \param  iMaterial   The material of the surface containing P.
+     *  \param  iVisibilities   The visibility of every light source of the scene from P,
+     *                          when already known, or NULL to compute it.
      *  \return The total radiance from all direct light sources on P.
      */
     inline Vec3Df DirectLighting (
@@ -369,7 +435,8 @@ public:
         const Vec3Df&   iViewPoint,
         const Vec3Df&   iPoint,
         const Vec3Df&   iNormal,
-        const Material& iMaterial
+        const Material& iMaterial,
+        const float*    iVisibilities = NULL
     ) const {
         // Vector of light sources.
         const std::vector< Light >& sceneLights = iScene.getLights ();
@@ -385,11 +452,13 @@ public:
             light++
         ) {
             // Calculate the light's visibility v.
-            float v = LightVisibility (
-                iScene,
-                iPoint,
-                *light
-            );
+            float v = ( iVisibilities )
+                ? iVisibilities[light - sceneLights.begin ()]
+                : LightVisibility (
+                    iScene,
+                    iPoint,
+                    *light
+                );
 
             // Modulate the Phong contribution by v. 
             color += v * Phong (
@@ -7,60 +7,19 @@
 
 #include "Ray.h"
 #include <stdio.h>
+#include <limits>
 
 using namespace std;
 
-static const unsigned int NUMDIM = 3, RIGHT = 0, LEFT = 1, MIDDLE = 2;
-
 bool Ray::intersect (const BoundingBox & bbox, Vec3Df & intersectionPoint) const {
-    const Vec3Df & minBb = bbox.getMin ();
-    const Vec3Df & maxBb = bbox.getMax ();
-    bool inside = true;
-    unsigned int  quadrant[NUMDIM];
-    register unsigned int i;
-    unsigned int whichPlane;
-    Vec3Df maxT;
-    Vec3Df candidatePlane;
-    
-    for (i=0; i<NUMDIM; i++)
-        if (origin[i] < minBb[i]) {
-            quadrant[i] = LEFT;
-            candidatePlane[i] = minBb[i];
-            inside = false;
-        } else if (origin[i] > maxBb[i]) {
-            quadrant[i] = RIGHT;
-            candidatePlane[i] = maxBb[i];
-            inside = false;
-        } else	{
-            quadrant[i] = MIDDLE;
-        }
-
-    if (inside)	{
-        intersectionPoint = origin;
-        return (true);
-    }
+    float tNear = 0.0f;
+    float tFar = std::numeric_limits<float>::infinity ();
+    if (!intersect (bbox, tNear, tFar))
+        return false;
 
-    for (i = 0; i < NUMDIM; i++)
-        if (quadrant[i] != MIDDLE && direction[i] !=0.)
-            maxT[i] = (candidatePlane[i]-origin[i]) / direction[i];
-        else
-            maxT[i] = -1.;
-
-    whichPlane = 0;
-    for (i = 1; i < NUMDIM; i++)
-        if (maxT[whichPlane] < maxT[i])
-            whichPlane = i;
-
-    if (maxT[whichPlane] < 0.) return (false);
-    for (i = 0; i < NUMDIM; i++)
-        if (whichPlane != i) {
-            intersectionPoint[i] = origin[i] + maxT[whichPlane] *direction[i];
-            if (intersectionPoint[i] < minBb[i] || intersectionPoint[i] > maxBb[i])
-                return (false);
-        } else {
-            intersectionPoint[i] = candidatePlane[i];
-        }
-    return (true);			
+    // Rays starting inside the box hit it at their origin.
+    intersectionPoint = origin + tNear * direction;
+    return true;
 }
 
 bool Ray::intersect (
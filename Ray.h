@@ -22,16 +22,64 @@ class Ray {
 public:
     inline Ray () {}
     inline Ray (const Vec3Df & origin, const Vec3Df & direction)
-        : origin (origin), direction (direction) {}
+        : origin (origin), direction (direction) {
+        // Zero components get an infinite inverse, whose sign
+        // follows the sign of the zero.
+        for (unsigned int axis = 0; axis < 3; axis++) {
+            invDirection[axis] = 1.0f / direction[axis];
+            sign[axis] = (invDirection[axis] < 0.0f) ? 1u : 0u;
+        }
+    }
     inline virtual ~Ray () {}
 
     inline const Vec3Df & getOrigin () const { return origin; }
-    inline Vec3Df & getOrigin () { return origin; }
     inline const Vec3Df & getDirection () const { return direction; }
-    inline Vec3Df & getDirection () { return direction; }
+    inline const Vec3Df & getInvDirection () const { return invDirection; }
+
+    /*!
+     *  \return 1 if the ray goes backwards along an axis, 0 otherwise.
+     */
+    inline unsigned int getSign (unsigned int axis) const { return sign[axis]; }
 
     bool intersect (const BoundingBox & bbox, Vec3Df & intersectionPoint) const;
 
+    /*!
+     *  \brief  Clips a segment of the ray against an axis-aligned box, using the
+     *          slab method without divisions nor branches.
+     *
+     *  \param  iMin        The lower corner of the box.
+     *  \param  iMax        The upper corner of the box.
+     *  \param  ioNear      The start of the segment, moved to the entry point.
+     *  \param  ioFar       The end of the segment, moved to the exit point.
+     *  \return true iff part of the segment lies inside the box.
+     */
+    inline bool intersect (
+        const float*    iMin,
+        const float*    iMax,
+        float&          ioNear,
+        float&          ioFar
+    ) const {
+        for (unsigned int axis = 0; axis < 3; axis++) {
+            const float tNear = ((sign[axis] ? iMax : iMin)[axis] - origin[axis]) * invDirection[axis];
+            const float tFar  = ((sign[axis] ? iMin : iMax)[axis] - origin[axis]) * invDirection[axis];
+
+            // NaNs (ray on a slab's boundary, parallel to it) fail
+            // both comparisons and leave the segment untouched.
+            ioNear = (tNear > ioNear) ? tNear : ioNear;
+            ioFar  = (tFar < ioFar) ? tFar : ioFar;
+        }
+
+        return ioNear <= ioFar;
+    }
+
+    inline bool intersect (
+        const BoundingBox&  iBox,
+        float&              ioNear,
+        float&              ioFar
+    ) const {
+        return intersect (&iBox.getMin ()[0], &iBox.getMax ()[0], ioNear, ioFar);
+    }
+
     bool intersect (
         const Vertex&   v0,
         const Vertex&   v1,
@@ -49,6 +97,8 @@ public:
 private:
     Vec3Df origin;
     Vec3Df direction;
+    Vec3Df invDirection;
+    unsigned int sign[3];
 };
 
 
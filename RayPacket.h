@@ -0,0 +1,141 @@
+#ifndef _RAYPACKET_H_
+#define _RAYPACKET_H_
+
+#include <cstring>
+#include "Ray.h"
+#include "SimdFloat.h"
+
+/*!
+ *  \brief  A group of rays traced together, one per SIMD lane.
+ *
+ *  The rays' origins and directions are kept per axis, in SIMD form. Packets are
+ *  meant for coherent rays, typically the primary rays of a small tile of pixels,
+ *  which cross mostly the same nodes of an acceleration structure. Packets holding
+ *  fewer rays than lanes fill the remaining lanes with copies of their first ray,
+ *  which are left out of the active mask.
+ *
+ *  Packets hold SIMD values and should live on the stack.
+ */
+class RayPacket {
+public:
+    static const unsigned int Size          = SimdFloat::Width;             //!< The maximum number of rays in a packet.
+    static const unsigned int TileWidth     = ( Size == 8u ) ? 4u : 2u;     //!< The width of the tile of pixels covered by a packet.
+    static const unsigned int TileHeight    = Size / TileWidth;             //!< The height of the tile of pixels covered by a packet.
+
+private:
+    const Ray*      m_rays[Size];           //!< The rays, inactive lanes repeating the first one.
+    unsigned int    m_count;                //!< The number of rays in the packet.
+    SimdFloat       m_origin[3];            //!< The origins of the rays, per axis.
+    SimdFloat       m_direction[3];         //!< The directions of the rays, per axis.
+    SimdFloat       m_invDirection[3];      //!< The inverses of the directions' components, per axis.
+    SimdFloat       m_active;               //!< The mask of the lanes holding a ray.
+    bool            m_coherent;             //!< Whether all directions have the same signs.
+
+public:
+    /*!
+     *  \brief  Creates a packet from a set of rays.
+     *
+     *  \param  iRays       The rays, which must outlive the packet.
+     *  \param  iCount      The number of rays, between 1 and Size.
+     */
+    inline RayPacket (
+        const Ray*              iRays,
+        const unsigned int&     iCount
+    )   :   m_count ( iCount )
+    {
+        float origin[3][Size], direction[3][Size], invDirection[3][Size], active[Size];
+        unsigned int negative[3] = { 0u, 0u, 0u };
+
+        for ( unsigned int lane = 0; lane < Size; lane++ ) {
+            m_rays[lane] = ( lane < iCount ) ? &iRays[lane] : &iRays[0];
+
+            for ( unsigned int axis = 0; axis < 3; axis++ ) {
+                origin[axis][lane]          = m_rays[lane]->getOrigin ()[axis];
+                direction[axis][lane]       = m_rays[lane]->getDirection ()[axis];
+                invDirection[axis][lane]    = 1.0f / direction[axis][lane];
+
+                // Zero components count by the sign of their inverse (+0 or -0).
+                if ( invDirection[axis][lane] < 0.0f ) {
+                    negative[axis]++;
+                }
+            }
+
+            // All bits set for active lanes.
+            const unsigned int bits = ( lane < iCount ) ? 0xFFFFFFFFu : 0u;
+            std::memcpy ( &active[lane], &bits, sizeof ( float ) );
+        }
+
+        m_coherent = true;
+        for ( unsigned int axis = 0; axis < 3; axis++ ) {
+            m_origin[axis]       = SimdFloat::Load ( origin[axis] );
+            m_direction[axis]    = SimdFloat::Load ( direction[axis] );
+            m_invDirection[axis] = SimdFloat::Load ( invDirection[axis] );
+
+            m_coherent &= ( negative[axis] == 0u ) || ( negative[axis] == Size );
+        }
+        m_active = SimdFloat::Load ( active );
+    }
+
+    /*!
+     *  \return The number of rays in the packet.
+     */
+    inline const unsigned int& GetCount () const
+    {
+        return m_count;
+    }
+
+    /*!
+     *  \return The ray of a lane.
+     */
+    inline const Ray& GetRay (
+        const unsigned int&     iLane
+    ) const {
+        return *m_rays[iLane];
+    }
+
+    /*!
+     *  \return The origins of the rays along an axis.
+     */
+    inline const SimdFloat& GetOrigin (
+        const unsigned int&     iAxis
+    ) const {
+        return m_origin[iAxis];
+    }
+
+    /*!
+     *  \return The directions of the rays along an axis.
+     */
+    inline const SimdFloat& GetDirection (
+        const unsigned int&     iAxis
+    ) const {
+        return m_direction[iAxis];
+    }
+
+    /*!
+     *  \return The inverses of the directions of the rays along an axis.
+     */
+    inline const SimdFloat& GetInverseDirection (
+        const unsigned int&     iAxis
+    ) const {
+        return m_invDirection[iAxis];
+    }
+
+    /*!
+     *  \return The mask of the lanes holding a ray.
+     */
+    inline const SimdFloat& GetActive () const
+    {
+        return m_active;
+    }
+
+    /*!
+     *  \return true iff, along every axis, the directions of all rays have the
+     *          same sign, so that they cross the nodes of a hierarchy in the same order.
+     */
+    inline bool IsCoherent () const
+    {
+        return m_coherent;
+    }
+};
+
+#endif // _RAYPACKET_H_
@@ -8,18 +8,79 @@
 #include "RayTracer.h"
 #include "Ray.h"
 #include "Scene.h"
+#ifndef RAYMINI_HEADLESS
 #include <QProgressDialog>
-#include <QCoreApplication>
+#endif
 #include <iostream>
+#include <sstream>
 #include <stdio.h>
 
-#include "kd/KdTree.h"
+#include "Accelerator.h"
 #include "ParameterHandler.h"
 #include "RadianceCalculator.h"
 #include "GuidedFilter.h"
+#include "TileScheduler.h"
+#include "FrameBuffer.h"
+#include "AdaptiveSampler.h"
 #include "Pbgi.h"
 #include <omp.h>
 
+namespace {
+
+    /*!
+     *  \brief  Shows the progress of a step of a render in a dialog, from its
+     *          creation to its destruction. Headless builds show nothing.
+     */
+    class RenderProgress {
+    private:
+#ifndef RAYMINI_HEADLESS
+        QProgressDialog*    m_dialog;   //!< The dialog, NULL if hidden.
+#endif
+
+    public:
+        RenderProgress (
+            const char*         iLabel,
+            const bool&         iVisible
+        ) {
+#ifndef RAYMINI_HEADLESS
+            m_dialog = iVisible ? new QProgressDialog ( iLabel, "Cancel", 0, 100 ) : NULL;
+            if ( m_dialog ) {
+                m_dialog->show ();
+            }
+#else
+            (void) iLabel;
+            (void) iVisible;
+#endif
+        }
+
+        ~RenderProgress ()
+        {
+#ifndef RAYMINI_HEADLESS
+            if ( m_dialog ) {
+                m_dialog->close ();
+                delete m_dialog;
+            }
+#endif
+        }
+
+        /*!
+         *  \brief  Moves the progress bar, from 0 to 100.
+         */
+        inline void SetValue (
+            const int&          iPercent
+        ) {
+#ifndef RAYMINI_HEADLESS
+            if ( m_dialog ) {
+                m_dialog->setValue ( iPercent );
+            }
+#else
+            (void) iPercent;
+#endif
+        }
+    };
+
+}
+
 using namespace kd;
 
 #ifdef GetObject
@@ -35,7 +96,7 @@ Vec3Df DoTracePath (
 ) {
     const ParameterHandler* params = ParameterHandler::Instance ();
     const RadianceCalculator* rc = RadianceCalculator::Instance ();
-    const KdTree* kdTree = iScene.getKdTree ();
+    const Accelerator* kdTree = iScene.getAccelerator ();
     KdIntersectionData intersection;
 
     Vec3Df color ( 0.0f, 0.0f, 0.0f );
@@ -147,6 +208,15 @@ Vec3Df TracePath (
     return accumulator / ( (float)rayCount );
 }
 
+Vec3Df ShadeIntersection (
+    const Scene&                iScene,
+    const Ray&                  iRay,
+    const unsigned int&         iDepth,
+    const KdIntersectionData&   iIntersection,
+    const Vec3Df&               iBackgroundColor,
+    const float*                iVisibilities = NULL
+);
+
 Vec3Df DoTraceRay (
     const Scene&            iScene,
     const Ray&              iRay,
@@ -155,9 +225,7 @@ Vec3Df DoTraceRay (
     KdIntersectionData&     oIntersection,
     const Vec3Df&           iBackgroundColor
 ) {
-    const ParameterHandler* params = ParameterHandler::Instance ();
-    const RadianceCalculator* rc = RadianceCalculator::Instance ();
-    const KdTree* kdTree = iScene.getKdTree ();
+    const Accelerator* kdTree = iScene.getAccelerator ();
 
     if (
         ( oHasIntersection = kdTree->Intersect (
@@ -167,102 +235,132 @@ Vec3Df DoTraceRay (
             )
         )
     ) {
-        const Vec3Df& interPoint  = oIntersection.GetIntersectionPoint ();
-        const Vec3Df& interNormal = oIntersection.GetIntersectionNormal ();
-        const Material& interMaterial = oIntersection.GetObject () ->getMaterial ();
-
-        Vec3Df color ( 0.0f, 0.0f, 0.0f );
-        if (
-            iDepth < params->GetMaxRayDepth ()
-        ) {
-            const Vec3Df&   N               = interNormal;
-            const Vec3Df&   Lm              = iRay.getDirection ();
-            Vec3Df          reflectionDir   = Lm - 2 * N * Vec3Df::dotProduct(Lm, N);
-            Ray reflectionRay ( interPoint, reflectionDir );
-
-            bool hasIntersection = false;
-            KdIntersectionData reflInter;
-            Vec3Df reflectionColor = DoTraceRay (
-                iScene,
-                reflectionRay,
-                iDepth + 1,
-                hasIntersection,
-                reflInter,
-                iBackgroundColor
-            );
-            color += interMaterial.getColor () * interMaterial.getSpecular () * reflectionColor;
-        }
-        color += rc->DirectLighting (
+        return ShadeIntersection (
             iScene,
-            iRay.getOrigin (),
-            interPoint,
-            interNormal,
-            interMaterial
+            iRay,
+            iDepth,
+            oIntersection,
+            iBackgroundColor
         );
-        
-        return color;
     } 
     
     return iBackgroundColor;
 }
 
+Vec3Df ShadeIntersection (
+    const Scene&                iScene,
+    const Ray&                  iRay,
+    const unsigned int&         iDepth,
+    const KdIntersectionData&   iIntersection,
+    const Vec3Df&               iBackgroundColor,
+    const float*                iVisibilities
+) {
+    const ParameterHandler* params = ParameterHandler::Instance ();
+    const RadianceCalculator* rc = RadianceCalculator::Instance ();
+
+    const Vec3Df& interPoint  = iIntersection.GetIntersectionPoint ();
+    const Vec3Df& interNormal = iIntersection.GetIntersectionNormal ();
+    const Material& interMaterial = iIntersection.GetObject () ->getMaterial ();
+
+    Vec3Df color ( 0.0f, 0.0f, 0.0f );
+    if (
+        iDepth < params->GetMaxRayDepth ()
+    ) {
+        const Vec3Df&   N               = interNormal;
+        const Vec3Df&   Lm              = iRay.getDirection ();
+        Vec3Df          reflectionDir   = Lm - 2 * N * Vec3Df::dotProduct(Lm, N);
+        Ray reflectionRay ( interPoint, reflectionDir );
+
+        bool hasIntersection = false;
+        KdIntersectionData reflInter;
+        Vec3Df reflectionColor = DoTraceRay (
+            iScene,
+            reflectionRay,
+            iDepth + 1,
+            hasIntersection,
+            reflInter,
+            iBackgroundColor
+        );
+        color += interMaterial.getColor () * interMaterial.getSpecular () * reflectionColor;
+    }
+    color += rc->DirectLighting (
+        iScene,
+        iRay.getOrigin (),
+        interPoint,
+        interNormal,
+        interMaterial,
+        iVisibilities
+    );
+
+    return color;
+}
+
+// Shades a primary ray whose intersection is already known,
+// typically from a packet traversal. Its ambient occlusion ratio
+// and the visibility of the lights are those computed for its tile.
 Vec3Df TraceRay (
-    const Scene&        iScene,
-    const Ray&          iRay,
-    const Vec3Df&       iBackgroundColor
+    const Scene&                iScene,
+    const Ray&                  iRay,
+    const KdIntersectionData&   iIntersection,
+    const Vec3Df&               iBackgroundColor,
+    const float&                iAoRatio,
+    const float*                iVisibilities
 ) {
     ParameterHandler* params = ParameterHandler::Instance ();
-    RadianceCalculator* rc = RadianceCalculator::Instance ();
 
-    bool hasIntersection = false;
-    KdIntersectionData intersectionData;
-    Vec3Df color = DoTraceRay (
+    Vec3Df color = ShadeIntersection (
         iScene,
         iRay,
-        0, 
-        hasIntersection,
-        intersectionData,
-        iBackgroundColor
+        0,
+        iIntersection,
+        iBackgroundColor,
+        iVisibilities
     );
     if (
-        ( hasIntersection )
+        ( params->GetAo () )
     ) {
-        if (
-            ( params->GetAo () )
-        ) {
-            const BoundingBox& bb = iScene.getBoundingBox ();
-
-            float sceneDist = 0.05f * Vec3Df::distance (
-                bb.getMin (),
-                bb.getMax ()
-            );
-            float aoRatio = rc->AmbientOcclusion (
-                20,
-                sceneDist,
-                intersectionData.GetIntersectionNormal (),
-                intersectionData.GetIntersectionPoint (),
-                iScene
-            );
-            color *= ( 1.0f - aoRatio );
-        }
+        color *= ( 1.0f - iAoRatio );
     }
     return color;
 }
 
-
 Vec3Df PathTracing(
     const Ray&              ray,            // incident ray
     const Scene*            scene,          // the scene
+    const unsigned int&     diffuseRays,    // Number of diffuse rays of the first bounce
     const unsigned int&     depth=0         // Recursion level
+);
+
+// Samples the direction of a diffuse bounce, over the hemisphere about a normal.
+Vec3Df DiffuseDirection(
+    std::default_random_engine& generator,      // the random generator of the bounces
+    const Vec3Df&               normal          // the normal of the surface
 ) {
-    const KdTree& kdTree = *(scene->getKdTree ());
-    ParameterHandler* params = ParameterHandler::Instance ();
-    RadianceCalculator* rc = RadianceCalculator::Instance ();
+    std::uniform_real_distribution<float> distributionTeta(0,2*M_PI);
+    std::uniform_real_distribution<float> distributionPhi(0,M_PI);
 
-    KdIntersectionData intData;
+    Vec3Df newDir = Vec3Df::polarToCartesian( Vec3Df(1, distributionTeta(generator), distributionPhi(generator)) );
+    if ( Vec3Df::dotProduct(newDir, normal) < 0 ) {
+        newDir = -newDir;
+    }
+    return newDir;
+}
 
-    if (!kdTree.Intersect(ray, intData))
-        return Vec3Df();
+// Shades the point where a ray hits the scene, the intersection being
+// already known, typically from a packet traversal. The visibility of the
+// lights and the radiance of the first diffuse bounces may also be given,
+// computed for a whole tile at once.
+Vec3Df ShadePath(
+    const Ray&                  ray,            // incident ray
+    const KdIntersectionData&   intData,        // where it hits the scene
+    const Scene*                scene,          // the scene
+    const unsigned int&         diffuseRays,    // Number of diffuse rays of the first bounce
+    const unsigned int&         depth=0,        // Recursion level
+    const float*                visibilities=NULL,  // The visibility of every light, or NULL
+    const Vec3Df*               diffuseSum=NULL     // The sum of the cosine weighted radiance of the first bounces, or NULL
+) {
+    ParameterHandler* params = ParameterHandler::Instance ();
+    RadianceCalculator* rc = RadianceCalculator::Instance ();
 
     const Object* obj = intData.GetObject ();
     Vec3Df point  = intData.GetIntersectionPoint ();
@@ -274,42 +372,41 @@ Vec3Df PathTracing(
         ray.getOrigin (),
         point,
         normal,
-        obj->getMaterial ()
+        obj->getMaterial (),
+        visibilities
     );
 
     Vec3Df dir = ray.getDirection();
     dir.normalize();
   
     //diffuse component modelling
-    std::default_random_engine generator;
-    std::uniform_real_distribution<float> distributionTeta(0,2*M_PI);
-    std::uniform_real_distribution<float> distributionPhi(0,M_PI);
-    generator.seed( rand() );
-
     Vec3Df diffusePart(0.f, 0.f, 0.f);
     if (
             ( obj->getMaterial().getDiffuse() > 0 )
         &&  ( depth == 0 )
     ) {
-        for (
-            unsigned int rayCounter = 0;
-            rayCounter < params->GetPathTracingDiffuseRayCount();
-            rayCounter++
-        ) {
-            Vec3Df newDir = Vec3Df::polarToCartesian( Vec3Df(1, distributionTeta(generator), distributionPhi(generator)) );
-            
-            if ( Vec3Df::dotProduct(newDir, normal) < 0 ) {
-                newDir = -newDir;
+        if ( diffuseSum ) {
+            diffusePart = *diffuseSum;
+        } else {
+            std::default_random_engine generator;
+            generator.seed( rand() );
+
+            for (
+                unsigned int rayCounter = 0;
+                rayCounter < diffuseRays;
+                rayCounter++
+            ) {
+                Vec3Df newDir = DiffuseDirection(generator, normal);
+                Ray newRay(intData.GetIntersectionPoint(), newDir);
+                diffusePart +=
+                    PathTracing(newRay, scene, diffuseRays, depth+1)
+                    * Vec3Df::dotProduct(normal, newDir);
             }
-            Ray newRay(intData.GetIntersectionPoint(), newDir);
-            diffusePart +=
-                PathTracing(newRay, scene, depth+1)
-                * Vec3Df::dotProduct(normal, newDir);
         }
         diffusePart = diffusePart 
                     * obj->getMaterial().getDiffuse() 
                     * obj->getMaterial().getColor() 
-                    / params->GetPathTracingDiffuseRayCount() 
+                    / diffuseRays 
                     * (2 * M_PI);
     }
 
@@ -321,7 +418,7 @@ Vec3Df PathTracing(
         if (cos_ > 0) {
             specularPart =
                 obj->getMaterial().getSpecular()
-                * PathTracing(newRay, scene, depth+1)
+                * PathTracing(newRay, scene, diffuseRays, depth+1)
                 * obj->getMaterial().getColor();
                 //* pow(cos_, obj->getMaterial().getShininess() );
         }
@@ -330,6 +427,235 @@ Vec3Df PathTracing(
     return (directPart + diffusePart + specularPart);
 }
 
+Vec3Df PathTracing(
+    const Ray&              ray,
+    const Scene*            scene,
+    const unsigned int&     diffuseRays,
+    const unsigned int&     depth
+) {
+    const Accelerator& kdTree = *(scene->getAccelerator ());
+    KdIntersectionData intData;
+
+    if (!kdTree.Intersect(ray, intData))
+        return Vec3Df();
+
+    return ShadePath(ray, intData, scene, diffuseRays, depth);
+}
+
+// A primary sample of a tile.
+struct TileSample {
+    Ray                 ray;            // The primary ray
+    KdIntersectionData  intersection;   // Where it hits the scene
+    bool                hit;            // Whether it hits the scene
+    unsigned int        x, y;           // Its pixel
+    Vec3Df              diffuseSum;     // The cosine weighted radiance of its first diffuse bounces
+};
+
+// The primary samples of a tile, whose secondary rays are traced in batches
+// of a whole tile: large enough for the accelerator to reorder them, and
+// traced by the thread rendering the tile. Buffers are kept from one tile
+// to the next.
+struct TileSamples {
+    std::vector< TileSample >           samples;        // The primary samples
+    std::vector< float >                visibilities;   // The visibility of every light from every sample
+    std::vector< float >                aoRatios;       // The ratio of the ambient occlusion rays of every sample that are occluded
+    std::vector< Ray >                  rays;           // The secondary rays of the current batch
+    std::vector< unsigned int >         owners;         // The sample, or sample and light, every ray is cast for
+    std::vector< char >                 results;        // Whether every ray is occluded, or hits the scene
+    std::vector< KdIntersectionData >   intersections;  // Where every ray hits the scene
+};
+
+// Traces the occlusion rays of the current batch, and gives every owner the
+// fraction of its rays that are occluded. Rays of an owner are consecutive.
+void TraceOcclusionBatch (
+    const Scene&            iScene,
+    TileSamples&            ioTile,
+    const float&            iNear,
+    const float&            iFar,
+    float*                  oRatios
+) {
+    const unsigned int count = ioTile.rays.size ();
+    if ( count == 0 ) {
+        return;
+    }
+
+    ioTile.results.resize ( count );
+    iScene.getAccelerator ()->OccludedBatch (
+        &ioTile.rays[0],
+        count,
+        &ioTile.results[0],
+        iNear,
+        iFar
+    );
+
+    for ( unsigned int first = 0; first < count; ) {
+        unsigned int last = first;
+        unsigned int occluded = 0;
+        for ( ; last < count && ioTile.owners[last] == ioTile.owners[first]; last++ ) {
+            if ( ioTile.results[last] ) {
+                occluded++;
+            }
+        }
+        oRatios[ioTile.owners[first]] = (float) occluded / (float) ( last - first );
+        first = last;
+    }
+}
+
+// Traces the shadow rays of all hits of a tile, and places the visibility
+// of every light from them. Returns false if shadows are disabled.
+bool TraceTileShadows (
+    const Scene&            iScene,
+    TileSamples&            ioTile
+) {
+    const ParameterHandler* params = ParameterHandler::Instance ();
+    const RadianceCalculator* rc = RadianceCalculator::Instance ();
+    if ( !params->GetShadows () ) {
+        return false;
+    }
+
+    const std::vector< Light >& lights = iScene.getLights ();
+    ioTile.rays.clear ();
+    ioTile.owners.clear ();
+    for ( unsigned int s = 0; s < ioTile.samples.size (); s++ ) {
+        const TileSample& sample = ioTile.samples[s];
+        if ( !sample.hit ) {
+            continue;
+        }
+        for ( unsigned int l = 0; l < lights.size (); l++ ) {
+            rc->LightVisibilityRays ( sample.intersection.GetIntersectionPoint (), lights[l], ioTile.rays );
+            ioTile.owners.resize ( ioTile.rays.size (), s * lights.size () + l );
+        }
+    }
+
+    ioTile.visibilities.assign ( ioTile.samples.size () * lights.size (), 0.0f );
+    if ( !ioTile.visibilities.empty () ) {
+        TraceOcclusionBatch ( iScene, ioTile, 0.000000000000000000005f, 1.0f, &ioTile.visibilities[0] );
+    }
+
+    // The visibility of a light is the fraction of its rays that aren't occluded.
+    for ( unsigned int v = 0; v < ioTile.visibilities.size (); v++ ) {
+        ioTile.visibilities[v] = 1.0f - ioTile.visibilities[v];
+    }
+    return true;
+}
+
+// Traces the ambient occlusion rays of all hits of a tile.
+void TraceTileAmbientOcclusion (
+    const Scene&            iScene,
+    TileSamples&            ioTile
+) {
+    const RadianceCalculator* rc = RadianceCalculator::Instance ();
+    const BoundingBox& bb = iScene.getBoundingBox ();
+
+    float sceneDist = 0.05f * Vec3Df::distance (
+        bb.getMin (),
+        bb.getMax ()
+    );
+
+    ioTile.rays.clear ();
+    ioTile.owners.clear ();
+    for ( unsigned int s = 0; s < ioTile.samples.size (); s++ ) {
+        const TileSample& sample = ioTile.samples[s];
+        if ( sample.hit ) {
+            rc->AmbientOcclusionRays (
+                20,
+                sample.intersection.GetIntersectionNormal (),
+                sample.intersection.GetIntersectionPoint (),
+                ioTile.rays
+            );
+            ioTile.owners.resize ( ioTile.rays.size (), s );
+        }
+    }
+
+    ioTile.aoRatios.assign ( ioTile.samples.size (), 0.0f );
+    if ( !ioTile.aoRatios.empty () ) {
+        TraceOcclusionBatch ( iScene, ioTile, EPSILON, sceneDist, &ioTile.aoRatios[0] );
+    }
+}
+
+// Casts the first diffuse bounces of the paths of all hits of a tile.
+void TileDiffuseRays (
+    const unsigned int&     diffuseRays,
+    TileSamples&            ioTile
+) {
+    ioTile.rays.clear ();
+    ioTile.owners.clear ();
+    for ( unsigned int s = 0; s < ioTile.samples.size (); s++ ) {
+        TileSample& sample = ioTile.samples[s];
+        sample.diffuseSum = Vec3Df ( 0.0f, 0.0f, 0.0f );
+        if ( !sample.hit || !( sample.intersection.GetObject ()->getMaterial ().getDiffuse () > 0 ) ) {
+            continue;
+        }
+
+        Vec3Df normal = sample.intersection.GetIntersectionNormal ();
+        normal.normalize ();
+
+        std::default_random_engine generator;
+        generator.seed ( rand () );
+        for ( unsigned int r = 0; r < diffuseRays; r++ ) {
+            ioTile.rays.push_back ( Ray ( sample.intersection.GetIntersectionPoint (), DiffuseDirection ( generator, normal ) ) );
+            ioTile.owners.push_back ( s );
+        }
+    }
+}
+
+// Traces the first diffuse bounces of the paths of all hits of a tile, and
+// sums the radiance they bring back, weighted by their cosines.
+void TraceTileDiffuseBounces (
+    const Scene*            scene,
+    const unsigned int&     diffuseRays,
+    TileSamples&            ioTile
+) {
+    TileDiffuseRays ( diffuseRays, ioTile );
+
+    const unsigned int count = ioTile.rays.size ();
+    if ( count == 0 ) {
+        return;
+    }
+    ioTile.results.resize ( count );
+    ioTile.intersections.resize ( count );
+    scene->getAccelerator ()->IntersectBatch (
+        &ioTile.rays[0],
+        count,
+        &ioTile.intersections[0],
+        &ioTile.results[0]
+    );
+
+    for ( unsigned int r = 0; r < count; r++ ) {
+        if ( !ioTile.results[r] ) {
+            continue;
+        }
+        TileSample& sample = ioTile.samples[ioTile.owners[r]];
+        Vec3Df normal = sample.intersection.GetIntersectionNormal ();
+        normal.normalize ();
+
+        sample.diffuseSum +=
+            ShadePath ( ioTile.rays[r], ioTile.intersections[r], scene, diffuseRays, 1 )
+            * Vec3Df::dotProduct ( normal, ioTile.rays[r].getDirection () );
+    }
+}
+
+// Same as TraceTileDiffuseBounces, but the bounces gather the radiance of the
+// lit point cloud instead of shading the triangles they hit.
+void GatherTileDiffuseBounces (
+    Scene&                  scene,
+    const unsigned int&     diffuseRays,
+    TileSamples&            ioTile
+) {
+    TileDiffuseRays ( diffuseRays, ioTile );
+
+    const Pbgi* pbgi = Pbgi::Instance ();
+    for ( unsigned int r = 0; r < ioTile.rays.size (); r++ ) {
+        TileSample& sample = ioTile.samples[ioTile.owners[r]];
+        Vec3Df normal = sample.intersection.GetIntersectionNormal ();
+        normal.normalize ();
+
+        sample.diffuseSum +=
+            pbgi->Gather ( scene, ioTile.rays[r] )
+            * Vec3Df::dotProduct ( normal, ioTile.rays[r].getDirection () );
+    }
+}
+
 static RayTracer * instance = NULL;
 
 RayTracer * RayTracer::getInstance () {
@@ -361,30 +687,16 @@ QImage RayTracer::render (
     Scene * scene = Scene::getInstance ();
     const std::vector<Light>& lights = scene->getLights();
 
-    QProgressDialog* progressDialog = NULL;
-    if (!fInterRenderer.isEnabled())
-        progressDialog = new QProgressDialog("Raytracing...", "Cancel", 0, 100);
-
     ParameterHandler* params = ParameterHandler::Instance ();
     if ( !params->GetKdTreeBuilt () ) {
-        QProgressDialog* ktDialog = NULL;
-        if (!fInterRenderer.isEnabled()) {
-            ktDialog = new QProgressDialog ("Building KD Tree...", "Cancel", 0, 100);
-            ktDialog->show ();
-        }
-
-        scene->buildKdTree ();
-        if (ktDialog) {
-            ktDialog->setValue ( 100 );
-            ktDialog->close();
-            delete ktDialog;
-        }
+        RenderProgress buildProgress ("Building acceleration structure...", !isInteractive());
+        scene->buildAccelerator ();
+        buildProgress.SetValue ( 100 );
         params->SetKdTreeBuilt ( true );
     }
-    const KdTree* kt = scene->getKdTree ();
+    const Accelerator* kt = scene->getAccelerator ();
 
-    if (progressDialog)
-        progressDialog->show ();
+    RenderProgress progress ("Raytracing...", !isInteractive());
     
     Vec3Df ambientColor ( 0, 0, 0 );
     for ( unsigned int l = 0; l < lights.size(); l++ ) {
@@ -396,104 +708,188 @@ QImage RayTracer::render (
     }
     ambientColor /= lights.size();
 
-    //Pbgi::Instance ()->IlluminatePointCloud ( *scene );
+    // Point-based path tracing gathers its diffuse bounces from the point
+    // cloud, lit once for the whole frame.
+    const bool pointBasedGi = params->GetPathTracing () && params->GetPointBasedGi ();
+    if ( pointBasedGi ) {
+        Pbgi::Instance ()->IlluminatePointCloud ( *scene );
+    }
 
     //initializing image set
     const unsigned short& AAFactor = ( params->GetAa() ) ? params->GetAaFactor() : 1;
     unsigned int RaysParPixel = AAFactor*AAFactor;
-    if (fInterRenderer.isEnabled())
+    if (isInteractive())
         RaysParPixel = 1;       //for interactive rendering anti-aliasing is just a question of time
 
-    std::vector<QImage*> images;
-    images.resize(RaysParPixel);
-    for (unsigned int imgCounter = 0; imgCounter < RaysParPixel; imgCounter++) {
-        images[imgCounter] = new QImage(QSize(screenWidth, screenHeight), QImage::Format_RGB888);
+    // Adaptive path tracing spreads the diffuse rays of a pixel over its passes, so
+    // that converged pixels stop casting them too.
+    const bool adaptive = params->GetAdaptiveSampling() && !isInteractive();
+    unsigned int diffuseRays = params->GetPathTracingDiffuseRayCount();
+    if (adaptive && params->GetPathTracing()) {
+        RaysParPixel *= diffuseRays;
+        diffuseRays = 1;
     }
 
+    // The samples of every pass are summed in floating point, and
+    // only averaged and quantized once all of them are in.
+    FrameBuffer frameBuffer(screenWidth, screenHeight);
+    GuidedFilter filter(screenWidth, screenHeight);
+    AdaptiveSampler sampler(screenWidth, screenHeight, AAFactor, RaysParPixel, adaptive);
+
+    // The extent of the image plane, at unit distance from the camera.
+    const float tanY = tan (fieldOfView);
+    const float tanX = tanY*aspectRatio;
+
     //let's go
-    int progress = 0;
-    for (unsigned int imgCounter = 0; imgCounter < RaysParPixel; imgCounter++) {
-        float OffsetX = 1.0f * (imgCounter % AAFactor) / AAFactor;
-        float OffsetY = 1.0f * ((unsigned int) (imgCounter / AAFactor)) / AAFactor;
-        if (fInterRenderer.isEnabled()) {
+    std::vector<RenderTile> passTiles;
+    std::ostringstream statistics;
+    while (sampler.NextPass(frameBuffer, passTiles)) {
+        const unsigned int imgCounter = sampler.GetPassCount() - 1;
+
+        float OffsetX, OffsetY;
+        sampler.GetPixelOffset(imgCounter, OffsetX, OffsetY);
+#ifndef RAYMINI_HEADLESS
+        if (isInteractive()) {
             OffsetX += fInterRenderer.getXOffset();
             OffsetY += fInterRenderer.getYOffset();
         }
+#endif
+
+        // Zero threads stands for all cores.
+        const unsigned int threadCount = ( params->GetThreadCount() > 0 ) ? params->GetThreadCount() : omp_get_max_threads();
+
+        const unsigned int tileWidth  = RayPacket::TileWidth;
+        const unsigned int tileHeight = RayPacket::TileHeight;
 
-        GuidedFilter filter(screenWidth, screenHeight);
+        TileScheduler scheduler ( passTiles, threadCount );
+        const std::size_t previousSamples = sampler.GetSampleCount () - scheduler.GetPixelCount ();
 
-        const unsigned int& threadCount = ( params->GetThreadCount() ) ? params->GetThreadCount() : 2;
-        
-        #pragma omp parallel for
-        for (unsigned int threadIdx = 0; threadIdx < threadCount; threadIdx++) {
-            for (unsigned int i = threadIdx; i < screenWidth; i += threadCount )
-                if (!fInterRenderer.isEnabled()  ||  !fInterRenderer.wasCancelled()) {
-                    #pragma omp critical
+        #pragma omp parallel num_threads(threadCount)
+        {
+            const unsigned int threadIdx = omp_get_thread_num ();
+
+            // Threads render small tiles, stealing them from each other when they run
+            // out; the primary rays of every packet tile of a tile are traced together,
+            // then its secondary rays in batches of the whole tile.
+            TileSamples tileSamples;
+            unsigned int tileIdx = 0;
+            while ( scheduler.Next ( threadIdx, tileIdx ) )
+                if (!wasCancelled()) {
+                    const RenderTile& tile = scheduler.GetTile ( tileIdx );
+                    const double tileStart = omp_get_wtime ();
+
+                    if (threadIdx == 0) /* master thread */
                     {
-                        progress++;
+                        progress.SetValue ((100*(previousSamples + scheduler.GetRenderedPixels ()))/sampler.GetBudget ());
                     }
 
-                    if (threadIdx == 0 && progressDialog) /* master thread */
-                    {
-                        progressDialog->setValue ((100*progress)/(RaysParPixel*screenWidth));
+                    std::vector< TileSample >& samples = tileSamples.samples;
+                    samples.clear ();
+                    for ( unsigned int j0 = tile.y0; j0 < tile.y1; j0 += tileHeight )
+                    for ( unsigned int i0 = tile.x0; i0 < tile.x1; i0 += tileWidth ) {
+                        const unsigned int stripWidth = min ( tileWidth, tile.x1 - i0 );
+
+                        // Primary rays of the tile's pixels, in lane order.
+                        Ray rays[RayPacket::Size];
+                        unsigned int pixelX[RayPacket::Size];
+                        unsigned int pixelY[RayPacket::Size];
+                        unsigned int rayCount = 0;
+                        for ( unsigned int j = j0; j < min ( j0 + tileHeight, tile.y1 ); j++ ) {
+                            for ( unsigned int i = i0; i < i0 + stripWidth; i++ ) {
+                                Vec3Df stepX = (float (i) + OffsetX - screenWidth / 2.f) / screenWidth * tanX * rightVector;
+                                Vec3Df stepY = (float (j) + OffsetY - screenHeight / 2.f) / screenHeight * tanY * upVector;
+                                Vec3Df step = stepX + stepY;
+                                Vec3Df dir = direction + step;
+                                dir.normalize ();
+
+                                rays[rayCount]   = Ray ( camPos, dir );
+                                pixelX[rayCount] = i;
+                                pixelY[rayCount] = j;
+                                rayCount++;
+                            }
+                        }
+
+                        KdIntersectionData intersections[RayPacket::Size];
+                        const unsigned int hits = kt->IntersectPacket (
+                            RayPacket ( rays, rayCount ),
+                            intersections
+                        );
+
+                        for ( unsigned int lane = 0; lane < rayCount; lane++ ) {
+                            TileSample sample;
+                            sample.ray          = rays[lane];
+                            sample.intersection = intersections[lane];
+                            sample.hit          = ( hits >> lane ) & 1u;
+                            sample.x            = pixelX[lane];
+                            sample.y            = pixelY[lane];
+                            samples.push_back ( sample );
+                        }
                     }
 
-                    for ( unsigned int j = 0; j < screenHeight; j++ ) {
-                        float tanX = tan (fieldOfView)*aspectRatio;
-                        float tanY = tan (fieldOfView);
+                    // Secondary rays of the whole tile.
+                    bool shadows = false;
+                    if ( params->GetPathTracing () ) {
+                        shadows = TraceTileShadows ( *scene, tileSamples );
+                        if ( pointBasedGi ) {
+                            GatherTileDiffuseBounces ( *scene, diffuseRays, tileSamples );
+                        } else {
+                            TraceTileDiffuseBounces ( scene, diffuseRays, tileSamples );
+                        }
+                    } else if ( params->GetRayTracing () ) {
+                        shadows = TraceTileShadows ( *scene, tileSamples );
+                        if ( params->GetAo () ) {
+                            TraceTileAmbientOcclusion ( *scene, tileSamples );
+                        }
+                    }
+
+                    for ( unsigned int s = 0; s < samples.size (); s++ ) {
+                        const TileSample& sample = samples[s];
+                        const unsigned int& i = sample.x;
+                        const unsigned int& j = sample.y;
+                        const Ray& ray = sample.ray;
+                        const KdIntersectionData& intersectionData = sample.intersection;
+                        const float* visibilities = ( shadows ) ? &tileSamples.visibilities[s * lights.size ()] : NULL;
 
                         Vec3Df radiance ( backgroundColor );
-                        Vec3Df stepX = (float (i) + OffsetX - screenWidth / 2.f) / screenWidth * tanX * rightVector;
-                        Vec3Df stepY = (float (j) + OffsetY - screenHeight / 2.f) / screenHeight * tanY * upVector;
-                        Vec3Df step = stepX + stepY;
-                        Vec3Df dir = direction + step;
-                        dir.normalize ();
-
-                        Ray ray ( camPos, dir );
-                        KdIntersectionData intersectionData;
-
-                        if ( params->GetPathTracing () ) {
-                            //PATH TRACING
-                            if ( kt->Intersect ( Ray ( camPos, dir ), intersectionData ) ) {
-                                if (!fInterRenderer.isEnabled())
+                        if ( sample.hit ) {
+                            if ( params->GetPathTracing () || params->GetRayTracing () ) {
+                                if (!isInteractive())
                                     filter.setDistance(
                                         i, j,
                                         Vec3Df::distance(intersectionData.GetIntersectionPoint(), camPos)
                                     );
+                            }
+
+                            if ( params->GetPathTracing () ) {
+                                //PATH TRACING
                                 //radiance = 255.f * TracePath (*scene, ray, backgroundColor/255.f);
-                                radiance = 255.f * PathTracing (
+                                radiance = 255.f * ShadePath (
                                     ray,
-                                    scene
+                                    intersectionData,
+                                    scene,
+                                    diffuseRays,
+                                    0,
+                                    visibilities,
+                                    &sample.diffuseSum
                                 );
-                            }
-                        } else if ( params->GetRayTracing () ) {
-                            //DIRECT LIGHTNING
-                            if ( kt->Intersect ( Ray ( camPos, dir ), intersectionData ) ) {
-                                if (!fInterRenderer.isEnabled())
-                                    filter.setDistance(
-                                        i, j,
-                                        Vec3Df::distance(intersectionData.GetIntersectionPoint(), camPos)
-                                    );
+                            } else if ( params->GetRayTracing () ) {
+                                //DIRECT LIGHTNING
                                 radiance = 255.f * TraceRay (
                                     *scene,
                                     ray,
-                                    backgroundColor/255.f
+                                    intersectionData,
+                                    backgroundColor/255.f,
+                                    ( params->GetAo () ) ? tileSamples.aoRatios[s] : 0.0f,
+                                    visibilities
                                 );
                             }
-                        } else {
                         }
 
-                        QRgb color = qRgb (
-                                min(255.0f, radiance[0]),
-                                min(255.0f, radiance[1]),
-                                min(255.0f, radiance[2])
-                                );
-
-                        /*for (unsigned int xx = i; xx < min(screenWidth, i + CeilW); xx ++)
-                            for (unsigned int yy = j; yy < min(screenHeight, j + CeilH); yy ++)*/
-                        images[imgCounter] -> setPixel (i, j, color);
+                        frameBuffer.AddSample (i, j, radiance);
                     }
 
+                    scheduler.Finish ( tileIdx, threadIdx, omp_get_wtime () - tileStart );
+
                     /*if (threadIdx == 0 && !fInteractive) {
                         QCoreApplication::processEvents();
                         if (progressDialog.wasCanceled())
@@ -502,44 +898,31 @@ QImage RayTracer::render (
                 }
             }
 
-            if (!fInterRenderer.isEnabled())
-                filter.adjustFocalPlane();
-
-            if ( params->GetFilter () && !fInterRenderer.isEnabled() ) {
-                filter.apply(*images[imgCounter]);
-            }
+            // Keeps the tile timings of the last pass for load-balance analysis.
+            tiles = scheduler.GetTiles ();
+            statistics.str ("");
+            scheduler.PrintStatistics (statistics);
         }
-    
 
-    if (progressDialog)
-        progressDialog->setValue (100);
-
-    QImage image = *images[0];
-    if (RaysParPixel > 1 && (!fInterRenderer.isEnabled() || !fInterRenderer.wasCancelled())) {
-        for ( unsigned int i = 0; i < screenWidth; i++ ) {
-            for ( unsigned int j = 0; j < screenHeight; j++ ) {
-                unsigned int r = 0, g = 0, b = 0;
-                for (unsigned int imgCounter = 1; imgCounter < RaysParPixel; imgCounter++) {
-                    QRgb pix = images[imgCounter]->pixel( QPoint(i,j) );
-                    r += qRed(pix);
-                    g += qGreen(pix);
-                    b += qBlue(pix);
-                }
-                QRgb pix = image.pixel( QPoint(i,j) );
-                r = min(255u, (r + qRed(pix)  ) / RaysParPixel);
-                g = min(255u, (g + qGreen(pix)) / RaysParPixel);
-                b = min(255u, (b + qBlue(pix) ) / RaysParPixel);
-                image.setPixel(i,j, qRgb(r,g,b));
-            }
-        }
-    }
+    lastSampleCount = sampler.GetSampleCount ();
+    statistics << "Samples: " << lastSampleCount << " in " << sampler.GetPassCount () << " passes"
+               << " (" << ( float ( lastSampleCount ) / ( screenWidth * screenHeight ) ) << " per pixel"
+               << ", budget " << ( float ( sampler.GetBudget () ) / ( screenWidth * screenHeight ) ) << ")"
+               << std::endl;
+    lastStatistics = statistics.str ();
 
-    for (unsigned int imgCounter = 0; imgCounter < RaysParPixel; imgCounter++) {
-        delete images[imgCounter];
-    }
+    progress.SetValue (100);
 
-    if (progressDialog)
-        delete progressDialog;
+    QImage image(QSize(screenWidth, screenHeight), QImage::Format_RGB888);
+    frameBuffer.Resolve (image.bits (), image.bytesPerLine ());
+
+    // Depth of field blurs the averaged image, with the distances of the last pass.
+    if (!isInteractive())
+        filter.adjustFocalPlane();
+
+    if ( params->GetFilter () && !isInteractive() ) {
+        filter.apply(image);
+    }
 
     return image;
 }
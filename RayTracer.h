@@ -9,13 +9,17 @@
 #define RAYTRACER_H
 
 #include <iostream>
+#include <string>
 #include <vector>
 #include <QImage>
 
 #include "Vec3D.h"
+#include "TileScheduler.h"
 
 // * Little intervention to the original Mr. Boubekeur's code
+#ifndef RAYMINI_HEADLESS
   #include "InteractiveRenderer.h"
+#endif
 // /*
 
 class RayTracer {
@@ -26,7 +30,18 @@ public:
     inline const Vec3Df & getBackgroundColor () const { return backgroundColor;}
     inline void setBackgroundColor (const Vec3Df & c) { backgroundColor = c; }
 
+#ifndef RAYMINI_HEADLESS
     inline InteractiveRenderer& getInterRenderer() { return fInterRenderer; }
+#endif
+
+    // The tiles of the last pass of the last render, with the thread and time each took.
+    inline const std::vector<RenderTile> & getTileTimes () const { return tiles; }
+
+    // The number of samples of the last render, which adaptive sampling may keep below the budget.
+    inline std::size_t getLastSampleCount () const { return lastSampleCount; }
+
+    // The load balance of the last pass and the samples of the last render, as lines of text.
+    inline const std::string & getLastStatistics () const { return lastStatistics; }
 
     QImage render (const Vec3Df & camPos,
                    const Vec3Df & viewDirection,
@@ -38,13 +53,27 @@ public:
                    unsigned int screenHeight);
     
 protected:
-    inline RayTracer () {}
+    inline RayTracer () : lastSampleCount (0) {}
     inline virtual ~RayTracer () {}
     
 private:
+    // Headless builds have no interactive renderer: every render is a final one.
+#ifndef RAYMINI_HEADLESS
+    inline bool isInteractive () const { return fInterRenderer.isEnabled (); }
+    inline bool wasCancelled () const { return fInterRenderer.isEnabled () && fInterRenderer.wasCancelled (); }
+#else
+    inline bool isInteractive () const { return false; }
+    inline bool wasCancelled () const { return false; }
+#endif
+
     Vec3Df backgroundColor;
+    std::vector<RenderTile> tiles;
+    std::size_t lastSampleCount;
+    std::string lastStatistics;
 
+#ifndef RAYMINI_HEADLESS
     InteractiveRenderer fInterRenderer;
+#endif
 };
 
 
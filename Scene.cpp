@@ -6,6 +6,8 @@
 // *********************************************************
 
 #include "Scene.h"
+
+#include <omp.h>
 using namespace std;
 
 static Scene * instance = NULL;
@@ -24,10 +26,12 @@ void Scene::destroyInstance () {
 }
 
 Scene::Scene ()
-    :   m_pointCloud() {
+    :   m_pointCloudBuilt (false),
+        m_pointCloud(),
+        m_surfelTree (NULL) {
     ParameterHandler* params = ParameterHandler::Instance();
    
-    kdTree = NULL;
+    accelerator = NULL;
     int scene = params -> GetScene();
     
     if(scene == 0){
@@ -47,35 +51,194 @@ Scene::Scene ()
 
 Scene::~Scene () {
     m_pointCloudBuilt = false;
-    if ( kdTree ) {
-        delete kdTree;
-        kdTree = (KdTree*)0x0;
+    if ( m_surfelTree.load () ) {
+        delete m_surfelTree.load ();
+        m_surfelTree = NULL;
+    }
+    if ( accelerator ) {
+        delete accelerator;
+        accelerator = (Accelerator*)0x0;
+    }
+}
+
+void Scene::buildAccelerator (bool useCache) {
+    const ParameterHandler* params = ParameterHandler::Instance ();
+
+    // Rebuilding (e.g. after the build mode or the acceleration
+    // structure changed) replaces the previous one.
+    if ( accelerator ) {
+        delete accelerator;
+        accelerator = (Accelerator*)0x0;
+    }
+
+    const AcceleratorType type      = static_cast< AcceleratorType > ( params->GetAccelerator () );
+    const KdBuildMode     buildMode = static_cast< KdBuildMode > ( params->GetKdTreeBuildMode () );
+
+    // Instanced structures are cheap to build and aren't cached. Lazy
+    // trees are refined while rendering: there's nothing to cache.
+    const bool cached = useCache
+                    &&  params->GetAcceleratorCache ()
+                    &&  !params->GetInstancing ()
+                    &&  ( type != ACCELERATOR_LAZY_KD_TREE );
+    AcceleratorCache cache;
+
+    if ( cached ) {
+        accelerator = cache.Load ( getObjects (), type, buildMode );
+        if ( accelerator ) {
+            m_buildTimes = accelerator->GetBuildTimes ();
+            std::cout << "Acceleration structure mapped from the cache in "
+                      << ( m_buildTimes.primitives + m_buildTimes.layout ) << "s" << std::endl;
+            buildKdTreeRopes ();
+            printAcceleratorMemory ();
+            return;
+        }
+    }
+
+    if ( params->GetInstancing () ) {
+        accelerator = new InstanceTree (
+            getObjects (),
+            type,
+            buildMode
+        );
+    } else if ( type == ACCELERATOR_BVH ) {
+        accelerator = new bvh::BvhTree ( getObjects () );
+    } else if ( type == ACCELERATOR_QUANTIZED_BVH ) {
+        accelerator = new bvh::QuantizedBvhTree ( getObjects () );
+    } else if ( type == ACCELERATOR_LAZY_KD_TREE ) {
+        accelerator = new kd::LazyKdTree ( getObjects (), buildMode );
+    } else {
+        accelerator = new KdTree (
+            getObjects (),
+            buildMode
+        );
+    }
+
+    m_buildTimes = accelerator->GetBuildTimes ();
+
+    std::cout << "Acceleration structure built in "
+              << ( m_buildTimes.primitives + m_buildTimes.hierarchy + m_buildTimes.layout ) << "s"
+              << " (primitives: " << m_buildTimes.primitives << "s"
+              << ", hierarchy: " << m_buildTimes.hierarchy << "s"
+              << ", layout: " << m_buildTimes.layout << "s)" << std::endl;
+    buildKdTreeRopes ();
+    printAcceleratorMemory ();
+
+    if ( cached ) {
+        cache.Store ( *accelerator, getObjects (), type, buildMode );
+    }
+}
+
+void Scene::buildKdTreeRopes () {
+    // Ropes aren't cached: they are linked after every build or load.
+    KdTree* tree = dynamic_cast<KdTree*> (accelerator);
+    if (tree && ParameterHandler::Instance ()->GetKdTreeRopes ()) {
+        double start = omp_get_wtime ();
+        tree->BuildRopes ();
+        std::cout << "KD-Tree ropes linked in " << ( omp_get_wtime () - start ) << "s" << std::endl;
     }
 }
 
-void Scene::buildKdTree () {
-    KdDataVector ktData;
-    const std::vector< Object >& sceneObjects = getObjects ();
+void Scene::printAcceleratorMemory () const {
+    std::cout << "Acceleration structure uses "
+              << accelerator->GetMemoryUsage () / ( 1024.0 * 1024.0 ) << " MB";
 
-    for ( unsigned int obj = 0; obj < sceneObjects.size (); obj++ ) {
-        const Object& object = sceneObjects[obj];
-        const std::vector< Triangle >& objectTriangles = object.getMesh ().getTriangles ();
+    // Compact structures also report what they save.
+    const bvh::QuantizedBvhTree* quantized = dynamic_cast<const bvh::QuantizedBvhTree*> (accelerator);
+    if (quantized) {
+        const std::size_t uncompressed = quantized->GetUncompressedMemoryUsage ();
+        std::cout << " (" << ( uncompressed - quantized->GetMemoryUsage () ) / ( 1024.0 * 1024.0 )
+                  << " MB saved over the uncompressed BVH)";
+    }
+    std::cout << std::endl;
+}
+
+bool Scene::refitAccelerator () {
+    if (
+            accelerator
+        &&  accelerator->Refit ()
+    ) {
+        return true;
+    }
+
+    // Structures that can't follow the objects are rebuilt. Moved objects
+    // rarely come back to the same place: the cache would only fill up.
+    buildAccelerator (false);
+    return false;
+}
+
+bool Scene::moveObject (unsigned int index, const Vec3Df & trans) {
+    objects[index].setTrans (trans);
+    updateBoundingBox ();
+    if (accelerator)
+        return refitAccelerator ();
+    return true;
+}
 
-        for ( unsigned int tri = 0; tri < objectTriangles.size (); tri++ ) {
-            ktData.push_back ( new KdData ( tri, &object ) );
+std::vector< Surfel* >& Scene::GetPointCloud () {
+    // Rays of several threads may ask for it at once: only the first one builds it.
+    if ( !m_pointCloudBuilt.load ( std::memory_order_acquire ) ) {
+        std::lock_guard< std::mutex > lock ( m_pointCloudLock );
+        if ( !m_pointCloudBuilt.load ( std::memory_order_relaxed ) ) {
+            for ( unsigned int obj = 0; obj < objects.size (); obj++ )
+                objects[obj].GetPointCloud ( m_pointCloud );
+            m_pointCloudBuilt.store ( true, std::memory_order_release );
         }
     }
+    return m_pointCloud;
+}
+
+const oc::OcTree& Scene::GetSurfelTree () {
+    oc::OcTree* tree = m_surfelTree.load ( std::memory_order_acquire );
+    if ( !tree ) {
+        std::lock_guard< std::mutex > lock ( m_surfelTreeLock );
+        tree = m_surfelTree.load ( std::memory_order_relaxed );
+        if ( !tree ) {
+            tree = new oc::OcTree ( GetPointCloud () );
+            m_surfelTree.store ( tree, std::memory_order_release );
+        }
+    }
+    return *tree;
+}
 
-    kdTree = new KdTree ( ktData );
+bool Scene::IntersectSurfel (
+    const Ray&          iRay,
+    const Surfel*&      oSurfel,
+    Vec3Df&             oPoint,
+    const float&        iNear,
+    const float&        iFar
+) {
+    const oc::OcTree& tree = GetSurfelTree ();
+
+    unsigned int surfel;
+    float t;
+    if ( !tree.Intersect ( iRay, surfel, t, iNear, iFar ) )
+        return false;
+
+    oSurfel = tree.GetSurfels ()[surfel];
+    oPoint  = iRay.getOrigin () + t * iRay.getDirection ();
+    return true;
+}
+
+bool Scene::getKdTreeStatistics (kd::KdStatistics & stats) const {
+    const KdTree* tree = dynamic_cast<const KdTree*> (accelerator);
+    if (!tree)
+        return false;
+
+    stats = tree->GetStatistics ();
+    return true;
 }
 
 void Scene::updateBoundingBox () {
     if (objects.empty ())
         bbox = BoundingBox ();
     else {
-        bbox = objects[0].getBoundingBox ();
-        for (unsigned int i = 1; i < objects.size (); i++)
-            bbox.extendTo (objects[i].getBoundingBox ());
+        // Object boxes are in object space: they follow their translation.
+        const BoundingBox & first = objects[0].getBoundingBox ();
+        bbox = BoundingBox (first.getMin () + objects[0].getTrans (), first.getMax () + objects[0].getTrans ());
+        for (unsigned int i = 1; i < objects.size (); i++) {
+            const BoundingBox & box = objects[i].getBoundingBox ();
+            bbox.extendTo (BoundingBox (box.getMin () + objects[i].getTrans (), box.getMax () + objects[i].getTrans ()));
+        }
     }
 }
 
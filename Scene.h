@@ -8,14 +8,23 @@
 #ifndef SCENE_H
 #define SCENE_H
 
+#include <atomic>
 #include <iostream>
+#include <mutex>
 #include <vector>
 
 #include "Object.h"
 #include "Light.h"
 #include "BoundingBox.h"
+#include "Accelerator.h"
+#include "AcceleratorCache.h"
 #include "kd/KdTree.h"
+#include "kd/LazyKdTree.h"
+#include "bvh/BvhTree.h"
+#include "bvh/QuantizedBvhTree.h"
+#include "InstanceTree.h"
 #include "Surfel.h"
+#include "oc/OcTree.h"
 
 using namespace kd;
 
@@ -33,25 +42,27 @@ public:
     inline const BoundingBox & getBoundingBox () const { return bbox; }
     void updateBoundingBox ();
     
-    void buildKdTree ();
-    inline const KdTree* getKdTree () const { return kdTree; }
+    void buildAccelerator (bool useCache = true);  // Without the cache, neither maps nor stores the structure.
+    bool refitAccelerator ();   // Call after moving objects with Object::setTrans. False if the structure had to be rebuilt.
+    bool moveObject (unsigned int index, const Vec3Df & trans);    // Sets the translation of an object, and refits the structure if built. False if it had to be rebuilt.
+    inline const Accelerator* getAccelerator () const { return accelerator; }
+    inline const AcceleratorBuildTimes & getBuildTimes () const { return m_buildTimes; }
+    bool getKdTreeStatistics (kd::KdStatistics & stats) const;  // False unless the structure is a KD-Tree.
 
-    std::vector< Surfel* >& GetPointCloud () {
-        if ( m_pointCloudBuilt ) {
-            return m_pointCloud;
-        }
-        for (
-            unsigned int obj = 0;
-            obj < objects.size ();
-            obj++
-        ) {
-            objects[obj].GetPointCloud (
-                m_pointCloud
-            );
-        }
-        m_pointCloudBuilt = true;
-        return m_pointCloud;
-    }
+    std::vector< Surfel* >& GetPointCloud ();    // Built on first use; safe to call from several threads.
+
+    // The index over the point cloud, built on first use; safe to call from several threads.
+    const oc::OcTree& GetSurfelTree ();
+
+    // Casts a ray against the point cloud, through its index: places the closest
+    // front-facing surfel hit and the intersection point.
+    bool IntersectSurfel (
+        const Ray&          iRay,
+        const Surfel*&      oSurfel,
+        Vec3Df&             oPoint,
+        const float&        iNear=-1.0f,
+        const float&        iFar=-1.0f
+    );
 protected:
     Scene ();
     virtual ~Scene ();
@@ -63,10 +74,16 @@ private:
     void buildSphereScene ();
     void buildCubeScene ();
     void buildBMWScene ();
+    void buildKdTreeRopes ();
+    void printAcceleratorMemory () const;
 
-    bool m_pointCloudBuilt;
+    std::atomic< bool > m_pointCloudBuilt;
+    std::mutex m_pointCloudLock;            // Held by the thread building the point cloud.
     std::vector< Surfel* > m_pointCloud;
-    KdTree* kdTree;
+    std::atomic< oc::OcTree* > m_surfelTree;
+    std::mutex m_surfelTreeLock;            // Held by the thread building the index.
+    Accelerator* accelerator;
+    AcceleratorBuildTimes m_buildTimes;
     std::vector<Object> objects;
     std::vector<Light> lights;
     BoundingBox bbox;
@@ -0,0 +1,156 @@
+#ifndef _SIMDFLOAT_H_
+#define _SIMDFLOAT_H_
+
+#if defined ( __AVX__ )
+#include <immintrin.h>
+#define SIMDFLOAT_AVX
+#elif defined ( __SSE2__ ) || defined ( _M_X64 )
+#include <emmintrin.h>
+#define SIMDFLOAT_SSE
+#endif
+
+/*!
+ *  \brief  A fixed number of floats processed together, with the widest
+ *          instruction set the compiler targets: 8 lanes with AVX, 4 lanes
+ *          with SSE, and 4 lanes of plain floats otherwise.
+ *
+ *  Comparisons return masks, whose lanes have either all bits set or all bits
+ *  cleared. Masks are combined with the bitwise operators and turned into one
+ *  bit per lane with GetMask. a.AndNot ( b ) clears the lanes of a set in b.
+ *
+ *  As with the underlying instructions, Min and Max return their argument when
+ *  either value is NaN, and all comparisons with NaN are false except for
+ *  NotLess and NotGreater.
+ */
+class SimdFloat {
+public:
+#if defined ( SIMDFLOAT_AVX )
+    static const unsigned int Width = 8;    //!< The number of lanes.
+    typedef __m256 Register;
+#elif defined ( SIMDFLOAT_SSE )
+    static const unsigned int Width = 4;    //!< The number of lanes.
+    typedef __m128 Register;
+#else
+    static const unsigned int Width = 4;    //!< The number of lanes.
+    union Register {
+        float           f[Width];
+        unsigned int    u[Width];
+    };
+#endif
+
+private:
+    Register    m_value;    //!< The values of all lanes.
+
+public:
+    inline SimdFloat ()
+    {}
+
+    inline SimdFloat (
+        const Register&     iValue
+    )   :   m_value ( iValue )
+    {}
+
+#if defined ( SIMDFLOAT_AVX )
+    static inline SimdFloat Broadcast ( const float& iValue )   { return _mm256_set1_ps ( iValue ); }
+    static inline SimdFloat Load ( const float* iValues )       { return _mm256_loadu_ps ( iValues ); }
+    inline void Store ( float* oValues ) const                  { _mm256_storeu_ps ( oValues, m_value ); }
+    inline unsigned int GetMask () const                        { return _mm256_movemask_ps ( m_value ); }
+
+    inline SimdFloat operator+ ( const SimdFloat& iOther ) const    { return _mm256_add_ps ( m_value, iOther.m_value ); }
+    inline SimdFloat operator- ( const SimdFloat& iOther ) const    { return _mm256_sub_ps ( m_value, iOther.m_value ); }
+    inline SimdFloat operator* ( const SimdFloat& iOther ) const    { return _mm256_mul_ps ( m_value, iOther.m_value ); }
+    inline SimdFloat operator/ ( const SimdFloat& iOther ) const    { return _mm256_div_ps ( m_value, iOther.m_value ); }
+    inline SimdFloat operator& ( const SimdFloat& iOther ) const    { return _mm256_and_ps ( m_value, iOther.m_value ); }
+    inline SimdFloat operator| ( const SimdFloat& iOther ) const    { return _mm256_or_ps ( m_value, iOther.m_value ); }
+    inline SimdFloat AndNot ( const SimdFloat& iOther ) const       { return _mm256_andnot_ps ( iOther.m_value, m_value ); }
+    inline SimdFloat Min ( const SimdFloat& iOther ) const          { return _mm256_min_ps ( m_value, iOther.m_value ); }
+    inline SimdFloat Max ( const SimdFloat& iOther ) const          { return _mm256_max_ps ( m_value, iOther.m_value ); }
+
+    inline SimdFloat operator< ( const SimdFloat& iOther ) const    { return _mm256_cmp_ps ( m_value, iOther.m_value, _CMP_LT_OQ ); }
+    inline SimdFloat operator<= ( const SimdFloat& iOther ) const   { return _mm256_cmp_ps ( m_value, iOther.m_value, _CMP_LE_OQ ); }
+    inline SimdFloat operator> ( const SimdFloat& iOther ) const    { return _mm256_cmp_ps ( m_value, iOther.m_value, _CMP_GT_OQ ); }
+    inline SimdFloat operator>= ( const SimdFloat& iOther ) const   { return _mm256_cmp_ps ( m_value, iOther.m_value, _CMP_GE_OQ ); }
+    inline SimdFloat NotLess ( const SimdFloat& iOther ) const      { return _mm256_cmp_ps ( m_value, iOther.m_value, _CMP_NLT_UQ ); }
+    inline SimdFloat NotGreater ( const SimdFloat& iOther ) const   { return _mm256_cmp_ps ( m_value, iOther.m_value, _CMP_NGT_UQ ); }
+#elif defined ( SIMDFLOAT_SSE )
+    static inline SimdFloat Broadcast ( const float& iValue )   { return _mm_set1_ps ( iValue ); }
+    static inline SimdFloat Load ( const float* iValues )       { return _mm_loadu_ps ( iValues ); }
+    inline void Store ( float* oValues ) const                  { _mm_storeu_ps ( oValues, m_value ); }
+    inline unsigned int GetMask () const                        { return _mm_movemask_ps ( m_value ); }
+
+    inline SimdFloat operator+ ( const SimdFloat& iOther ) const    { return _mm_add_ps ( m_value, iOther.m_value ); }
+    inline SimdFloat operator- ( const SimdFloat& iOther ) const    { return _mm_sub_ps ( m_value, iOther.m_value ); }
+    inline SimdFloat operator* ( const SimdFloat& iOther ) const    { return _mm_mul_ps ( m_value, iOther.m_value ); }
+    inline SimdFloat operator/ ( const SimdFloat& iOther ) const    { return _mm_div_ps ( m_value, iOther.m_value ); }
+    inline SimdFloat operator& ( const SimdFloat& iOther ) const    { return _mm_and_ps ( m_value, iOther.m_value ); }
+    inline SimdFloat operator| ( const SimdFloat& iOther ) const    { return _mm_or_ps ( m_value, iOther.m_value ); }
+    inline SimdFloat AndNot ( const SimdFloat& iOther ) const       { return _mm_andnot_ps ( iOther.m_value, m_value ); }
+    inline SimdFloat Min ( const SimdFloat& iOther ) const          { return _mm_min_ps ( m_value, iOther.m_value ); }
+    inline SimdFloat Max ( const SimdFloat& iOther ) const          { return _mm_max_ps ( m_value, iOther.m_value ); }
+
+    inline SimdFloat operator< ( const SimdFloat& iOther ) const    { return _mm_cmplt_ps ( m_value, iOther.m_value ); }
+    inline SimdFloat operator<= ( const SimdFloat& iOther ) const   { return _mm_cmple_ps ( m_value, iOther.m_value ); }
+    inline SimdFloat operator> ( const SimdFloat& iOther ) const    { return _mm_cmpgt_ps ( m_value, iOther.m_value ); }
+    inline SimdFloat operator>= ( const SimdFloat& iOther ) const   { return _mm_cmpge_ps ( m_value, iOther.m_value ); }
+    inline SimdFloat NotLess ( const SimdFloat& iOther ) const      { return _mm_cmpnlt_ps ( m_value, iOther.m_value ); }
+    inline SimdFloat NotGreater ( const SimdFloat& iOther ) const   { return _mm_cmpngt_ps ( m_value, iOther.m_value ); }
+#else
+    static inline SimdFloat Broadcast ( const float& iValue )
+    {
+        Register value;
+        for ( unsigned int i = 0; i < Width; i++ ) value.f[i] = iValue;
+        return value;
+    }
+    static inline SimdFloat Load ( const float* iValues )
+    {
+        Register value;
+        for ( unsigned int i = 0; i < Width; i++ ) value.f[i] = iValues[i];
+        return value;
+    }
+    inline void Store ( float* oValues ) const
+    {
+        for ( unsigned int i = 0; i < Width; i++ ) oValues[i] = m_value.f[i];
+    }
+    inline unsigned int GetMask () const
+    {
+        unsigned int mask = 0u;
+        for ( unsigned int i = 0; i < Width; i++ ) mask |= ( m_value.u[i] >> 31 ) << i;
+        return mask;
+    }
+
+    inline SimdFloat operator+ ( const SimdFloat& iOther ) const    { Register r; for ( unsigned int i = 0; i < Width; i++ ) r.f[i] = m_value.f[i] + iOther.m_value.f[i]; return r; }
+    inline SimdFloat operator- ( const SimdFloat& iOther ) const    { Register r; for ( unsigned int i = 0; i < Width; i++ ) r.f[i] = m_value.f[i] - iOther.m_value.f[i]; return r; }
+    inline SimdFloat operator* ( const SimdFloat& iOther ) const    { Register r; for ( unsigned int i = 0; i < Width; i++ ) r.f[i] = m_value.f[i] * iOther.m_value.f[i]; return r; }
+    inline SimdFloat operator/ ( const SimdFloat& iOther ) const    { Register r; for ( unsigned int i = 0; i < Width; i++ ) r.f[i] = m_value.f[i] / iOther.m_value.f[i]; return r; }
+    inline SimdFloat operator& ( const SimdFloat& iOther ) const    { Register r; for ( unsigned int i = 0; i < Width; i++ ) r.u[i] = m_value.u[i] & iOther.m_value.u[i]; return r; }
+    inline SimdFloat operator| ( const SimdFloat& iOther ) const    { Register r; for ( unsigned int i = 0; i < Width; i++ ) r.u[i] = m_value.u[i] | iOther.m_value.u[i]; return r; }
+    inline SimdFloat AndNot ( const SimdFloat& iOther ) const       { Register r; for ( unsigned int i = 0; i < Width; i++ ) r.u[i] = m_value.u[i] & ~iOther.m_value.u[i]; return r; }
+    inline SimdFloat Min ( const SimdFloat& iOther ) const          { Register r; for ( unsigned int i = 0; i < Width; i++ ) r.f[i] = ( m_value.f[i] < iOther.m_value.f[i] ) ? m_value.f[i] : iOther.m_value.f[i]; return r; }
+    inline SimdFloat Max ( const SimdFloat& iOther ) const          { Register r; for ( unsigned int i = 0; i < Width; i++ ) r.f[i] = ( m_value.f[i] > iOther.m_value.f[i] ) ? m_value.f[i] : iOther.m_value.f[i]; return r; }
+
+    inline SimdFloat operator< ( const SimdFloat& iOther ) const    { Register r; for ( unsigned int i = 0; i < Width; i++ ) r.u[i] = ( m_value.f[i] < iOther.m_value.f[i] ) ? ~0u : 0u; return r; }
+    inline SimdFloat operator<= ( const SimdFloat& iOther ) const   { Register r; for ( unsigned int i = 0; i < Width; i++ ) r.u[i] = ( m_value.f[i] <= iOther.m_value.f[i] ) ? ~0u : 0u; return r; }
+    inline SimdFloat operator> ( const SimdFloat& iOther ) const    { Register r; for ( unsigned int i = 0; i < Width; i++ ) r.u[i] = ( m_value.f[i] > iOther.m_value.f[i] ) ? ~0u : 0u; return r; }
+    inline SimdFloat operator>= ( const SimdFloat& iOther ) const   { Register r; for ( unsigned int i = 0; i < Width; i++ ) r.u[i] = ( m_value.f[i] >= iOther.m_value.f[i] ) ? ~0u : 0u; return r; }
+    inline SimdFloat NotLess ( const SimdFloat& iOther ) const      { Register r; for ( unsigned int i = 0; i < Width; i++ ) r.u[i] = !( m_value.f[i] < iOther.m_value.f[i] ) ? ~0u : 0u; return r; }
+    inline SimdFloat NotGreater ( const SimdFloat& iOther ) const   { Register r; for ( unsigned int i = 0; i < Width; i++ ) r.u[i] = !( m_value.f[i] > iOther.m_value.f[i] ) ? ~0u : 0u; return r; }
+#endif
+
+    /*!
+     *  \brief  Picks the lanes of one of two values according to a mask.
+     *
+     *  \param  iMask       The mask.
+     *  \param  iSet        The values of the lanes set in the mask.
+     *  \param  iCleared    The values of the lanes cleared in the mask.
+     */
+    static inline SimdFloat Select (
+        const SimdFloat&    iMask,
+        const SimdFloat&    iSet,
+        const SimdFloat&    iCleared
+    ) {
+        return ( iSet & iMask ) | iCleared.AndNot ( iMask );
+    }
+
+};
+
+#endif // _SIMDFLOAT_H_
@@ -0,0 +1,237 @@
+#include "TileScheduler.h"
+
+#include <algorithm>
+
+namespace {
+
+    /*!
+     *  \brief  Spreads the bits of a tile coordinate apart, so that the Morton
+     *          code of a tile is the interleaving of both of its coordinates.
+     */
+    inline unsigned int SpreadBits (
+        unsigned int            iValue
+    ) {
+        iValue &= 0x0000ffffu;
+        iValue = ( iValue | ( iValue << 8 ) ) & 0x00ff00ffu;
+        iValue = ( iValue | ( iValue << 4 ) ) & 0x0f0f0f0fu;
+        iValue = ( iValue | ( iValue << 2 ) ) & 0x33333333u;
+        iValue = ( iValue | ( iValue << 1 ) ) & 0x55555555u;
+        return iValue;
+    }
+
+    /*!
+     *  \brief  Orders tiles along the Morton curve.
+     */
+    struct MortonOrder {
+        inline bool operator() (
+            const RenderTile&   iA,
+            const RenderTile&   iB
+        ) const {
+            const unsigned int a = SpreadBits ( iA.x0 / RenderTileSize ) | ( SpreadBits ( iA.y0 / RenderTileSize ) << 1 );
+            const unsigned int b = SpreadBits ( iB.x0 / RenderTileSize ) | ( SpreadBits ( iB.y0 / RenderTileSize ) << 1 );
+            return a < b;
+        }
+    };
+
+}
+
+/*!
+ * \inheaderfile
+ */
+std::vector< RenderTile > TileScheduler::CutImage (
+    const unsigned int&     iWidth,
+    const unsigned int&     iHeight
+) {
+    std::vector< RenderTile > tiles;
+    for ( unsigned int y = 0; y < iHeight; y += RenderTileSize ) {
+        for ( unsigned int x = 0; x < iWidth; x += RenderTileSize ) {
+            RenderTile tile = {
+                x,
+                y,
+                std::min ( x + RenderTileSize, iWidth ),
+                std::min ( y + RenderTileSize, iHeight ),
+                0u,
+                0.0
+            };
+            tiles.push_back ( tile );
+        }
+    }
+    std::sort ( tiles.begin (), tiles.end (), MortonOrder () );
+
+    return tiles;
+}
+
+/*!
+ * \inheaderfile
+ */
+TileScheduler::TileScheduler (
+    const std::vector< RenderTile >&    iTiles,
+    const unsigned int&                 iThreadCount
+)   :   m_tiles ( iTiles ),
+        m_runs ( std::max ( iThreadCount, 1u ) ),
+        m_renderedPixels ( 0u ),
+        m_steals ( 0u ),
+        m_pixelCount ( 0u )
+{
+    for ( unsigned int i = 0; i < m_tiles.size (); i++ ) {
+        m_pixelCount += ( m_tiles[i].x1 - m_tiles[i].x0 ) * ( m_tiles[i].y1 - m_tiles[i].y0 );
+    }
+
+    // Every thread starts with an equal run of consecutive tiles.
+    const unsigned int threadCount = m_runs.size ();
+    const unsigned int tileCount   = m_tiles.size ();
+    for ( unsigned int thread = 0; thread < threadCount; thread++ ) {
+        m_runs[thread] = PackRun (
+            ( tileCount * thread ) / threadCount,
+            ( tileCount * ( thread + 1 ) ) / threadCount
+        );
+    }
+}
+
+/*!
+ * \inheaderfile
+ */
+bool TileScheduler::TakeFront (
+    const unsigned int&     iThread,
+    unsigned int&           oTile
+) {
+    std::atomic< unsigned long long >& run = m_runs[iThread];
+
+    unsigned long long current = run.load ();
+    for ( ;; ) {
+        const unsigned int begin = (unsigned int) ( current >> 32 );
+        const unsigned int end   = (unsigned int) current;
+        if ( begin >= end ) {
+            return false;
+        }
+
+        // On failure, current is reloaded with the run left by a thief.
+        if ( run.compare_exchange_weak ( current, PackRun ( begin + 1, end ) ) ) {
+            oTile = begin;
+            return true;
+        }
+    }
+}
+
+/*!
+ * \inheaderfile
+ */
+bool TileScheduler::StealBack (
+    const unsigned int&     iVictim,
+    unsigned int&           oBegin,
+    unsigned int&           oEnd
+) {
+    std::atomic< unsigned long long >& run = m_runs[iVictim];
+
+    unsigned long long current = run.load ();
+    for ( ;; ) {
+        const unsigned int begin = (unsigned int) ( current >> 32 );
+        const unsigned int end   = (unsigned int) current;
+        if ( begin >= end ) {
+            return false;
+        }
+
+        // The victim keeps the front half, the one it is about to render.
+        const unsigned int middle = end - ( end - begin + 1 ) / 2;
+        if ( run.compare_exchange_weak ( current, PackRun ( begin, middle ) ) ) {
+            oBegin = middle;
+            oEnd   = end;
+            return true;
+        }
+    }
+}
+
+/*!
+ * \inheaderfile
+ */
+bool TileScheduler::Next (
+    const unsigned int&     iThread,
+    unsigned int&           oTile
+) {
+    if ( TakeFront ( iThread, oTile ) ) {
+        return true;
+    }
+
+    // Runs shrink, but a thief refills its own run with the tiles it
+    // stole, possibly after this thread scanned it: runs are scanned
+    // again as long as steals completed during the previous scan. A
+    // steal still under way when the last scan ends may be missed,
+    // which only costs balance: the thief renders those tiles itself.
+    const unsigned int threadCount = m_runs.size ();
+    for ( ;; ) {
+        const unsigned int steals = m_steals.load ();
+        for ( unsigned int i = 1; i < threadCount; i++ ) {
+            unsigned int begin = 0, end = 0;
+            if ( StealBack ( ( iThread + i ) % threadCount, begin, end ) ) {
+                // Only thieves write to an empty run, and none
+                // steals from one: a plain store is enough.
+                m_runs[iThread] = PackRun ( begin + 1, end );
+
+                // Counted once the run is refilled, so that scans
+                // seeing the count change also see the run.
+                m_steals++;
+
+                oTile = begin;
+                return true;
+            }
+        }
+
+        if ( m_steals.load () == steals ) {
+            break;
+        }
+    }
+
+    return false;
+}
+
+/*!
+ * \inheaderfile
+ */
+void TileScheduler::Finish (
+    const unsigned int&     iTile,
+    const unsigned int&     iThread,
+    const double&           iSeconds
+) {
+    // Every tile is handed to a single thread.
+    RenderTile& tile = m_tiles[iTile];
+    tile.thread  = iThread;
+    tile.seconds = iSeconds;
+
+    m_renderedPixels.fetch_add (
+        ( tile.x1 - tile.x0 ) * ( tile.y1 - tile.y0 ),
+        std::memory_order_relaxed
+    );
+}
+
+/*!
+ * \inheaderfile
+ */
+void TileScheduler::PrintStatistics (
+    std::ostream&           ioStream
+) const {
+    if ( m_tiles.empty () ) {
+        return;
+    }
+
+    std::vector< double > threadSeconds ( m_runs.size (), 0.0 );
+    double total   = 0.0;
+    double slowest = 0.0;
+    for ( unsigned int i = 0; i < m_tiles.size (); i++ ) {
+        threadSeconds[m_tiles[i].thread] += m_tiles[i].seconds;
+        total   += m_tiles[i].seconds;
+        slowest  = std::max ( slowest, m_tiles[i].seconds );
+    }
+
+    // A perfectly balanced render keeps all threads busy for the mean time.
+    const double busiest = *std::max_element ( threadSeconds.begin (), threadSeconds.end () );
+    const double mean    = total / threadSeconds.size ();
+
+    ioStream << "Tiles: " << m_tiles.size ()
+             << " (" << RenderTileSize << "x" << RenderTileSize << ")"
+             << ", mean " << ( 1000.0 * total / m_tiles.size () ) << "ms"
+             << ", slowest " << ( 1000.0 * slowest ) << "ms"
+             << ", steals " << m_steals.load ()
+             << ", busiest thread " << busiest << "s"
+             << " (" << ( ( mean > 0.0 ) ? 100.0 * ( busiest / mean - 1.0 ) : 0.0 ) << "% over the mean)"
+             << std::endl;
+}
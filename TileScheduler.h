@@ -0,0 +1,177 @@
+#ifndef _TILESCHEDULER_H_
+#define _TILESCHEDULER_H_
+
+#include <atomic>
+#include <ostream>
+#include <vector>
+
+/*!
+ *  \brief  The width and height, in pixels, of the tiles an image is rendered by.
+ *          A multiple of the packet tile sizes.
+ */
+const unsigned int RenderTileSize = 16;
+
+/*!
+ *  \brief  A rectangle of pixels rendered by a single thread, and how long it took.
+ */
+struct RenderTile {
+    unsigned int    x0;         //!< The first column of the tile.
+    unsigned int    y0;         //!< The first row of the tile.
+    unsigned int    x1;         //!< The column after the last one of the tile.
+    unsigned int    y1;         //!< The row after the last one of the tile.
+    unsigned int    thread;     //!< The thread that rendered the tile.
+    double          seconds;    //!< The time spent rendering the tile.
+};
+
+/*!
+ *  \brief  Hands the tiles of an image out to a pool of threads, with work stealing.
+ *
+ *  Tiles are sorted along a Morton (Z-order) curve, so that consecutive tiles are
+ *  neighbors in the image and their rays visit the same parts of the acceleration
+ *  structure. Every thread starts with a contiguous run of that order and takes its
+ *  tiles from the front; a thread whose run is empty steals the back half of the
+ *  run of another thread. Runs are packed in a single atomic word each and updated
+ *  by compare-and-swap, so that neither taking nor stealing a tile ever locks.
+ *
+ *  The number of pixels rendered is counted atomically, for progress reports, and
+ *  the time spent on every tile is kept for load-balance analysis.
+ */
+class TileScheduler {
+private:
+    std::vector< RenderTile >                   m_tiles;            //!< The tiles, in Morton order.
+    std::vector< std::atomic< unsigned long long > > m_runs;        //!< The first and past-the-last tile of every thread's run, packed.
+    std::atomic< unsigned int >                 m_renderedPixels;   //!< The number of pixels of the tiles finished so far.
+    std::atomic< unsigned int >                 m_steals;           //!< The number of runs stolen so far.
+    unsigned int                                m_pixelCount;       //!< The number of pixels of all tiles.
+
+    /*!
+     *  \brief  Packs a run of tiles in a single word.
+     */
+    static inline unsigned long long PackRun (
+        const unsigned int&     iBegin,
+        const unsigned int&     iEnd
+    ) {
+        return ( (unsigned long long) iBegin << 32 ) | iEnd;
+    }
+
+    /*!
+     *  \brief  Takes the first tile of a thread's run.
+     *
+     *  \param  iThread     The thread whose run the tile is taken from.
+     *  \param  oTile       Where to place the index of the tile.
+     *  \return false iff the run was empty.
+     */
+    bool TakeFront (
+        const unsigned int&     iThread,
+        unsigned int&           oTile
+    );
+
+    /*!
+     *  \brief  Steals the back half of another thread's run.
+     *
+     *  \param  iVictim     The thread whose run is stolen.
+     *  \param  oBegin      Where to place the first stolen tile.
+     *  \param  oEnd        Where to place the tile after the last stolen one.
+     *  \return false iff the run was empty.
+     */
+    bool StealBack (
+        const unsigned int&     iVictim,
+        unsigned int&           oBegin,
+        unsigned int&           oEnd
+    );
+
+public:
+    /*!
+     *  \brief  Cuts an image into tiles of RenderTileSize pixels.
+     *
+     *  \param  iWidth      The width of the image, in pixels.
+     *  \param  iHeight     The height of the image, in pixels.
+     *  \return The tiles, in Morton order.
+     */
+    static std::vector< RenderTile > CutImage (
+        const unsigned int&     iWidth,
+        const unsigned int&     iHeight
+    );
+
+    /*!
+     *  \brief  Shares tiles between threads.
+     *
+     *  \param  iTiles      The tiles to be rendered, as given by CutImage or a
+     *                      subset of them.
+     *  \param  iThreadCount    The number of threads that will take tiles.
+     */
+    TileScheduler (
+        const std::vector< RenderTile >&    iTiles,
+        const unsigned int&                 iThreadCount
+    );
+
+    /*!
+     *  \brief  Gives a thread the next tile to render, from its own run or from
+     *          another thread's.
+     *
+     *  \param  iThread     The index of the thread, below the thread count.
+     *  \param  oTile       Where to place the index of the tile.
+     *  \return false once no tile is left.
+     */
+    bool Next (
+        const unsigned int&     iThread,
+        unsigned int&           oTile
+    );
+
+    /*!
+     *  \brief  Records that a tile was rendered.
+     *
+     *  \param  iTile       The index of the tile.
+     *  \param  iThread     The thread that rendered it.
+     *  \param  iSeconds    The time spent rendering it.
+     */
+    void Finish (
+        const unsigned int&     iTile,
+        const unsigned int&     iThread,
+        const double&           iSeconds
+    );
+
+    /*!
+     *  \return The tile of an index given by Next.
+     */
+    inline const RenderTile& GetTile (
+        const unsigned int&     iTile
+    ) const {
+        return m_tiles[iTile];
+    }
+
+    /*!
+     *  \return All tiles, in Morton order, with the time spent on those finished.
+     */
+    inline const std::vector< RenderTile >& GetTiles () const
+    {
+        return m_tiles;
+    }
+
+    /*!
+     *  \return The number of pixels of the tiles finished so far.
+     */
+    inline unsigned int GetRenderedPixels () const
+    {
+        return m_renderedPixels.load ( std::memory_order_relaxed );
+    }
+
+    /*!
+     *  \return The number of pixels of all tiles.
+     */
+    inline const unsigned int& GetPixelCount () const
+    {
+        return m_pixelCount;
+    }
+
+    /*!
+     *  \brief  Prints the time spent on the tiles and by every thread.
+     *
+     *  \param  ioStream    The stream the report is written to.
+     */
+    void PrintStatistics (
+        std::ostream&           ioStream
+    ) const;
+};
+
+#endif // _TILESCHEDULER_H_
@@ -0,0 +1,285 @@
+#include "TriangleStore.h"
+
+#include <limits>
+
+/*!
+ * \inheaderfile
+ */
+TriangleStore::TriangleStore (
+    const std::vector< Object >&    iObjects
+) {
+    for ( unsigned int obj = 0; obj < iObjects.size (); obj++ ) {
+        Append (
+            iObjects[obj],
+            iObjects[obj].getTrans ()
+        );
+    }
+
+    m_bounds = GetBounds ( GetIndices () );
+}
+
+/*!
+ * \inheaderfile
+ */
+TriangleStore::TriangleStore (
+    const Object&                   iObject
+) {
+    Append (
+        iObject,
+        Vec3Df ( 0.0f, 0.0f, 0.0f )
+    );
+
+    m_bounds = GetBounds ( GetIndices () );
+}
+
+/*!
+ * \inheaderfile
+ */
+void TriangleStore::Append (
+    const Object&           iObject,
+    const Vec3Df&           iTranslation
+) {
+    const Mesh& mesh = iObject.getMesh ();
+    const unsigned int offset = GetSize ();
+    const unsigned int objectTriangleCount = mesh.getTriangles ().size ();
+    const unsigned int triangleCount = offset + objectTriangleCount;
+
+    const unsigned int objectId = m_objects.size ();
+    m_objects.push_back ( &iObject );
+
+    for ( unsigned int axis = 0; axis < 3; axis++ ) {
+        for ( unsigned int vertex = 0; vertex < 3; vertex++ ) {
+            m_vertices[vertex][axis].Resize ( triangleCount );
+        }
+        m_e1[axis].Resize ( triangleCount );
+        m_e2[axis].Resize ( triangleCount );
+        m_normals[axis].Resize ( triangleCount );
+    }
+    m_objectIds.Resize ( triangleCount );
+    m_triangleIds.Resize ( triangleCount );
+
+    // The triangles of an object are copied concurrently.
+    #pragma omp parallel for
+    for ( unsigned int tri = 0; tri < objectTriangleCount; tri++ ) {
+        const Triangle& triangle = mesh.getTriangles ()[tri];
+        const unsigned int index = offset + tri;
+
+        // Translates the vertices.
+        Vec3Df positions[3];
+        for ( unsigned int vertex = 0; vertex < 3; vertex++ ) {
+            positions[vertex] = mesh.getVertices ()[triangle.getVertex ( vertex )].getPos ()
+                              + iTranslation;
+        }
+
+        const Vec3Df e1 = positions[1] - positions[0];
+        const Vec3Df e2 = positions[2] - positions[0];
+        const Vec3Df normal = Vec3Df::crossProduct ( e1, e2 );
+
+        for ( unsigned int axis = 0; axis < 3; axis++ ) {
+            for ( unsigned int vertex = 0; vertex < 3; vertex++ ) {
+                m_vertices[vertex][axis][index] = positions[vertex][axis];
+            }
+            m_e1[axis][index] = e1[axis];
+            m_e2[axis][index] = e2[axis];
+            m_normals[axis][index] = normal[axis];
+        }
+
+        m_objectIds[index]   = objectId;
+        m_triangleIds[index] = tri;
+    }
+}
+
+/*!
+ * \inheaderfile
+ */
+std::size_t TriangleStore::GetMemoryUsage () const
+{
+    // Per triangle: 3 vertices, 2 edges and a normal, then 2 indices.
+    const std::size_t triangleBytes = 6 * 3 * sizeof ( float ) + 2 * sizeof ( unsigned int );
+
+    return GetSize () * triangleBytes + m_objects.size () * sizeof ( const Object* );
+}
+
+/*!
+ * \inheaderfile
+ */
+TriangleIndexVector TriangleStore::GetIndices () const
+{
+    TriangleIndexVector indices ( GetSize () );
+
+    for ( unsigned int i = 0; i < indices.size (); i++ ) {
+        indices[i] = i;
+    }
+
+    return indices;
+}
+
+/*!
+ * \inheaderfile
+ */
+BoundingBox TriangleStore::GetBounds (
+    const unsigned int&     iTriangle
+) const {
+    BoundingBox bounds ( GetVertex ( iTriangle, 0 ) );
+    bounds.extendTo ( GetVertex ( iTriangle, 1 ) );
+    bounds.extendTo ( GetVertex ( iTriangle, 2 ) );
+
+    return bounds;
+}
+
+/*!
+ * \inheaderfile
+ */
+BoundingBox TriangleStore::GetBounds (
+    const TriangleIndexVector&  iTriangles
+) const {
+    const float inf = std::numeric_limits<float>::infinity ();
+
+    float minBb[3] = {  inf,  inf,  inf };
+    float maxBb[3] = { -inf, -inf, -inf };
+
+    for (
+        TriangleIndexVector::const_iterator it = iTriangles.begin ();
+        it != iTriangles.end ();
+        it++
+    ) {
+        for ( unsigned int axis = 0; axis < 3; axis++ ) {
+            float lo, hi;
+            GetExtent ( *it, axis, lo, hi );
+
+            minBb[axis] = std::min ( minBb[axis], lo );
+            maxBb[axis] = std::max ( maxBb[axis], hi );
+        }
+    }
+
+    return BoundingBox (
+        Vec3Df ( minBb[0], minBb[1], minBb[2] ),
+        Vec3Df ( maxBb[0], maxBb[1], maxBb[2] )
+    );
+}
+
+/*!
+ * \inheaderfile
+ */
+bool TriangleStore::Intersects (
+    const unsigned int&     iTriangle,
+    const BoundingBox&      iRegion
+) const {
+    for ( unsigned int axis = 0; axis < 3; axis++ ) {
+        float lo, hi;
+        GetExtent ( iTriangle, axis, lo, hi );
+
+        // If all of the vertices' coordinates along an axis are below the
+        // lower boundary of the bounding box, or above its upper boundary,
+        // there's no intersection.
+        if (
+                ( hi < iRegion.getMin ()[axis] )
+            ||  ( lo > iRegion.getMax ()[axis] )
+        ) {
+            return false;
+        }
+    }
+
+    // Otherwise, an intersection occurs.
+    return true;
+}
+
+/*!
+ * \inheaderfile
+ */
+Vec3Df TriangleStore::GetInterpolatedNormal (
+    const unsigned int&     iTriangle,
+    const float&            iU,
+    const float&            iV
+) const {
+    const Mesh& mesh = GetObject ( iTriangle )->getMesh ();
+    const Triangle& triangle = mesh.getTriangles ()[GetTriangleIndex ( iTriangle )];
+
+    return ( 1 - iU - iV ) * mesh.getVertices ()[triangle.getVertex ( 0 )].getNormal ()
+         +       iU        * mesh.getVertices ()[triangle.getVertex ( 1 )].getNormal ()
+         +       iV        * mesh.getVertices ()[triangle.getVertex ( 2 )].getNormal ();
+}
+
+/*!
+ * \inheaderfile
+ */
+void TriangleStore::Save (
+    CacheWriter&            ioWriter
+) const {
+    for ( unsigned int vertex = 0; vertex < 3; vertex++ ) {
+        for ( unsigned int axis = 0; axis < 3; axis++ ) {
+            ioWriter.WriteArray ( m_vertices[vertex][axis] );
+        }
+    }
+    for ( unsigned int axis = 0; axis < 3; axis++ ) {
+        ioWriter.WriteArray ( m_e1[axis] );
+        ioWriter.WriteArray ( m_e2[axis] );
+        ioWriter.WriteArray ( m_normals[axis] );
+    }
+    ioWriter.WriteArray ( m_objectIds );
+    ioWriter.WriteArray ( m_triangleIds );
+
+    ioWriter.Write ( m_bounds.getMin () );
+    ioWriter.Write ( m_bounds.getMax () );
+    ioWriter.Write ( (unsigned int) m_objects.size () );
+}
+
+/*!
+ * \inheaderfile
+ */
+bool TriangleStore::Map (
+    CacheReader&                    ioReader,
+    const std::vector< Object >&    iObjects
+) {
+    for ( unsigned int vertex = 0; vertex < 3; vertex++ ) {
+        for ( unsigned int axis = 0; axis < 3; axis++ ) {
+            ioReader.ReadArray ( m_vertices[vertex][axis] );
+        }
+    }
+    for ( unsigned int axis = 0; axis < 3; axis++ ) {
+        ioReader.ReadArray ( m_e1[axis] );
+        ioReader.ReadArray ( m_e2[axis] );
+        ioReader.ReadArray ( m_normals[axis] );
+    }
+    ioReader.ReadArray ( m_objectIds );
+    ioReader.ReadArray ( m_triangleIds );
+
+    Vec3Df minBb, maxBb;
+    unsigned int objectCount = 0;
+    ioReader.Read ( minBb );
+    ioReader.Read ( maxBb );
+    ioReader.Read ( objectCount );
+    m_bounds = BoundingBox ( minBb, maxBb );
+
+    // Object pointers are only valid for this run: they are rebuilt
+    // from the objects the store was created from.
+    m_objects.clear ();
+    if (
+            !ioReader.IsValid ()
+        ||  ( objectCount != iObjects.size () )
+    ) {
+        return false;
+    }
+    for ( unsigned int obj = 0; obj < iObjects.size (); obj++ ) {
+        m_objects.push_back ( &iObjects[obj] );
+    }
+
+    // Every array must describe as many triangles as the first one.
+    const unsigned int triangleCount = m_vertices[0][0].GetSize ();
+    for ( unsigned int axis = 0; axis < 3; axis++ ) {
+        if (
+                ( m_vertices[0][axis].GetSize () != triangleCount )
+            ||  ( m_vertices[1][axis].GetSize () != triangleCount )
+            ||  ( m_vertices[2][axis].GetSize () != triangleCount )
+            ||  ( m_e1[axis].GetSize () != triangleCount )
+            ||  ( m_e2[axis].GetSize () != triangleCount )
+            ||  ( m_normals[axis].GetSize () != triangleCount )
+        ) {
+            return false;
+        }
+    }
+
+    return
+            ( m_triangleIds.GetSize () == triangleCount )
+        &&  ( m_objectIds.GetSize () == triangleCount );
+}
@@ -0,0 +1,379 @@
+#ifndef _TRIANGLESTORE_H_
+#define _TRIANGLESTORE_H_
+
+#include <algorithm>
+#include <vector>
+#include "BoundingBox.h"
+#include "CacheFile.h"
+#include "MappedArray.h"
+#include "Object.h"
+#include "RayPacket.h"
+#include "Ray.h"
+#include "Vec3D.h"
+
+#undef GetObject       //special for windows
+
+/*!
+ *  \brief  The vector used to refer to triangles of a TriangleStore.
+ */
+typedef std::vector< unsigned int >     TriangleIndexVector;
+
+/*!
+ *  \brief  A compact, structure-of-arrays copy of the triangles of a set of objects.
+ *
+ *  Each triangle is described by the positions of its vertices (translated by its
+ *  object's translation) and its two edges from the first vertex, precomputed for
+ *  the ray-triangle test, plus the index of its object and its index on the object's
+ *  mesh. Acceleration structures refer to triangles by their 32-bit index in the store.
+ *  Everything else (normals, surfels) is fetched from the object's mesh once an
+ *  intersection is found.
+ */
+class TriangleStore {
+private:
+    MappedArray< float >            m_vertices[3][3];   //!< The coordinates of every vertex of every triangle, per vertex and axis.
+    MappedArray< float >            m_e1[3];            //!< The coordinates of the edge from the first to the second vertex, per axis.
+    MappedArray< float >            m_e2[3];            //!< The coordinates of the edge from the first to the third vertex, per axis.
+    MappedArray< float >            m_normals[3];       //!< The coordinates of the unnormalized geometric normal E1 x E2, per axis.
+    MappedArray< unsigned int >     m_objectIds;        //!< The index of the object owning every triangle.
+    MappedArray< unsigned int >     m_triangleIds;      //!< The index of every triangle on its object's mesh.
+    std::vector< const Object* >    m_objects;          //!< The objects owning the triangles.
+    BoundingBox                     m_bounds;           //!< The bounding box of all triangles.
+
+    /*!
+     *  \brief  Appends the triangles of an object to the store.
+     *
+     *  \param  iObject         The object whose triangles should be stored.
+     *  \param  iTranslation    The translation applied to the object's vertices.
+     */
+    void Append (
+        const Object&           iObject,
+        const Vec3Df&           iTranslation
+    );
+
+public:
+    /*!
+     *  \brief  Creates an empty store.
+     */
+    inline TriangleStore () {}
+
+    /*!
+     *  \brief  Copies all triangles of a set of objects, translated to their
+     *          position in the scene.
+     *
+     *  \param  iObjects    The objects whose triangles should be stored. They must
+     *                      outlive the store.
+     */
+    TriangleStore (
+        const std::vector< Object >&    iObjects
+    );
+
+    /*!
+     *  \brief  Copies all triangles of a single object, in the object's own space.
+     *
+     *  The object's translation is ignored, so that the store can be shared by all
+     *  objects with the same mesh and doesn't change when the object is moved.
+     *
+     *  \param  iObject     The object whose triangles should be stored. It must
+     *                      outlive the store.
+     */
+    TriangleStore (
+        const Object&                   iObject
+    );
+
+    /*!
+     *  \brief  Writes the store to a cache file.
+     *
+     *  \param  ioWriter    The cache file being written.
+     */
+    void Save (
+        CacheWriter&            ioWriter
+    ) const;
+
+    /*!
+     *  \brief  Reads a store written by Save from a mapped cache file, in place.
+     *
+     *  \param  ioReader    The cache file being read. It must outlive the store.
+     *  \param  iObjects    The objects the store was built from, in the same order.
+     *                      They must outlive the store.
+     *  \return true iff the store was read and matches the objects.
+     */
+    bool Map (
+        CacheReader&                    ioReader,
+        const std::vector< Object >&    iObjects
+    );
+
+    /*!
+     *  \return The number of bytes used by the triangles of the store.
+     */
+    std::size_t GetMemoryUsage () const;
+
+    /*!
+     *  \return The number of triangles in the store.
+     */
+    inline unsigned int GetSize () const
+    {
+        return m_objectIds.GetSize ();
+    }
+
+    /*!
+     *  \return A constant reference to the bounding box of all triangles.
+     */
+    inline const BoundingBox& GetBounds () const
+    {
+        return m_bounds;
+    }
+
+    /*!
+     *  \return The indices of all triangles in the store, in order.
+     */
+    TriangleIndexVector GetIndices () const;
+
+    /*!
+     *  \brief  Accesses the position of a vertex of a triangle.
+     *
+     *  \param  iTriangle   The index of the triangle in the store.
+     *  \param  iVertex     The index of the vertex in the triangle (0, 1 or 2).
+     *  \return The translated position of the vertex.
+     */
+    inline Vec3Df GetVertex (
+        const unsigned int&     iTriangle,
+        const unsigned int&     iVertex
+    ) const {
+        return Vec3Df (
+            m_vertices[iVertex][0][iTriangle],
+            m_vertices[iVertex][1][iTriangle],
+            m_vertices[iVertex][2][iTriangle]
+        );
+    }
+
+    /*!
+     *  \brief  Calculates the extent of a triangle along an axis.
+     *
+     *  \param  iTriangle   The index of the triangle in the store.
+     *  \param  iAxis       The axis along which the extent is measured.
+     *  \param  oMin        Where to place the lower end of the extent.
+     *  \param  oMax        Where to place the upper end of the extent.
+     */
+    inline void GetExtent (
+        const unsigned int&     iTriangle,
+        const unsigned int&     iAxis,
+        float&                  oMin,
+        float&                  oMax
+    ) const {
+        const float p0 = m_vertices[0][iAxis][iTriangle];
+        const float p1 = m_vertices[1][iAxis][iTriangle];
+        const float p2 = m_vertices[2][iAxis][iTriangle];
+
+        oMin = std::min ( std::min ( p0, p1 ), p2 );
+        oMax = std::max ( std::max ( p0, p1 ), p2 );
+    }
+
+    /*!
+     *  \brief  Calculates the bounding box of a triangle.
+     *
+     *  \param  iTriangle   The index of the triangle in the store.
+     *  \return The bounding box of the triangle's vertices.
+     */
+    BoundingBox GetBounds (
+        const unsigned int&     iTriangle
+    ) const;
+
+    /*!
+     *  \brief  Calculates the bounding box of a set of triangles.
+     *
+     *  \param  iTriangles  The indices of the triangles in the store.
+     *  \return The bounding box of all vertices of the triangles.
+     */
+    BoundingBox GetBounds (
+        const TriangleIndexVector&  iTriangles
+    ) const;
+
+    /*!
+     *  \brief  Tests if a triangle intersects a given bounding box.
+     *
+     *  An intersection occurs when the triangle's vertices are not all on the same
+     *  outer side of one of the bounding box's planes.
+     *
+     *  \param  iTriangle       The index of the triangle in the store.
+     *  \param  iRegion         The bounding box to test against.
+     *  \return true iff there is an intersection.
+     */
+    bool Intersects (
+        const unsigned int&     iTriangle,
+        const BoundingBox&      iRegion
+    ) const;
+
+    /*!
+     *  \brief  Tests a ray against a triangle, culling backfaces.
+     *
+     *  A variant of the Moller-Trumbore test that uses the triangle's precomputed
+     *  edges and normal, entirely in single precision. The distance is computed
+     *  first, so that triangles outside of the ray's segment are rejected before
+     *  the barycentric coordinates are.
+     *
+     *  \param  iTriangle   The index of the triangle in the store.
+     *  \param  iRay        The ray to be tested.
+     *  \param  iNear       The minimum distance of the intersection.
+     *  \param  iFar        The maximum distance of the intersection.
+     *  \param  oT          Where to place the distance from the ray's origin.
+     *  \param  oU          Where to place the barycentric coordinate U.
+     *  \param  oV          Where to place the barycentric coordinate V.
+     *  \return true iff the ray hits the front face of the triangle within [iNear, iFar].
+     */
+    inline bool Intersect (
+        const unsigned int&     iTriangle,
+        const Ray&              iRay,
+        const float&            iNear,
+        const float&            iFar,
+        float&                  oT,
+        float&                  oU,
+        float&                  oV
+    ) const {
+        const Vec3Df& direction = iRay.getDirection ();
+        const Vec3Df  normal ( m_normals[0][iTriangle], m_normals[1][iTriangle], m_normals[2][iTriangle] );
+
+        // The determinant of [-direction, E1, E2], which is
+        // -direction . N since N = E1 x E2.
+        const float det = -Vec3Df::dotProduct ( direction, normal );
+
+        // Rejects backfaces, and rays parallel to the triangle.
+        if ( det < float ( EPSILON ) ) {
+            return false;
+        }
+
+        const float invDet = 1.0f / det;
+
+        // Translates the origin of the ray along with the triangle
+        const Vec3Df v0 ( m_vertices[0][0][iTriangle], m_vertices[0][1][iTriangle], m_vertices[0][2][iTriangle] );
+        const Vec3Df T = iRay.getOrigin () - v0;
+
+        oT = Vec3Df::dotProduct ( T, normal ) * invDet;
+        if ( oT < iNear || oT > iFar ) {
+            return false;
+        }
+
+        // R = T x direction
+        const Vec3Df R  = Vec3Df::crossProduct ( T, direction );
+        const Vec3Df e2 ( m_e2[0][iTriangle], m_e2[1][iTriangle], m_e2[2][iTriangle] );
+
+        oU = Vec3Df::dotProduct ( e2, R ) * invDet;
+        if ( oU < 0.0f || oU > 1.0f ) {
+            return false;
+        }
+
+        const Vec3Df e1 ( m_e1[0][iTriangle], m_e1[1][iTriangle], m_e1[2][iTriangle] );
+
+        oV = -Vec3Df::dotProduct ( e1, R ) * invDet;
+        if ( oV < 0.0f || oU + oV > 1.0f ) {
+            return false;
+        }
+
+        return true;
+    }
+
+    /*!
+     *  \brief  Finds the rays of a packet that may hit a triangle.
+     *
+     *  Runs the test of Intersect on all rays at once, in single precision and with a
+     *  small tolerance, so that it never rejects a ray Intersect would accept: rays it
+     *  keeps must still be tested with Intersect. Rays nearly parallel to the triangle
+     *  are always kept.
+     *
+     *  \param  iTriangle   The index of the triangle in the store.
+     *  \param  iPacket     The rays to be tested.
+     *  \param  iActive     The mask of the rays to be tested.
+     *  \param  iFar        The maximum distance of an intersection, per ray.
+     *  \return One bit per lane, set iff the ray may hit the front face of the triangle.
+     */
+    inline unsigned int MayIntersect (
+        const unsigned int&     iTriangle,
+        const RayPacket&        iPacket,
+        const SimdFloat&        iActive,
+        const SimdFloat&        iFar
+    ) const {
+        const SimdFloat zero        = SimdFloat::Broadcast ( 0.0f );
+        const SimdFloat one         = SimdFloat::Broadcast ( 1.0f );
+        const SimdFloat tolerance   = SimdFloat::Broadcast ( 1e-4f );
+        const SimdFloat lowest      = zero - tolerance;
+        const SimdFloat highest     = one + tolerance;
+
+        SimdFloat e1[3], e2[3], N[3], T[3];
+        for ( unsigned int axis = 0; axis < 3; axis++ ) {
+            e1[axis] = SimdFloat::Broadcast ( m_e1[axis][iTriangle] );
+            e2[axis] = SimdFloat::Broadcast ( m_e2[axis][iTriangle] );
+            N[axis]  = SimdFloat::Broadcast ( m_normals[axis][iTriangle] );
+            T[axis]  = iPacket.GetOrigin ( axis ) - SimdFloat::Broadcast ( m_vertices[0][axis][iTriangle] );
+        }
+
+        const SimdFloat& dx = iPacket.GetDirection ( 0 );
+        const SimdFloat& dy = iPacket.GetDirection ( 1 );
+        const SimdFloat& dz = iPacket.GetDirection ( 2 );
+
+        // Same operations as Intersect, in the same order.
+        const SimdFloat det    = zero - ( dx * N[0] + dy * N[1] + dz * N[2] );
+        const SimdFloat invDet = one / det;
+        const SimdFloat t      = ( T[0] * N[0] + T[1] * N[1] + T[2] * N[2] ) * invDet;
+
+        const SimdFloat Rx = T[1] * dz - T[2] * dy;
+        const SimdFloat Ry = T[2] * dx - T[0] * dz;
+        const SimdFloat Rz = T[0] * dy - T[1] * dx;
+
+        const SimdFloat u = ( e2[0] * Rx + e2[1] * Ry + e2[2] * Rz ) * invDet;
+        const SimdFloat v = ( zero - ( e1[0] * Rx + e1[1] * Ry + e1[2] * Rz ) ) * invDet;
+
+        // The determinant is only meaningful relative to the
+        // lengths of the vectors it is made of.
+        const SimdFloat NLength2  = N[0] * N[0] + N[1] * N[1] + N[2] * N[2];
+        const SimdFloat dLength2  = dx * dx + dy * dy + dz * dz;
+        const SimdFloat ambiguous = ( det * det ) <= ( NLength2 * dLength2 * SimdFloat::Broadcast ( 1e-10f ) );
+
+        const SimdFloat hit =
+                ( det > zero )
+            &   ( u >= lowest )
+            &   ( u <= highest )
+            &   ( v >= lowest )
+            &   ( ( u + v ) <= highest )
+            &   ( t >= lowest )
+            &   ( t <= iFar + ( iFar + one ) * tolerance );
+
+        return ( iActive & ( hit | ambiguous ) ).GetMask ();
+    }
+
+    /*!
+     *  \brief  Calculates the normal at a point of a triangle, interpolated
+     *          from its vertices' normals.
+     *
+     *  \param  iTriangle   The index of the triangle in the store.
+     *  \param  iU          The barycentric coordinate U of the point.
+     *  \param  iV          The barycentric coordinate V of the point.
+     *  \return The interpolated, unnormalized normal.
+     */
+    Vec3Df GetInterpolatedNormal (
+        const unsigned int&     iTriangle,
+        const float&            iU,
+        const float&            iV
+    ) const;
+
+    /*!
+     *  \param  iTriangle   The index of the triangle in the store.
+     *  \return A constant pointer to the object owning the triangle.
+     */
+    inline const Object* GetObject (
+        const unsigned int&     iTriangle
+    ) const {
+        return m_objects[m_objectIds[iTriangle]];
+    }
+
+    /*!
+     *  \param  iTriangle   The index of the triangle in the store.
+     *  \return The index of the triangle on its object's mesh.
+     */
+    inline const unsigned int& GetTriangleIndex (
+        const unsigned int&     iTriangle
+    ) const {
+        return m_triangleIds[iTriangle];
+    }
+
+};
+
+#endif // _TRIANGLESTORE_H_
@@ -4,6 +4,8 @@
 #include "RayTracer.h"
 #include "InteractiveRenderer.h"
 
+#include <fstream>
+
 using namespace std;
 
 /*!
@@ -25,6 +27,10 @@ Window::Window () : QMainWindow (NULL) {
     settingsMenu->addAction(bgAct);
     connect(bgAct, SIGNAL(triggered()),
             this, SLOT(setBGColor()));
+    QAction *statsAct = new QAction(tr("&KD-Tree Statistics..."), this);
+    settingsMenu->addAction(statsAct);
+    connect(statsAct, SIGNAL(triggered()),
+            this, SLOT(showKdTreeStatistics()));
     
     /* Adding quit and about buttons to upper menu */
     QMenu *fileMenu = menuBar()->addMenu(tr("&Help"));
@@ -98,11 +104,22 @@ void Window::renderRayImage () {
 
 
 
+    // Primary samples per second, as raymini-cli reports them, next to the
+    // memory the structure needs for them.
+    const double primarySamples = double (rayTracer->getLastSampleCount ());
+    const double seconds = std::max (timer.elapsed (), 1) / 1000.0;
+    const Accelerator* accelerator = Scene::getInstance ()->getAccelerator ();
+    const double acceleratorMemory = accelerator ? accelerator->GetMemoryUsage () / (1024.0 * 1024.0) : 0.0;
+
     statusBar()->showMessage(QString ("Raytracing performed in ") +
                              QString::number (timer.elapsed ()) +
                              QString ("ms at ") +
                              QString::number (screenWidth) + QString ("x") + QString::number (screenHeight) +
-                             QString (" screen resolution"));
+                             QString (" screen resolution (") +
+                             QString::number (primarySamples / seconds / 1e6, 'f', 2) +
+                             QString (" Msamples/s, acceleration structure: ") +
+                             QString::number (acceleratorMemory, 'f', 1) +
+                             QString (" MB)"));
     viewer->setDisplayMode (GLViewer::RayDisplayMode);
 }
 
@@ -184,6 +201,38 @@ void Window::exportRayImage () {
         viewer->getRayImage().save (filename);
 }
 
+/*!
+ *  \brief  Print the statistics of the KD-Tree and save them as JSON
+ */
+void Window::showKdTreeStatistics () {
+    ParameterHandler* params = ParameterHandler::Instance();
+    Scene* scene = Scene::getInstance ();
+    if (!params->GetKdTreeBuilt ()) {
+        scene->buildAccelerator ();
+        params->SetKdTreeBuilt (true);
+    }
+
+    kd::KdStatistics stats;
+    if (!scene->getKdTreeStatistics (stats)) {
+        showStatusMessage ("Statistics are only available for the KD-Tree, without instancing.");
+        return;
+    }
+    stats.Print (cout);
+
+    QString filename = QFileDialog::getSaveFileName (this,
+                                                     "Save KD-Tree statistics",
+                                                     "kdtree-stats.json",
+                                                     "*.json");
+    if (!filename.isNull () && !filename.isEmpty ()) {
+        ofstream json (filename.toStdString ().c_str ());
+        json << stats.ToJson ();
+    }
+
+    showStatusMessage (QString ("KD-Tree: %1 nodes, %2 leaves, SAH cost %3")
+                       .arg (stats.nodeCount)
+                       .arg (stats.leafCount)
+                       .arg (stats.sahCost));
+}
 
 /*!
  *  \brief  Show a content about this program 
@@ -255,13 +304,57 @@ void Window::SetScene(int scene)     {
 
 /*!
  *  \brief  Set the number of threads to be used by the program
- *  \param  iThread Number of threads used in the program
+ *  \param  iThread Number of threads used in the program, 0 for all cores
  */
 void Window::SetThreadCount(int iThread)     {
     ParameterHandler* params = ParameterHandler::Instance();
     params -> SetThreadCount(iThread);
 }
 
+/*!
+ *  \brief  Set the strategy used to split KD-Tree nodes
+ *  \param  iMode Index of the build mode (0 = midpoint, 1 = SAH)
+ */
+void Window::SetKdTreeBuildMode(int iMode)     {
+    ParameterHandler* params = ParameterHandler::Instance();
+    RESET_INTERACTIVITY_BEGIN;
+    params -> SetKdTreeBuildMode(iMode);
+    RESET_INTERACTIVITY_END;
+}
+
+/*!
+ *  \brief  Set the acceleration structure indexing the scene
+ *  \param  iAccelerator Index of the structure (0 = KD-Tree, 1 = BVH, 2 = quantized BVH, 3 = lazy KD-Tree)
+ */
+void Window::SetAccelerator(int iAccelerator)     {
+    ParameterHandler* params = ParameterHandler::Instance();
+    RESET_INTERACTIVITY_BEGIN;
+    params -> SetAccelerator(iAccelerator);
+    RESET_INTERACTIVITY_END;
+}
+
+/*!
+ *  \brief  Activate/Desactivate one structure per distinct mesh under a tree of objects
+ *  \param  b Activate (true)/Desactivate (false) instancing
+ */
+void Window::SetInstancing(bool b)     {
+    ParameterHandler* params = ParameterHandler::Instance();
+    RESET_INTERACTIVITY_BEGIN;
+    params -> SetInstancing(b);
+    RESET_INTERACTIVITY_END;
+}
+
+/*!
+ *  \brief  Activate/Desactivate the stackless KD-Tree traversal along neighbor ropes
+ *  \param  b Activate (true)/Desactivate (false) ropes
+ */
+void Window::SetKdTreeRopes(bool b)     {
+    ParameterHandler* params = ParameterHandler::Instance();
+    RESET_INTERACTIVITY_BEGIN;
+    params -> SetKdTreeRopes(b);
+    RESET_INTERACTIVITY_END;
+}
+
 /*!
  *  \brief  Activate/Desactivate Focus effect
  *  \param  b Activate (true)/Desactivate (false) focus
@@ -297,6 +390,17 @@ void Window::SetAo(bool b){
     RESET_INTERACTIVITY_END;
 }
 
+/*!
+ *  \brief  Activate/Desactivate point-based global illumination
+ *  \param  b  Path tracing gathers diffuse bounces from the lit point cloud (true) or from the triangles (false)
+ */
+void Window::SetPointBasedGi(bool b){
+    ParameterHandler* params = ParameterHandler::Instance();
+    RESET_INTERACTIVITY_BEGIN;
+    params -> SetPointBasedGi(b);
+    RESET_INTERACTIVITY_END;
+}
+
 /*!
  *  \brief  Activate/Desactiva Path tracing
  *  \param  b  Activate (true)/Desactivate (false) path tracing
@@ -371,6 +475,15 @@ void Window::SetAaFactor(int index){
     params -> SetAaFactor(aaFactor);
 }
 
+/*!
+ *  \brief  Activate/Desactivate adaptive sampling, which stops sampling converged tiles
+ *  \param  b  Activate (true)/Desactivate (false)
+ */
+void Window::SetAdaptiveSampling(bool b){
+    ParameterHandler* params = ParameterHandler::Instance();
+    params -> SetAdaptiveSampling(b);
+}
+
 /*!
  *  \brief  Activate/Desactivate Shadows effect
  *  \param  b  Activate (true)/Desactivate (false) 
@@ -499,7 +612,8 @@ void Window::initControlWidget () {
 
     QSpinBox * threadsSpinBox = new  QSpinBox (generalGroupBox);
     threadsSpinBox -> setFixedSize(80,20);
-    threadsSpinBox -> setRange(1,16);
+    threadsSpinBox -> setRange(0,64);
+    threadsSpinBox -> setSpecialValueText(tr("All cores"));
     threadsSpinBox -> setValue(params -> GetThreadCount());
     connect (threadsSpinBox, SIGNAL (valueChanged(int)), this, SLOT (SetThreadCount(int)));
     
@@ -519,6 +633,38 @@ void Window::initControlWidget () {
     sceneLabel = new QLabel(tr("Scene:"));
     sceneLabel -> setBuddy(sceneComboBox);
 
+    QComboBox * acceleratorComboBox = new QComboBox (generalGroupBox);
+    acceleratorComboBox -> addItem(tr("KD-Tree"));
+    acceleratorComboBox -> addItem(tr("BVH"));
+    acceleratorComboBox -> addItem(tr("Compact BVH"));
+    acceleratorComboBox -> addItem(tr("Lazy KD-Tree"));
+    acceleratorComboBox -> setCurrentIndex(params -> GetAccelerator());
+    acceleratorComboBox -> setFixedSize(100,20);
+    connect (acceleratorComboBox, SIGNAL (currentIndexChanged(int)), this, SLOT (SetAccelerator (int)));
+
+    QLabel      * acceleratorLabel;
+    acceleratorLabel = new QLabel(tr("Accelerator:"));
+    acceleratorLabel -> setBuddy(acceleratorComboBox);
+
+    QComboBox * kdTreeComboBox = new QComboBox (generalGroupBox);
+    kdTreeComboBox -> addItem(tr("Midpoint"));
+    kdTreeComboBox -> addItem(tr("SAH"));
+    kdTreeComboBox -> setCurrentIndex(params -> GetKdTreeBuildMode());
+    kdTreeComboBox -> setFixedSize(80,20);
+    connect (kdTreeComboBox, SIGNAL (currentIndexChanged(int)), this, SLOT (SetKdTreeBuildMode (int)));
+
+    QLabel      * kdTreeLabel;
+    kdTreeLabel = new QLabel(tr("KD-Tree:"));
+    kdTreeLabel -> setBuddy(kdTreeComboBox);
+
+    QCheckBox * instancingCheckBox = new QCheckBox ("Instancing", generalGroupBox);
+    instancingCheckBox -> setChecked (params->GetInstancing() );
+    connect (instancingCheckBox, SIGNAL (toggled (bool)), this, SLOT (SetInstancing(bool)));
+
+    QCheckBox * kdTreeRopesCheckBox = new QCheckBox ("KD-Tree Ropes", generalGroupBox);
+    kdTreeRopesCheckBox -> setChecked (params->GetKdTreeRopes() );
+    connect (kdTreeRopesCheckBox, SIGNAL (toggled (bool)), this, SLOT (SetKdTreeRopes(bool)));
+
     focusCheckBox = new QCheckBox ("Effect Focus", generalGroupBox);
     focusCheckBox -> setChecked (params->GetFilter() );
     connect (focusCheckBox, SIGNAL (toggled (bool)), this, SLOT (SetFilter(bool)));
@@ -531,7 +677,13 @@ void Window::initControlWidget () {
     generalFormLayout -> setWidget(0, QFormLayout::FieldRole, sceneComboBox);
     generalFormLayout -> setWidget(1, QFormLayout::LabelRole, threadsLabel);
     generalFormLayout -> setWidget(1, QFormLayout::FieldRole, threadsSpinBox);
-    generalFormLayout -> setWidget(2, QFormLayout::SpanningRole, focusCheckBox);
+    generalFormLayout -> setWidget(2, QFormLayout::LabelRole, acceleratorLabel);
+    generalFormLayout -> setWidget(2, QFormLayout::FieldRole, acceleratorComboBox);
+    generalFormLayout -> setWidget(3, QFormLayout::LabelRole, kdTreeLabel);
+    generalFormLayout -> setWidget(3, QFormLayout::FieldRole, kdTreeComboBox);
+    generalFormLayout -> setWidget(4, QFormLayout::SpanningRole, instancingCheckBox);
+    generalFormLayout -> setWidget(5, QFormLayout::SpanningRole, kdTreeRopesCheckBox);
+    generalFormLayout -> setWidget(6, QFormLayout::SpanningRole, focusCheckBox);
 
     /* Adding widget to layout */
     generalLayout->addWidget (generalLayoutWidget);
@@ -565,6 +717,10 @@ void Window::initControlWidget () {
     aaFactorComboBox -> setCurrentIndex(index);
     connect (aaFactorComboBox, SIGNAL (currentIndexChanged(int)), this, SLOT (SetAaFactor (int)));
 
+    QCheckBox * adaptiveCheckBox = new QCheckBox ("Adaptive", aaGroupBox);
+    adaptiveCheckBox -> setChecked (params->GetAdaptiveSampling() );
+    connect (adaptiveCheckBox, SIGNAL (toggled (bool)), this, SLOT (SetAdaptiveSampling(bool)));
+
     QWidget *aaLayoutWidget = new QWidget(aaGroupBox);
     QFormLayout *aaFormLayout = new QFormLayout(aaLayoutWidget);;
     QLabel *aaLabel = new QLabel(tr("Factor:"));
@@ -578,6 +734,7 @@ void Window::initControlWidget () {
     /* Adding widget to UI */
     aaLayout -> addWidget (aaCheckBox);
     aaLayout -> addWidget (aaLayoutWidget);
+    aaLayout -> addWidget (adaptiveCheckBox);
 
     /* == Section of Shadows parameters == */
     QGroupBox * shadowsGroupBox = new QGroupBox ("Shadows",projectGroupBox);
@@ -677,6 +834,11 @@ void Window::initControlWidget () {
     pathTracingLayout -> setWidget(1, QFormLayout::LabelRole, pathTracingDiffuseRayLabel);
     pathTracingLayout -> setWidget(1, QFormLayout::FieldRole, pathTracingDiffuseRaySB);
 
+    QCheckBox * pbgiCheckBox = new QCheckBox ("Point-based GI", pathTracingLayoutWidget);
+    pbgiCheckBox->setChecked(params->GetPointBasedGi());
+    connect (pbgiCheckBox, SIGNAL (toggled (bool)), this, SLOT (SetPointBasedGi(bool)));
+    pathTracingLayout -> setWidget(2, QFormLayout::SpanningRole, pbgiCheckBox);
+
     /* Ambient Occlusion parameters */
     QCheckBox * aoCheckBox = new QCheckBox ("Ambient Occlusion", raysGroupBox);
     aoCheckBox->setChecked(params->GetAo());
@@ -70,6 +70,7 @@ public slots :
     void showRayImage ();
     void exportGLImage ();
     void exportRayImage ();
+    void showKdTreeStatistics ();
     void about ();
 
     /*Windows only*/
@@ -78,15 +79,21 @@ public slots :
     /* Program parameters */
     void SetScene(int scene);
     void SetThreadCount(int iThread);
+    void SetKdTreeBuildMode(int iMode);
+    void SetAccelerator(int iAccelerator);
+    void SetInstancing(bool b);
+    void SetKdTreeRopes(bool b);
     void SetFilter(bool b);
     void SetInteractiveRender(bool b);
     void SetAo(bool b);
+    void SetPointBasedGi(bool b);
     void SetPathTracing(bool b);
     void SetMaxRayDepth(int maxDepth);
     void SetPathTracingDiffuseRayCount(int nbRays);
     void SetRayTracing(bool b);
     void SetAa(bool b);
     void SetAaFactor(int factor);
+    void SetAdaptiveSampling(bool b);
     void SetShadows(bool b)     ;
     void SetHardShadows(bool b)     ;
     void SetSoftShadows(bool b) ;
@@ -0,0 +1,506 @@
+#include "bvh/BvhBuilder.h"
+
+#include <algorithm>
+
+using namespace bvh;
+
+namespace {
+
+    /*!
+     *  \brief  The primitives whose centroid falls inside a slice of a node's
+     *          centroid bounds.
+     */
+    struct BvhBin {
+        BoundingBox     bounds;     //!< The bounding box of the primitives in the bin.
+        unsigned int    count;      //!< The number of primitives in the bin.
+    };
+
+    /*!
+     *  \brief  The data shared by all recursive calls of a build.
+     */
+    struct BvhBuildState {
+        const std::vector< BoundingBox >*   bounds;     //!< The bounding box of every primitive.
+        std::vector< Vec3Df >               centroids;  //!< The center of every primitive's bounding box.
+        std::vector< unsigned int >*        order;      //!< The primitive indices, reordered as nodes are split.
+    };
+
+    /*!
+     *  \brief  Calculates the surface area of a bounding box.
+     */
+    inline float Area (
+        const BoundingBox&      iBounds
+    ) {
+        const float w = iBounds.getWidth ();
+        const float h = iBounds.getHeight ();
+        const float l = iBounds.getLength ();
+
+        return 2.0f * ( w * h + h * l + l * w );
+    }
+
+    /*!
+     *  \brief  Finds the bin in which a centroid falls.
+     */
+    inline unsigned int BinIndex (
+        const float&            iCentroid,
+        const float&            iMin,
+        const float&            iScale
+    ) {
+        const unsigned int bin = (unsigned int) ( ( iCentroid - iMin ) * iScale );
+        return std::min ( bin, BvhBinCount - 1 );
+    }
+
+    /*!
+     *  \brief  Tells whether a primitive's centroid lies before a bin boundary.
+     */
+    struct BvhBinPredicate {
+        const std::vector< Vec3Df >*    centroids;
+        unsigned int                    axis;
+        float                           min;
+        float                           scale;
+        unsigned int                    split;
+
+        inline bool operator() (
+            const unsigned int&     iPrimitive
+        ) const {
+            return BinIndex ( (*centroids)[iPrimitive][axis], min, scale ) <= split;
+        }
+    };
+
+    /*!
+     *  \brief  Orders primitives by the position of their centroid along an axis.
+     */
+    struct BvhCentroidLess {
+        const std::vector< Vec3Df >*    centroids;
+        unsigned int                    axis;
+
+        inline bool operator() (
+            const unsigned int&     iLeft,
+            const unsigned int&     iRight
+        ) const {
+            return (*centroids)[iLeft][axis] < (*centroids)[iRight][axis];
+        }
+    };
+
+    /*!
+     *  \brief  Searches the cheapest bin boundary along which to split a node,
+     *          on a single axis.
+     *
+     *  \param  iState          The build state.
+     *  \param  iBegin          The first primitive of the node in the order array.
+     *  \param  iEnd            One past the last primitive of the node in the order array.
+     *  \param  iInvNodeArea    The inverse of the surface area of the node.
+     *  \param  iCentroidBounds The bounding box of the node's primitives' centroids.
+     *  \param  iAxis           The axis along which primitives are binned.
+     *  \param  oSplit          Where to place the last bin of the first child.
+     *  \param  oCost           Where to place the cost of the best split.
+     *  \return true iff a split leaving primitives on both sides exists.
+     */
+    bool FindBinnedSplitOnAxis (
+        const BvhBuildState&    iState,
+        const unsigned int&     iBegin,
+        const unsigned int&     iEnd,
+        const float&            iInvNodeArea,
+        const BoundingBox&      iCentroidBounds,
+        const unsigned int&     iAxis,
+        unsigned int&           oSplit,
+        float&                  oCost
+    ) {
+        const float min    = iCentroidBounds.getMin ()[iAxis];
+        const float extent = iCentroidBounds.getMax ()[iAxis] - min;
+
+        // All centroids are on the same plane.
+        if ( extent <= 0.0f ) {
+            return false;
+        }
+        const float scale = BvhBinCount / extent;
+
+        // Places every primitive in the bin its centroid falls in.
+        BvhBin bins[BvhBinCount];
+        for ( unsigned int b = 0; b < BvhBinCount; b++ ) {
+            bins[b].count = 0;
+        }
+        for ( unsigned int i = iBegin; i < iEnd; i++ ) {
+            const unsigned int primitive = (*iState.order)[i];
+            BvhBin& bin = bins[BinIndex ( iState.centroids[primitive][iAxis], min, scale )];
+
+            if ( bin.count == 0 ) {
+                bin.bounds = (*iState.bounds)[primitive];
+            } else {
+                bin.bounds.extendTo ( (*iState.bounds)[primitive] );
+            }
+            bin.count++;
+        }
+
+        // Sweeps the bins from the right to know the area and primitive
+        // count on the right side of every boundary.
+        float        rightArea[BvhBinCount];
+        unsigned int rightCount[BvhBinCount];
+        BoundingBox  rightBounds;
+        unsigned int count = 0;
+        for ( unsigned int b = BvhBinCount - 1; b > 0; b-- ) {
+            if ( bins[b].count > 0 ) {
+                if ( count == 0 ) {
+                    rightBounds = bins[b].bounds;
+                } else {
+                    rightBounds.extendTo ( bins[b].bounds );
+                }
+                count += bins[b].count;
+            }
+            rightArea[b - 1]  = ( count > 0 ) ? Area ( rightBounds ) : 0.0f;
+            rightCount[b - 1] = count;
+        }
+
+        // Sweeps the bins from the left, evaluating the cost of
+        // splitting after each of them.
+        bool found = false;
+        BoundingBox  leftBounds;
+        count = 0;
+        for ( unsigned int b = 0; b < BvhBinCount - 1; b++ ) {
+            if ( bins[b].count > 0 ) {
+                if ( count == 0 ) {
+                    leftBounds = bins[b].bounds;
+                } else {
+                    leftBounds.extendTo ( bins[b].bounds );
+                }
+                count += bins[b].count;
+            }
+
+            if (
+                    ( count == 0 )
+                ||  ( rightCount[b] == 0 )
+            ) {
+                continue;
+            }
+
+            const float cost = BvhTraversalCost
+                             + BvhIntersectionCost * iInvNodeArea
+                             * ( Area ( leftBounds ) * count + rightArea[b] * rightCount[b] );
+
+            if (
+                    !found
+                ||  ( cost < oCost )
+            ) {
+                oSplit = b;
+                oCost  = cost;
+                found  = true;
+            }
+        }
+
+        return found;
+    }
+
+    /*!
+     *  \brief  Searches the cheapest bin boundary along which to split a node.
+     *
+     *  \param  iState          The build state.
+     *  \param  iBegin          The first primitive of the node in the order array.
+     *  \param  iEnd            One past the last primitive of the node in the order array.
+     *  \param  iNodeBounds     The bounding box of the node's primitives.
+     *  \param  iCentroidBounds The bounding box of the node's primitives' centroids.
+     *  \param  oAxis           Where to place the axis of the best split.
+     *  \param  oSplit          Where to place the last bin of the first child.
+     *  \param  oCost           Where to place the cost of the best split.
+     *  \return true iff a split leaving primitives on both sides exists.
+     */
+    bool FindBinnedSplit (
+        const BvhBuildState&    iState,
+        const unsigned int&     iBegin,
+        const unsigned int&     iEnd,
+        const BoundingBox&      iNodeBounds,
+        const BoundingBox&      iCentroidBounds,
+        unsigned int&           oAxis,
+        unsigned int&           oSplit,
+        float&                  oCost
+    ) {
+        const float nodeArea = Area ( iNodeBounds );
+        const float invNodeArea = ( nodeArea > 0.0f ) ? 1.0f / nodeArea : 0.0f;
+
+        // Bins the primitives along each axis. Near the root, where nodes
+        // hold many primitives, all three axes are binned concurrently.
+        bool         axisFound[3];
+        unsigned int axisSplit[3];
+        float        axisCost[3];
+        for ( unsigned int axis = 0; axis < 3; axis++ ) {
+            #pragma omp task default ( shared ) firstprivate ( axis ) \
+                             if ( iEnd - iBegin >= BvhParallelBuildThreshold )
+            axisFound[axis] = FindBinnedSplitOnAxis (
+                iState,
+                iBegin,
+                iEnd,
+                invNodeArea,
+                iCentroidBounds,
+                axis,
+                axisSplit[axis],
+                axisCost[axis]
+            );
+        }
+        #pragma omp taskwait
+
+        // Keeps the cheapest of the three splits.
+        bool found = false;
+        for ( unsigned int axis = 0; axis < 3; axis++ ) {
+            if (
+                    axisFound[axis]
+                &&  (
+                            !found
+                        ||  ( axisCost[axis] < oCost )
+                    )
+            ) {
+                oAxis  = axis;
+                oSplit = axisSplit[axis];
+                oCost  = axisCost[axis];
+                found  = true;
+            }
+        }
+
+        return found;
+    }
+
+    /*!
+     *  \brief  Partitions a range of the order array, so that the primitives
+     *          satisfying a predicate come first.
+     *
+     *  Small ranges are partitioned by std::partition. Larger ones are cut into
+     *  chunks of BvhPartitionChunkSize primitives, partitioned concurrently; the
+     *  sizes of their two parts then give, by prefix sums, where every part is
+     *  scattered.
+     *
+     *  \param  ioOrder     The order array.
+     *  \param  iBegin      The first primitive of the range.
+     *  \param  iEnd        One past the last primitive of the range.
+     *  \param  iPredicate  The predicate of the first part.
+     *  \return One past the last primitive of the first part.
+     */
+    unsigned int Partition (
+        std::vector< unsigned int >&    ioOrder,
+        const unsigned int&             iBegin,
+        const unsigned int&             iEnd,
+        const BvhBinPredicate&          iPredicate
+    ) {
+        if ( iEnd - iBegin < BvhParallelBuildThreshold ) {
+            return std::partition (
+                ioOrder.begin () + iBegin,
+                ioOrder.begin () + iEnd,
+                iPredicate
+            ) - ioOrder.begin ();
+        }
+
+        const unsigned int chunkCount = ( iEnd - iBegin + BvhPartitionChunkSize - 1 ) / BvhPartitionChunkSize;
+        std::vector< unsigned int > firstCounts ( chunkCount );
+
+        // Partitions every chunk in place.
+        for ( unsigned int chunk = 0; chunk < chunkCount; chunk++ ) {
+            #pragma omp task default ( shared ) firstprivate ( chunk )
+            {
+                const unsigned int begin = iBegin + chunk * BvhPartitionChunkSize;
+                const unsigned int end   = std::min ( begin + BvhPartitionChunkSize, iEnd );
+                firstCounts[chunk] = std::partition (
+                    ioOrder.begin () + begin,
+                    ioOrder.begin () + end,
+                    iPredicate
+                ) - ( ioOrder.begin () + begin );
+            }
+        }
+        #pragma omp taskwait
+
+        // Where the two parts of every chunk go.
+        std::vector< unsigned int > firstOffsets ( chunkCount );
+        unsigned int middle = iBegin;
+        for ( unsigned int chunk = 0; chunk < chunkCount; chunk++ ) {
+            firstOffsets[chunk] = middle;
+            middle += firstCounts[chunk];
+        }
+
+        // Scatters the parts from a copy of the range.
+        const std::vector< unsigned int > chunks ( ioOrder.begin () + iBegin, ioOrder.begin () + iEnd );
+        for ( unsigned int chunk = 0; chunk < chunkCount; chunk++ ) {
+            #pragma omp task default ( shared ) firstprivate ( chunk )
+            {
+                const unsigned int begin = chunk * BvhPartitionChunkSize;
+                const unsigned int end   = std::min ( begin + BvhPartitionChunkSize, iEnd - iBegin );
+                const unsigned int split = begin + firstCounts[chunk];
+
+                // The second parts of the previous chunks come first.
+                const unsigned int secondOffset = middle + ( begin - ( firstOffsets[chunk] - iBegin ) );
+
+                std::copy ( chunks.begin () + begin, chunks.begin () + split, ioOrder.begin () + firstOffsets[chunk] );
+                std::copy ( chunks.begin () + split, chunks.begin () + end, ioOrder.begin () + secondOffset );
+            }
+        }
+        #pragma omp taskwait
+
+        return middle;
+    }
+
+    /*!
+     *  \brief  Builds the subtree over a range of the order array.
+     *
+     *  \param  ioState     The build state.
+     *  \param  iBegin      The first primitive of the subtree in the order array.
+     *  \param  iEnd        One past the last primitive of the subtree in the order array.
+     *  \param  iDepth      The depth of the subtree's root.
+     *  \param  ioNodes     Where to append the nodes of the subtree. Child indices are
+     *                      relative to the start of this array.
+     *  \return The depth of the subtree.
+     */
+    unsigned int BuildRange (
+        BvhBuildState&          ioState,
+        const unsigned int&     iBegin,
+        const unsigned int&     iEnd,
+        const unsigned int&     iDepth,
+        std::vector< BvhNode >& ioNodes
+    ) {
+        std::vector< BvhNode >&      nodes  = ioNodes;
+        std::vector< unsigned int >& order  = *ioState.order;
+
+        const unsigned int index = nodes.size ();
+        nodes.push_back ( BvhNode () );
+
+        // Bounds of the primitives and of their centroids.
+        BoundingBox nodeBounds     = (*ioState.bounds)[order[iBegin]];
+        BoundingBox centroidBounds ( ioState.centroids[order[iBegin]] );
+        for ( unsigned int i = iBegin + 1; i < iEnd; i++ ) {
+            nodeBounds.extendTo ( (*ioState.bounds)[order[i]] );
+            centroidBounds.extendTo ( ioState.centroids[order[i]] );
+        }
+
+        const unsigned int count = iEnd - iBegin;
+        if (
+                ( count == 1 )
+            ||  ( iDepth >= BvhMaxDepth )
+        ) {
+            nodes[index].InitLeaf ( nodeBounds, iBegin, count );
+            return 0u;
+        }
+
+        unsigned int axis = 0, split = 0;
+        float cost = 0.0f;
+        unsigned int middle;
+
+        if (
+            FindBinnedSplit (
+                ioState,
+                iBegin,
+                iEnd,
+                nodeBounds,
+                centroidBounds,
+                axis,
+                split,
+                cost
+            )
+        ) {
+            // Keeps the node as a leaf if intersecting all of its primitives
+            // is cheaper than splitting it.
+            if (
+                    ( count <= BvhMaxLeafSize )
+                &&  ( BvhIntersectionCost * count <= cost )
+            ) {
+                nodes[index].InitLeaf ( nodeBounds, iBegin, count );
+                return 0u;
+            }
+
+            const float extent = centroidBounds.getMax ()[axis] - centroidBounds.getMin ()[axis];
+            BvhBinPredicate predicate = {
+                &ioState.centroids,
+                axis,
+                centroidBounds.getMin ()[axis],
+                BvhBinCount / extent,
+                split
+            };
+            middle = Partition ( order, iBegin, iEnd, predicate );
+        } else if ( count <= BvhMaxLeafSize ) {
+            // All centroids coincide: no split can separate the primitives.
+            nodes[index].InitLeaf ( nodeBounds, iBegin, count );
+            return 0u;
+        } else {
+            // Too many coincident centroids for a single leaf: halves them.
+            axis   = 0;
+            middle = iBegin + count / 2;
+            BvhCentroidLess less = { &ioState.centroids, axis };
+            std::nth_element (
+                order.begin () + iBegin,
+                order.begin () + middle,
+                order.begin () + iEnd,
+                less
+            );
+        }
+
+        nodes[index].InitInterior ( nodeBounds, axis );
+
+        unsigned int firstDepth = 0, secondDepth = 0;
+
+        if ( count < BvhParallelBuildThreshold ) {
+            // The first child directly follows its parent.
+            firstDepth = BuildRange ( ioState, iBegin, middle, iDepth + 1, nodes );
+
+            // The second child is placed after the whole first subtree.
+            nodes[index].SetSecondChild ( nodes.size () );
+            secondDepth = BuildRange ( ioState, middle, iEnd, iDepth + 1, nodes );
+        } else {
+            // Large subtrees are built concurrently: the second one in
+            // a separate array, appended once both are done.
+            std::vector< BvhNode > secondNodes;
+            const unsigned int nextDepth = iDepth + 1;
+
+            #pragma omp task default ( shared )
+            secondDepth = BuildRange ( ioState, middle, iEnd, nextDepth, secondNodes );
+
+            firstDepth = BuildRange ( ioState, iBegin, middle, nextDepth, nodes );
+
+            #pragma omp taskwait
+
+            // Moves the second subtree's child indices past the first subtree.
+            const unsigned int offset = nodes.size ();
+            for ( unsigned int i = 0; i < secondNodes.size (); i++ ) {
+                if ( !secondNodes[i].IsLeaf () ) {
+                    secondNodes[i].SetSecondChild ( secondNodes[i].GetSecondChild () + offset );
+                }
+            }
+            nodes[index].SetSecondChild ( offset );
+            nodes.insert ( nodes.end (), secondNodes.begin (), secondNodes.end () );
+        }
+
+        return std::max ( firstDepth, secondDepth ) + 1;
+    }
+
+}
+
+/*!
+ * \inheaderfile
+ */
+unsigned int bvh::BuildBvh (
+    const std::vector< BoundingBox >&   iBounds,
+    std::vector< BvhNode >&             oNodes,
+    std::vector< unsigned int >&        oOrder
+) {
+    oNodes.clear ();
+    oOrder.resize ( iBounds.size () );
+
+    if ( iBounds.empty () ) {
+        return 0u;
+    }
+
+    BvhBuildState state;
+    state.bounds = &iBounds;
+    state.order  = &oOrder;
+
+    state.centroids.resize ( iBounds.size () );
+    for ( unsigned int i = 0; i < iBounds.size (); i++ ) {
+        state.centroids[i] = iBounds[i].getCenter ();
+        oOrder[i] = i;
+    }
+
+    // A binary tree with one primitive per leaf has less than twice
+    // as many nodes as primitives.
+    oNodes.reserve ( 2 * iBounds.size () );
+
+    unsigned int depth = 0;
+
+    // The root is split by a single thread, the others pick up
+    // the subtrees it spawns as tasks.
+    #pragma omp parallel
+    #pragma omp single
+    depth = BuildRange ( state, 0u, iBounds.size (), 0u, oNodes );
+
+    return depth;
+}
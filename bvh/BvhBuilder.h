@@ -0,0 +1,44 @@
+#ifndef _BVHBUILDER_H_
+#define _BVHBUILDER_H_
+
+#include <vector>
+#include "BoundingBox.h"
+#include "bvh/BvhNode.h"
+
+namespace bvh {
+
+    const unsigned int BvhBinCount          = 16;       //!< The number of candidate planes evaluated per axis, plus one.
+    const unsigned int BvhMaxLeafSize       = 8;        //!< The number of primitives past which a node is always split.
+    const unsigned int BvhMaxDepth          = 60;       //!< The depth past which no node can be split.
+    const unsigned int BvhParallelBuildThreshold = 4096;    //!< The number of primitives below which a node is built by a single thread.
+    const unsigned int BvhPartitionChunkSize = 1024;        //!< The number of primitives partitioned by each task of a concurrent split.
+    const float        BvhTraversalCost     = 1.0f;     //!< Estimated cost of traversing an intermediary node.
+    const float        BvhIntersectionCost  = 1.5f;     //!< Estimated cost of intersecting a primitive.
+
+    /*!
+     *  \brief  Builds a bounding volume hierarchy over a set of bounding boxes.
+     *
+     *  Only the bounding boxes of the primitives are needed, so that the same builder
+     *  serves any kind of primitive. Nodes are split using the surface area heuristic,
+     *  evaluated on BvhBinCount bins of the primitives' centroids along each axis: a
+     *  node becomes a leaf when it holds a single primitive, or when splitting it
+     *  is more expensive than intersecting all of its (at most BvhMaxLeafSize) primitives.
+     *  Subtrees holding at least BvhParallelBuildThreshold primitives are built
+     *  concurrently by the OpenMP threads, which also share the binning and the
+     *  partitioning of their roots.
+     *
+     *  \param  iBounds     The bounding box of every primitive.
+     *  \param  oNodes      Where to place the nodes of the hierarchy, in depth-first order.
+     *  \param  oOrder      Where to place the indices of the primitives, ordered so that
+     *                      every leaf refers to a contiguous range of it.
+     *  \return The depth of the hierarchy.
+     */
+    unsigned int BuildBvh (
+        const std::vector< BoundingBox >&   iBounds,
+        std::vector< BvhNode >&             oNodes,
+        std::vector< unsigned int >&        oOrder
+    );
+
+}
+
+#endif // _BVHBUILDER_H_
@@ -0,0 +1,172 @@
+#ifndef _BVHNODE_H_
+#define _BVHNODE_H_
+
+#include "BoundingBox.h"
+#include "Ray.h"
+#include "Vec3D.h"
+
+namespace bvh {
+
+    /*!
+     *  \brief  A node of the flattened bounding volume hierarchy.
+     *
+     *  Nodes are stored in depth-first order inside a single array, so that the
+     *  first child of an intermediary node always directly follows it. Only the
+     *  index of the second child needs to be stored. Leaves refer to a contiguous
+     *  range of primitives. Each node fits in 32 bytes:
+     *
+     *  - six words for the bounding box of the node;
+     *  - the index of the second child (intermediary nodes) or the offset of the
+     *    first primitive (leaves);
+     *  - the two lowest bits of the last word are the axis along which the children
+     *    were partitioned, and its 30 upper bits are the number of primitives of a
+     *    leaf, or 0 for intermediary nodes.
+     */
+    class BvhNode {
+
+    private:
+        float           m_min[3];   //!< The lower boundary of the node's bounding box.
+        float           m_max[3];   //!< The upper boundary of the node's bounding box.
+        unsigned int    m_offset;   //!< The index of the second child or of the first primitive.
+        unsigned int    m_flags;    //!< The partitioning axis and the primitive count.
+
+    public:
+        /*!
+         *  \brief  Copies the boundaries of a bounding box.
+         *
+         *  Also used to refit a node whose primitives have moved, keeping
+         *  its place in the hierarchy.
+         *
+         *  \param  iBounds     The bounding box of the node.
+         */
+        inline void SetBounds (
+            const BoundingBox&      iBounds
+        ) {
+            for ( unsigned int axis = 0; axis < 3; axis++ ) {
+                m_min[axis] = iBounds.getMin ()[axis];
+                m_max[axis] = iBounds.getMax ()[axis];
+            }
+        }
+
+        /*!
+         *  \brief  Turns the node into a leaf.
+         *
+         *  \param  iBounds             The bounding box of the leaf's primitives.
+         *  \param  iPrimitiveOffset    The offset of the leaf's first primitive.
+         *  \param  iPrimitiveCount     The number of primitives contained in the leaf.
+         */
+        inline void InitLeaf (
+            const BoundingBox&      iBounds,
+            const unsigned int&     iPrimitiveOffset,
+            const unsigned int&     iPrimitiveCount
+        ) {
+            SetBounds ( iBounds );
+            m_offset = iPrimitiveOffset;
+            m_flags = iPrimitiveCount << 2;
+        }
+
+        /*!
+         *  \brief  Turns the node into an intermediary node.
+         *
+         *  The index of the second child must be set with SetSecondChild
+         *  once it is known.
+         *
+         *  \param  iBounds     The bounding box of both children.
+         *  \param  iAxis       The axis along which the children were partitioned.
+         */
+        inline void InitInterior (
+            const BoundingBox&      iBounds,
+            const unsigned int&     iAxis
+        ) {
+            SetBounds ( iBounds );
+            m_offset = 0u;
+            m_flags = iAxis;
+        }
+
+        /*!
+         *  \brief  Sets the index of the second child.
+         *
+         *  \param  iIndex      The index of the child in the node array.
+         */
+        inline void SetSecondChild (
+            const unsigned int&     iIndex
+        ) {
+            m_offset = iIndex;
+        }
+
+        /*!
+         *  \return true iff the node is a leaf.
+         */
+        inline bool IsLeaf () const
+        {
+            return ( m_flags >> 2 ) != 0u;
+        }
+
+        /*!
+         *  \return The axis along which the children of an intermediary node were partitioned.
+         */
+        inline unsigned int GetAxis () const
+        {
+            return m_flags & 3u;
+        }
+
+        /*!
+         *  \return The index of the second child of an intermediary node.
+         */
+        inline unsigned int GetSecondChild () const
+        {
+            return m_offset;
+        }
+
+        /*!
+         *  \return The offset of the first primitive of a leaf.
+         */
+        inline unsigned int GetPrimitiveOffset () const
+        {
+            return m_offset;
+        }
+
+        /*!
+         *  \return The number of primitives contained in a leaf.
+         */
+        inline unsigned int GetPrimitiveCount () const
+        {
+            return m_flags >> 2;
+        }
+
+        /*!
+         *  \return The bounding box of the node.
+         */
+        inline BoundingBox GetBounds () const
+        {
+            return BoundingBox (
+                Vec3Df ( m_min[0], m_min[1], m_min[2] ),
+                Vec3Df ( m_max[0], m_max[1], m_max[2] )
+            );
+        }
+
+        /*!
+         *  \brief  Tests whether a ray segment crosses the node's bounding box,
+         *          using the slab method.
+         *
+         *  \param  iRay        The ray.
+         *  \param  iMin        The start of the segment.
+         *  \param  iMax        The end of the segment.
+         *  \return true iff part of the segment lies inside the bounding box.
+         */
+        inline bool Intersects (
+            const Ray&              iRay,
+            const float&            iMin,
+            const float&            iMax
+        ) const {
+            float tMin = iMin;
+            float tMax = iMax;
+
+            return iRay.intersect ( m_min, m_max, tMin, tMax );
+        }
+
+    };
+
+}
+
+#endif // _BVHNODE_H_
@@ -0,0 +1,242 @@
+#include "bvh/BvhTree.h"
+
+#include <algorithm>
+#include <limits>
+#include <omp.h>
+
+using namespace bvh;
+using namespace kd;
+
+namespace {
+
+    const unsigned int StackSize = BvhMaxDepth + 4;    //!< The maximum number of pending nodes during a traversal.
+
+}
+
+/*!
+ * \inheaderfile
+ */
+BvhTree::BvhTree (
+    const std::vector< Object >&    iObjects
+)   :   Accelerator ( iObjects ),
+        m_depth ( 0u )
+{
+    Build ();
+}
+
+/*!
+ * \inheaderfile
+ */
+BvhTree::BvhTree (
+    const Object&                   iObject
+)   :   Accelerator ( iObject ),
+        m_depth ( 0u )
+{
+    Build ();
+}
+
+/*!
+ * \inheaderfile
+ */
+void BvhTree::Build ()
+{
+    double start = omp_get_wtime ();
+
+    m_region = m_triangles.GetBounds ();
+
+    // The bounding box of every triangle.
+    std::vector< BoundingBox > bounds ( m_triangles.GetSize () );
+    for ( unsigned int i = 0; i < bounds.size (); i++ ) {
+        bounds[i] = m_triangles.GetBounds ( i );
+    }
+
+    // The builder orders the triangles' indices so that
+    // leaves don't need an extra index array.
+    std::vector< BvhNode > nodes;
+    TriangleIndexVector elems;
+    m_depth = BuildBvh (
+        bounds,
+        nodes,
+        elems
+    );
+
+    m_nodes.Assign ( nodes );
+    m_elems.Assign ( elems );
+
+    m_buildTimes.hierarchy = omp_get_wtime () - start;
+}
+
+/*!
+ * \inheaderfile
+ */
+BvhTree::BvhTree (
+    const std::vector< Object >&    iObjects,
+    CacheReader*                    ioCache
+)   :   Accelerator ( iObjects, ioCache ),
+        m_depth ( 0u )
+{
+    double start = omp_get_wtime ();
+
+    Vec3Df minBb, maxBb;
+    m_cache->Read ( minBb );
+    m_cache->Read ( maxBb );
+    m_cache->Read ( m_depth );
+    m_cache->ReadArray ( m_nodes );
+    m_cache->ReadArray ( m_elems );
+    m_region = BoundingBox ( minBb, maxBb );
+
+    // The traversal's stack only fits trees the builder can produce.
+    if ( m_depth > BvhMaxDepth ) {
+        m_cache->Invalidate ();
+    }
+
+    m_buildTimes.layout = omp_get_wtime () - start;
+}
+
+/*!
+ * \inheaderfile
+ */
+BvhTree::~BvhTree ()
+{}
+
+/*!
+ * \inheaderfile
+ */
+bool BvhTree::Save (
+    CacheWriter&            ioWriter
+) const {
+    m_triangles.Save ( ioWriter );
+
+    ioWriter.Write ( m_region.getMin () );
+    ioWriter.Write ( m_region.getMax () );
+    ioWriter.Write ( m_depth );
+    ioWriter.WriteArray ( m_nodes );
+    ioWriter.WriteArray ( m_elems );
+
+    return true;
+}
+
+/*!
+ * \inheaderfile
+ */
+bool BvhTree::IntersectHit (
+    const Ray&              iRay,
+    KdHit&                  oHit,
+    const float&            iNear,
+    const float&            iFar
+) const {
+    if ( m_nodes.IsEmpty () ) {
+        return false;
+    }
+
+    // Check for default near and far plane distances.
+    const float nearPlane = ( iNear < 0.0f ) ? EPSILON : iNear;
+    const float farPlane  = ( iFar  < 0.0f ) ? std::numeric_limits<float>::infinity () : iFar;
+
+    // Smallest distance found so far.
+    float minDist = std::numeric_limits<float>::infinity ();
+    bool intersects = false;
+
+    unsigned int stack[StackSize];
+    unsigned int stackSize = 0;
+    stack[stackSize++] = 0u;
+
+    while ( stackSize > 0 ) {
+        const unsigned int index = stack[--stackSize];
+        const BvhNode&     node  = m_nodes[index];
+
+        // Skips nodes the ray only enters past the closest intersection.
+        if ( !node.Intersects ( iRay, nearPlane, std::min ( farPlane, minDist ) ) ) {
+            continue;
+        }
+
+        if ( node.IsLeaf () ) {
+            const unsigned int offset = node.GetPrimitiveOffset ();
+            const unsigned int count  = node.GetPrimitiveCount ();
+
+            for ( unsigned int i = 0; i < count; i++ ) {
+                intersects |= IntersectPrimitive (
+                    m_elems[offset + i],
+                    iRay,
+                    oHit,
+                    nearPlane,
+                    farPlane,
+                    minDist
+                );
+            }
+            continue;
+        }
+
+        // The second child holds the primitives further along the axis:
+        // it is visited first when the ray goes backwards on it.
+        if ( iRay.getSign ( node.GetAxis () ) ) {
+            stack[stackSize++] = index + 1;
+            stack[stackSize++] = node.GetSecondChild ();
+        } else {
+            stack[stackSize++] = node.GetSecondChild ();
+            stack[stackSize++] = index + 1;
+        }
+    }
+
+    return intersects;
+}
+
+/*!
+ * \inheaderfile
+ */
+bool BvhTree::Occluded (
+    const Ray&              iRay,
+    const float&            iNear,
+    const float&            iFar
+) const {
+    if ( m_nodes.IsEmpty () ) {
+        return false;
+    }
+
+    // Check for default near and far plane distances.
+    const float nearPlane = ( iNear < 0.0f ) ? EPSILON : iNear;
+    const float farPlane  = ( iFar  < 0.0f ) ? std::numeric_limits<float>::infinity () : iFar;
+
+    unsigned int stack[StackSize];
+    unsigned int stackSize = 0;
+    stack[stackSize++] = 0u;
+
+    while ( stackSize > 0 ) {
+        const unsigned int index = stack[--stackSize];
+        const BvhNode&     node  = m_nodes[index];
+
+        if ( !node.Intersects ( iRay, nearPlane, farPlane ) ) {
+            continue;
+        }
+
+        if ( node.IsLeaf () ) {
+            const unsigned int offset = node.GetPrimitiveOffset ();
+            const unsigned int count  = node.GetPrimitiveCount ();
+
+            // Any intersection will do.
+            for ( unsigned int i = 0; i < count; i++ ) {
+                if (
+                    OccludedByPrimitive (
+                        m_elems[offset + i],
+                        iRay,
+                        nearPlane,
+                        farPlane
+                    )
+                ) {
+                    return true;
+                }
+            }
+            continue;
+        }
+
+        if ( iRay.getSign ( node.GetAxis () ) ) {
+            stack[stackSize++] = index + 1;
+            stack[stackSize++] = node.GetSecondChild ();
+        } else {
+            stack[stackSize++] = node.GetSecondChild ();
+            stack[stackSize++] = index + 1;
+        }
+    }
+
+    return false;
+}
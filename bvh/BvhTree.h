@@ -0,0 +1,151 @@
+#ifndef _BVHTREE_H_
+#define _BVHTREE_H_
+
+#include <vector>
+#include "Accelerator.h"
+#include "BoundingBox.h"
+#include "Ray.h"
+#include "Object.h"
+#include "TriangleStore.h"
+#include "kd/KdIntersectionData.h"
+#include "bvh/BvhNode.h"
+#include "bvh/BvhBuilder.h"
+
+namespace bvh {
+
+    /*!
+     *  \brief  A bounding volume hierarchy to speed up ray intersection checks.
+     *
+     *  Indexes the triangles of its TriangleStore. Unlike the KD-Tree, every triangle is
+     *  referenced by exactly one leaf, so that memory use only depends on the number of
+     *  triangles: their indices are kept in leaf order so that each leaf refers to a
+     *  contiguous range of them.
+     */
+    class BvhTree
+        :   public Accelerator
+    {
+    private:
+        BoundingBox                 m_region;   //!< The region surrounding all data in the tree.
+        MappedArray< BvhNode >      m_nodes;    //!< The nodes of the tree, in depth-first order.
+        MappedArray< unsigned int > m_elems;    //!< The indices of the triangles in the store, in leaf order.
+        unsigned int                m_depth;    //!< The maximum depth of the tree.
+
+        /*!
+         *  \brief  Builds the hierarchy over all triangles of the store and
+         *          keeps the time spent in the build times.
+         */
+        void Build ();
+
+    public:
+        /*!
+         *  \brief  Creates a bounding volume hierarchy over the triangles of a set
+         *          of objects.
+         *
+         *  \param  iObjects    The objects whose triangles should be indexed by the tree.
+         *                      They must outlive the tree.
+         */
+        BvhTree (
+            const std::vector< Object >&    iObjects
+        );
+
+        /*!
+         *  \brief  Creates a bounding volume hierarchy over the triangles of a
+         *          single object, in the object's own space.
+         *
+         *  \param  iObject     The object whose triangles should be indexed by the tree.
+         *                      It must outlive the tree.
+         */
+        BvhTree (
+            const Object&                   iObject
+        );
+
+        /*!
+         *  \brief  Maps a bounding volume hierarchy written by Save from a cache
+         *          file, in place.
+         *
+         *  \param  iObjects    The objects the tree was built from. They must outlive
+         *                      the tree.
+         *  \param  ioCache     The cache file, owned by the tree. Check IsValid before
+         *                      using the tree.
+         */
+        BvhTree (
+            const std::vector< Object >&    iObjects,
+            CacheReader*                    ioCache
+        );
+
+        /*!
+         *  \brief  Destroys the tree.
+         */
+        virtual ~BvhTree ();
+
+        /*!
+         *  \brief  Accesses the region surrounding all data in the tree.
+         *
+         *  \return A constant reference to the bounding box of the root node.
+         */
+        inline virtual const BoundingBox& GetRegion () const
+        {
+            return m_region;
+        }
+
+        /*!
+         *  \return The number of bytes used by the tree, its triangles included.
+         */
+        inline virtual std::size_t GetMemoryUsage () const
+        {
+            return m_nodes.GetSize () * sizeof ( BvhNode )
+                +  m_elems.GetSize () * sizeof ( unsigned int )
+                +  m_triangles.GetMemoryUsage ();
+        }
+
+        /*!
+         *  \brief  Writes the tree, its triangles included, to a cache file.
+         *
+         *  \param  ioWriter    The cache file being written.
+         *  \return true.
+         */
+        virtual bool Save (
+            CacheWriter&            ioWriter
+        ) const;
+
+        /*!
+         *  \brief  Tests intersection of a ray against the primitives contained
+         *          in the tree.
+         *
+         *  Walks down the node array with an explicit stack, visiting first the child
+         *  whose primitives lie first along the ray's direction, and skipping every node
+         *  whose bounding box the ray enters past the closest intersection found.
+         *
+         *  \param  iRay            The ray to be tested.
+         *  \param  oHit            Where to place the hit record.
+         *  \param  iNear           The minimum distance an intersection can occur (defaults to 0).
+         *  \param  iFar            The maximum distance an intersection can occur (defaults to infinity).
+         *  \return true iff there is an intersection.
+         */
+        virtual bool IntersectHit (
+            const Ray&                  iRay,
+            kd::KdHit&                  oHit,
+            const float&                iNear=-1.0f,
+            const float&                iFar=-1.0f
+        ) const;
+
+        /*!
+         *  \brief  Tests whether a ray hits any of the primitives contained in the
+         *          tree between two distances.
+         *
+         *  \param  iRay            The ray to be tested.
+         *  \param  iNear           The minimum distance an intersection can occur (defaults to 0).
+         *  \param  iFar            The maximum distance an intersection can occur (defaults to infinity).
+         *  \return true iff there is an intersection.
+         */
+        virtual bool Occluded (
+            const Ray&                  iRay,
+            const float&                iNear=-1.0f,
+            const float&                iFar=-1.0f
+        ) const;
+
+    };
+
+}
+
+#endif // _BVHTREE_H_
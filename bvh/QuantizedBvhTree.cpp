@@ -0,0 +1,446 @@
+#include "bvh/QuantizedBvhTree.h"
+
+#include <algorithm>
+#include <limits>
+#include <omp.h>
+
+using namespace bvh;
+using namespace kd;
+
+namespace {
+
+    const unsigned int StackSize = BvhMaxDepth + 36;    //!< The maximum number of pending nodes during a traversal.
+
+    /*!
+     *  \brief  A node waiting to be visited during a traversal, along with its
+     *          decoded bounding box.
+     */
+    struct QuantizedBvhStackEntry {
+        unsigned int    node;       //!< The index of the node.
+        float           min[3];     //!< The lower boundary of the node's box.
+        float           max[3];     //!< The upper boundary of the node's box.
+    };
+
+    /*!
+     *  \brief  Decodes the box of the root, quantized relative to the tree's
+     *          region, and pushes it.
+     *
+     *  \param  iNodes      The nodes of the tree.
+     *  \param  iRegion     The region of the tree.
+     *  \param  ioStack     The traversal's stack.
+     *  \param  ioStackSize The number of entries of the stack.
+     */
+    inline void PushRoot (
+        const MappedArray< bvh::QuantizedBvhNode >& iNodes,
+        const BoundingBox&                          iRegion,
+        QuantizedBvhStackEntry*                     ioStack,
+        unsigned int&                               ioStackSize
+    ) {
+        const float regionMin[3] = { iRegion.getMin ()[0], iRegion.getMin ()[1], iRegion.getMin ()[2] };
+        const float regionMax[3] = { iRegion.getMax ()[0], iRegion.getMax ()[1], iRegion.getMax ()[2] };
+
+        float step[3];
+        bvh::QuantizedBvhNode::GetSteps ( regionMin, regionMax, step );
+
+        QuantizedBvhStackEntry& root = ioStack[ioStackSize++];
+        root.node = 0u;
+        iNodes[0].GetBounds ( regionMin, regionMax, step, root.min, root.max );
+    }
+
+    /*!
+     *  \brief  Decodes the boxes of both children of an intermediary node and pushes
+     *          them, the one to be visited first last.
+     *
+     *  \param  iNodes      The nodes of the tree.
+     *  \param  iEntry      The intermediary node, with its decoded box.
+     *  \param  iRay        The ray being traced.
+     *  \param  ioStack     The traversal's stack.
+     *  \param  ioStackSize The number of entries of the stack.
+     */
+    inline void PushChildren (
+        const MappedArray< bvh::QuantizedBvhNode >& iNodes,
+        const QuantizedBvhStackEntry&               iEntry,
+        const Ray&                                  iRay,
+        QuantizedBvhStackEntry*                     ioStack,
+        unsigned int&                               ioStackSize
+    ) {
+        const bvh::QuantizedBvhNode& node = iNodes[iEntry.node];
+
+        float step[3];
+        bvh::QuantizedBvhNode::GetSteps ( iEntry.min, iEntry.max, step );
+
+        // The second child holds the primitives further along the axis:
+        // it is visited first when the ray goes backwards on it.
+        const bool         secondFirst = iRay.getSign ( node.GetAxis () ) != 0;
+        const unsigned int first       = iEntry.node + 1;
+        const unsigned int second      = node.GetSecondChild ();
+        const unsigned int children[2] = {
+            secondFirst ? first : second,
+            secondFirst ? second : first
+        };
+
+        for ( unsigned int i = 0; i < 2; i++ ) {
+            QuantizedBvhStackEntry& child = ioStack[ioStackSize++];
+            child.node = children[i];
+            iNodes[child.node].GetBounds ( iEntry.min, iEntry.max, step, child.min, child.max );
+        }
+    }
+
+}
+
+/*!
+ * \inheaderfile
+ */
+QuantizedBvhTree::QuantizedBvhTree (
+    const std::vector< Object >&    iObjects
+)   :   Accelerator ( iObjects ),
+        m_indexBytes ( 4u ),
+        m_depth ( 0u ),
+        m_bvhNodeCount ( 0u )
+{
+    Build ();
+}
+
+/*!
+ * \inheaderfile
+ */
+QuantizedBvhTree::QuantizedBvhTree (
+    const Object&                   iObject
+)   :   Accelerator ( iObject ),
+        m_indexBytes ( 4u ),
+        m_depth ( 0u ),
+        m_bvhNodeCount ( 0u )
+{
+    Build ();
+}
+
+/*!
+ * \inheaderfile
+ */
+void QuantizedBvhTree::Build ()
+{
+    double start = omp_get_wtime ();
+
+    m_region = m_triangles.GetBounds ();
+
+    // The bounding box of every triangle.
+    std::vector< BoundingBox > bounds ( m_triangles.GetSize () );
+    for ( unsigned int i = 0; i < bounds.size (); i++ ) {
+        bounds[i] = m_triangles.GetBounds ( i );
+    }
+
+    std::vector< BvhNode > nodes;
+    TriangleIndexVector elems;
+    BuildBvh (
+        bounds,
+        nodes,
+        elems
+    );
+    m_bvhNodeCount = nodes.size ();
+
+    m_buildTimes.hierarchy = omp_get_wtime () - start;
+    start = omp_get_wtime ();
+
+    // The root is quantized relative to the region, which is kept exactly.
+    std::vector< QuantizedBvhNode > quantized;
+    if ( !nodes.empty () ) {
+        const float regionMin[3] = { m_region.getMin ()[0], m_region.getMin ()[1], m_region.getMin ()[2] };
+        const float regionMax[3] = { m_region.getMax ()[0], m_region.getMax ()[1], m_region.getMax ()[2] };
+        quantized.reserve ( nodes.size () );
+        Quantize ( nodes, 0u, regionMin, regionMax, quantized, 0u );
+    }
+    m_nodes.Assign ( quantized );
+
+    // Uses the narrowest indices that can address every triangle.
+    const unsigned int triangleCount = m_triangles.GetSize ();
+    m_indexBytes = ( triangleCount <= ( 1u << 16 ) ) ? 2u : ( ( triangleCount <= ( 1u << 24 ) ) ? 3u : 4u );
+
+    std::vector< unsigned char > bytes ( elems.size () * m_indexBytes );
+    for ( unsigned int i = 0; i < elems.size (); i++ ) {
+        for ( unsigned int b = 0; b < m_indexBytes; b++ ) {
+            bytes[i * m_indexBytes + b] = (unsigned char) ( elems[i] >> ( 8 * b ) );
+        }
+    }
+    m_elems.Assign ( bytes );
+
+    m_buildTimes.layout = omp_get_wtime () - start;
+}
+
+/*!
+ * \inheaderfile
+ */
+void QuantizedBvhTree::Quantize (
+    const std::vector< BvhNode >&       iNodes,
+    const unsigned int&                 iNode,
+    const float*                        iParentMin,
+    const float*                        iParentMax,
+    std::vector< QuantizedBvhNode >&    ioNodes,
+    const unsigned int&                 iDepth
+) {
+    const BvhNode&     source = iNodes[iNode];
+    const BoundingBox  bounds = source.GetBounds ();
+    const float exactMin[3] = { bounds.getMin ()[0], bounds.getMin ()[1], bounds.getMin ()[2] };
+    const float exactMax[3] = { bounds.getMax ()[0], bounds.getMax ()[1], bounds.getMax ()[2] };
+
+    if ( source.IsLeaf () ) {
+        QuantizeLeaf (
+            source.GetPrimitiveOffset (),
+            source.GetPrimitiveCount (),
+            iParentMin,
+            iParentMax,
+            exactMin,
+            exactMax,
+            ioNodes,
+            iDepth
+        );
+        return;
+    }
+
+    const unsigned int index = ioNodes.size ();
+    ioNodes.push_back ( QuantizedBvhNode () );
+    ioNodes[index].InitInterior ( source.GetAxis () );
+    ioNodes[index].SetBounds ( iParentMin, iParentMax, exactMin, exactMax );
+
+    // Children are quantized relative to the box traversals decode.
+    float step[3], decodedMin[3], decodedMax[3];
+    QuantizedBvhNode::GetSteps ( iParentMin, iParentMax, step );
+    ioNodes[index].GetBounds ( iParentMin, iParentMax, step, decodedMin, decodedMax );
+
+    Quantize ( iNodes, iNode + 1, decodedMin, decodedMax, ioNodes, iDepth + 1 );
+    ioNodes[index].SetSecondChild ( ioNodes.size () );
+    Quantize ( iNodes, source.GetSecondChild (), decodedMin, decodedMax, ioNodes, iDepth + 1 );
+}
+
+/*!
+ * \inheaderfile
+ */
+void QuantizedBvhTree::QuantizeLeaf (
+    const unsigned int&                 iOffset,
+    const unsigned int&                 iCount,
+    const float*                        iParentMin,
+    const float*                        iParentMax,
+    const float*                        iMin,
+    const float*                        iMax,
+    std::vector< QuantizedBvhNode >&    ioNodes,
+    const unsigned int&                 iDepth
+) {
+    m_depth = std::max ( m_depth, iDepth );
+
+    const unsigned int index = ioNodes.size ();
+    ioNodes.push_back ( QuantizedBvhNode () );
+    ioNodes[index].SetBounds ( iParentMin, iParentMax, iMin, iMax );
+
+    if ( iCount <= QuantizedBvhMaxLeafSize ) {
+        ioNodes[index].InitLeaf ( iOffset, iCount );
+        return;
+    }
+
+    // Halves the primitives, leaving both halves the box of the whole.
+    ioNodes[index].InitInterior ( 0u );
+
+    float step[3], decodedMin[3], decodedMax[3];
+    QuantizedBvhNode::GetSteps ( iParentMin, iParentMax, step );
+    ioNodes[index].GetBounds ( iParentMin, iParentMax, step, decodedMin, decodedMax );
+
+    const unsigned int half = iCount / 2;
+    QuantizeLeaf ( iOffset, half, decodedMin, decodedMax, iMin, iMax, ioNodes, iDepth + 1 );
+    ioNodes[index].SetSecondChild ( ioNodes.size () );
+    QuantizeLeaf ( iOffset + half, iCount - half, decodedMin, decodedMax, iMin, iMax, ioNodes, iDepth + 1 );
+}
+
+/*!
+ * \inheaderfile
+ */
+QuantizedBvhTree::QuantizedBvhTree (
+    const std::vector< Object >&    iObjects,
+    CacheReader*                    ioCache
+)   :   Accelerator ( iObjects, ioCache ),
+        m_indexBytes ( 4u ),
+        m_depth ( 0u ),
+        m_bvhNodeCount ( 0u )
+{
+    double start = omp_get_wtime ();
+
+    Vec3Df minBb, maxBb;
+    m_cache->Read ( minBb );
+    m_cache->Read ( maxBb );
+    m_cache->Read ( m_depth );
+    m_cache->Read ( m_indexBytes );
+    m_cache->Read ( m_bvhNodeCount );
+    m_cache->ReadArray ( m_nodes );
+    m_cache->ReadArray ( m_elems );
+    m_region = BoundingBox ( minBb, maxBb );
+
+    // The traversal's stack only fits trees the builder can produce.
+    if (
+            ( m_depth + 4 > StackSize )
+        ||  ( m_indexBytes < 2u )
+        ||  ( m_indexBytes > 4u )
+    ) {
+        m_cache->Invalidate ();
+    }
+
+    m_buildTimes.layout = omp_get_wtime () - start;
+}
+
+/*!
+ * \inheaderfile
+ */
+QuantizedBvhTree::~QuantizedBvhTree ()
+{}
+
+/*!
+ * \inheaderfile
+ */
+std::size_t QuantizedBvhTree::GetMemoryUsage () const
+{
+    return m_nodes.GetSize () * sizeof ( QuantizedBvhNode )
+        +  m_elems.GetSize () * sizeof ( unsigned char )
+        +  m_triangles.GetMemoryUsage ();
+}
+
+/*!
+ * \inheaderfile
+ */
+std::size_t QuantizedBvhTree::GetUncompressedMemoryUsage () const
+{
+    return m_bvhNodeCount * sizeof ( BvhNode )
+        +  m_elems.GetSize () / m_indexBytes * sizeof ( unsigned int )
+        +  m_triangles.GetMemoryUsage ();
+}
+
+/*!
+ * \inheaderfile
+ */
+bool QuantizedBvhTree::Save (
+    CacheWriter&            ioWriter
+) const {
+    m_triangles.Save ( ioWriter );
+
+    ioWriter.Write ( m_region.getMin () );
+    ioWriter.Write ( m_region.getMax () );
+    ioWriter.Write ( m_depth );
+    ioWriter.Write ( m_indexBytes );
+    ioWriter.Write ( m_bvhNodeCount );
+    ioWriter.WriteArray ( m_nodes );
+    ioWriter.WriteArray ( m_elems );
+
+    return true;
+}
+
+/*!
+ * \inheaderfile
+ */
+bool QuantizedBvhTree::IntersectHit (
+    const Ray&              iRay,
+    KdHit&                  oHit,
+    const float&            iNear,
+    const float&            iFar
+) const {
+    if ( m_nodes.IsEmpty () ) {
+        return false;
+    }
+
+    // Check for default near and far plane distances.
+    const float nearPlane = ( iNear < 0.0f ) ? EPSILON : iNear;
+    const float farPlane  = ( iFar  < 0.0f ) ? std::numeric_limits<float>::infinity () : iFar;
+
+    // Smallest distance found so far.
+    float minDist = std::numeric_limits<float>::infinity ();
+    bool intersects = false;
+
+    QuantizedBvhStackEntry stack[StackSize];
+    unsigned int stackSize = 0;
+
+    PushRoot ( m_nodes, m_region, stack, stackSize );
+
+    while ( stackSize > 0 ) {
+        const QuantizedBvhStackEntry entry = stack[--stackSize];
+        const QuantizedBvhNode&      node  = m_nodes[entry.node];
+
+        // Skips nodes the ray only enters past the closest intersection.
+        float tMin = nearPlane;
+        float tMax = std::min ( farPlane, minDist );
+        if ( !iRay.intersect ( entry.min, entry.max, tMin, tMax ) ) {
+            continue;
+        }
+
+        if ( node.IsLeaf () ) {
+            const unsigned int offset = node.GetPrimitiveOffset ();
+            const unsigned int count  = node.GetPrimitiveCount ();
+
+            for ( unsigned int i = 0; i < count; i++ ) {
+                intersects |= IntersectPrimitive (
+                    GetElement ( offset + i ),
+                    iRay,
+                    oHit,
+                    nearPlane,
+                    farPlane,
+                    minDist
+                );
+            }
+            continue;
+        }
+
+        PushChildren ( m_nodes, entry, iRay, stack, stackSize );
+    }
+
+    return intersects;
+}
+
+/*!
+ * \inheaderfile
+ */
+bool QuantizedBvhTree::Occluded (
+    const Ray&              iRay,
+    const float&            iNear,
+    const float&            iFar
+) const {
+    if ( m_nodes.IsEmpty () ) {
+        return false;
+    }
+
+    // Check for default near and far plane distances.
+    const float nearPlane = ( iNear < 0.0f ) ? EPSILON : iNear;
+    const float farPlane  = ( iFar  < 0.0f ) ? std::numeric_limits<float>::infinity () : iFar;
+
+    QuantizedBvhStackEntry stack[StackSize];
+    unsigned int stackSize = 0;
+
+    PushRoot ( m_nodes, m_region, stack, stackSize );
+
+    while ( stackSize > 0 ) {
+        const QuantizedBvhStackEntry entry = stack[--stackSize];
+        const QuantizedBvhNode&      node  = m_nodes[entry.node];
+
+        float tMin = nearPlane;
+        float tMax = farPlane;
+        if ( !iRay.intersect ( entry.min, entry.max, tMin, tMax ) ) {
+            continue;
+        }
+
+        if ( node.IsLeaf () ) {
+            const unsigned int offset = node.GetPrimitiveOffset ();
+            const unsigned int count  = node.GetPrimitiveCount ();
+
+            // Any intersection will do.
+            for ( unsigned int i = 0; i < count; i++ ) {
+                if (
+                    OccludedByPrimitive (
+                        GetElement ( offset + i ),
+                        iRay,
+                        nearPlane,
+                        farPlane
+                    )
+                ) {
+                    return true;
+                }
+            }
+            continue;
+        }
+
+        PushChildren ( m_nodes, entry, iRay, stack, stackSize );
+    }
+
+    return false;
+}
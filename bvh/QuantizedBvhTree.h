@@ -0,0 +1,225 @@
+#ifndef _QUANTIZEDBVHTREE_H_
+#define _QUANTIZEDBVHTREE_H_
+
+#include <vector>
+#include "Accelerator.h"
+#include "BoundingBox.h"
+#include "Ray.h"
+#include "Object.h"
+#include "TriangleStore.h"
+#include "kd/KdIntersectionData.h"
+#include "bvh/BvhNode.h"
+#include "bvh/BvhBuilder.h"
+#include "bvh/QuantizedBvhNode.h"
+
+namespace bvh {
+
+    /*!
+     *  \brief  A memory-saving form of the bounding volume hierarchy, for scenes made
+     *          of very large meshes.
+     *
+     *  Built like BvhTree, then stored in a compact form: every node's bounding box is
+     *  quantized to 8 bits per coordinate relative to its parent's (see QuantizedBvhNode),
+     *  and the triangle indices of the leaves are stored on 2, 3 or 4 bytes, the fewest
+     *  that fit the number of triangles. Traversals decode the children's boxes from the
+     *  box of their parent, kept on the stack: a little arithmetic per node, against
+     *  less than half of the hierarchy's memory traffic.
+     */
+    class QuantizedBvhTree
+        :   public Accelerator
+    {
+    private:
+        BoundingBox                         m_region;       //!< The region surrounding all data in the tree.
+        MappedArray< QuantizedBvhNode >     m_nodes;        //!< The nodes of the tree, in depth-first order.
+        MappedArray< unsigned char >        m_elems;        //!< The indices of the triangles in the store, in leaf order, on m_indexBytes bytes each.
+        unsigned int                        m_indexBytes;   //!< The number of bytes of every triangle index.
+        unsigned int                        m_depth;        //!< The maximum depth of the tree.
+        unsigned int                        m_bvhNodeCount; //!< The number of nodes of the hierarchy before quantization.
+
+        /*!
+         *  \brief  Builds the hierarchy over all triangles of the store, quantizes it,
+         *          and keeps the time spent in the build times.
+         */
+        void Build ();
+
+        /*!
+         *  \brief  Quantizes a node of the built hierarchy and its descendants.
+         *
+         *  Leaves holding more than QuantizedBvhMaxLeafSize primitives are split into
+         *  smaller leaves with the same box.
+         *
+         *  \param  iNodes      The nodes of the built hierarchy.
+         *  \param  iNode       The index of the node to be quantized.
+         *  \param  iParentMin  The lower boundary of the parent's decoded box.
+         *  \param  iParentMax  The upper boundary of the parent's decoded box.
+         *  \param  ioNodes     The quantized nodes, to which the node is appended.
+         *  \param  iDepth      The depth of the node in the quantized tree.
+         */
+        void Quantize (
+            const std::vector< BvhNode >&       iNodes,
+            const unsigned int&                 iNode,
+            const float*                        iParentMin,
+            const float*                        iParentMax,
+            std::vector< QuantizedBvhNode >&    ioNodes,
+            const unsigned int&                 iDepth
+        );
+
+        /*!
+         *  \brief  Appends a leaf, split into several ones if it holds more primitives
+         *          than a quantized leaf can encode.
+         *
+         *  \param  iOffset     The offset of the leaf's first primitive.
+         *  \param  iCount      The number of primitives of the leaf.
+         *  \param  iParentMin  The lower boundary of the parent's decoded box.
+         *  \param  iParentMax  The upper boundary of the parent's decoded box.
+         *  \param  iMin        The lower boundary of the leaf's exact box.
+         *  \param  iMax        The upper boundary of the leaf's exact box.
+         *  \param  ioNodes     The quantized nodes, to which the leaf is appended.
+         *  \param  iDepth      The depth of the leaf in the quantized tree.
+         */
+        void QuantizeLeaf (
+            const unsigned int&                 iOffset,
+            const unsigned int&                 iCount,
+            const float*                        iParentMin,
+            const float*                        iParentMax,
+            const float*                        iMin,
+            const float*                        iMax,
+            std::vector< QuantizedBvhNode >&    ioNodes,
+            const unsigned int&                 iDepth
+        );
+
+        /*!
+         *  \brief  Decodes the index in the store of a triangle of a leaf.
+         *
+         *  \param  iElement    The position of the triangle in leaf order.
+         *  \return The index of the triangle in the store.
+         */
+        inline unsigned int GetElement (
+            const unsigned int&     iElement
+        ) const {
+            const unsigned char* bytes = &m_elems[iElement * m_indexBytes];
+
+            unsigned int index = bytes[0] | ( bytes[1] << 8 );
+            if ( m_indexBytes > 2 ) {
+                index |= bytes[2] << 16;
+            }
+            if ( m_indexBytes > 3 ) {
+                index |= bytes[3] << 24;
+            }
+
+            return index;
+        }
+
+    public:
+        /*!
+         *  \brief  Creates a quantized bounding volume hierarchy over the triangles of
+         *          a set of objects.
+         *
+         *  \param  iObjects    The objects whose triangles should be indexed by the tree.
+         *                      They must outlive the tree.
+         */
+        QuantizedBvhTree (
+            const std::vector< Object >&    iObjects
+        );
+
+        /*!
+         *  \brief  Creates a quantized bounding volume hierarchy over the triangles of
+         *          a single object, in the object's own space.
+         *
+         *  \param  iObject     The object whose triangles should be indexed by the tree.
+         *                      It must outlive the tree.
+         */
+        QuantizedBvhTree (
+            const Object&                   iObject
+        );
+
+        /*!
+         *  \brief  Maps a quantized bounding volume hierarchy written by Save from a
+         *          cache file, in place.
+         *
+         *  \param  iObjects    The objects the tree was built from. They must outlive
+         *                      the tree.
+         *  \param  ioCache     The cache file, owned by the tree. Check IsValid before
+         *                      using the tree.
+         */
+        QuantizedBvhTree (
+            const std::vector< Object >&    iObjects,
+            CacheReader*                    ioCache
+        );
+
+        /*!
+         *  \brief  Destroys the tree.
+         */
+        virtual ~QuantizedBvhTree ();
+
+        /*!
+         *  \brief  Accesses the region surrounding all data in the tree.
+         *
+         *  \return A constant reference to the bounding box of the root node.
+         */
+        inline virtual const BoundingBox& GetRegion () const
+        {
+            return m_region;
+        }
+
+        /*!
+         *  \return The number of bytes used by the tree, its triangles included.
+         */
+        virtual std::size_t GetMemoryUsage () const;
+
+        /*!
+         *  \return The number of bytes the same tree uses in the uncompressed form
+         *          of BvhTree, its triangles included.
+         */
+        std::size_t GetUncompressedMemoryUsage () const;
+
+        /*!
+         *  \brief  Writes the tree, its triangles included, to a cache file.
+         *
+         *  \param  ioWriter    The cache file being written.
+         *  \return true.
+         */
+        virtual bool Save (
+            CacheWriter&            ioWriter
+        ) const;
+
+        /*!
+         *  \brief  Tests intersection of a ray against the primitives contained
+         *          in the tree.
+         *
+         *  Same traversal as BvhTree::IntersectHit, with every pending node's box
+         *  decoded when its parent is visited.
+         *
+         *  \param  iRay            The ray to be tested.
+         *  \param  oHit            Where to place the hit record.
+         *  \param  iNear           The minimum distance an intersection can occur (defaults to 0).
+         *  \param  iFar            The maximum distance an intersection can occur (defaults to infinity).
+         *  \return true iff there is an intersection.
+         */
+        virtual bool IntersectHit (
+            const Ray&                  iRay,
+            kd::KdHit&                  oHit,
+            const float&                iNear=-1.0f,
+            const float&                iFar=-1.0f
+        ) const;
+
+        /*!
+         *  \brief  Tests whether a ray hits any of the primitives contained in the
+         *          tree between two distances.
+         *
+         *  \param  iRay            The ray to be tested.
+         *  \param  iNear           The minimum distance an intersection can occur (defaults to 0).
+         *  \param  iFar            The maximum distance an intersection can occur (defaults to infinity).
+         *  \return true iff there is an intersection.
+         */
+        virtual bool Occluded (
+            const Ray&                  iRay,
+            const float&                iNear=-1.0f,
+            const float&                iFar=-1.0f
+        ) const;
+
+    };
+
+}
+
+#endif // _QUANTIZEDBVHTREE_H_
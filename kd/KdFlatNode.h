@@ -0,0 +1,126 @@
+#ifndef _KDFLATNODE_H_
+#define _KDFLATNODE_H_
+
+namespace kd {
+
+    /*!
+     *  \brief  A node of the flattened, pointer-free representation of the KD-Tree.
+     *
+     *  Nodes are stored in depth-first order inside a single array, so that the
+     *  child below an intermediary node's splitting plane always directly follows it.
+     *  Only the index of the child above the plane needs to be stored. Leaves refer to
+     *  a range of a contiguous array of primitive indices. Each node fits in 8 bytes:
+     *
+     *  - the first word is the splitting position (intermediary nodes) or the offset
+     *    of the first primitive index (leaves);
+     *  - the two lowest bits of the second word are the splitting axis, or 3 for
+     *    leaves, and its 30 upper bits are the index of the child above the plane
+     *    (intermediary nodes) or the number of primitives (leaves).
+     */
+    class KdFlatNode {
+
+    private:
+        static const unsigned int LeafFlag = 3u;    //!< The value of the axis bits marking a leaf.
+
+        union {
+            float           m_split;                //!< The position of the splitting plane.
+            unsigned int    m_primitiveOffset;      //!< The offset of the first primitive index of the leaf.
+        };
+        unsigned int        m_flags;                //!< The axis bits and the child index or primitive count.
+
+    public:
+        /*!
+         *  \brief  Turns the node into a leaf.
+         *
+         *  \param  iPrimitiveOffset    The offset of the leaf's first primitive index.
+         *  \param  iPrimitiveCount     The number of primitives contained in the leaf.
+         */
+        inline void InitLeaf (
+            const unsigned int&     iPrimitiveOffset,
+            const unsigned int&     iPrimitiveCount
+        ) {
+            m_primitiveOffset = iPrimitiveOffset;
+            m_flags = ( iPrimitiveCount << 2 ) | LeafFlag;
+        }
+
+        /*!
+         *  \brief  Turns the node into an intermediary node.
+         *
+         *  The index of the child above the plane must be set with SetAboveChild
+         *  once it is known.
+         *
+         *  \param  iAxis       The axis of the splitting plane.
+         *  \param  iSplit      The position of the splitting plane.
+         */
+        inline void InitInterior (
+            const unsigned int&     iAxis,
+            const float&            iSplit
+        ) {
+            m_split = iSplit;
+            m_flags = iAxis;
+        }
+
+        /*!
+         *  \brief  Sets the index of the child above the splitting plane.
+         *
+         *  \param  iIndex      The index of the child in the node array.
+         */
+        inline void SetAboveChild (
+            const unsigned int&     iIndex
+        ) {
+            m_flags = ( m_flags & LeafFlag ) | ( iIndex << 2 );
+        }
+
+        /*!
+         *  \return true iff the node is a leaf.
+         */
+        inline bool IsLeaf () const
+        {
+            return ( m_flags & LeafFlag ) == LeafFlag;
+        }
+
+        /*!
+         *  \return The axis of the splitting plane of an intermediary node.
+         */
+        inline unsigned int GetAxis () const
+        {
+            return m_flags & LeafFlag;
+        }
+
+        /*!
+         *  \return The position of the splitting plane of an intermediary node.
+         */
+        inline float GetSplit () const
+        {
+            return m_split;
+        }
+
+        /*!
+         *  \return The index of the child above the splitting plane of an intermediary node.
+         */
+        inline unsigned int GetAboveChild () const
+        {
+            return m_flags >> 2;
+        }
+
+        /*!
+         *  \return The offset of the first primitive index of a leaf.
+         */
+        inline unsigned int GetPrimitiveOffset () const
+        {
+            return m_primitiveOffset;
+        }
+
+        /*!
+         *  \return The number of primitives contained in a leaf.
+         */
+        inline unsigned int GetPrimitiveCount () const
+        {
+            return m_flags >> 2;
+        }
+
+    };
+
+}
+
+#endif // _KDFLATNODE_H_
@@ -0,0 +1,23 @@
+#ifndef _KDHIT_H_
+#define _KDHIT_H_
+
+namespace kd {
+
+    /*!
+     *  \brief  The closest intersection found so far by a traversal.
+     *
+     *  Only holds what ray-triangle tests produce. The intersection point and the
+     *  (bumped) normal are computed once, for the final hit, by Accelerator::ResolveHit
+     *  which turns the record into a KdIntersectionData.
+     */
+    struct KdHit {
+        float           t;          //!< The distance from the ray's origin, along its direction.
+        float           u;          //!< Barycentric coordinate U.
+        float           v;          //!< Barycentric coordinate V.
+        unsigned int    triangle;   //!< The index of the triangle in the triangle store.
+        unsigned int    instance;   //!< The index of the instance, for structures indexing other structures.
+    };
+
+}
+
+#endif // _KDHIT_H_
@@ -3,56 +3,60 @@
 
 #include "Object.h"
 #include "Vec3D.h"
-#include "kd/KdData.h"
 
 namespace kd {
 
     /*!
      *  \brief A class that describes a ray's intersection point with the geometry stored in the KD-Tree.
      *
-     *  Contains the KdData descriptor of the triangle with which the intersection occurred, the
+     *  Contains the object and the index of the triangle with which the intersection occurred, the
      *  surface normal at the intersection point, the intersection point, the distance t from the
      *  ray's origin and the barycentric coordinates of the intersection point inside the triangle.
      */
     class KdIntersectionData {
 
     private:
-        KdData*         m_primitive;    //!< The intersected primitive.
-        Vec3Df          m_normal;       //!< The normal at intersection point.
-        Vec3Df          m_point;        //!< The intersection point.
-        double           m_T;            //!< The distance from ray's origin.
-        double           m_U;            //!< Barycentric coordinate U.
-        double           m_V;            //!< Barycentric coordinate V.
+        const Object*   m_object;           //!< The owner of the intersected triangle.
+        unsigned int    m_triangleIndex;    //!< The intersected triangle's index on its owner's mesh.
+        Vec3Df          m_normal;           //!< The normal at intersection point.
+        Vec3Df          m_point;            //!< The intersection point.
+        double           m_T;                //!< The distance from ray's origin.
+        double           m_U;                //!< Barycentric coordinate U.
+        double           m_V;                //!< Barycentric coordinate V.
 
     public:
         /*!
          *  \brief  Default constructor.
          *
-         *  Sets the primitive pointer to O.
+         *  Sets the object pointer to O.
          */
         inline KdIntersectionData ()
+            :   m_triangleIndex ( 0u )
         {
-            m_primitive = (KdData*)0x0;
+            m_object = (const Object*)0x0;
         }
 
         /*!
          *  \brief  Creates an intersection descriptor from its data.
          *
-         *  \param  iPrimitive  The data descriptor of the primitive with which the intersection occurred.
-         *  \param  iNormal     The surface normal at the intersection point.
-         *  \param  iPoint      The intersection point.
-         *  \param  iT          The distance T from ray's origin.
-         *  \param  iU          The U barycentric coordinate of the intersection point.
-         *  \param  iV          The V barycentric coordinate of the intersection point.
+         *  \param  iObject         The owner of the triangle with which the intersection occurred.
+         *  \param  iTriangleIndex  The index of the triangle on its owner's mesh.
+         *  \param  iNormal         The surface normal at the intersection point.
+         *  \param  iPoint          The intersection point.
+         *  \param  iT              The distance T from ray's origin.
+         *  \param  iU              The U barycentric coordinate of the intersection point.
+         *  \param  iV              The V barycentric coordinate of the intersection point.
          */
         inline KdIntersectionData (
-            KdData*             iPrimitive,
+            const Object*       iObject,
+            const unsigned int& iTriangleIndex,
             const Vec3Df&       iNormal,
             const Vec3Df&       iPoint,
             const float&        iT,
             const float&        iU,
             const float&        iV
-        )   :   m_primitive ( iPrimitive ),
+        )   :   m_object ( iObject ),
+                m_triangleIndex ( iTriangleIndex ),
                 m_normal ( iNormal ),
                 m_point ( iPoint ),
                 m_T ( iT ), m_U ( iU ), m_V ( iV )
@@ -66,7 +70,7 @@ namespace kd {
          */
         inline const unsigned int& GetTriangleIndex () const
         {
-            return m_primitive->GetTriangleIndex ();
+            return m_triangleIndex;
         }
 
         /*!
@@ -76,7 +80,7 @@ namespace kd {
          */
         inline const Object* GetObject () const
         {
-            return m_primitive->GetObject ();
+            return m_object;
         }
 
         /*!
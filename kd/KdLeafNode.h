@@ -1,9 +1,8 @@
 #ifndef _KDLEAFNODE_H_
 #define _KDLEAFNODE_H_
 
-#include "kd/KdData.h"
+#include "TriangleStore.h"
 #include "kd/KdNode.h"
-#include "kd/KdIntersectionData.h"
 #include "Ray.h"
 
 namespace kd {
@@ -12,16 +11,16 @@ namespace kd {
      *  \brief  A class representing a leaf node of the KD-Tree, storing all
      *          primitives contained in a given region.
      *
-     *  Representation of a leaf node that stores but DOES NOT OWN pointers to
-     *  various elements contained in the region defined by the node's
-     *  bounding box.
+     *  Representation of a leaf node that stores the indices, in the tree's
+     *  TriangleStore, of the elements contained in the region defined by the
+     *  node's bounding box.
      */
     class KdLeafNode
         :   public KdNode
     {
 
     private:
-        KdDataVector        m_elems;    //!< The vector of all primitives contained in the region.
+        TriangleIndexVector m_elems;    //!< The indices of all primitives contained in the region.
 
     public:
         /*!
@@ -32,7 +31,7 @@ namespace kd {
          *  \param  iRegion     The region represented by the node.
          */
         inline KdLeafNode (
-            const KdDataVector&     iPrimitives,
+            const TriangleIndexVector&  iPrimitives,
             const BoundingBox&      iRegion
         )   :   KdNode ( iRegion ),
                 m_elems ( iPrimitives )
@@ -47,7 +46,7 @@ namespace kd {
          *  \param  iMaxBb      The upper boundary of the region represented by the node.
          */
         inline KdLeafNode (
-            const KdDataVector&     iPrimitives,
+            const TriangleIndexVector&  iPrimitives,
             const Vec3Df&           iMinBb,
             const Vec3Df&           iMaxBb
         )   :   KdNode ( iMinBb, iMaxBb ),
@@ -56,49 +55,28 @@ namespace kd {
 
         /*!
          *  \brief  The default destructor.
-         *
-         *  Deletes all primitives from memory.
          */
         inline ~KdLeafNode ()
         {}
 
         /*!
-         *  \brief  Tests if a ray intersects any of the primitives contained in the node.
-         *
-         *  Iterates over all the data descriptors and test intersection against them.
-         *  Places the intersection data in oIntersection.
-         *
-         *  \param  iRay            The ray to be tested.
-         *  \param  oIntersection   Where to place the intersection descriptor.
-         *  \param  iNear           The minimum distance an intersection can occur.
-         *  \param  iFar            The maximum distance an intersection can occur.
-         *  \return true iff there is an intersection.
+         *  \return true, as the node is a leaf.
          */
-        bool Intersect (
-            const Ray&              iRay,
-            KdIntersectionData&     oIntersection,
-            const float&            iNear,
-            const float&            iFar
-        ) const;
+        inline bool IsLeaf () const
+        {
+            return true;
+        }
 
         /*!
-         *  \brief  Tests if a ray intersects any of the surfels of the primitives contained in the node.
-         *
-         *  Iterates over all the data descriptors and test intersection against their surfels.
-         *  Places the intersection data in oIntersection.
+         *  \brief  Accesses the primitives contained in the region represented
+         *          by the node.
          *
-         *  \param  iRay            The ray to be tested.
-         *  \param  oIntersection   Where to place the intersection descriptor.
-         *  \param  iNear           The minimum distance an intersection can occur.
-         *  \param  iFar            The maximum distance an intersection can occur.
-         *  \return true iff there is an intersection.
+         *  \return A constant reference to the vector of primitive indices.
          */
-        bool IntersectSurfel (
-            const Ray&              iRay,
-            KdIntersectionData&     oIntersection,
-            const float&            iNear,
-            const float&            iFar
-        ) const;
+        inline const TriangleIndexVector& GetPrimitives () const
+        {
+            return m_elems;
+        }
 
     };
 
@@ -0,0 +1,114 @@
+#ifndef _KDMAILBOX_H_
+#define _KDMAILBOX_H_
+
+namespace kd {
+
+    const unsigned int KdMailboxSize = 16;  //!< The number of triangles remembered by a mailbox, a power of 2.
+
+    /*!
+     *  \brief  Remembers the last triangles tested against a ray, so that triangles
+     *          referenced by several leaves are only tested once.
+     *
+     *  Triangles are stored in a small direct-mapped table indexed by the lowest bits
+     *  of their index. A triangle evicted by another one may be tested again, which is
+     *  only wasted work: the mailbox never hides an untested triangle. Mailboxes live
+     *  on the stack of a single traversal, so they need no synchronization.
+     */
+    class KdMailbox {
+    private:
+        unsigned int    m_triangles[KdMailboxSize];     //!< The triangles tested, by slot.
+        unsigned int    m_tests;                        //!< The number of triangles let through.
+        unsigned int    m_skips;                        //!< The number of triangles found in the mailbox.
+
+    public:
+        inline KdMailbox ()
+            :   m_tests ( 0u ),
+                m_skips ( 0u )
+        {
+            for ( unsigned int i = 0; i < KdMailboxSize; i++ ) {
+                m_triangles[i] = ~0u;
+            }
+        }
+
+        /*!
+         *  \brief  Records that a triangle is about to be tested.
+         *
+         *  \param  iTriangle   The index of the triangle in the store.
+         *  \return true iff the triangle was already tested, and can be skipped.
+         */
+        inline bool Visit (
+            const unsigned int&     iTriangle
+        ) {
+            unsigned int& slot = m_triangles[iTriangle & ( KdMailboxSize - 1 )];
+            if ( slot == iTriangle ) {
+                m_skips++;
+                return true;
+            }
+
+            slot = iTriangle;
+            m_tests++;
+            return false;
+        }
+
+        /*!
+         *  \return The number of triangles that were tested.
+         */
+        inline const unsigned int& GetTests () const
+        {
+            return m_tests;
+        }
+
+        /*!
+         *  \return The number of triangle tests that were skipped.
+         */
+        inline const unsigned int& GetSkips () const
+        {
+            return m_skips;
+        }
+    };
+
+    /*!
+     *  \brief  The mailbox of a packet traversal, which remembers which rays of the
+     *          packet each triangle was tested against.
+     */
+    class KdPacketMailbox {
+    private:
+        unsigned int    m_triangles[KdMailboxSize];     //!< The triangles tested, by slot.
+        unsigned int    m_lanes[KdMailboxSize];         //!< One bit per ray the triangle of the slot was tested against.
+
+    public:
+        inline KdPacketMailbox ()
+        {
+            for ( unsigned int i = 0; i < KdMailboxSize; i++ ) {
+                m_triangles[i] = ~0u;
+                m_lanes[i] = 0u;
+            }
+        }
+
+        /*!
+         *  \brief  Records that a triangle is about to be tested against some rays.
+         *
+         *  \param  iTriangle   The index of the triangle in the store.
+         *  \param  iLanes      One bit per ray to be tested.
+         *  \return One bit per ray of iLanes the triangle wasn't tested against yet.
+         */
+        inline unsigned int Visit (
+            const unsigned int&     iTriangle,
+            const unsigned int&     iLanes
+        ) {
+            const unsigned int slot = iTriangle & ( KdMailboxSize - 1 );
+            if ( m_triangles[slot] != iTriangle ) {
+                m_triangles[slot] = iTriangle;
+                m_lanes[slot] = 0u;
+            }
+
+            const unsigned int untested = iLanes & ~m_lanes[slot];
+            m_lanes[slot] |= iLanes;
+
+            return untested;
+        }
+    };
+
+}
+
+#endif // _KDMAILBOX_H_
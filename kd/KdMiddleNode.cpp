@@ -11,6 +11,7 @@ using namespace kd;
  *  of elements allowed in a leaf, create a leaf node. Else, create
  *  an intermediary node and split it.
  *
+ *  \param  iTriangles  The store holding the primitives' geometry.
  *  \param  iPrimitives The primitives that should be placed on the child node.
  *  \param  iChildBb    The bounding box of the child node.
  *  \param  iNextDepth  The depth of the child node.
@@ -19,7 +20,8 @@ using namespace kd;
  *  \param  oChildNode  Where to store the new child node.
  */
 inline void UpdateChildNode (
-    const KdDataVector&     iPrimitives,
+    const TriangleStore&    iTriangles,
+    const TriangleIndexVector&  iPrimitives,
     const BoundingBox&      iChildBb,
     const unsigned int&     iNextDepth,
     const KdPlane&          iSplitPlane,
@@ -58,6 +60,76 @@ inline void UpdateChildNode (
         oChildDepth = newChildNode->Split (
             iNextDepth,
             iSplitPlane,
+            iTriangles,
+            iPrimitives
+        );
+    }
+}
+
+/*!
+ *  \brief  Updates a node based on it's primitives list, using the surface
+ *          area heuristic to decide whether or not it should be split.
+ *
+ *  If the child node's list is empty, does not allocate memory
+ *  for any node and sets the pointer to 0. If either the maximum depth
+ *  has been reached or no splitting plane is cheaper than testing all
+ *  primitives, create a leaf node. Else, create an intermediary node
+ *  and split it along the cheapest plane.
+ *
+ *  \param  iTriangles  The store holding the primitives' geometry.
+ *  \param  iPrimitives The primitives that should be placed on the child node.
+ *  \param  iChildBb    The bounding box of the child node.
+ *  \param  iNextDepth  The depth of the child node.
+ *  \param  iMaxDepth   The depth past which no node can be split.
+ *  \param  oChildDepth Where to place the new child's depth.
+ *  \param  oChildNode  Where to store the new child node.
+ */
+inline void UpdateChildNodeSAH (
+    const TriangleStore&    iTriangles,
+    const TriangleIndexVector&  iPrimitives,
+    const BoundingBox&      iChildBb,
+    const unsigned int&     iNextDepth,
+    const unsigned int&     iMaxDepth,
+    unsigned int&           oChildDepth,
+    KdNode*&                oChildNode
+) {
+    unsigned int axis = 0;
+    float position = 0.0f;
+
+    // If no primitives should be placed inside the child node.
+    if (
+        iPrimitives.size () == 0
+    ) {
+        // No node is allocated.
+        oChildNode = (KdNode*)0x0;
+    } else if (
+            ( iNextDepth >= iMaxDepth )
+        ||  !FindSAHSplit ( iChildBb, iTriangles, iPrimitives, axis, position )
+    ) {
+        // If we have reached maximum depth or splitting the node
+        // would not pay off, allocate a new leaf node and place
+        // primitives inside it.
+        oChildNode = new KdLeafNode (
+            iPrimitives,
+            iChildBb
+        );
+
+        // Leaf nodes' trees have null depths.
+        oChildDepth = 0u;
+    } else {
+        // If splitting is worth it, create a new intermediary node.
+        KdMiddleNode* newChildNode = (KdMiddleNode*)0x0;
+        oChildNode = newChildNode = new KdMiddleNode (
+            iChildBb
+        );
+
+        // Split the node and store it's tree's height.
+        oChildDepth = newChildNode->SplitSAH (
+            iNextDepth,
+            iMaxDepth,
+            axis,
+            position,
+            iTriangles,
             iPrimitives
         );
     }
@@ -69,7 +141,8 @@ inline void UpdateChildNode (
 int KdMiddleNode::Split (
     const unsigned int&     iDepth,
     const KdPlane&          iSplitPlane,
-    const KdDataVector&     iData
+    const TriangleStore&    iTriangles,
+    const TriangleIndexVector&  iData
 ) {
     // Child nodes' bounding boxes.
     BoundingBox leftBb, rightBb;
@@ -78,6 +151,9 @@ int KdMiddleNode::Split (
     // by it's center.
     Vec3Df cutPosition = GetRegion ().getCenter ();
 
+    m_splitAxis = iSplitPlane.GetAxis ();
+    m_splitPosition = cutPosition[m_splitAxis];
+
     // How far away from the splitting plane the
     // lower boundary of the bounding box is located.
     Vec3Df projMin = Vec3Df::projectOntoVector(
@@ -104,28 +180,25 @@ int KdMiddleNode::Split (
     rightBb.extendTo ( GetRegion ().getMax () );
 
     // The lists of primitives contained in each child node.
-    KdDataVector leftPrimitives;
-    KdDataVector rightPrimitives;
+    TriangleIndexVector leftPrimitives;
+    TriangleIndexVector rightPrimitives;
 
     // Tests intersection of each primitive against each child node
     // and place them in the corresponding list.
     for (
-        KdDataVector::const_iterator it = iData.begin();
+        TriangleIndexVector::const_iterator it = iData.begin();
         it != iData.end();
         it++
     ) {
-        KdData* primitive = *it;
-
-        bool isContained = false;
         if (
-            primitive->Intersects ( rightBb, isContained )
+            iTriangles.Intersects ( *it, rightBb )
         ) {
-            rightPrimitives.push_back ( primitive );
+            rightPrimitives.push_back ( *it );
         }
         if (
-            primitive->Intersects ( leftBb, isContained )
+            iTriangles.Intersects ( *it, leftBb )
         ) {
-            leftPrimitives.push_back ( primitive );
+            leftPrimitives.push_back ( *it );
         }
     }
 
@@ -137,8 +210,12 @@ int KdMiddleNode::Split (
     unsigned int rDepth = 0;
     unsigned int lDepth = 0;
 
-    // Updates right node.
+    // Updates right node. Large subtrees are built by another
+    // thread while this one builds the left node.
+    #pragma omp task default ( shared ) \
+                     if ( rightPrimitives.size () >= ParallelBuildThreshold )
     UpdateChildNode (
+        iTriangles,
         rightPrimitives,
         rightBb,
         nextDepth,
@@ -149,6 +226,7 @@ int KdMiddleNode::Split (
 
     // Updates left node.
     UpdateChildNode (
+        iTriangles,
         leftPrimitives,
         leftBb,
         nextDepth,
@@ -157,6 +235,9 @@ int KdMiddleNode::Split (
         m_lChild
     );
 
+    // Waits for the right node.
+    #pragma omp taskwait
+
     // This node's tree has maximum depth equal to the maximum
     // between it's child node's trees' maximum depths plus 1.
     return ( max( rDepth, lDepth ) + 1 );
@@ -165,177 +246,75 @@ int KdMiddleNode::Split (
 /*!
  * \inheaderfile
  */
-bool KdMiddleNode::Intersect (
-    const Ray&              iRay,
-    KdIntersectionData&     oIntersection,
-    const float&            iNear,
-    const float&            iFar
-) const {
-    // The point where the intersection ocurred.
-    Vec3Df intersectionPoint;
-
-    // Signals intersections with each child node.
-    bool intersectsLeft = false;
-    bool intersectsRight = false;
-
-    KdIntersectionData leftData;
-    KdIntersectionData rightData;
-
-    // Tests for intersection with right tree.
-    if (
-            m_rChild
-        &&  iRay.intersect ( m_rChild->GetRegion (), intersectionPoint )
-    ) {
-        //Ray newRay ( intersectionPoint, iRay.getDirection () );
-        Ray newRay ( iRay.getOrigin (), iRay.getDirection () );
-
-        intersectsRight = m_rChild->Intersect (
-            newRay,
-            rightData,
-            iNear,
-            iFar
-        );
-    }
-    // Tests for intersection with left tree.
-    if (
-            m_lChild
-        &&  iRay.intersect ( m_lChild->GetRegion (), intersectionPoint )
-    ) {
-        //Ray newRay ( intersectionPoint, iRay.getDirection () );
-        Ray newRay ( iRay.getOrigin (), iRay.getDirection () );
-
-        intersectsLeft = m_lChild->Intersect (
-            newRay,
-            leftData,
-            iNear,
-            iFar
-        );
-    }
+int KdMiddleNode::SplitSAH (
+    const unsigned int&     iDepth,
+    const unsigned int&     iMaxDepth,
+    const unsigned int&     iAxis,
+    const float&            iPosition,
+    const TriangleStore&    iTriangles,
+    const TriangleIndexVector&  iData
+) {
+    m_splitAxis = iAxis;
+    m_splitPosition = iPosition;
 
-    if ( // If there's no intersection, return false.
-            !intersectsLeft
-        &&  !intersectsRight ) {
-        return false;
-    } else if ( // Intersection only with right tree.
-        !intersectsLeft
-    ) {
-        oIntersection = rightData;
-    } else if ( // Intersection only with left tree.
-        !intersectsRight
-    ) {
-        oIntersection = leftData;
-    } else if ( // Intersection with both trees. Ignores two intersections on same triangle.
-        (
-                ( rightData.GetObject () != leftData.GetObject () )
-        ) || (
-                ( rightData.GetObject () == leftData.GetObject () )
-            &&  ( rightData.GetTriangleIndex () != leftData.GetTriangleIndex () )
-        )
-    ) {
-        const Vec3Df&  leftPoint =  leftData.GetIntersectionPoint();
-        const Vec3Df& rightPoint = rightData.GetIntersectionPoint();
+    // Child nodes' bounding boxes are the node's bounding box with
+    // one of their boundaries moved to the splitting plane.
+    Vec3Df leftMax  = GetRegion ().getMax ();
+    Vec3Df rightMin = GetRegion ().getMin ();
+    leftMax[iAxis]  = iPosition;
+    rightMin[iAxis] = iPosition;
 
-        double  leftDist = Vec3Df::squaredDistance (  leftPoint, iRay.getOrigin() );
-        double rightDist = Vec3Df::squaredDistance ( rightPoint, iRay.getOrigin() );
+    BoundingBox leftBb  ( GetRegion ().getMin (), leftMax );
+    BoundingBox rightBb ( rightMin, GetRegion ().getMax () );
 
-        if (
-            ( rightDist <= leftDist )
-        ) {
-            oIntersection = rightData;
-        } else {
-            oIntersection = leftData;
-        }
-    } else {
-        oIntersection = rightData;
-    }
-
-    return true;
-}
-
-/*!
- * \inheaderfile
- */
-bool KdMiddleNode::IntersectSurfel (
-    const Ray&              iRay,
-    KdIntersectionData&     oIntersection,
-    const float&            iNear,
-    const float&            iFar
-) const {
-    Vec3Df intersectionPoint;
-
-    bool intersectsLeft = false;
-    bool intersectsRight = false;
-
-    KdIntersectionData leftData;
-    KdIntersectionData rightData;
+    // The lists of primitives contained in each child node.
+    TriangleIndexVector leftPrimitives;
+    TriangleIndexVector rightPrimitives;
+
+    PartitionPrimitives (
+        GetRegion (),
+        iTriangles,
+        iData,
+        iAxis,
+        iPosition,
+        leftPrimitives,
+        rightPrimitives
+    );
 
-    // Tests for intersection with right tree.
-    if (
-            m_rChild
-        &&  iRay.intersect ( m_rChild->GetRegion (), intersectionPoint )
-    ) {
-        //Ray newRay ( intersectionPoint, iRay.getDirection () );
-        Ray newRay ( iRay.getOrigin (), iRay.getDirection () );
-
-        intersectsRight = m_rChild->IntersectSurfel (
-            newRay,
-            rightData,
-            iNear,
-            iFar
-        );
-    }
-    // Tests for intersection with left tree.
-    if (
-            m_lChild
-        &&  iRay.intersect ( m_lChild->GetRegion (), intersectionPoint )
-    ) {
-        //Ray newRay ( intersectionPoint, iRay.getDirection () );
-        Ray newRay ( iRay.getOrigin (), iRay.getDirection () );
-
-        intersectsLeft = m_lChild->IntersectSurfel (
-            newRay,
-            leftData,
-            iNear,
-            iFar
-        );
-    }
+    // Child nodes' depths.
+    unsigned int nextDepth = iDepth + 1;
+    unsigned int rDepth = 0;
+    unsigned int lDepth = 0;
 
-    if ( // If there's no intersection, return false.
-            !intersectsLeft
-        &&  !intersectsRight ) {
-        return false;
-    } else if ( // Intersection only with right tree.
-        !intersectsLeft
-    ) {
-        oIntersection = rightData;
-    } else if ( // Intersection only with left tree.
-        !intersectsRight
-    ) {
-        oIntersection = leftData;
-    } else if ( // Intersection with both trees. Ignores two intersections on same triangle.
-        (
-                ( rightData.GetObject () != leftData.GetObject () )
-        ) || (
-                ( rightData.GetObject () == leftData.GetObject () )
-            &&  ( rightData.GetTriangleIndex () != leftData.GetTriangleIndex () )
-        )
-    ) {
-        const Vec3Df&  leftPoint =  leftData.GetIntersectionPoint();
-        const Vec3Df& rightPoint = rightData.GetIntersectionPoint();
+    // Updates right node. Large subtrees are built by another
+    // thread while this one builds the left node.
+    #pragma omp task default ( shared ) \
+                     if ( rightPrimitives.size () >= ParallelBuildThreshold )
+    UpdateChildNodeSAH (
+        iTriangles,
+        rightPrimitives,
+        rightBb,
+        nextDepth,
+        iMaxDepth,
+        rDepth,
+        m_rChild
+    );
 
-        double  leftDist = Vec3Df::distance (  leftPoint, iRay.getOrigin() );
-        double rightDist = Vec3Df::distance ( rightPoint, iRay.getOrigin() );
+    // Updates left node.
+    UpdateChildNodeSAH (
+        iTriangles,
+        leftPrimitives,
+        leftBb,
+        nextDepth,
+        iMaxDepth,
+        lDepth,
+        m_lChild
+    );
 
-        if (
-            ( rightDist <= leftDist )
-        ) {
-            oIntersection = rightData;
-        } else {
-            oIntersection = leftData;
-        }
-    } else {
-        oIntersection = rightData;
-    }
+    // Waits for the right node.
+    #pragma omp taskwait
 
-    return true;
+    // This node's tree has maximum depth equal to the maximum
+    // between it's child node's trees' maximum depths plus 1.
+    return ( max( rDepth, lDepth ) + 1 );
 }
@@ -2,9 +2,10 @@
 #define _KDMIDDLENODE_H_
 
 #include "kd/KdPlane.h"
-#include "kd/KdData.h"
+#include "TriangleStore.h"
 #include "kd/KdNode.h"
 #include "kd/KdLeafNode.h"
+#include "kd/KdSAH.h"
 #include "BoundingBox.h"
 #include "Ray.h"
 
@@ -25,32 +26,26 @@ namespace kd {
                                     //!< region inferior to the cut plane's position.
         KdNode*         m_rChild;   //!< The right child of the node, representing
                                     //!< region superior to the cut plane's position.
+        unsigned int    m_splitAxis;        //!< The axis of the cut plane.
+        float           m_splitPosition;    //!< The position of the cut plane along its axis.
 
     public:
         /*!
          *  \brief  Creates a node with no children from the list of primitives
          *          it should contain.
          *
+         *  \param  iTriangles  The store holding the primitives' geometry.
          *  \param  iPrimitives The primitives that should be placed inside the node.
          */
         inline KdMiddleNode (
-            const KdDataVector&     iPrimitives
-        )   :   KdNode ()
+            const TriangleStore&        iTriangles,
+            const TriangleIndexVector&  iPrimitives
+        )   :   KdNode ( iTriangles.GetBounds ( iPrimitives ) )
         {
-            Vec3Df minBb, maxBb;
-
-            // Calculates bounding box's upper and lower boundaries.
-            GetMinMax (
-                iPrimitives,
-                minBb,
-                maxBb
-            );
-
-            GetRegion ().init ( minBb );
-            GetRegion ().extendTo ( maxBb );
-
             m_lChild = (KdNode*)0x0;
             m_rChild = (KdNode*)0x0;
+            m_splitAxis = 0u;
+            m_splitPosition = 0.0f;
         }
 
         /*!
@@ -65,6 +60,8 @@ namespace kd {
         {
             m_lChild = (KdNode*)0x0;
             m_rChild = (KdNode*)0x0;
+            m_splitAxis = 0u;
+            m_splitPosition = 0.0f;
         }
 
         /*!
@@ -93,54 +90,87 @@ namespace kd {
          *
          *  \param  iDepth      The depth of the node being split.
          *  \param  iSplitPlane The axis along which to split the node's bounding box.
+         *  \param  iTriangles  The store holding the primitives' geometry.
          *  \param  iData       The data to be placed on child nodes.
          *  \return The maximum depth of the tree generated by the split operation.
          */
         int Split (
             const unsigned int&     iDepth,
             const KdPlane&          iSplitPlane,
-            const KdDataVector&     iData
+            const TriangleStore&    iTriangles,
+            const TriangleIndexVector&  iData
         );
 
         /*!
-         *  \brief  Tests if a ray intersects a primitive in any of the child nodes.
+         *  \brief  Splits an intermediary node into two child nodes along a plane
+         *          chosen by the surface area heuristic.
          *
-         *  Tests intersection against both child trees and returns that which has
-         *  the smallest distance. If the ray intersects a primitive in only one of the
-         *  child trees, return that intersection.
+         *  Cuts the bounding box of the node at the given plane and distributes the
+         *  primitives between both halves. Each child is then either split again, if
+         *  the heuristic finds a plane cheaper than a leaf, or made into a leaf.
          *
-         *  \param  iRay            The ray to be tested.
-         *  \param  oIntersection   Where to place the intersection descriptor.
-         *  \param  iNear           The minimum distance an intersection can occur.
-         *  \param  iFar            The maximum distance an intersection can occur.
-         *  \return true iff there is an intersection.
+         *  \param  iDepth      The depth of the node being split.
+         *  \param  iMaxDepth   The depth past which no node can be split.
+         *  \param  iAxis       The axis of the splitting plane, as found by FindSAHSplit.
+         *  \param  iPosition   The position of the splitting plane, as found by FindSAHSplit.
+         *  \param  iTriangles  The store holding the primitives' geometry.
+         *  \param  iData       The data to be placed on child nodes.
+         *  \return The maximum depth of the tree generated by the split operation.
          */
-        bool Intersect (
-            const Ray&              iRay,
-            KdIntersectionData&     oIntersection,
-            const float&            iNear,
-            const float&            iFar
-        ) const;
+        int SplitSAH (
+            const unsigned int&     iDepth,
+            const unsigned int&     iMaxDepth,
+            const unsigned int&     iAxis,
+            const float&            iPosition,
+            const TriangleStore&    iTriangles,
+            const TriangleIndexVector&  iData
+        );
 
         /*!
-         *  \brief  Tests if a ray intersects a surfel in any of the child nodes.
+         *  \return false, as the node is an intermediary node.
+         */
+        inline bool IsLeaf () const
+        {
+            return false;
+        }
+
+        /*!
+         *  \brief  Accesses the child representing the region inferior to the
+         *          cut plane's position.
          *
-         *  Tests intersection against both child trees and returns that which has
-         *  the smallest distance. If the ray intersects a surfel in only one of the
-         *  child trees, return that intersection.
+         *  \return A constant pointer to the left child, or 0 if it contains no primitive.
+         */
+        inline const KdNode* GetLeftChild () const
+        {
+            return m_lChild;
+        }
+
+        /*!
+         *  \brief  Accesses the child representing the region superior to the
+         *          cut plane's position.
          *
-         *  \param  iRay            The ray to be tested.
-         *  \param  oIntersection   Where to place the intersection descriptor.
-         *  \param  iNear           The minimum distance an intersection can occur.
-         *  \param  iFar            The maximum distance an intersection can occur.
-         *  \return true iff there is an intersection.
+         *  \return A constant pointer to the right child, or 0 if it contains no primitive.
+         */
+        inline const KdNode* GetRightChild () const
+        {
+            return m_rChild;
+        }
+
+        /*!
+         *  \return The axis (0 for X, 1 for Y, 2 for Z) of the cut plane.
          */
-        bool IntersectSurfel (
-            const Ray&              iRay,
-            KdIntersectionData&     oIntersection,
-            const float&            iNear,
-            const float&            iFar
-        ) const;
+        inline const unsigned int& GetSplitAxis () const
+        {
+            return m_splitAxis;
+        }
+
+        /*!
+         *  \return The position of the cut plane along its axis.
+         */
+        inline const float& GetSplitPosition () const
+        {
+            return m_splitPosition;
+        }
 
     };
 
@@ -60,6 +60,22 @@ namespace kd {
             return m_normal;
         }
 
+        /*!
+         *  \brief  Accesses the index of the axis the plane is perpendicular to.
+         *
+         *  \return 0 for the X plane, 1 for the Y plane and 2 for the Z plane.
+         */
+        inline unsigned int GetAxis () const
+        {
+            if ( m_normal[0] != 0.0f ) {
+                return 0u;
+            } else if ( m_normal[1] != 0.0f ) {
+                return 1u;
+            } else {
+                return 2u;
+            }
+        }
+
         /*!
          *  \brief  Rotates around splitting planes.
          *
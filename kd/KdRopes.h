@@ -0,0 +1,25 @@
+#ifndef _KDROPES_H_
+#define _KDROPES_H_
+
+namespace kd {
+
+    const unsigned int KdNoRope = ~0u;  //!< The rope of a face on the boundary of the tree's region.
+
+    /*!
+     *  \brief  The region of a leaf and the ropes leaving its six faces.
+     *
+     *  The rope of a face is the index of the smallest node whose region holds the
+     *  whole face, on the other side of it. A ray leaving the leaf through the face
+     *  follows the rope, then only descends the (usually small) subtree below it to
+     *  find the next leaf, instead of popping a stack. Ropes are indexed by
+     *  2 * axis + side, side being 0 for the lower face and 1 for the upper one.
+     */
+    struct KdRopeLeaf {
+        float           min[3];     //!< The lower boundary of the leaf's region.
+        float           max[3];     //!< The upper boundary of the leaf's region.
+        unsigned int    ropes[6];   //!< The node beyond every face, or KdNoRope.
+    };
+
+}
+
+#endif // _KDROPES_H_
@@ -0,0 +1,373 @@
+#include "kd/KdSAH.h"
+#include "kd/KdNode.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace kd;
+
+namespace {
+
+    /*!
+     *  \brief  The kinds of events produced by a primitive along an axis.
+     *
+     *  The ordering matters: at equal positions, ending primitives must be
+     *  swept before planar ones, which must be swept before starting ones.
+     */
+    enum SAHEventType {
+        SAH_EVENT_END       = 0,    //!< The primitive's extent ends at the event.
+        SAH_EVENT_PLANAR    = 1,    //!< The primitive lies on the plane of the event.
+        SAH_EVENT_START     = 2     //!< The primitive's extent starts at the event.
+    };
+
+    /*!
+     *  \brief  A candidate splitting plane position along an axis.
+     */
+    struct SAHEvent {
+        float           position;   //!< Where the event happens on the axis.
+        SAHEventType    type;       //!< What happens at the event.
+
+        inline bool operator< (
+            const SAHEvent&     iOther
+        ) const {
+            return  ( position < iOther.position )
+                ||  ( ( position == iOther.position ) && ( type < iOther.type ) );
+        }
+    };
+
+    /*!
+     *  \brief  Calculates the extent of a primitive along an axis, clipped
+     *          to a region.
+     *
+     *  \param  iTriangles  The store holding the primitive's geometry.
+     *  \param  iTriangle   The primitive to be measured.
+     *  \param  iRegion     The region to clip the extent to.
+     *  \param  iAxis       The axis along which the extent is measured.
+     *  \param  oMin        Where to place the lower end of the extent.
+     *  \param  oMax        Where to place the upper end of the extent.
+     */
+    inline void ClippedExtent (
+        const TriangleStore&    iTriangles,
+        const unsigned int&     iTriangle,
+        const BoundingBox&      iRegion,
+        const unsigned int&     iAxis,
+        float&                  oMin,
+        float&                  oMax
+    ) {
+        iTriangles.GetExtent ( iTriangle, iAxis, oMin, oMax );
+
+        oMin = std::max ( oMin, iRegion.getMin ()[iAxis] );
+        oMax = std::min ( oMax, iRegion.getMax ()[iAxis] );
+    }
+
+    /*!
+     *  \brief  Calculates the surface area of one side of a region cut by a plane.
+     *
+     *  \param  iExtent     The width, height and length of the region.
+     *  \param  iAxis       The axis of the cutting plane.
+     *  \param  iLength     The length of the side along the cutting axis.
+     *  \return The surface area of the side.
+     */
+    inline float SideArea (
+        const float             iExtent[3],
+        const unsigned int&     iAxis,
+        const float&            iLength
+    ) {
+        float d[3] = { iExtent[0], iExtent[1], iExtent[2] };
+        d[iAxis] = iLength;
+
+        return 2.0f * ( d[0] * d[1] + d[1] * d[2] + d[2] * d[0] );
+    }
+
+    /*!
+     *  \brief  Searches the splitting plane of minimal cost for a node along
+     *          a single axis.
+     *
+     *  \param  iRegion     The region represented by the node.
+     *  \param  iTriangles  The store holding the primitives' geometry.
+     *  \param  iData       The primitives contained in the node.
+     *  \param  iAxis       The axis of the candidate planes.
+     *  \param  iLeafCost   The cost of turning the node into a leaf.
+     *  \param  iInvNodeArea The inverse of the node's surface area.
+     *  \param  oCost       Where to place the cost of the best plane.
+     *  \param  oPosition   Where to place the position of the best plane.
+     *  \return true iff a plane cheaper than a leaf exists on the axis.
+     */
+    bool FindSAHSplitOnAxis (
+        const BoundingBox&      iRegion,
+        const TriangleStore&    iTriangles,
+        const TriangleIndexVector&  iData,
+        const unsigned int&     iAxis,
+        const float&            iLeafCost,
+        const float&            iInvNodeArea,
+        float&                  oCost,
+        float&                  oPosition
+    ) {
+        const unsigned int primitiveCount = iData.size ();
+        const unsigned int axis = iAxis;
+
+        const float extent[3] = {
+            iRegion.getWidth (),
+            iRegion.getHeight (),
+            iRegion.getLength ()
+        };
+
+        const float axisMin = iRegion.getMin ()[axis];
+        const float axisMax = iRegion.getMax ()[axis];
+
+        // A flat region can't be cut along its null dimension.
+        if ( extent[axis] <= 0.0f ) {
+            return false;
+        }
+
+        float bestCost = iLeafCost;
+        bool found = false;
+
+        // Generates the events of every primitive along the axis.
+        std::vector< SAHEvent > events;
+        events.reserve ( 2 * primitiveCount );
+        for (
+            TriangleIndexVector::const_iterator it = iData.begin ();
+            it != iData.end ();
+            it++
+        ) {
+            float lo, hi;
+            ClippedExtent ( iTriangles, *it, iRegion, axis, lo, hi );
+
+            if ( lo == hi ) {
+                SAHEvent planar = { lo, SAH_EVENT_PLANAR };
+                events.push_back ( planar );
+            } else {
+                SAHEvent start = { lo, SAH_EVENT_START };
+                SAHEvent end   = { hi, SAH_EVENT_END };
+                events.push_back ( start );
+                events.push_back ( end );
+            }
+        }
+        std::sort ( events.begin (), events.end () );
+
+        // Sweeps the events, keeping track of how many primitives lie
+        // on each side of the current candidate plane.
+        unsigned int nLeft  = 0;
+        unsigned int nRight = primitiveCount;
+
+        for ( unsigned int e = 0; e < events.size (); ) {
+            const float position = events[e].position;
+
+            // Counts all events happening at the current position.
+            unsigned int nEnding = 0, nPlanar = 0, nStarting = 0;
+            while ( ( e < events.size () ) && ( events[e].position == position ) && ( events[e].type == SAH_EVENT_END ) ) {
+                nEnding++; e++;
+            }
+            while ( ( e < events.size () ) && ( events[e].position == position ) && ( events[e].type == SAH_EVENT_PLANAR ) ) {
+                nPlanar++; e++;
+            }
+            while ( ( e < events.size () ) && ( events[e].position == position ) && ( events[e].type == SAH_EVENT_START ) ) {
+                nStarting++; e++;
+            }
+
+            // Primitives ending or lying on the plane are no longer on its right side.
+            nRight -= nEnding + nPlanar;
+
+            // Planes on the boundaries of the region would produce an empty child
+            // with the same region as its parent.
+            if (
+                    ( position > axisMin )
+                &&  ( position < axisMax )
+            ) {
+                // Planar primitives are placed on the left side of the plane.
+                const unsigned int left  = nLeft + nPlanar;
+                const unsigned int right = nRight;
+
+                const float leftProbability  = SideArea ( extent, axis, position - axisMin ) * iInvNodeArea;
+                const float rightProbability = SideArea ( extent, axis, axisMax - position ) * iInvNodeArea;
+
+                float cost = SahTraversalCost
+                           + SahIntersectionCost * ( leftProbability * left + rightProbability * right );
+
+                // Favors cutting off empty space.
+                if (
+                        ( left == 0 )
+                    ||  ( right == 0 )
+                ) {
+                    cost *= ( 1.0f - SahEmptyBonus );
+                }
+
+                if ( cost < bestCost ) {
+                    bestCost  = cost;
+                    oCost     = cost;
+                    oPosition = position;
+                    found     = true;
+                }
+            }
+
+            // Primitives starting or lying on the plane are now on its left side.
+            nLeft += nStarting + nPlanar;
+        }
+
+        return found;
+    }
+
+    /*!
+     *  \brief  Tells whether a primitive lies on the left side of a splitting plane.
+     *
+     *  Primitives lying on the plane belong to its left side.
+     */
+    inline bool IsLeftOfPlane (
+        const float&            iLo,
+        const float&            iHi,
+        const float&            iPosition
+    ) {
+        return  ( ( iLo == iHi ) && ( iLo == iPosition ) )
+            ||  ( iLo < iPosition );
+    }
+
+    /*!
+     *  \brief  Tells whether a primitive lies on the right side of a splitting plane.
+     */
+    inline bool IsRightOfPlane (
+        const float&            iLo,
+        const float&            iHi,
+        const float&            iPosition
+    ) {
+        return  !( ( iLo == iHi ) && ( iLo == iPosition ) )
+            &&  ( iHi > iPosition );
+    }
+
+    /*!
+     *  \brief  Collects the primitives lying on one side of a splitting plane.
+     *
+     *  \param  iRegion     The region represented by the node.
+     *  \param  iTriangles  The store holding the primitives' geometry.
+     *  \param  iData       The primitives contained in the node.
+     *  \param  iAxis       The axis of the splitting plane.
+     *  \param  iPosition   The position of the splitting plane.
+     *  \param  iLeft       Whether to collect the left or the right side.
+     *  \param  oSide       Where to place the primitives of that side.
+     */
+    void CollectSide (
+        const BoundingBox&      iRegion,
+        const TriangleStore&    iTriangles,
+        const TriangleIndexVector&  iData,
+        const unsigned int&     iAxis,
+        const float&            iPosition,
+        const bool&             iLeft,
+        TriangleIndexVector&    oSide
+    ) {
+        for (
+            TriangleIndexVector::const_iterator it = iData.begin ();
+            it != iData.end ();
+            it++
+        ) {
+            float lo, hi;
+            ClippedExtent ( iTriangles, *it, iRegion, iAxis, lo, hi );
+
+            if (
+                iLeft
+                    ? IsLeftOfPlane ( lo, hi, iPosition )
+                    : IsRightOfPlane ( lo, hi, iPosition )
+            ) {
+                oSide.push_back ( *it );
+            }
+        }
+    }
+
+}
+
+/*!
+ * \inheaderfile
+ */
+unsigned int kd::SAHMaxDepth (
+    const unsigned int&     iPrimitiveCount
+) {
+    const float log2Count = std::log ( (float) std::max ( iPrimitiveCount, 1u ) ) / std::log ( 2.0f );
+
+    return (unsigned int) ( 8.0f + 1.3f * log2Count + 0.5f );
+}
+
+/*!
+ * \inheaderfile
+ */
+bool kd::FindSAHSplit (
+    const BoundingBox&      iRegion,
+    const TriangleStore&    iTriangles,
+    const TriangleIndexVector&  iData,
+    unsigned int&           oAxis,
+    float&                  oPosition
+) {
+    const unsigned int primitiveCount = iData.size ();
+
+    // The surface area of the node, used to turn the areas of the
+    // children into the probability of a ray hitting them.
+    const float nodeArea = SurfaceArea ( iRegion );
+    if (
+            ( primitiveCount == 0 )
+        ||  ( nodeArea <= 0.0f )
+    ) {
+        return false;
+    }
+    const float invNodeArea = 1.0f / nodeArea;
+
+    // Making a leaf is the cost to beat.
+    const float leafCost = SahIntersectionCost * primitiveCount;
+
+    // Searches the best plane on each axis. Near the root, where nodes
+    // hold many primitives, all three axes are swept concurrently.
+    bool  axisFound[3];
+    float axisCost[3];
+    float axisPosition[3];
+    for ( unsigned int axis = 0; axis < 3; axis++ ) {
+        #pragma omp task default ( shared ) firstprivate ( axis ) \
+                         if ( primitiveCount >= ParallelBuildThreshold )
+        axisFound[axis] = FindSAHSplitOnAxis (
+            iRegion,
+            iTriangles,
+            iData,
+            axis,
+            leafCost,
+            invNodeArea,
+            axisCost[axis],
+            axisPosition[axis]
+        );
+    }
+    #pragma omp taskwait
+
+    // Keeps the cheapest of the three planes.
+    float bestCost = leafCost;
+    bool found = false;
+    for ( unsigned int axis = 0; axis < 3; axis++ ) {
+        if (
+                axisFound[axis]
+            &&  ( axisCost[axis] < bestCost )
+        ) {
+            bestCost  = axisCost[axis];
+            oAxis     = axis;
+            oPosition = axisPosition[axis];
+            found     = true;
+        }
+    }
+
+    return found;
+}
+
+/*!
+ * \inheaderfile
+ */
+void kd::PartitionPrimitives (
+    const BoundingBox&      iRegion,
+    const TriangleStore&    iTriangles,
+    const TriangleIndexVector&  iData,
+    const unsigned int&     iAxis,
+    const float&            iPosition,
+    TriangleIndexVector&    oLeft,
+    TriangleIndexVector&    oRight
+) {
+    // Both sides are collected concurrently for large nodes.
+    #pragma omp task default ( shared ) if ( iData.size () >= ParallelBuildThreshold )
+    CollectSide ( iRegion, iTriangles, iData, iAxis, iPosition, true, oLeft );
+
+    CollectSide ( iRegion, iTriangles, iData, iAxis, iPosition, false, oRight );
+
+    #pragma omp taskwait
+}
@@ -0,0 +1,97 @@
+#ifndef _KDSAH_H_
+#define _KDSAH_H_
+
+#include "BoundingBox.h"
+#include "TriangleStore.h"
+
+namespace kd {
+
+    const float SahTraversalCost    = 1.0f;     //!< Estimated cost of traversing an intermediary node.
+    const float SahIntersectionCost = 1.5f;     //!< Estimated cost of a ray-triangle intersection test.
+    const float SahEmptyBonus       = 0.2f;     //!< Cost reduction granted to splits that cut off empty space.
+
+    /*!
+     *  \brief  Calculates the surface area of a region.
+     *
+     *  \param  iRegion     The region to be measured.
+     *  \return The area of the six faces of the region's bounding box.
+     */
+    inline float SurfaceArea (
+        const BoundingBox&      iRegion
+    ) {
+        const float w = iRegion.getWidth ();
+        const float h = iRegion.getHeight ();
+        const float l = iRegion.getLength ();
+
+        return 2.0f * ( w * h + h * l + l * w );
+    }
+
+    /*!
+     *  \brief  Calculates the maximum depth a SAH-built tree is allowed to reach.
+     *
+     *  The cost function is what normally terminates the recursion. This limit is
+     *  only a safeguard against degenerate inputs, and grows with the logarithm of the
+     *  number of primitives like the depth of a balanced tree would.
+     *
+     *  \param  iPrimitiveCount The number of primitives indexed by the tree.
+     *  \return The maximum depth of a leaf node.
+     */
+    unsigned int SAHMaxDepth (
+        const unsigned int&     iPrimitiveCount
+    );
+
+    /*!
+     *  \brief  Searches the splitting plane of minimal cost for a node, according
+     *          to the surface area heuristic.
+     *
+     *  Candidate planes are placed on both sides of every primitive's bounding box
+     *  (clipped to the region), on all three axes. For each candidate the expected cost
+     *  of traversing the split node is
+     *  \f[ C_t + C_i ( \frac{SA_L}{SA} N_L + \frac{SA_R}{SA} N_R ) \f]
+     *  and it is compared to the cost \f$ C_i N \f$ of turning the node into a leaf.
+     *  All candidates of an axis are evaluated with a single sweep over their sorted events.
+     *
+     *  \param  iRegion     The region represented by the node.
+     *  \param  iTriangles  The store holding the primitives' geometry.
+     *  \param  iData       The primitives contained in the node.
+     *  \param  oAxis       Where to place the axis of the best splitting plane.
+     *  \param  oPosition   Where to place the position of the best splitting plane.
+     *  \return true iff splitting the node is cheaper than making it a leaf.
+     */
+    bool FindSAHSplit (
+        const BoundingBox&      iRegion,
+        const TriangleStore&    iTriangles,
+        const TriangleIndexVector&  iData,
+        unsigned int&           oAxis,
+        float&                  oPosition
+    );
+
+    /*!
+     *  \brief  Distributes a node's primitives between the two sides of
+     *          a splitting plane.
+     *
+     *  Primitives are classified by their bounding box clipped to the node's region.
+     *  Those that straddle the plane are placed on both sides, and those lying on the
+     *  plane are placed on its left side.
+     *
+     *  \param  iRegion     The region represented by the node.
+     *  \param  iTriangles  The store holding the primitives' geometry.
+     *  \param  iData       The primitives contained in the node.
+     *  \param  iAxis       The axis of the splitting plane.
+     *  \param  iPosition   The position of the splitting plane.
+     *  \param  oLeft       Where to place the primitives below the plane.
+     *  \param  oRight      Where to place the primitives above the plane.
+     */
+    void PartitionPrimitives (
+        const BoundingBox&      iRegion,
+        const TriangleStore&    iTriangles,
+        const TriangleIndexVector&  iData,
+        const unsigned int&     iAxis,
+        const float&            iPosition,
+        TriangleIndexVector&    oLeft,
+        TriangleIndexVector&    oRight
+    );
+
+}
+
+#endif // _KDSAH_H_
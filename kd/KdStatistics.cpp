@@ -0,0 +1,104 @@
+#include "kd/KdStatistics.h"
+
+#include <sstream>
+
+using namespace kd;
+
+namespace {
+
+    /*!
+     *  \brief  Formats a histogram as a JSON array.
+     */
+    std::string ToJsonArray (
+        const std::vector< unsigned int >&  iValues
+    ) {
+        std::ostringstream json;
+
+        json << "[";
+        for ( unsigned int i = 0; i < iValues.size (); i++ ) {
+            json << ( i ? ", " : "" ) << iValues[i];
+        }
+        json << "]";
+
+        return json.str ();
+    }
+
+}
+
+/*!
+ * \inheaderfile
+ */
+void KdStatistics::Print (
+    std::ostream&       ioStream
+) const {
+    ioStream << "KD-Tree statistics" << std::endl
+             << "  nodes:              " << nodeCount
+             << " (" << interiorCount << " intermediary, " << leafCount << " leaves)" << std::endl
+             << "  empty leaves:       " << emptyLeafCount
+             << " (" << 100.0f * GetEmptyLeafShare () << "%)" << std::endl
+             << "  maximum depth:      " << maxDepth << std::endl
+             << "  triangles:          " << triangleCount << std::endl
+             << "  references:         " << primitiveReferences
+             << " (duplication factor " << GetDuplicationFactor () << ")" << std::endl
+             << "  primitives by leaf: " << GetAverageLeafSize ()
+             << " on average in non-empty leaves, " << maxLeafSize << " at most" << std::endl
+             << "  memory:             " << ( nodeBytes + indexBytes + triangleBytes ) << " bytes"
+             << " (nodes " << nodeBytes << ", indices " << indexBytes << ", triangles " << triangleBytes << ")" << std::endl
+             << "  SAH cost:           " << sahCost << std::endl
+             << "  mailboxing:         " << mailboxSkips << " of " << ( primitiveTests + mailboxSkips )
+             << " triangle tests skipped (" << 100.0f * GetMailboxSavings () << "%) on " << sampleRays << " random rays" << std::endl;
+
+    ioStream << "  leaves by depth:" << std::endl;
+    for ( unsigned int depth = 0; depth < leafDepthHistogram.size (); depth++ ) {
+        if ( leafDepthHistogram[depth] ) {
+            ioStream << "    " << depth << ": " << leafDepthHistogram[depth] << std::endl;
+        }
+    }
+
+    ioStream << "  leaves by number of primitives:" << std::endl;
+    for ( unsigned int size = 0; size < leafSizeHistogram.size (); size++ ) {
+        if ( leafSizeHistogram[size] ) {
+            ioStream << "    " << size << ( ( size == KdStatisticsMaxLeafSize ) ? "+" : "" )
+                     << ": " << leafSizeHistogram[size] << std::endl;
+        }
+    }
+}
+
+/*!
+ * \inheaderfile
+ */
+std::string KdStatistics::ToJson () const
+{
+    std::ostringstream json;
+
+    json << "{" << std::endl
+         << "  \"nodes\": " << nodeCount << "," << std::endl
+         << "  \"interiorNodes\": " << interiorCount << "," << std::endl
+         << "  \"leaves\": " << leafCount << "," << std::endl
+         << "  \"emptyLeaves\": " << emptyLeafCount << "," << std::endl
+         << "  \"emptyLeafShare\": " << GetEmptyLeafShare () << "," << std::endl
+         << "  \"maxDepth\": " << maxDepth << "," << std::endl
+         << "  \"triangles\": " << triangleCount << "," << std::endl
+         << "  \"primitiveReferences\": " << primitiveReferences << "," << std::endl
+         << "  \"duplicationFactor\": " << GetDuplicationFactor () << "," << std::endl
+         << "  \"averageLeafSize\": " << GetAverageLeafSize () << "," << std::endl
+         << "  \"maxLeafSize\": " << maxLeafSize << "," << std::endl
+         << "  \"leafDepthHistogram\": " << ToJsonArray ( leafDepthHistogram ) << "," << std::endl
+         << "  \"leafSizeHistogram\": " << ToJsonArray ( leafSizeHistogram ) << "," << std::endl
+         << "  \"memory\": {" << std::endl
+         << "    \"nodes\": " << nodeBytes << "," << std::endl
+         << "    \"indices\": " << indexBytes << "," << std::endl
+         << "    \"triangles\": " << triangleBytes << "," << std::endl
+         << "    \"total\": " << ( nodeBytes + indexBytes + triangleBytes ) << std::endl
+         << "  }," << std::endl
+         << "  \"sahCost\": " << sahCost << "," << std::endl
+         << "  \"mailbox\": {" << std::endl
+         << "    \"sampleRays\": " << sampleRays << "," << std::endl
+         << "    \"primitiveTests\": " << primitiveTests << "," << std::endl
+         << "    \"skippedTests\": " << mailboxSkips << "," << std::endl
+         << "    \"savings\": " << GetMailboxSavings () << std::endl
+         << "  }" << std::endl
+         << "}" << std::endl;
+
+    return json.str ();
+}
@@ -0,0 +1,111 @@
+#ifndef _KDSTATISTICS_H_
+#define _KDSTATISTICS_H_
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace kd {
+
+    const unsigned int KdStatisticsMaxLeafSize  = 32;   //!< The last bucket of the leaf size histogram, which also counts larger leaves.
+    const unsigned int KdStatisticsSampleRays   = 4096; //!< The number of random rays traced to measure mailboxing.
+
+    /*!
+     *  \brief  Measures of the quality and size of a KD-Tree, see KdTree::GetStatistics.
+     *
+     *  The SAH cost is the expected cost of tracing a ray through the tree, with the
+     *  constants of the builder: every node costs its traversal or intersection cost
+     *  weighted by the probability \f$ SA_{node} / SA_{root} \f$ that a ray crossing
+     *  the root also crosses it.
+     */
+    struct KdStatistics {
+        unsigned int                nodeCount;              //!< The number of nodes.
+        unsigned int                interiorCount;          //!< The number of intermediary nodes.
+        unsigned int                leafCount;              //!< The number of leaves.
+        unsigned int                emptyLeafCount;         //!< The number of leaves holding no primitive.
+        unsigned int                maxDepth;               //!< The depth of the deepest leaf.
+        unsigned int                triangleCount;          //!< The number of distinct triangles indexed by the tree.
+        unsigned int                primitiveReferences;    //!< The number of triangle indices held by all leaves.
+        unsigned int                maxLeafSize;            //!< The number of primitives in the largest leaf.
+        std::vector< unsigned int > leafDepthHistogram;     //!< The number of leaves at every depth.
+        std::vector< unsigned int > leafSizeHistogram;      //!< The number of leaves holding 0, 1, ... KdStatisticsMaxLeafSize or more primitives.
+        std::size_t                 nodeBytes;              //!< The memory used by the nodes.
+        std::size_t                 indexBytes;             //!< The memory used by the leaves' primitive indices.
+        std::size_t                 triangleBytes;          //!< The memory used by the triangle store.
+        float                       sahCost;                //!< The SAH-estimated cost of tracing a ray through the tree.
+        unsigned int                sampleRays;             //!< The number of random rays traced through the tree.
+        unsigned int                primitiveTests;         //!< The number of triangle tests made by the sample rays.
+        unsigned int                mailboxSkips;           //!< The number of triangle tests of the sample rays saved by mailboxing.
+
+        inline KdStatistics ()
+            :   nodeCount ( 0u ),
+                interiorCount ( 0u ),
+                leafCount ( 0u ),
+                emptyLeafCount ( 0u ),
+                maxDepth ( 0u ),
+                triangleCount ( 0u ),
+                primitiveReferences ( 0u ),
+                maxLeafSize ( 0u ),
+                leafSizeHistogram ( KdStatisticsMaxLeafSize + 1, 0u ),
+                nodeBytes ( 0u ),
+                indexBytes ( 0u ),
+                triangleBytes ( 0u ),
+                sahCost ( 0.0f ),
+                sampleRays ( 0u ),
+                primitiveTests ( 0u ),
+                mailboxSkips ( 0u )
+        {}
+
+        /*!
+         *  \return The average number of times every triangle is referenced by a leaf.
+         */
+        inline float GetDuplicationFactor () const
+        {
+            return triangleCount ? float ( primitiveReferences ) / triangleCount : 0.0f;
+        }
+
+        /*!
+         *  \return The fraction of leaves that hold no primitive.
+         */
+        inline float GetEmptyLeafShare () const
+        {
+            return leafCount ? float ( emptyLeafCount ) / leafCount : 0.0f;
+        }
+
+        /*!
+         *  \return The average number of primitives of non-empty leaves.
+         */
+        inline float GetAverageLeafSize () const
+        {
+            return ( leafCount > emptyLeafCount ) ? float ( primitiveReferences ) / ( leafCount - emptyLeafCount ) : 0.0f;
+        }
+
+        /*!
+         *  \return The fraction of the sample rays' triangle tests that mailboxing saved.
+         */
+        inline float GetMailboxSavings () const
+        {
+            return ( primitiveTests + mailboxSkips ) ? float ( mailboxSkips ) / ( primitiveTests + mailboxSkips ) : 0.0f;
+        }
+
+        /*!
+         *  \brief  Writes a human-readable report.
+         *
+         *  \param  ioStream    The stream to write to.
+         */
+        void Print (
+            std::ostream&       ioStream
+        ) const;
+
+        /*!
+         *  \brief  Formats all measures as a JSON object, to be compared across
+         *          scenes and builders.
+         *
+         *  \return The JSON text.
+         */
+        std::string ToJson () const;
+    };
+}
+
+#endif // _KDSTATISTICS_H_
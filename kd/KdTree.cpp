@@ -0,0 +1,988 @@
+#include "kd/KdTree.h"
+
+#include <omp.h>
+#include <random>
+
+using namespace kd;
+
+namespace {
+
+    const unsigned int StackSize = 64;  //!< The maximum number of pending nodes during a traversal.
+
+    /*!
+     *  \brief  A node waiting to be visited during a traversal, along with the
+     *          segment of the ray that crosses its region.
+     */
+    struct KdStackEntry {
+        unsigned int    node;   //!< The index of the node.
+        float           tMin;   //!< The distance at which the ray enters the node's region.
+        float           tMax;   //!< The distance at which the ray leaves the node's region.
+    };
+
+    /*!
+     *  \brief  A node waiting to be visited during a packet traversal, along with
+     *          the segment of every ray that crosses its region.
+     *
+     *  Rays that don't cross the region have an empty segment.
+     */
+    struct KdPacketStackEntry {
+        unsigned int    node;   //!< The index of the node.
+        SimdFloat       tMin;   //!< The distances at which the rays enter the node's region.
+        SimdFloat       tMax;   //!< The distances at which the rays leave the node's region.
+    };
+
+}
+
+/*!
+ * \inheaderfile
+ */
+void KdTree::Build (
+    const KdBuildMode&      iBuildMode
+) {
+    KdNode* root = (KdNode*)0x0;
+    m_region = m_triangles.GetBounds ();
+
+    // The root holds every triangle of the store.
+    const TriangleIndexVector primitives = m_triangles.GetIndices ();
+
+    double start = omp_get_wtime ();
+
+    // The root is split by a single thread, the others pick up
+    // the subtrees it spawns as tasks.
+    #pragma omp parallel
+    #pragma omp single
+    {
+        unsigned int axis = 0;
+        float position = 0.0f;
+
+        if ( iBuildMode == KD_BUILD_MIDPOINT ) {
+            // Allocates root node from input region.
+            KdMiddleNode* rootNode = new KdMiddleNode ( m_region );
+            root = rootNode;
+
+            // Splits root node.
+            m_depth = rootNode->Split (
+                0u,
+                KdPlane::X_PLANE,
+                m_triangles,
+                primitives
+            );
+        } else if (
+            FindSAHSplit (
+                m_region,
+                m_triangles,
+                primitives,
+                axis,
+                position
+            )
+        ) {
+            // Allocates root node from input region and splits it
+            // along the cheapest plane.
+            KdMiddleNode* rootNode = new KdMiddleNode ( m_region );
+            root = rootNode;
+
+            m_depth = rootNode->SplitSAH (
+                0u,
+                SAHMaxDepth ( primitives.size () ),
+                axis,
+                position,
+                m_triangles,
+                primitives
+            );
+        } else {
+            // No split pays off: the whole tree is a single leaf.
+            root = new KdLeafNode ( primitives, m_region );
+            m_depth = 0u;
+        }
+    }
+
+    m_buildTimes.hierarchy = omp_get_wtime () - start;
+    start = omp_get_wtime ();
+
+    // The traversal only needs the flattened tree: the
+    // pointer-based nodes are released once it's built.
+    std::vector< KdFlatNode > nodes;
+    std::vector< unsigned int > indices;
+    Flatten ( root, nodes, indices );
+    delete root;
+
+    m_nodes.Assign ( nodes );
+    m_primitiveIndices.Assign ( indices );
+
+    m_buildTimes.layout = omp_get_wtime () - start;
+}
+
+/*!
+ * \inheaderfile
+ */
+void KdTree::Flatten (
+    const KdNode*                   iNode,
+    std::vector< KdFlatNode >&      ioNodes,
+    std::vector< unsigned int >&    ioIndices
+) {
+    const unsigned int index = ioNodes.size ();
+    ioNodes.push_back ( KdFlatNode () );
+
+    if ( !iNode ) {
+        // Empty regions are leaves with no primitives.
+        ioNodes[index].InitLeaf ( ioIndices.size (), 0u );
+    } else if ( iNode->IsLeaf () ) {
+        const TriangleIndexVector& primitives = static_cast< const KdLeafNode* > ( iNode )->GetPrimitives ();
+
+        ioNodes[index].InitLeaf ( ioIndices.size (), primitives.size () );
+        ioIndices.insert (
+            ioIndices.end (),
+            primitives.begin (),
+            primitives.end ()
+        );
+    } else {
+        const KdMiddleNode* middleNode = static_cast< const KdMiddleNode* > ( iNode );
+
+        ioNodes[index].InitInterior (
+            middleNode->GetSplitAxis (),
+            middleNode->GetSplitPosition ()
+        );
+
+        // The left child directly follows its parent.
+        Flatten ( middleNode->GetLeftChild (), ioNodes, ioIndices );
+
+        // The right child is placed after the whole left subtree.
+        ioNodes[index].SetAboveChild ( ioNodes.size () );
+        Flatten ( middleNode->GetRightChild (), ioNodes, ioIndices );
+    }
+}
+
+/*!
+ * \inheaderfile
+ */
+KdTree::KdTree (
+    const std::vector< Object >&    iObjects,
+    CacheReader*                    ioCache
+)   :   Accelerator ( iObjects, ioCache ),
+        m_depth ( 0u )
+{
+    double start = omp_get_wtime ();
+
+    Vec3Df minBb, maxBb;
+    m_cache->Read ( minBb );
+    m_cache->Read ( maxBb );
+    m_cache->Read ( m_depth );
+    m_cache->ReadArray ( m_nodes );
+    m_cache->ReadArray ( m_primitiveIndices );
+    m_region = BoundingBox ( minBb, maxBb );
+
+    // Traversals start at the root: a tree always has one.
+    if ( m_nodes.IsEmpty () ) {
+        m_cache->Invalidate ();
+    }
+
+    m_buildTimes.layout = omp_get_wtime () - start;
+}
+
+/*!
+ * \inheaderfile
+ */
+KdStatistics KdTree::GetStatistics () const
+{
+    KdStatistics stats;
+
+    stats.nodeCount     = m_nodes.GetSize ();
+    stats.triangleCount = m_triangles.GetSize ();
+    stats.nodeBytes     = m_nodes.GetSize () * sizeof ( KdFlatNode );
+    stats.indexBytes    = m_primitiveIndices.GetSize () * sizeof ( unsigned int );
+    stats.triangleBytes = m_triangles.GetMemoryUsage ();
+
+    if ( m_nodes.IsEmpty () ) {
+        return stats;
+    }
+
+    // Pending nodes, along with their depth and region.
+    struct Pending {
+        unsigned int    node;
+        unsigned int    depth;
+        BoundingBox     region;
+    };
+    std::vector< Pending > pending;
+    Pending root = { 0u, 0u, m_region };
+    pending.push_back ( root );
+
+    const float rootArea = SurfaceArea ( m_region );
+
+    while ( !pending.empty () ) {
+        const Pending     entry = pending.back ();
+        const KdFlatNode& node  = m_nodes[entry.node];
+        pending.pop_back ();
+
+        // The probability for a ray crossing the root to cross the node.
+        const float probability = ( rootArea > 0.0f ) ? SurfaceArea ( entry.region ) / rootArea : 1.0f;
+
+        if ( node.IsLeaf () ) {
+            const unsigned int count = node.GetPrimitiveCount ();
+
+            stats.leafCount++;
+            stats.primitiveReferences += count;
+            stats.maxLeafSize = std::max ( stats.maxLeafSize, count );
+            stats.maxDepth    = std::max ( stats.maxDepth, entry.depth );
+            if ( count == 0u ) {
+                stats.emptyLeafCount++;
+            }
+
+            if ( stats.leafDepthHistogram.size () <= entry.depth ) {
+                stats.leafDepthHistogram.resize ( entry.depth + 1, 0u );
+            }
+            stats.leafDepthHistogram[entry.depth]++;
+            stats.leafSizeHistogram[std::min ( count, KdStatisticsMaxLeafSize )]++;
+
+            stats.sahCost += SahIntersectionCost * count * probability;
+            continue;
+        }
+
+        stats.interiorCount++;
+        stats.sahCost += SahTraversalCost * probability;
+
+        // Splits the region at the plane.
+        const unsigned int axis = node.GetAxis ();
+        Vec3Df belowMax = entry.region.getMax ();
+        Vec3Df aboveMin = entry.region.getMin ();
+        belowMax[axis] = node.GetSplit ();
+        aboveMin[axis] = node.GetSplit ();
+
+        Pending below = { entry.node + 1, entry.depth + 1, BoundingBox ( entry.region.getMin (), belowMax ) };
+        Pending above = { node.GetAboveChild (), entry.depth + 1, BoundingBox ( aboveMin, entry.region.getMax () ) };
+        pending.push_back ( below );
+        pending.push_back ( above );
+    }
+
+    // Traces rays between random points of the region, with a fixed seed so that
+    // reports can be compared, to count the tests the mailboxes save.
+    std::default_random_engine generator;
+    std::uniform_real_distribution<float> distribution ( 0.0f, 1.0f );
+    const Vec3Df& regionMin  = m_region.getMin ();
+    const Vec3Df  regionSize = m_region.getMax () - regionMin;
+
+    for ( unsigned int i = 0; i < KdStatisticsSampleRays; i++ ) {
+        Vec3Df origin, target;
+        for ( unsigned int axis = 0; axis < 3; axis++ ) {
+            origin[axis] = regionMin[axis] + distribution ( generator ) * regionSize[axis];
+            target[axis] = regionMin[axis] + distribution ( generator ) * regionSize[axis];
+        }
+
+        Vec3Df direction = target - origin;
+        if ( direction.normalize () == 0.0f ) {
+            continue;
+        }
+
+        KdHit hit;
+        KdMailbox mailbox;
+        Trace ( Ray ( origin, direction ), hit, -1.0f, -1.0f, mailbox );
+
+        stats.sampleRays++;
+        stats.primitiveTests += mailbox.GetTests ();
+        stats.mailboxSkips   += mailbox.GetSkips ();
+    }
+
+    return stats;
+}
+
+/*!
+ * \inheaderfile
+ */
+void KdTree::BuildRopes ()
+{
+    m_ropes.clear ();
+    if ( m_nodes.IsEmpty () ) {
+        return;
+    }
+
+    m_ropes.resize ( m_nodes.GetSize () );
+
+    // Nodes mapped from the cache are only readable through the const accessor.
+    const MappedArray< KdFlatNode >& nodes = m_nodes;
+
+    // Pending nodes, along with their region and the ropes they inherit.
+    struct Pending {
+        unsigned int    node;
+        KdRopeLeaf      leaf;
+    };
+    std::vector< Pending > pending;
+
+    Pending root;
+    root.node = 0u;
+    for ( unsigned int axis = 0; axis < 3; axis++ ) {
+        root.leaf.min[axis] = m_region.getMin ()[axis];
+        root.leaf.max[axis] = m_region.getMax ()[axis];
+    }
+    for ( unsigned int face = 0; face < 6; face++ ) {
+        root.leaf.ropes[face] = KdNoRope;
+    }
+    pending.push_back ( root );
+
+    while ( !pending.empty () ) {
+        Pending entry = pending.back ();
+        pending.pop_back ();
+
+        const KdFlatNode& node = nodes[entry.node];
+
+        if ( !node.IsLeaf () ) {
+            const unsigned int axis  = node.GetAxis ();
+            const unsigned int below = entry.node + 1;
+            const unsigned int above = node.GetAboveChild ();
+
+            // Each child's face on the plane leads to its sibling.
+            Pending belowEntry = entry;
+            belowEntry.node = below;
+            belowEntry.leaf.max[axis] = node.GetSplit ();
+            belowEntry.leaf.ropes[2 * axis + 1] = above;
+
+            Pending aboveEntry = entry;
+            aboveEntry.node = above;
+            aboveEntry.leaf.min[axis] = node.GetSplit ();
+            aboveEntry.leaf.ropes[2 * axis] = below;
+
+            pending.push_back ( belowEntry );
+            pending.push_back ( aboveEntry );
+            continue;
+        }
+
+        // Pushes every rope down to the smallest node holding the whole face.
+        KdRopeLeaf& leaf = entry.leaf;
+        for ( unsigned int face = 0; face < 6; face++ ) {
+            const unsigned int faceAxis = face / 2;
+            unsigned int&      rope     = leaf.ropes[face];
+
+            while ( ( rope != KdNoRope ) && !nodes[rope].IsLeaf () ) {
+                const KdFlatNode&  target = nodes[rope];
+                const unsigned int axis   = target.GetAxis ();
+                const float        split  = target.GetSplit ();
+
+                if ( axis == faceAxis ) {
+                    // The child of the node touching the face.
+                    rope = ( face & 1u ) ? rope + 1 : target.GetAboveChild ();
+                } else if ( split <= leaf.min[axis] ) {
+                    rope = target.GetAboveChild ();
+                } else if ( split >= leaf.max[axis] ) {
+                    rope = rope + 1;
+                } else {
+                    // The plane cuts the face.
+                    break;
+                }
+            }
+        }
+
+        m_ropes[entry.node] = leaf;
+    }
+}
+
+/*!
+ * \inheaderfile
+ */
+bool KdTree::TraceRopes (
+    const Ray&              iRay,
+    KdHit&                  oHit,
+    const float&            iNear,
+    const float&            iFar,
+    KdMailbox&              ioMailbox
+) const {
+    // Check for default near and far plane distances.
+    const float nearPlane = ( iNear < 0.0f ) ? EPSILON : iNear;
+    const float farPlane  = ( iFar  < 0.0f ) ? std::numeric_limits<float>::infinity () : iFar;
+
+    float tMin = nearPlane;
+    float tMax = farPlane;
+    if (
+        !iRay.intersect (
+            m_region,
+            tMin,
+            tMax
+        )
+    ) {
+        return false;
+    }
+
+    // Smallest distance found so far.
+    float minDist = std::numeric_limits<float>::infinity ();
+    bool intersects = false;
+
+    Vec3Df point = iRay.getOrigin () + tMin * iRay.getDirection ();
+    unsigned int node = 0u;
+
+    while ( node != KdNoRope ) {
+        node = LocateLeaf ( node, point, iRay.getDirection () );
+
+        intersects |= IntersectLeaf (
+            m_nodes[node],
+            iRay,
+            oHit,
+            nearPlane,
+            farPlane,
+            minDist,
+            ioMailbox
+        );
+
+        float exit;
+        node = ExitLeaf ( m_ropes[node], iRay, exit, point );
+
+        // Leaves are visited front to back: an intersection before the exit
+        // of the leaf is the closest one.
+        if (
+                ( minDist <= exit )
+            ||  ( exit >= tMax )
+        ) {
+            break;
+        }
+    }
+
+    return intersects;
+}
+
+/*!
+ * \inheaderfile
+ */
+bool KdTree::OccludedRopes (
+    const Ray&              iRay,
+    const float&            iNear,
+    const float&            iFar
+) const {
+    // Check for default near and far plane distances.
+    const float nearPlane = ( iNear < 0.0f ) ? EPSILON : iNear;
+    const float farPlane  = ( iFar  < 0.0f ) ? std::numeric_limits<float>::infinity () : iFar;
+
+    float tMin = nearPlane;
+    float tMax = farPlane;
+    if (
+        !iRay.intersect (
+            m_region,
+            tMin,
+            tMax
+        )
+    ) {
+        return false;
+    }
+
+    KdMailbox mailbox;
+
+    Vec3Df point = iRay.getOrigin () + tMin * iRay.getDirection ();
+    unsigned int node = 0u;
+
+    while ( node != KdNoRope ) {
+        node = LocateLeaf ( node, point, iRay.getDirection () );
+
+        // Any intersection will do.
+        if (
+            OccludedLeaf (
+                m_nodes[node],
+                iRay,
+                nearPlane,
+                farPlane,
+                mailbox
+            )
+        ) {
+            return true;
+        }
+
+        float exit;
+        node = ExitLeaf ( m_ropes[node], iRay, exit, point );
+        if ( exit >= tMax ) {
+            break;
+        }
+    }
+
+    return false;
+}
+
+/*!
+ * \inheaderfile
+ */
+bool KdTree::Save (
+    CacheWriter&            ioWriter
+) const {
+    m_triangles.Save ( ioWriter );
+
+    ioWriter.Write ( m_region.getMin () );
+    ioWriter.Write ( m_region.getMax () );
+    ioWriter.Write ( m_depth );
+    ioWriter.WriteArray ( m_nodes );
+    ioWriter.WriteArray ( m_primitiveIndices );
+
+    return true;
+}
+
+/*!
+ * \inheaderfile
+ */
+bool KdTree::IntersectLeaf (
+    const KdFlatNode&       iNode,
+    const Ray&              iRay,
+    KdHit&                  oHit,
+    const float&            iNear,
+    const float&            iFar,
+    float&                  ioMinDist,
+    KdMailbox&              ioMailbox
+) const {
+    // Stores whether or not an intersection has occurred.
+    bool intersects = false;
+
+    const unsigned int* indices = &m_primitiveIndices[iNode.GetPrimitiveOffset ()];
+    const unsigned int  count   = iNode.GetPrimitiveCount ();
+
+    // For each primitive contained in the region described by the leaf,
+    // test for intersection. Primitives are tested along the whole ray, so
+    // that those already tested in another leaf can't give a new result.
+    for ( unsigned int i = 0; i < count; i++ ) {
+        if ( ioMailbox.Visit ( indices[i] ) ) {
+            continue;
+        }
+
+        intersects |= IntersectPrimitive (
+            indices[i],
+            iRay,
+            oHit,
+            iNear,
+            iFar,
+            ioMinDist
+        );
+    }
+
+    // Returns whether or not an intersection has been found.
+    return intersects;
+}
+
+/*!
+ * \inheaderfile
+ */
+bool KdTree::OccludedLeaf (
+    const KdFlatNode&       iNode,
+    const Ray&              iRay,
+    const float&            iNear,
+    const float&            iFar,
+    KdMailbox&              ioMailbox
+) const {
+    const unsigned int* indices = &m_primitiveIndices[iNode.GetPrimitiveOffset ()];
+    const unsigned int  count   = iNode.GetPrimitiveCount ();
+
+    for ( unsigned int i = 0; i < count; i++ ) {
+        if ( ioMailbox.Visit ( indices[i] ) ) {
+            continue;
+        }
+
+        if (
+            OccludedByPrimitive (
+                indices[i],
+                iRay,
+                iNear,
+                iFar
+            )
+        ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*!
+ * \inheaderfile
+ */
+bool KdTree::IntersectHit (
+    const Ray&              iRay,
+    KdHit&                  oHit,
+    const float&            iNear,
+    const float&            iFar
+) const {
+    KdMailbox mailbox;
+
+    return Trace (
+        iRay,
+        oHit,
+        iNear,
+        iFar,
+        mailbox
+    );
+}
+
+/*!
+ * \inheaderfile
+ */
+bool KdTree::Trace (
+    const Ray&              iRay,
+    KdHit&                  oHit,
+    const float&            iNear,
+    const float&            iFar,
+    KdMailbox&              ioMailbox
+) const {
+    if ( HasRopes () ) {
+        return TraceRopes ( iRay, oHit, iNear, iFar, ioMailbox );
+    }
+
+    // Check for default near and far plane distances.
+    const float nearPlane = ( iNear < 0.0f ) ? EPSILON : iNear;
+    const float farPlane  = ( iFar  < 0.0f ) ? std::numeric_limits<float>::infinity () : iFar;
+
+    // If the ray misses the root's bounding box, there can't be
+    // an intersection with the geometry.
+    float tMin = nearPlane;
+    float tMax = farPlane;
+    if (
+        !iRay.intersect (
+            m_region,
+            tMin,
+            tMax
+        )
+    ) {
+        return false;
+    }
+
+    const Vec3Df& origin    = iRay.getOrigin ();
+    const Vec3Df& direction = iRay.getDirection ();
+    const Vec3Df& invDir    = iRay.getInvDirection ();
+
+    // Smallest distance found so far.
+    float minDist = std::numeric_limits<float>::infinity ();
+    bool intersects = false;
+
+    KdStackEntry stack[StackSize];
+    unsigned int stackSize = 0;
+
+    KdStackEntry root = { 0u, tMin, tMax };
+    stack[stackSize++] = root;
+
+    while ( stackSize > 0 ) {
+        const KdStackEntry entry = stack[--stackSize];
+        const KdFlatNode&  node  = m_nodes[entry.node];
+
+        // Nodes are visited front to back: once the closest intersection lies
+        // before the region of a node, no remaining node can hold a closer one.
+        if ( minDist < entry.tMin ) {
+            break;
+        }
+
+        if ( node.IsLeaf () ) {
+            intersects |= IntersectLeaf (
+                node,
+                iRay,
+                oHit,
+                nearPlane,
+                farPlane,
+                minDist,
+                ioMailbox
+            );
+            continue;
+        }
+
+        const unsigned int axis  = node.GetAxis ();
+        const float        split = node.GetSplit ();
+        const unsigned int below = entry.node + 1;
+        const unsigned int above = node.GetAboveChild ();
+
+        // Distance along the ray at which it crosses the splitting plane.
+        const float tSplit = ( split - origin[axis] ) * invDir[axis];
+
+        // The child on the side of the plane containing the ray's origin.
+        const bool belowFirst = ( origin[axis] < split )
+                            ||  ( ( origin[axis] == split ) && ( direction[axis] <= 0.0f ) );
+        const unsigned int nearChild = belowFirst ? below : above;
+        const unsigned int farChild  = belowFirst ? above : below;
+
+        if (
+                ( tSplit > entry.tMax )
+            ||  ( tSplit <= 0.0f )
+            ||  ( tSplit != tSplit )
+        ) {
+            // The ray doesn't reach the plane inside the node.
+            KdStackEntry nearEntry = { nearChild, entry.tMin, entry.tMax };
+            stack[stackSize++] = nearEntry;
+        } else if ( tSplit < entry.tMin ) {
+            // The ray has already crossed the plane when entering the node.
+            KdStackEntry farEntry = { farChild, entry.tMin, entry.tMax };
+            stack[stackSize++] = farEntry;
+        } else {
+            // The ray crosses both children: the near one is
+            // pushed last so that it is visited first.
+            KdStackEntry belowEntry = { below, belowFirst ? entry.tMin : tSplit, belowFirst ? tSplit : entry.tMax };
+            KdStackEntry aboveEntry = { above, belowFirst ? tSplit : entry.tMin, belowFirst ? entry.tMax : tSplit };
+            stack[stackSize++] = belowFirst ? aboveEntry : belowEntry;
+            stack[stackSize++] = belowFirst ? belowEntry : aboveEntry;
+        }
+    }
+
+    return intersects;
+}
+
+/*!
+ * \inheaderfile
+ */
+unsigned int KdTree::IntersectPacket (
+    const RayPacket&        iPacket,
+    KdIntersectionData*     oIntersections,
+    const float&            iNear,
+    const float&            iFar
+) const {
+    // Rays going different ways share few nodes:
+    // they are traced one at a time.
+    if ( !iPacket.IsCoherent () ) {
+        return Accelerator::IntersectPacket (
+            iPacket,
+            oIntersections,
+            iNear,
+            iFar
+        );
+    }
+
+    // Check for default near and far plane distances.
+    const float nearPlane = ( iNear < 0.0f ) ? EPSILON : iNear;
+    const float farPlane  = ( iFar  < 0.0f ) ? std::numeric_limits<float>::infinity () : iFar;
+
+    const SimdFloat infinity = SimdFloat::Broadcast ( std::numeric_limits<float>::infinity () );
+    const SimdFloat zero     = SimdFloat::Broadcast ( 0.0f );
+
+    // Rays missing the root's bounding box can't hit the geometry.
+    SimdFloat tMin = SimdFloat::Broadcast ( nearPlane );
+    SimdFloat tMax = SimdFloat::Broadcast ( farPlane );
+    if (
+        !ClipPacket (
+            iPacket,
+            m_region,
+            tMin,
+            tMax
+        )
+    ) {
+        return 0u;
+    }
+
+    // Smallest distance found so far, per ray.
+    float minDist[RayPacket::Size];
+    for ( unsigned int lane = 0; lane < RayPacket::Size; lane++ ) {
+        minDist[lane] = std::numeric_limits<float>::infinity ();
+    }
+    SimdFloat minDists = infinity;
+    unsigned int hits = 0u;
+    KdHit hitRecords[RayPacket::Size];
+    KdPacketMailbox mailbox;
+
+    KdPacketStackEntry stack[StackSize];
+    unsigned int stackSize = 0;
+
+    KdPacketStackEntry root = { 0u, tMin, tMax };
+    stack[stackSize++] = root;
+
+    while ( stackSize > 0 ) {
+        const KdPacketStackEntry entry = stack[--stackSize];
+        const KdFlatNode&        node  = m_nodes[entry.node];
+
+        // A ray takes part in a node if its segment crosses the node's region,
+        // and if it has no intersection before that region.
+        const SimdFloat active = ( iPacket.GetActive () & ( entry.tMin <= entry.tMax ) ).AndNot ( minDists < entry.tMin );
+        if ( !active.GetMask () ) {
+            continue;
+        }
+
+        if ( node.IsLeaf () ) {
+            const unsigned int* indices = &m_primitiveIndices[node.GetPrimitiveOffset ()];
+            const unsigned int  count   = node.GetPrimitiveCount ();
+
+            for ( unsigned int i = 0; i < count; i++ ) {
+                // Rays the triangle was already considered for in another leaf.
+                const unsigned int untested = mailbox.Visit ( indices[i], active.GetMask () );
+                if ( !untested ) {
+                    continue;
+                }
+
+                unsigned int candidates = untested & m_triangles.MayIntersect (
+                    indices[i],
+                    iPacket,
+                    active,
+                    minDists.Min ( SimdFloat::Broadcast ( farPlane ) )
+                );
+                if ( !candidates ) {
+                    continue;
+                }
+
+                // Rays that may hit the triangle get the exact test.
+                for ( unsigned int lane = 0; candidates; lane++, candidates >>= 1 ) {
+                    if (
+                            ( candidates & 1u )
+                        &&  IntersectPrimitive (
+                                indices[i],
+                                iPacket.GetRay ( lane ),
+                                hitRecords[lane],
+                                nearPlane,
+                                farPlane,
+                                minDist[lane]
+                            )
+                    ) {
+                        hits |= 1u << lane;
+                    }
+                }
+                minDists = SimdFloat::Load ( minDist );
+            }
+            continue;
+        }
+
+        const unsigned int axis  = node.GetAxis ();
+        const SimdFloat    split = SimdFloat::Broadcast ( node.GetSplit () );
+        const unsigned int below = entry.node + 1;
+        const unsigned int above = node.GetAboveChild ();
+
+        const SimdFloat& origin    = iPacket.GetOrigin ( axis );
+        const SimdFloat& direction = iPacket.GetDirection ( axis );
+
+        // Same decisions as IntersectHit, for every ray.
+        const SimdFloat tSplit = ( split - origin ) * iPacket.GetInverseDirection ( axis );
+        const SimdFloat belowFirst = ( origin < split ) | ( ( origin <= split ).AndNot ( origin < split ) & ( direction <= zero ) );
+
+        // Whether the ray reaches the plane inside the node, and
+        // whether it has crossed it before entering the node.
+        const SimdFloat reaches = ( tSplit <= entry.tMax ) & ( tSplit > zero );
+        const SimdFloat crossed = reaches & ( tSplit < entry.tMin );
+        const SimdFloat both    = reaches.AndNot ( crossed );
+
+        // Segments of the near and far children, empty
+        // for rays that don't enter them.
+        const SimdFloat nearMin = SimdFloat::Select ( crossed, infinity, entry.tMin );
+        const SimdFloat nearMax = SimdFloat::Select ( both, tSplit, entry.tMax );
+        const SimdFloat farMin  = SimdFloat::Select ( reaches, SimdFloat::Select ( both, tSplit, entry.tMin ), infinity );
+        const SimdFloat farMax  = entry.tMax;
+
+        KdPacketStackEntry belowEntry = {
+            below,
+            SimdFloat::Select ( belowFirst, nearMin, farMin ),
+            SimdFloat::Select ( belowFirst, nearMax, farMax )
+        };
+        KdPacketStackEntry aboveEntry = {
+            above,
+            SimdFloat::Select ( belowFirst, farMin, nearMin ),
+            SimdFloat::Select ( belowFirst, farMax, nearMax )
+        };
+
+        // The child that is near for all rays is pushed last so that it
+        // is visited first. Children no ray enters aren't pushed at all.
+        const unsigned int activeMask     = active.GetMask ();
+        const unsigned int belowFirstMask = ( belowFirst & active ).GetMask ();
+        const bool         enterBelow     = ( ( belowEntry.tMin <= belowEntry.tMax ) & active ).GetMask () != 0u;
+        const bool         enterAbove     = ( ( aboveEntry.tMin <= aboveEntry.tMax ) & active ).GetMask () != 0u;
+
+        if ( belowFirstMask == activeMask ) {
+            if ( enterAbove ) {
+                stack[stackSize++] = aboveEntry;
+            }
+            if ( enterBelow ) {
+                stack[stackSize++] = belowEntry;
+            }
+        } else {
+            if ( enterBelow ) {
+                stack[stackSize++] = belowEntry;
+            }
+            if ( enterAbove ) {
+                stack[stackSize++] = aboveEntry;
+            }
+        }
+    }
+
+    // Only the final hit of each ray is resolved.
+    for ( unsigned int lane = 0; lane < RayPacket::Size; lane++ ) {
+        if ( hits & ( 1u << lane ) ) {
+            ResolveHit ( iPacket.GetRay ( lane ), hitRecords[lane], oIntersections[lane] );
+        }
+    }
+
+    return hits;
+}
+
+/*!
+ * \inheaderfile
+ */
+bool KdTree::Occluded (
+    const Ray&              iRay,
+    const float&            iNear,
+    const float&            iFar
+) const {
+    if ( HasRopes () ) {
+        return OccludedRopes ( iRay, iNear, iFar );
+    }
+
+    // Check for default near and far plane distances.
+    const float nearPlane = ( iNear < 0.0f ) ? EPSILON : iNear;
+    const float farPlane  = ( iFar  < 0.0f ) ? std::numeric_limits<float>::infinity () : iFar;
+
+    float tMin = nearPlane;
+    float tMax = farPlane;
+    if (
+        !iRay.intersect (
+            m_region,
+            tMin,
+            tMax
+        )
+    ) {
+        return false;
+    }
+
+    const Vec3Df& origin    = iRay.getOrigin ();
+    const Vec3Df& direction = iRay.getDirection ();
+    const Vec3Df& invDir    = iRay.getInvDirection ();
+
+    KdMailbox mailbox;
+
+    KdStackEntry stack[StackSize];
+    unsigned int stackSize = 0;
+
+    KdStackEntry root = { 0u, tMin, tMax };
+    stack[stackSize++] = root;
+
+    while ( stackSize > 0 ) {
+        const KdStackEntry entry = stack[--stackSize];
+        const KdFlatNode&  node  = m_nodes[entry.node];
+
+        if ( node.IsLeaf () ) {
+            // Any intersection will do.
+            if (
+                OccludedLeaf (
+                    node,
+                    iRay,
+                    nearPlane,
+                    farPlane,
+                    mailbox
+                )
+            ) {
+                return true;
+            }
+            continue;
+        }
+
+        const unsigned int axis  = node.GetAxis ();
+        const float        split = node.GetSplit ();
+        const unsigned int below = entry.node + 1;
+        const unsigned int above = node.GetAboveChild ();
+
+        // Distance along the ray at which it crosses the splitting plane.
+        const float tSplit = ( split - origin[axis] ) * invDir[axis];
+
+        // The child on the side of the plane containing the ray's origin.
+        const bool belowFirst = ( origin[axis] < split )
+                            ||  ( ( origin[axis] == split ) && ( direction[axis] <= 0.0f ) );
+        const unsigned int nearChild = belowFirst ? below : above;
+        const unsigned int farChild  = belowFirst ? above : below;
+
+        if (
+                ( tSplit > entry.tMax )
+            ||  ( tSplit <= 0.0f )
+            ||  ( tSplit != tSplit )
+        ) {
+            // The ray doesn't reach the plane inside the node.
+            KdStackEntry nearEntry = { nearChild, entry.tMin, entry.tMax };
+            stack[stackSize++] = nearEntry;
+        } else if ( tSplit < entry.tMin ) {
+            // The ray has already crossed the plane when entering the node.
+            KdStackEntry farEntry = { farChild, entry.tMin, entry.tMax };
+            stack[stackSize++] = farEntry;
+        } else {
+            // The ray crosses both children. Occluders close to the origin
+            // are more likely, so the near one is still visited first.
+            KdStackEntry belowEntry = { below, belowFirst ? entry.tMin : tSplit, belowFirst ? tSplit : entry.tMax };
+            KdStackEntry aboveEntry = { above, belowFirst ? tSplit : entry.tMin, belowFirst ? entry.tMax : tSplit };
+            stack[stackSize++] = belowFirst ? aboveEntry : belowEntry;
+            stack[stackSize++] = belowFirst ? belowEntry : aboveEntry;
+        }
+    }
+
+    return false;
+}
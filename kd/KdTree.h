@@ -2,6 +2,7 @@
 #define _KDTREE_H_
 
 #include <limits>
+#include <vector>
 #include "BoundingBox.h"
 #include "Ray.h"
 #include "Object.h"
@@ -10,210 +11,422 @@
 #include "MathUtils.h"
 #include "kd/KdNode.h"
 #include "kd/KdMiddleNode.h"
+#include "kd/KdFlatNode.h"
+#include "kd/KdMailbox.h"
+#include "kd/KdRopes.h"
+#include "kd/KdSAH.h"
+#include "kd/KdStatistics.h"
+#include "Accelerator.h"
 
-// TODO
-//  - Make KdData and KdIntersectionData interfaces.
-//  - Implement SAH
 namespace kd {
 
+    /*!
+     *  \brief  The strategies available to choose the plane along which
+     *          a node is split.
+     */
+    enum KdBuildMode {
+        KD_BUILD_MIDPOINT   = 0,    //!< Cuts nodes at their center, rotating axes X->Y->Z, down to MaxElems / MaxDepth.
+        KD_BUILD_SAH        = 1     //!< Cuts nodes where the surface area heuristic cost is minimal, until no cut pays off.
+    };
+
     /*!
      *  \brief  An implementation of a KD-Tree to speed up ray
      *  intersection checks.
      *
-     *  A KD-Tree descriptor that stores and OWNS pointers to all primitive
-     *  data descriptors contained in its leaf nodes.
+     *  A KD-Tree descriptor over the triangles of its TriangleStore.
+     *
+     *  The tree is built as a hierarchy of KdMiddleNode and KdLeafNode objects,
+     *  which is then flattened into a compact array of KdFlatNode and released.
+     *  Leaves refer to triangles through a single contiguous array of indices
+     *  in the store.
      */
-    class KdTree {
+    class KdTree
+        :   public Accelerator
+    {
     private:
-        KdNode*         m_root;     //!< The root node of the tree.
-        KdDataVector    m_elems;    //!< Keeps copies of data descriptor pointers for memory cleanup.
-        unsigned int    m_depth;    //!< The maximum depth of the tree.
+        BoundingBox                 m_region;           //!< The region surrounding all data in the tree.
+        MappedArray< KdFlatNode >   m_nodes;            //!< The nodes of the tree, in depth-first order.
+        MappedArray< unsigned int > m_primitiveIndices; //!< The indices in the store of the triangles of every leaf.
+        unsigned int                m_depth;            //!< The maximum depth of the tree.
+        std::vector< KdRopeLeaf >   m_ropes;            //!< The region and ropes of every node (only used for leaves), empty unless BuildRopes was called.
+
+        /*!
+         *  \brief  Appends a node of the pointer-based tree, and all of its
+         *          descendants, to the flattened node array.
+         *
+         *  Intermediary nodes are followed by their left (below the plane) subtree, then
+         *  by their right (above the plane) subtree. Missing children become empty leaves.
+         *
+         *  \param  iNode           The node to be flattened, or 0 for an empty region.
+         *  \param  ioNodes         The flattened nodes.
+         *  \param  ioIndices       The indices of the triangles of the flattened leaves.
+         */
+        static void Flatten (
+            const KdNode*                   iNode,
+            std::vector< KdFlatNode >&      ioNodes,
+            std::vector< unsigned int >&    ioIndices
+        );
+
+        /*!
+         *  \brief  Tests a ray against the triangles of a leaf and keeps the closest
+         *          intersection found so far.
+         *
+         *  \param  iNode           The leaf to be tested.
+         *  \param  iRay            The ray to be tested.
+         *  \param  oHit            Where to place the hit record.
+         *  \param  iNear           The minimum distance an intersection can occur.
+         *  \param  iFar            The maximum distance an intersection can occur.
+         *  \param  ioMinDist       The distance of the closest intersection found so far.
+         *  \param  ioMailbox       The triangles already tested by the traversal, skipped.
+         *  \return true iff a closer intersection was found in the leaf.
+         */
+        bool IntersectLeaf (
+            const KdFlatNode&       iNode,
+            const Ray&              iRay,
+            KdHit&                  oHit,
+            const float&            iNear,
+            const float&            iFar,
+            float&                  ioMinDist,
+            KdMailbox&              ioMailbox
+        ) const;
+
+        /*!
+         *  \brief  Tests whether a ray hits any of the triangles of a leaf.
+         *
+         *  \param  iNode           The leaf to be tested.
+         *  \param  iRay            The ray to be tested.
+         *  \param  iNear           The minimum distance an intersection can occur.
+         *  \param  iFar            The maximum distance an intersection can occur.
+         *  \param  ioMailbox       The triangles already tested by the traversal, skipped.
+         *  \return true iff a front-facing triangle of the leaf is hit within [iNear, iFar].
+         */
+        bool OccludedLeaf (
+            const KdFlatNode&       iNode,
+            const Ray&              iRay,
+            const float&            iNear,
+            const float&            iFar,
+            KdMailbox&              ioMailbox
+        ) const;
+
+        /*!
+         *  \brief  Searches the closest triangle hit by a ray, front to back, with a
+         *          mailbox so that triangles referenced by several leaves are tested once.
+         *
+         *  \param  iRay            The ray to be tested.
+         *  \param  oHit            Where to place the hit record.
+         *  \param  iNear           The minimum distance an intersection can occur (defaults to epsilon).
+         *  \param  iFar            The maximum distance an intersection can occur (defaults to infinity).
+         *  \param  ioMailbox       The mailbox of the ray, which counts the tests made and skipped.
+         *  \return true iff there is an intersection.
+         */
+        bool Trace (
+            const Ray&              iRay,
+            KdHit&                  oHit,
+            const float&            iNear,
+            const float&            iFar,
+            KdMailbox&              ioMailbox
+        ) const;
+
+        /*!
+         *  \brief  Descends from a node to the leaf holding a point of a ray.
+         *
+         *  \param  iNode           The node to descend from, whose region holds the point.
+         *  \param  iPoint          The point.
+         *  \param  iDirection      The direction of the ray, which picks the child a point
+         *                          lying on a splitting plane goes to.
+         *  \return The index of the leaf.
+         */
+        inline unsigned int LocateLeaf (
+            unsigned int            iNode,
+            const Vec3Df&           iPoint,
+            const Vec3Df&           iDirection
+        ) const {
+            while ( !m_nodes[iNode].IsLeaf () ) {
+                const KdFlatNode&  node  = m_nodes[iNode];
+                const unsigned int axis  = node.GetAxis ();
+                const float        split = node.GetSplit ();
+
+                // Same choice as the near child of the stack-based traversal.
+                const bool below = ( iPoint[axis] < split )
+                               ||  ( ( iPoint[axis] == split ) && ( iDirection[axis] <= 0.0f ) );
+                iNode = below ? iNode + 1 : node.GetAboveChild ();
+            }
+
+            return iNode;
+        }
+
+        /*!
+         *  \brief  Finds where a ray leaves a leaf, and the node it enters next.
+         *
+         *  \param  iLeaf           The region and ropes of the leaf.
+         *  \param  iRay            The ray.
+         *  \param  oExit           Where to place the distance at which the ray leaves the leaf.
+         *  \param  oPoint          Where to place the exit point, exactly on the exit face.
+         *  \return The rope of the exit face, KdNoRope if the ray leaves the tree.
+         */
+        inline unsigned int ExitLeaf (
+            const KdRopeLeaf&       iLeaf,
+            const Ray&              iRay,
+            float&                  oExit,
+            Vec3Df&                 oPoint
+        ) const {
+            const Vec3Df& origin = iRay.getOrigin ();
+            const Vec3Df& invDir = iRay.getInvDirection ();
+
+            // The ray leaves through the first face it crosses among
+            // those it moves towards. NaNs never compare lower.
+            unsigned int face = KdNoRope;
+            oExit = std::numeric_limits<float>::infinity ();
+            for ( unsigned int axis = 0; axis < 3; axis++ ) {
+                const unsigned int side   = iRay.getSign ( axis ) ? 0u : 1u;
+                const float        bound  = side ? iLeaf.max[axis] : iLeaf.min[axis];
+                const float        tFace  = ( bound - origin[axis] ) * invDir[axis];
+                if ( tFace < oExit ) {
+                    oExit = tFace;
+                    face  = 2 * axis + side;
+                }
+            }
+
+            if ( face == KdNoRope ) {
+                return KdNoRope;
+            }
+
+            const unsigned int axis = face / 2;
+            oPoint = origin + oExit * iRay.getDirection ();
+            oPoint[axis] = ( face & 1u ) ? iLeaf.max[axis] : iLeaf.min[axis];
+
+            return iLeaf.ropes[face];
+        }
+
+        /*!
+         *  \brief  Searches the closest triangle hit by a ray by following the ropes
+         *          from leaf to leaf, with no stack.
+         *
+         *  \param  iRay            The ray to be tested.
+         *  \param  oHit            Where to place the hit record.
+         *  \param  iNear           The minimum distance an intersection can occur.
+         *  \param  iFar            The maximum distance an intersection can occur.
+         *  \param  ioMailbox       The mailbox of the ray.
+         *  \return true iff there is an intersection.
+         */
+        bool TraceRopes (
+            const Ray&              iRay,
+            KdHit&                  oHit,
+            const float&            iNear,
+            const float&            iFar,
+            KdMailbox&              ioMailbox
+        ) const;
+
+        /*!
+         *  \brief  Tests whether a ray hits any triangle by following the ropes from
+         *          leaf to leaf, with no stack.
+         *
+         *  \param  iRay            The ray to be tested.
+         *  \param  iNear           The minimum distance an intersection can occur.
+         *  \param  iFar            The maximum distance an intersection can occur.
+         *  \return true iff there is an intersection.
+         */
+        bool OccludedRopes (
+            const Ray&              iRay,
+            const float&            iNear,
+            const float&            iFar
+        ) const;
+
+        /*!
+         *  \brief  Allocates the root node of the tree and recursively splits it.
+         *
+         *  With the midpoint strategy the root is always an intermediary node, cut
+         *  at the center of its region. With the surface area heuristic the root is
+         *  only split if a plane cheaper than a single leaf exists. Subtrees holding
+         *  at least ParallelBuildThreshold primitives are built concurrently by the
+         *  OpenMP threads. The time spent splitting and flattening is kept in the
+         *  build times.
+         *
+         *  \param  iBuildMode  The strategy used to choose splitting planes.
+         */
+        void Build (
+            const KdBuildMode&      iBuildMode
+        );
 
     public:
         /*!
-         *  \brief  Creates a KD-Tree from the primitive descriptors it should
-         *          contain.
+         *  \brief  Creates a KD-Tree over the triangles of a set of objects.
          *
-         *  Calculates the bounding box that best fits all vertices inside the region, allocates
-         *  a root node with all data and splits it.
+         *  Copies the triangles into the tree's store, allocates a root node with all
+         *  of them, in the bounding box that best fits their vertices, and splits it.
          *
-         *  \param  iPrimitives The list of primitives that should be indexed by the KD-Tree.
+         *  \param  iObjects    The objects whose triangles should be indexed by the KD-Tree.
+         *                      They must outlive the tree.
+         *  \param  iBuildMode  The strategy used to choose splitting planes.
          */
         inline KdTree (
-            const KdDataVector&     iPrimitives
-        )   :   m_elems ( iPrimitives )
+            const std::vector< Object >&    iObjects,
+            const KdBuildMode&              iBuildMode=KD_BUILD_SAH
+        )   :   Accelerator ( iObjects )
         {
-            Vec3Df minBb;
-            Vec3Df maxBb;
-
-            // Calculate lowed and upper boundaries of the bounding box
-            // that best surrounds all data in the KD-Tree.
-            GetMinMax (
-                iPrimitives,
-                minBb,
-                maxBb
-            );
-
-            BoundingBox rootRegion ( minBb, maxBb );
-
-            KdMiddleNode* rootNode = new KdMiddleNode ( rootRegion );
-            m_depth = rootNode->Split (
-                0u,
-                KdPlane::X_PLANE,
-                iPrimitives
-            );
-
-            //KdLeafNode* rootNode = new KdLeafNode ( iPrimitives, rootRegion );
-            //m_depth = 0;
-
-            m_root = rootNode;
+            Build ( iBuildMode );
         }
 
         /*!
-         *  \brief  Creates a KD-Tree from the primitive descriptors it should
-         *          contain and a bounding box that surrounds all of them.
+         *  \brief  Creates a KD-Tree over the triangles of a single object, in
+         *          the object's own space.
          *
-         *  \param  iRegion     A region that surrounds all data on the KD-Tree.
-         *  \param  iPrimitives The list of primitives that should be indexed by the KD-Tree.
+         *  \param  iObject     The object whose triangles should be indexed by the KD-Tree.
+         *                      It must outlive the tree.
+         *  \param  iBuildMode  The strategy used to choose splitting planes.
          */
         inline KdTree (
-            const BoundingBox&      iRegion,
-            const KdDataVector&     iPrimitives
-        )   :   m_elems ( iPrimitives )
+            const Object&                   iObject,
+            const KdBuildMode&              iBuildMode=KD_BUILD_SAH
+        )   :   Accelerator ( iObject )
         {
-            // Allocates root node from input region.
-            KdMiddleNode* rootNode = new KdMiddleNode ( iRegion );
-            m_root = rootNode;
-
-            // Splits root node.
-            m_depth = rootNode->Split (
-                0u,
-                KdPlane::X_PLANE,
-                iPrimitives
-            );
+            Build ( iBuildMode );
         }
 
         /*!
-         *  \brief  Destroys the KD-Tree instance and all data it contains.
+         *  \brief  Maps a KD-Tree written by Save from a cache file, in place.
+         *
+         *  \param  iObjects    The objects the tree was built from. They must outlive
+         *                      the tree.
+         *  \param  ioCache     The cache file, owned by the tree. Check IsValid before
+         *                      using the tree.
+         */
+        KdTree (
+            const std::vector< Object >&    iObjects,
+            CacheReader*                    ioCache
+        );
+
+        /*!
+         *  \brief  Destroys the KD-Tree instance.
          */
         inline ~KdTree ()
+        {}
+
+        /*!
+         *  \brief  Accesses the region surrounding all data in the tree.
+         *
+         *  \return A constant reference to the bounding box of the root node.
+         */
+        inline virtual const BoundingBox& GetRegion () const
         {
-            if ( m_root ) {
-                delete m_root;
-                m_root = (KdNode*)0x0;
-            }
+            return m_region;
+        }
 
-            // Iterates over all primitive descriptors and free
-            // the memory allocated for them.
-            for (
-                unsigned int i = 0;
-                i < m_elems.size ();
-                i++
-            ) {
-                KdData* ptr = m_elems[i];
-
-                if ( ptr ) {
-                    delete ptr;
-                    ptr = (KdData*)0x0;
-                }
-            }
+        /*!
+         *  \return The number of bytes used by the tree, its triangles included.
+         */
+        inline virtual std::size_t GetMemoryUsage () const
+        {
+            return m_nodes.GetSize () * sizeof ( KdFlatNode )
+                +  m_primitiveIndices.GetSize () * sizeof ( unsigned int )
+                +  m_ropes.size () * sizeof ( KdRopeLeaf )
+                +  m_triangles.GetMemoryUsage ();
+        }
+
+        /*!
+         *  \brief  Links the faces of every leaf to the nodes beyond them, so that
+         *          single rays follow ropes from leaf to leaf instead of using a stack.
+         *
+         *  Ropes are built top-down: a child inherits the ropes of its parent, the face
+         *  on the splitting plane leading to its sibling. The rope of every leaf face is
+         *  then pushed down to the smallest node still holding the whole face. Ropes use
+         *  48 more bytes per node; they aren't cached and are rebuilt after loading.
+         */
+        void BuildRopes ();
+
+        /*!
+         *  \return true iff single rays follow ropes, see BuildRopes.
+         */
+        inline bool HasRopes () const
+        {
+            return !m_ropes.empty ();
         }
 
+        /*!
+         *  \brief  Measures the size and quality of the tree with a walk over all
+         *          of its nodes, and the triangle tests saved by mailboxing with
+         *          KdStatisticsSampleRays random rays across its region.
+         *
+         *  \return The statistics of the tree.
+         */
+        KdStatistics GetStatistics () const;
+
+        /*!
+         *  \brief  Writes the tree, its triangles included, to a cache file.
+         *
+         *  \param  ioWriter    The cache file being written.
+         *  \return true.
+         */
+        virtual bool Save (
+            CacheWriter&            ioWriter
+        ) const;
+
         /*!
          *  \brief  Tests intersection of a ray against the primitives contained
          *          in the KD-Tree.
          *
-         *  Checks for intersection against the root's bounding box. If there's an
-         *  intersection, propagate the test from the root.
+         *  Clips the ray against the root's bounding box. If there's an intersection,
+         *  walks down the flattened node array front to back with an explicit stack:
+         *  the child on the ray origin's side of a splitting plane is visited before the
+         *  other one, which is skipped if the ray doesn't reach it. The traversal stops
+         *  as soon as the closest intersection found lies before the next node's region.
          *
          *  \param  iRay            The ray to be tested.
-         *  \param  oIntersection   Where to place the intersection descriptor.
+         *  \param  oHit            Where to place the hit record.
          *  \param  iNear           The minimum distance an intersection can occur (defaults to 0).
          *  \param  iFar            The maximum distance an intersection can occur (defaults to infinity).
          *  \return true iff there is an intersection.
          */
-        inline bool Intersect (
+        virtual bool IntersectHit (
             const Ray&              iRay,
-            KdIntersectionData&     oIntersection,
+            KdHit&                  oHit,
             const float&            iNear=-1.0f,
             const float&            iFar=-1.0f
-        ) const {
-            Vec3Df intersectionPoint;
-
-            // Check for default near and far plane distances.
-            const double nearPlane = ( iNear < 0.0f ) ? EPSILON : iNear;
-            const double farPlane  = ( iFar  < 0.0f ) ? std::numeric_limits<double>::infinity () : iFar;
-
-            // If the ray intersects the root's bounding box,
-            // propagate the intersection test.
-            if (
-                iRay.intersect (
-                    m_root->GetRegion (),
-                    intersectionPoint
-                )
-            ) {
-                //Ray newRay ( intersectionPoint, iRay.getDirection () );
-                Ray newRay ( iRay );
-
-                return m_root->Intersect (
-                    newRay,
-                    oIntersection,
-                    nearPlane,
-                    farPlane
-                );
-            }
+        ) const;
 
-            // Else, there can't be an intersection with the geometry.
-            return false;
-        }
+        /*!
+         *  \brief  Tests intersection of every ray of a packet against the primitives
+         *          contained in the KD-Tree.
+         *
+         *  Walks the tree once for the whole packet, with the same per-ray decisions as
+         *  IntersectHit kept in SIMD lanes: a node is visited while any ray's segment crosses
+         *  it and no closer intersection was found for that ray. In leaves, the triangles
+         *  are first tested against all rays at once with TriangleStore::MayIntersect, and
+         *  only the rays that may hit them go through the exact single-ray test.
+         *
+         *  Packets whose directions don't share the same signs are traced one ray at a time.
+         *
+         *  \param  iPacket         The rays to be tested.
+         *  \param  oIntersections  Where to place the intersection descriptor of every ray.
+         *  \param  iNear           The minimum distance an intersection can occur (defaults to 0).
+         *  \param  iFar            The maximum distance an intersection can occur (defaults to infinity).
+         *  \return One bit per ray of the packet, set iff the ray hits a primitive.
+         */
+        virtual unsigned int IntersectPacket (
+            const RayPacket&        iPacket,
+            KdIntersectionData*     oIntersections,
+            const float&            iNear=-1.0f,
+            const float&            iFar=-1.0f
+        ) const;
 
         /*!
-         *  \brief  Tests intersection of a ray against the surfels contained
-         *          in the KD-Tree.
+         *  \brief  Tests whether a ray hits any of the primitives contained in the
+         *          KD-Tree between two distances.
          *
-         *  Checks for intersection against the root's bounding box. If there's an
-         *  intersection, propagate the test from the root.
+         *  Meant for shadow and ambient occlusion rays, which only need to know if
+         *  something lies in the way: returns on the first intersection found, whichever
+         *  it is, and builds no intersection descriptor.
          *
          *  \param  iRay            The ray to be tested.
-         *  \param  oIntersection   Where to place the intersection descriptor.
          *  \param  iNear           The minimum distance an intersection can occur (defaults to 0).
          *  \param  iFar            The maximum distance an intersection can occur (defaults to infinity).
          *  \return true iff there is an intersection.
          */
-        inline bool IntersectSurfel (
+        virtual bool Occluded (
             const Ray&              iRay,
-            KdIntersectionData&     oIntersection,
             const float&            iNear=-1.0f,
             const float&            iFar=-1.0f
-        ) const {
-            Vec3Df intersectionPoint;
-
-            // Check for default near and far plane distances.
-            const double nearPlane = ( iNear < 0.0f ) ? 0.0f : iNear;
-            const double farPlane  = ( iFar  < 0.0f ) ? std::numeric_limits<double>::infinity () : iFar;
-
-            // If the ray intersects the root's bounding box,
-            // propagate the intersection test.
-            if (
-                iRay.intersect (
-                    m_root->GetRegion (),
-                    intersectionPoint
-                )
-            ) {
-                //Ray newRay ( intersectionPoint, iRay.getDirection () );
-                Ray newRay ( iRay );
-
-                return m_root->IntersectSurfel (
-                    newRay,
-                    oIntersection,
-                    nearPlane,
-                    farPlane
-                );
-            }
-
-            // Else, there can't be an intersection with any of the surfels.
-            return false;
-        }
+        ) const;
 
     };
 }
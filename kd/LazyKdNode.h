@@ -0,0 +1,199 @@
+#ifndef _LAZYKDNODE_H_
+#define _LAZYKDNODE_H_
+
+#include <atomic>
+#include <mutex>
+#include "BoundingBox.h"
+#include "TriangleStore.h"
+
+namespace kd {
+
+    /*!
+     *  \brief  The states a node of the lazy KD-Tree goes through.
+     */
+    enum LazyKdState {
+        LAZY_KD_UNREFINED   = 0,    //!< The node holds its primitives, and wasn't entered by any ray yet.
+        LAZY_KD_LEAF        = 1,    //!< The node was refined into a leaf, and keeps its primitives.
+        LAZY_KD_INTERIOR    = 2     //!< The node was split, its children hold the primitives.
+    };
+
+    /*!
+     *  \brief  A node of the lazy KD-Tree.
+     *
+     *  Nodes are created unrefined, with the primitives overlapping their region.
+     *  The first ray to enter a node refines it, under the node's lock, into either a
+     *  leaf or an intermediary node with two new unrefined children. The children are
+     *  published by a single release store of the state, after which they never change:
+     *  rays reading the state with an acquire load see either an unrefined node, which
+     *  they refine (or wait for), or a complete one.
+     */
+    class LazyKdNode {
+
+    private:
+        BoundingBox                 m_region;       //!< The region in space represented by the node.
+        TriangleIndexVector         m_primitives;   //!< The primitives of an unrefined node or of a leaf.
+        unsigned int                m_depth;        //!< The depth of the node with respect to the root.
+        unsigned int                m_axis;         //!< The axis of the cut plane of an intermediary node.
+        float                       m_split;        //!< The position of the cut plane along its axis.
+        LazyKdNode*                 m_below;        //!< The child below the cut plane, once split.
+        LazyKdNode*                 m_above;        //!< The child above the cut plane, once split.
+        std::atomic< unsigned int > m_state;        //!< The LazyKdState of the node.
+        std::mutex                  m_lock;         //!< Held by the ray refining the node.
+
+        /*!
+         *  \brief  Private copy constructor: nodes are only referred to by pointers.
+         */
+        LazyKdNode ( const LazyKdNode& );
+
+        /*!
+         *  \brief  Private assignment operator: nodes are only referred to by pointers.
+         */
+        LazyKdNode& operator= ( const LazyKdNode& );
+
+    public:
+        /*!
+         *  \brief  Creates an unrefined node. Nodes with no primitives are
+         *          leaves right away.
+         *
+         *  \param  iRegion     The region represented by the node.
+         *  \param  ioPrimitives    The primitives overlapping the region, moved
+         *                          into the node (the vector is left empty).
+         *  \param  iDepth      The depth of the node with respect to the root.
+         */
+        inline LazyKdNode (
+            const BoundingBox&      iRegion,
+            TriangleIndexVector&    ioPrimitives,
+            const unsigned int&     iDepth
+        )   :   m_region ( iRegion ),
+                m_depth ( iDepth ),
+                m_axis ( 0u ),
+                m_split ( 0.0f ),
+                m_below ( (LazyKdNode*)0x0 ),
+                m_above ( (LazyKdNode*)0x0 ),
+                m_state ( ioPrimitives.empty () ? LAZY_KD_LEAF : LAZY_KD_UNREFINED )
+        {
+            m_primitives.swap ( ioPrimitives );
+        }
+
+        /*!
+         *  \brief  Destroys the node and both of its children.
+         */
+        inline ~LazyKdNode ()
+        {
+            delete m_below;
+            delete m_above;
+        }
+
+        /*!
+         *  \return The LazyKdState of the node, with acquire semantics: once it isn't
+         *          LAZY_KD_UNREFINED, the rest of the node may be read.
+         */
+        inline unsigned int GetState () const
+        {
+            return m_state.load ( std::memory_order_acquire );
+        }
+
+        /*!
+         *  \brief  Turns an unrefined node into a leaf.
+         */
+        inline void MakeLeaf ()
+        {
+            m_state.store ( LAZY_KD_LEAF, std::memory_order_release );
+        }
+
+        /*!
+         *  \brief  Turns an unrefined node into an intermediary node, and publishes
+         *          its children.
+         *
+         *  The node's primitives, now held by its children, are released.
+         *
+         *  \param  iAxis       The axis of the cut plane.
+         *  \param  iSplit      The position of the cut plane along its axis.
+         *  \param  iBelow      The child below the cut plane, owned by the node.
+         *  \param  iAbove      The child above the cut plane, owned by the node.
+         */
+        inline void MakeInterior (
+            const unsigned int&     iAxis,
+            const float&            iSplit,
+            LazyKdNode*             iBelow,
+            LazyKdNode*             iAbove
+        ) {
+            m_axis  = iAxis;
+            m_split = iSplit;
+            m_below = iBelow;
+            m_above = iAbove;
+            TriangleIndexVector ().swap ( m_primitives );
+
+            m_state.store ( LAZY_KD_INTERIOR, std::memory_order_release );
+        }
+
+        /*!
+         *  \return The lock a ray must hold to refine the node.
+         */
+        inline std::mutex& GetLock ()
+        {
+            return m_lock;
+        }
+
+        /*!
+         *  \return The region in space represented by the node.
+         */
+        inline const BoundingBox& GetRegion () const
+        {
+            return m_region;
+        }
+
+        /*!
+         *  \return The primitives of an unrefined node or of a leaf.
+         */
+        inline const TriangleIndexVector& GetPrimitives () const
+        {
+            return m_primitives;
+        }
+
+        /*!
+         *  \return The depth of the node with respect to the root.
+         */
+        inline const unsigned int& GetDepth () const
+        {
+            return m_depth;
+        }
+
+        /*!
+         *  \return The axis (0 for X, 1 for Y, 2 for Z) of the cut plane of an
+         *          intermediary node.
+         */
+        inline const unsigned int& GetAxis () const
+        {
+            return m_axis;
+        }
+
+        /*!
+         *  \return The position of the cut plane of an intermediary node along its axis.
+         */
+        inline const float& GetSplit () const
+        {
+            return m_split;
+        }
+
+        /*!
+         *  \return The child of an intermediary node below its cut plane.
+         */
+        inline LazyKdNode* GetBelowChild () const
+        {
+            return m_below;
+        }
+
+        /*!
+         *  \return The child of an intermediary node above its cut plane.
+         */
+        inline LazyKdNode* GetAboveChild () const
+        {
+            return m_above;
+        }
+
+    };
+
+}
+
+#endif // _LAZYKDNODE_H_
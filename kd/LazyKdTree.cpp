@@ -0,0 +1,321 @@
+#include "kd/LazyKdTree.h"
+
+#include <omp.h>
+
+using namespace kd;
+
+namespace {
+
+    const unsigned int StackSize = 64;  //!< The maximum number of pending nodes during a traversal.
+
+    /*!
+     *  \brief  A node waiting to be visited during a traversal, along with the
+     *          segment of the ray that crosses its region.
+     */
+    struct LazyKdStackEntry {
+        LazyKdNode*     node;   //!< The node.
+        float           tMin;   //!< The distance at which the ray enters the node's region.
+        float           tMax;   //!< The distance at which the ray leaves the node's region.
+    };
+
+    /*!
+     *  \brief  Pushes the children of an intermediary node a ray crosses, the near
+     *          one last so that it is visited first.
+     *
+     *  \param  iEntry      The intermediary node and the segment of the ray crossing it.
+     *  \param  iRay        The ray.
+     *  \param  ioStack     The pending nodes.
+     *  \param  ioStackSize The number of pending nodes.
+     */
+    inline void PushChildren (
+        const LazyKdStackEntry& iEntry,
+        const Ray&              iRay,
+        LazyKdStackEntry*       ioStack,
+        unsigned int&           ioStackSize
+    ) {
+        const LazyKdNode&  node  = *iEntry.node;
+        const unsigned int axis  = node.GetAxis ();
+        const float        split = node.GetSplit ();
+        LazyKdNode*        below = node.GetBelowChild ();
+        LazyKdNode*        above = node.GetAboveChild ();
+
+        const Vec3Df& origin = iRay.getOrigin ();
+
+        // Distance along the ray at which it crosses the splitting plane.
+        const float tSplit = ( split - origin[axis] ) * iRay.getInvDirection ()[axis];
+
+        // The child on the side of the plane containing the ray's origin.
+        const bool belowFirst = ( origin[axis] < split )
+                            ||  ( ( origin[axis] == split ) && ( iRay.getDirection ()[axis] <= 0.0f ) );
+        LazyKdNode* nearChild = belowFirst ? below : above;
+        LazyKdNode* farChild  = belowFirst ? above : below;
+
+        if (
+                ( tSplit > iEntry.tMax )
+            ||  ( tSplit <= 0.0f )
+            ||  ( tSplit != tSplit )
+        ) {
+            // The ray doesn't reach the plane inside the node.
+            LazyKdStackEntry nearEntry = { nearChild, iEntry.tMin, iEntry.tMax };
+            ioStack[ioStackSize++] = nearEntry;
+        } else if ( tSplit < iEntry.tMin ) {
+            // The ray has already crossed the plane when entering the node.
+            LazyKdStackEntry farEntry = { farChild, iEntry.tMin, iEntry.tMax };
+            ioStack[ioStackSize++] = farEntry;
+        } else {
+            LazyKdStackEntry belowEntry = { below, belowFirst ? iEntry.tMin : tSplit, belowFirst ? tSplit : iEntry.tMax };
+            LazyKdStackEntry aboveEntry = { above, belowFirst ? tSplit : iEntry.tMin, belowFirst ? iEntry.tMax : tSplit };
+            ioStack[ioStackSize++] = belowFirst ? aboveEntry : belowEntry;
+            ioStack[ioStackSize++] = belowFirst ? belowEntry : aboveEntry;
+        }
+    }
+
+}
+
+/*!
+ * \inheaderfile
+ */
+void LazyKdTree::Build (
+    const KdBuildMode&      iBuildMode
+) {
+    double start = omp_get_wtime ();
+
+    m_region    = m_triangles.GetBounds ();
+    m_buildMode = iBuildMode;
+
+    // The root holds every triangle of the store.
+    TriangleIndexVector primitives = m_triangles.GetIndices ();
+    m_maxDepth = ( iBuildMode == KD_BUILD_MIDPOINT ) ? MaxDepth - 1 : SAHMaxDepth ( primitives.size () );
+    m_referenceCount = primitives.size ();
+    m_nodeCount = 1u;
+
+    m_root = new LazyKdNode ( m_region, primitives, 0u );
+
+    m_buildTimes.hierarchy = omp_get_wtime () - start;
+}
+
+/*!
+ * \inheaderfile
+ */
+LazyKdTree::~LazyKdTree ()
+{
+    delete m_root;
+}
+
+/*!
+ * \inheaderfile
+ */
+unsigned int LazyKdTree::Refine (
+    LazyKdNode&             ioNode
+) const {
+    unsigned int state = ioNode.GetState ();
+    if ( state != LAZY_KD_UNREFINED ) {
+        return state;
+    }
+
+    std::lock_guard< std::mutex > lock ( ioNode.GetLock () );
+
+    // Another ray may have refined the node while this one waited.
+    state = ioNode.GetState ();
+    if ( state != LAZY_KD_UNREFINED ) {
+        return state;
+    }
+
+    const BoundingBox&         region     = ioNode.GetRegion ();
+    const TriangleIndexVector& primitives = ioNode.GetPrimitives ();
+    const unsigned int         depth      = ioNode.GetDepth ();
+
+    // Same decisions as the recursive builders of KdMiddleNode.
+    unsigned int axis = 0;
+    float position = 0.0f;
+    bool split = false;
+
+    if ( m_buildMode == KD_BUILD_MIDPOINT ) {
+        // The root is always cut, planes rotate X->Y->Z.
+        axis     = depth % 3;
+        position = region.getCenter ()[axis];
+        split    = ( depth == 0u )
+               ||  ( ( primitives.size () > MaxElems ) && ( depth < m_maxDepth ) );
+    } else {
+        split = ( depth < m_maxDepth )
+            &&  FindSAHSplit ( region, m_triangles, primitives, axis, position );
+    }
+
+    if ( !split ) {
+        ioNode.MakeLeaf ();
+        return LAZY_KD_LEAF;
+    }
+
+    // Child nodes' bounding boxes are the node's bounding box with
+    // one of their boundaries moved to the splitting plane.
+    Vec3Df belowMax = region.getMax ();
+    Vec3Df aboveMin = region.getMin ();
+    belowMax[axis] = position;
+    aboveMin[axis] = position;
+
+    const BoundingBox belowBb ( region.getMin (), belowMax );
+    const BoundingBox aboveBb ( aboveMin, region.getMax () );
+
+    TriangleIndexVector belowPrimitives;
+    TriangleIndexVector abovePrimitives;
+
+    if ( m_buildMode == KD_BUILD_MIDPOINT ) {
+        // Midpoint trees keep the triangles that actually cross each half.
+        for ( unsigned int i = 0; i < primitives.size (); i++ ) {
+            if ( m_triangles.Intersects ( primitives[i], aboveBb ) ) {
+                abovePrimitives.push_back ( primitives[i] );
+            }
+            if ( m_triangles.Intersects ( primitives[i], belowBb ) ) {
+                belowPrimitives.push_back ( primitives[i] );
+            }
+        }
+    } else {
+        PartitionPrimitives (
+            region,
+            m_triangles,
+            primitives,
+            axis,
+            position,
+            belowPrimitives,
+            abovePrimitives
+        );
+    }
+
+    m_nodeCount += 2u;
+    m_referenceCount += belowPrimitives.size () + abovePrimitives.size ();
+    m_referenceCount -= primitives.size ();
+
+    LazyKdNode* below = new LazyKdNode ( belowBb, belowPrimitives, depth + 1 );
+    LazyKdNode* above = new LazyKdNode ( aboveBb, abovePrimitives, depth + 1 );
+    ioNode.MakeInterior ( axis, position, below, above );
+
+    return LAZY_KD_INTERIOR;
+}
+
+/*!
+ * \inheaderfile
+ */
+bool LazyKdTree::IntersectHit (
+    const Ray&              iRay,
+    KdHit&                  oHit,
+    const float&            iNear,
+    const float&            iFar
+) const {
+    // Check for default near and far plane distances.
+    const float nearPlane = ( iNear < 0.0f ) ? EPSILON : iNear;
+    const float farPlane  = ( iFar  < 0.0f ) ? std::numeric_limits<float>::infinity () : iFar;
+
+    // If the ray misses the root's bounding box, there can't be
+    // an intersection with the geometry.
+    float tMin = nearPlane;
+    float tMax = farPlane;
+    if (
+        !iRay.intersect (
+            m_region,
+            tMin,
+            tMax
+        )
+    ) {
+        return false;
+    }
+
+    // Smallest distance found so far.
+    float minDist = std::numeric_limits<float>::infinity ();
+    bool intersects = false;
+
+    KdMailbox mailbox;
+
+    LazyKdStackEntry stack[StackSize];
+    unsigned int stackSize = 0;
+
+    LazyKdStackEntry root = { m_root, tMin, tMax };
+    stack[stackSize++] = root;
+
+    while ( stackSize > 0 ) {
+        const LazyKdStackEntry entry = stack[--stackSize];
+
+        // Nodes are visited front to back: once the closest intersection lies
+        // before the region of a node, no remaining node can hold a closer one.
+        if ( minDist < entry.tMin ) {
+            break;
+        }
+
+        if ( Refine ( *entry.node ) == LAZY_KD_INTERIOR ) {
+            PushChildren ( entry, iRay, stack, stackSize );
+            continue;
+        }
+
+        const TriangleIndexVector& primitives = entry.node->GetPrimitives ();
+        for ( unsigned int i = 0; i < primitives.size (); i++ ) {
+            if ( mailbox.Visit ( primitives[i] ) ) {
+                continue;
+            }
+
+            intersects |= IntersectPrimitive (
+                primitives[i],
+                iRay,
+                oHit,
+                nearPlane,
+                farPlane,
+                minDist
+            );
+        }
+    }
+
+    return intersects;
+}
+
+/*!
+ * \inheaderfile
+ */
+bool LazyKdTree::Occluded (
+    const Ray&              iRay,
+    const float&            iNear,
+    const float&            iFar
+) const {
+    // Check for default near and far plane distances.
+    const float nearPlane = ( iNear < 0.0f ) ? EPSILON : iNear;
+    const float farPlane  = ( iFar  < 0.0f ) ? std::numeric_limits<float>::infinity () : iFar;
+
+    float tMin = nearPlane;
+    float tMax = farPlane;
+    if (
+        !iRay.intersect (
+            m_region,
+            tMin,
+            tMax
+        )
+    ) {
+        return false;
+    }
+
+    KdMailbox mailbox;
+
+    LazyKdStackEntry stack[StackSize];
+    unsigned int stackSize = 0;
+
+    LazyKdStackEntry root = { m_root, tMin, tMax };
+    stack[stackSize++] = root;
+
+    while ( stackSize > 0 ) {
+        const LazyKdStackEntry entry = stack[--stackSize];
+
+        if ( Refine ( *entry.node ) == LAZY_KD_INTERIOR ) {
+            PushChildren ( entry, iRay, stack, stackSize );
+            continue;
+        }
+
+        // Any intersection will do.
+        const TriangleIndexVector& primitives = entry.node->GetPrimitives ();
+        for ( unsigned int i = 0; i < primitives.size (); i++ ) {
+            if (
+                    !mailbox.Visit ( primitives[i] )
+                &&  OccludedByPrimitive ( primitives[i], iRay, nearPlane, farPlane )
+            ) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,160 @@
+#ifndef _LAZYKDTREE_H_
+#define _LAZYKDTREE_H_
+
+#include <atomic>
+#include <vector>
+#include "BoundingBox.h"
+#include "Ray.h"
+#include "Object.h"
+#include "kd/KdTree.h"
+#include "kd/LazyKdNode.h"
+#include "Accelerator.h"
+
+namespace kd {
+
+    /*!
+     *  \brief  A KD-Tree whose nodes are only split when a ray first enters them.
+     *
+     *  Creating the tree only copies the triangles and allocates an unrefined root
+     *  holding all of them, so that rendering can start right away. Traversals then
+     *  refine every node they enter with the same decisions as KdTree (a midpoint cut
+     *  down to MaxElems / MaxDepth, or the surface area heuristic), so the tree converges
+     *  to KdTree's one in the regions rays go through, and regions no ray reaches are
+     *  never split. Concurrent rays refining different nodes don't wait for each other.
+     */
+    class LazyKdTree
+        :   public Accelerator
+    {
+    private:
+        BoundingBox                         m_region;           //!< The region surrounding all data in the tree.
+        LazyKdNode*                         m_root;             //!< The root of the tree.
+        KdBuildMode                         m_buildMode;        //!< The strategy used to choose splitting planes.
+        unsigned int                        m_maxDepth;         //!< The depth past which no node can be split.
+        mutable std::atomic< std::size_t >  m_nodeCount;        //!< The number of nodes allocated so far.
+        mutable std::atomic< std::size_t >  m_referenceCount;   //!< The number of primitive references held by the nodes.
+
+        /*!
+         *  \brief  Allocates the unrefined root, with all triangles of the store.
+         *
+         *  \param  iBuildMode  The strategy used to choose splitting planes.
+         */
+        void Build (
+            const KdBuildMode&      iBuildMode
+        );
+
+        /*!
+         *  \brief  Refines a node, unless another ray already did.
+         *
+         *  \param  ioNode      The node entered by a ray.
+         *  \return The LazyKdState of the refined node, LAZY_KD_LEAF or LAZY_KD_INTERIOR.
+         */
+        unsigned int Refine (
+            LazyKdNode&             ioNode
+        ) const;
+
+    public:
+        /*!
+         *  \brief  Creates a lazy KD-Tree over the triangles of a set of objects.
+         *
+         *  \param  iObjects    The objects whose triangles should be indexed by the KD-Tree.
+         *                      They must outlive the tree.
+         *  \param  iBuildMode  The strategy used to choose splitting planes.
+         */
+        inline LazyKdTree (
+            const std::vector< Object >&    iObjects,
+            const KdBuildMode&              iBuildMode=KD_BUILD_SAH
+        )   :   Accelerator ( iObjects )
+        {
+            Build ( iBuildMode );
+        }
+
+        /*!
+         *  \brief  Creates a lazy KD-Tree over the triangles of a single object, in
+         *          the object's own space.
+         *
+         *  \param  iObject     The object whose triangles should be indexed by the KD-Tree.
+         *                      It must outlive the tree.
+         *  \param  iBuildMode  The strategy used to choose splitting planes.
+         */
+        inline LazyKdTree (
+            const Object&                   iObject,
+            const KdBuildMode&              iBuildMode=KD_BUILD_SAH
+        )   :   Accelerator ( iObject )
+        {
+            Build ( iBuildMode );
+        }
+
+        /*!
+         *  \brief  Destroys the tree and all of its nodes.
+         */
+        virtual ~LazyKdTree ();
+
+        /*!
+         *  \brief  Accesses the region surrounding all data in the tree.
+         *
+         *  \return A constant reference to the bounding box of the root node.
+         */
+        inline virtual const BoundingBox& GetRegion () const
+        {
+            return m_region;
+        }
+
+        /*!
+         *  \return The number of bytes used by the nodes refined so far, their
+         *          primitive lists and the triangles.
+         */
+        inline virtual std::size_t GetMemoryUsage () const
+        {
+            return m_nodeCount.load () * sizeof ( LazyKdNode )
+                +  m_referenceCount.load () * sizeof ( unsigned int )
+                +  m_triangles.GetMemoryUsage ();
+        }
+
+        /*!
+         *  \return The number of nodes allocated so far.
+         */
+        inline std::size_t GetNodeCount () const
+        {
+            return m_nodeCount.load ();
+        }
+
+        /*!
+         *  \brief  Tests intersection of a ray against the primitives contained
+         *          in the KD-Tree.
+         *
+         *  Same front to back traversal as KdTree::IntersectHit, refining the nodes
+         *  on the way.
+         *
+         *  \param  iRay            The ray to be tested.
+         *  \param  oHit            Where to place the hit record.
+         *  \param  iNear           The minimum distance an intersection can occur (defaults to 0).
+         *  \param  iFar            The maximum distance an intersection can occur (defaults to infinity).
+         *  \return true iff there is an intersection.
+         */
+        virtual bool IntersectHit (
+            const Ray&              iRay,
+            KdHit&                  oHit,
+            const float&            iNear=-1.0f,
+            const float&            iFar=-1.0f
+        ) const;
+
+        /*!
+         *  \brief  Tests whether a ray hits any of the primitives contained in the
+         *          KD-Tree between two distances.
+         *
+         *  \param  iRay            The ray to be tested.
+         *  \param  iNear           The minimum distance an intersection can occur (defaults to 0).
+         *  \param  iFar            The maximum distance an intersection can occur (defaults to infinity).
+         *  \return true iff there is an intersection.
+         */
+        virtual bool Occluded (
+            const Ray&              iRay,
+            const float&            iNear=-1.0f,
+            const float&            iFar=-1.0f
+        ) const;
+
+    };
+
+}
+
+#endif // _LAZYKDTREE_H_
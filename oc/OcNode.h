@@ -0,0 +1,158 @@
+#ifndef _OCNODE_H_
+#define _OCNODE_H_
+
+#include "BoundingBox.h"
+#include "Ray.h"
+#include "Vec3D.h"
+
+namespace oc {
+
+    /*!
+     *  \brief  A node of the flattened surfel octree.
+     *
+     *  The children of an intermediary node are stored next to each other in the
+     *  node array, so that only the index of the first one is needed. Leaves refer
+     *  to a contiguous range of surfels. Each node fits in 32 bytes:
+     *
+     *  - six words for the bounding box of the disks of the node's surfels, which
+     *    can stick out of the octree cell the surfels' centers belong to;
+     *  - the index of the first child (intermediary nodes) or the offset of the
+     *    first surfel (leaves);
+     *  - the lowest bit of the last word is set for leaves, and its 31 upper bits
+     *    are the number of surfels of a leaf or of children of an intermediary node.
+     */
+    class OcNode {
+
+    private:
+        float           m_min[3];   //!< The lower boundary of the node's bounding box.
+        float           m_max[3];   //!< The upper boundary of the node's bounding box.
+        unsigned int    m_offset;   //!< The index of the first child or of the first surfel.
+        unsigned int    m_flags;    //!< The leaf bit and the number of children or surfels.
+
+    public:
+        /*!
+         *  \brief  Copies the boundaries of a bounding box.
+         *
+         *  \param  iBounds     The bounding box of the node.
+         */
+        inline void SetBounds (
+            const BoundingBox&      iBounds
+        ) {
+            for ( unsigned int axis = 0; axis < 3; axis++ ) {
+                m_min[axis] = iBounds.getMin ()[axis];
+                m_max[axis] = iBounds.getMax ()[axis];
+            }
+        }
+
+        /*!
+         *  \brief  Turns the node into a leaf.
+         *
+         *  \param  iBounds         The bounding box of the leaf's surfels.
+         *  \param  iSurfelOffset   The offset of the leaf's first surfel.
+         *  \param  iSurfelCount    The number of surfels contained in the leaf.
+         */
+        inline void InitLeaf (
+            const BoundingBox&      iBounds,
+            const unsigned int&     iSurfelOffset,
+            const unsigned int&     iSurfelCount
+        ) {
+            SetBounds ( iBounds );
+            m_offset = iSurfelOffset;
+            m_flags = ( iSurfelCount << 1 ) | 1u;
+        }
+
+        /*!
+         *  \brief  Turns the node into an intermediary node.
+         *
+         *  \param  iBounds         The bounding box of all children.
+         *  \param  iFirstChild     The index of the first child in the node array.
+         *  \param  iChildCount     The number of children, between 1 and 8.
+         */
+        inline void InitInterior (
+            const BoundingBox&      iBounds,
+            const unsigned int&     iFirstChild,
+            const unsigned int&     iChildCount
+        ) {
+            SetBounds ( iBounds );
+            m_offset = iFirstChild;
+            m_flags = iChildCount << 1;
+        }
+
+        /*!
+         *  \return true iff the node is a leaf.
+         */
+        inline bool IsLeaf () const
+        {
+            return ( m_flags & 1u ) != 0u;
+        }
+
+        /*!
+         *  \return The index of the first child of an intermediary node.
+         */
+        inline unsigned int GetFirstChild () const
+        {
+            return m_offset;
+        }
+
+        /*!
+         *  \return The number of children of an intermediary node.
+         */
+        inline unsigned int GetChildCount () const
+        {
+            return m_flags >> 1;
+        }
+
+        /*!
+         *  \return The offset of the first surfel of a leaf.
+         */
+        inline unsigned int GetSurfelOffset () const
+        {
+            return m_offset;
+        }
+
+        /*!
+         *  \return The number of surfels contained in a leaf.
+         */
+        inline unsigned int GetSurfelCount () const
+        {
+            return m_flags >> 1;
+        }
+
+        /*!
+         *  \brief  Clips a ray segment against the node's bounding box.
+         *
+         *  \param  iRay        The ray.
+         *  \param  ioMin       The start of the segment, moved to the entry point.
+         *  \param  ioMax       The end of the segment, moved to the exit point.
+         *  \return true iff part of the segment lies inside the bounding box.
+         */
+        inline bool Intersects (
+            const Ray&              iRay,
+            float&                  ioMin,
+            float&                  ioMax
+        ) const {
+            return iRay.intersect ( m_min, m_max, ioMin, ioMax );
+        }
+
+        /*!
+         *  \return The squared distance from a point to the node's bounding box,
+         *          0 if the point is inside.
+         */
+        inline float GetSquaredDistance (
+            const Vec3Df&           iPoint
+        ) const {
+            float distance = 0.0f;
+            for ( unsigned int axis = 0; axis < 3; axis++ ) {
+                const float below = m_min[axis] - iPoint[axis];
+                const float above = iPoint[axis] - m_max[axis];
+                const float gap   = ( below > 0.0f ) ? below : ( ( above > 0.0f ) ? above : 0.0f );
+                distance += gap * gap;
+            }
+            return distance;
+        }
+
+    };
+
+}
+
+#endif // _OCNODE_H_
@@ -0,0 +1,342 @@
+#include "oc/OcTree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace oc;
+
+namespace {
+
+    const unsigned int StackSize = 7 * OcMaxDepth + 8;  //!< The maximum number of pending nodes during a traversal.
+
+    /*!
+     *  \brief  A node waiting to be visited by a ray, with the distance at which
+     *          the ray enters it.
+     */
+    struct OcStackEntry {
+        unsigned int    node;   //!< The index of the node.
+        float           tMin;   //!< The entry distance of the ray into the node.
+    };
+
+    /*!
+     *  \brief  Calculates the bounding box of a surfel's disk.
+     *
+     *  Along each axis, a disk extends from its center by its radius times the
+     *  sine of the angle between its normal and the axis.
+     */
+    BoundingBox DiskBounds (
+        const Surfel&           iSurfel
+    ) {
+        const Vec3Df& normal  = iSurfel.GetNormal ();
+        const float   length2 = Vec3Df::dotProduct ( normal, normal );
+
+        Vec3Df extent;
+        for ( unsigned int axis = 0; axis < 3; axis++ ) {
+            const float cos2 = ( length2 > 0.0f ) ? normal[axis] * normal[axis] / length2 : 0.0f;
+            extent[axis] = iSurfel.GetRadius () * std::sqrt ( std::max ( 0.0f, 1.0f - cos2 ) );
+        }
+
+        return BoundingBox (
+            iSurfel.GetPosition () - extent,
+            iSurfel.GetPosition () + extent
+        );
+    }
+
+    /*!
+     *  \brief  Finds the octant of a cell a point falls in: bit i is set iff
+     *          the point lies above the cell's center along axis i.
+     */
+    inline unsigned int Octant (
+        const Vec3Df&           iPoint,
+        const Vec3Df&           iCenter
+    ) {
+        return ( ( iPoint[0] > iCenter[0] ) ? 1u : 0u )
+            |  ( ( iPoint[1] > iCenter[1] ) ? 2u : 0u )
+            |  ( ( iPoint[2] > iCenter[2] ) ? 4u : 0u );
+    }
+
+}
+
+/*!
+ * \inheaderfile
+ */
+OcTree::OcTree (
+    const std::vector< Surfel* >&   iSurfels
+)   :   m_surfels ( iSurfels.begin (), iSurfels.end () ),
+        m_depth ( 0u )
+{
+    if ( m_surfels.empty () ) {
+        return;
+    }
+
+    std::vector< BoundingBox > bounds ( m_surfels.size () );
+    BoundingBox cell ( m_surfels[0]->GetPosition () );
+    for ( unsigned int i = 0; i < m_surfels.size (); i++ ) {
+        bounds[i] = DiskBounds ( *m_surfels[i] );
+        cell.extendTo ( m_surfels[i]->GetPosition () );
+    }
+
+    // The root cell is the cube around all centers.
+    const float  halfSize = 0.5f * std::max ( cell.getWidth (), std::max ( cell.getHeight (), cell.getLength () ) );
+    const Vec3Df center   = cell.getCenter ();
+    const Vec3Df half ( halfSize, halfSize, halfSize );
+    cell = BoundingBox ( center - half, center + half );
+
+    m_order.resize ( m_surfels.size () );
+    for ( unsigned int i = 0; i < m_order.size (); i++ ) {
+        m_order[i] = i;
+    }
+
+    m_nodes.push_back ( OcNode () );
+    BuildNode ( 0u, cell, 0u, m_order.size (), bounds, 0u );
+
+    // Copies the surfels' geometry in leaf order.
+    m_disks.resize ( m_order.size () );
+    for ( unsigned int i = 0; i < m_order.size (); i++ ) {
+        const Surfel& surfel = *m_surfels[m_order[i]];
+        m_disks[i].position = surfel.GetPosition ();
+        m_disks[i].normal   = surfel.GetNormal ();
+        m_disks[i].radius2  = surfel.GetRadius () * surfel.GetRadius ();
+    }
+}
+
+/*!
+ * \inheaderfile
+ */
+void OcTree::BuildNode (
+    const unsigned int&                 iNode,
+    const BoundingBox&                  iCell,
+    const unsigned int&                 iBegin,
+    const unsigned int&                 iEnd,
+    const std::vector< BoundingBox >&   iBounds,
+    const unsigned int&                 iDepth
+) {
+    m_depth = std::max ( m_depth, iDepth );
+
+    BoundingBox bounds = iBounds[m_order[iBegin]];
+    for ( unsigned int i = iBegin + 1; i < iEnd; i++ ) {
+        bounds.extendTo ( iBounds[m_order[i]] );
+    }
+
+    if (
+            ( iEnd - iBegin <= OcMaxLeafSize )
+        ||  ( iDepth >= OcMaxDepth )
+    ) {
+        m_nodes[iNode].InitLeaf ( bounds, iBegin, iEnd - iBegin );
+        return;
+    }
+
+    // Sorts the surfels by octant, keeping their order within each octant.
+    const Vec3Df center = iCell.getCenter ();
+    unsigned int starts[9] = { 0u };
+    for ( unsigned int i = iBegin; i < iEnd; i++ ) {
+        starts[Octant ( m_surfels[m_order[i]]->GetPosition (), center ) + 1]++;
+    }
+    for ( unsigned int octant = 0; octant < 8; octant++ ) {
+        starts[octant + 1] += starts[octant];
+    }
+
+    std::vector< unsigned int > sorted ( iEnd - iBegin );
+    unsigned int next[8];
+    for ( unsigned int octant = 0; octant < 8; octant++ ) {
+        next[octant] = starts[octant];
+    }
+    for ( unsigned int i = iBegin; i < iEnd; i++ ) {
+        sorted[next[Octant ( m_surfels[m_order[i]]->GetPosition (), center )]++] = m_order[i];
+    }
+    std::copy ( sorted.begin (), sorted.end (), m_order.begin () + iBegin );
+
+    // Only non-empty octants get a child.
+    unsigned int childCount = 0;
+    for ( unsigned int octant = 0; octant < 8; octant++ ) {
+        if ( starts[octant + 1] > starts[octant] ) {
+            childCount++;
+        }
+    }
+
+    const unsigned int firstChild = m_nodes.size ();
+    m_nodes.resize ( firstChild + childCount );
+    m_nodes[iNode].InitInterior ( bounds, firstChild, childCount );
+
+    unsigned int child = firstChild;
+    for ( unsigned int octant = 0; octant < 8; octant++ ) {
+        if ( starts[octant + 1] == starts[octant] ) {
+            continue;
+        }
+
+        Vec3Df childMin, childMax;
+        for ( unsigned int axis = 0; axis < 3; axis++ ) {
+            const bool upper = ( octant >> axis ) & 1u;
+            childMin[axis] = upper ? center[axis] : iCell.getMin ()[axis];
+            childMax[axis] = upper ? iCell.getMax ()[axis] : center[axis];
+        }
+
+        BuildNode (
+            child++,
+            BoundingBox ( childMin, childMax ),
+            iBegin + starts[octant],
+            iBegin + starts[octant + 1],
+            iBounds,
+            iDepth + 1
+        );
+    }
+}
+
+/*!
+ * \inheaderfile
+ */
+bool OcTree::Intersect (
+    const Ray&              iRay,
+    unsigned int&           oSurfel,
+    float&                  oDistance,
+    const float&            iNear,
+    const float&            iFar
+) const {
+    if ( m_nodes.empty () ) {
+        return false;
+    }
+
+    // Check for default near and far plane distances.
+    const float nearPlane = ( iNear < 0.0f ) ? 0.0f : iNear;
+    const float farPlane  = ( iFar  < 0.0f ) ? std::numeric_limits<float>::infinity () : iFar;
+
+    float tMin = nearPlane;
+    float tMax = farPlane;
+    if ( !m_nodes[0].Intersects ( iRay, tMin, tMax ) ) {
+        return false;
+    }
+
+    const Vec3Df& origin    = iRay.getOrigin ();
+    const Vec3Df& direction = iRay.getDirection ();
+
+    // Smallest distance found so far.
+    float minDist = std::numeric_limits<float>::infinity ();
+    bool intersects = false;
+
+    OcStackEntry stack[StackSize];
+    unsigned int stackSize = 0;
+
+    OcStackEntry root = { 0u, tMin };
+    stack[stackSize++] = root;
+
+    while ( stackSize > 0 ) {
+        const OcStackEntry entry = stack[--stackSize];
+        const OcNode&      node  = m_nodes[entry.node];
+
+        // Nodes overlap: the closest intersection found since the node was
+        // pushed may lie before it.
+        if ( entry.tMin > minDist ) {
+            continue;
+        }
+
+        if ( node.IsLeaf () ) {
+            const unsigned int offset = node.GetSurfelOffset ();
+            const unsigned int count  = node.GetSurfelCount ();
+
+            for ( unsigned int i = offset; i < offset + count; i++ ) {
+                const OcDisk& disk  = m_disks[i];
+                const float   slope = Vec3Df::dotProduct ( direction, disk.normal );
+
+                // Skips disks facing away from the ray, or parallel to it.
+                if ( slope >= 0.0f ) {
+                    continue;
+                }
+
+                const float t = Vec3Df::dotProduct ( disk.position - origin, disk.normal ) / slope;
+                if (
+                        ( t < nearPlane )
+                    ||  ( t > farPlane )
+                    ||  ( t >= minDist )
+                ) {
+                    continue;
+                }
+
+                const Vec3Df offsetToCenter = origin + t * direction - disk.position;
+                if ( Vec3Df::dotProduct ( offsetToCenter, offsetToCenter ) <= disk.radius2 ) {
+                    minDist    = t;
+                    oSurfel    = m_order[i];
+                    oDistance  = t;
+                    intersects = true;
+                }
+            }
+            continue;
+        }
+
+        // Children are pushed from the furthest to the closest entry point,
+        // so that the closest one is visited first.
+        OcStackEntry children[8];
+        unsigned int childCount = 0;
+
+        const unsigned int first = node.GetFirstChild ();
+        for ( unsigned int child = first; child < first + node.GetChildCount (); child++ ) {
+            float childMin = nearPlane;
+            float childMax = std::min ( farPlane, minDist );
+            if ( !m_nodes[child].Intersects ( iRay, childMin, childMax ) ) {
+                continue;
+            }
+
+            unsigned int slot = childCount++;
+            while ( ( slot > 0 ) && ( children[slot - 1].tMin < childMin ) ) {
+                children[slot] = children[slot - 1];
+                slot--;
+            }
+            children[slot].node = child;
+            children[slot].tMin = childMin;
+        }
+
+        for ( unsigned int i = 0; i < childCount; i++ ) {
+            stack[stackSize++] = children[i];
+        }
+    }
+
+    return intersects;
+}
+
+/*!
+ * \inheaderfile
+ */
+void OcTree::GetNeighbours (
+    const Vec3Df&                   iPoint,
+    const float&                    iRadius,
+    std::vector< unsigned int >&    oSurfels
+) const {
+    if ( m_nodes.empty () ) {
+        return;
+    }
+
+    const float radius2 = iRadius * iRadius;
+
+    // Neighborhood queries visit nodes in any order, so that
+    // the stack only needs node indices.
+    std::vector< unsigned int > stack;
+    stack.push_back ( 0u );
+
+    while ( !stack.empty () ) {
+        const OcNode& node = m_nodes[stack.back ()];
+        stack.pop_back ();
+
+        // Node boxes contain their surfels' centers.
+        if ( node.GetSquaredDistance ( iPoint ) > radius2 ) {
+            continue;
+        }
+
+        if ( node.IsLeaf () ) {
+            const unsigned int offset = node.GetSurfelOffset ();
+            const unsigned int count  = node.GetSurfelCount ();
+
+            for ( unsigned int i = offset; i < offset + count; i++ ) {
+                const Vec3Df toCenter = m_disks[i].position - iPoint;
+                if ( Vec3Df::dotProduct ( toCenter, toCenter ) <= radius2 ) {
+                    oSurfels.push_back ( m_order[i] );
+                }
+            }
+            continue;
+        }
+
+        const unsigned int first = node.GetFirstChild ();
+        for ( unsigned int child = first; child < first + node.GetChildCount (); child++ ) {
+            stack.push_back ( child );
+        }
+    }
+}
@@ -1,23 +1,135 @@
 #ifndef _OCTREE_H_
 #define _OCTREE_H_
 
-class ONode {
-private:
-    ONode*          m_neighbours[4];
-    BoundingBox     m_region;
+#include <vector>
+#include "BoundingBox.h"
+#include "Ray.h"
+#include "Surfel.h"
+#include "Vec3D.h"
+#include "oc/OcNode.h"
 
-};
+namespace oc {
 
-class OInterNode {
-    ONode*          m_children;
-};
+    const unsigned int OcMaxLeafSize    = 8;    //!< The number of surfels past which a cell is always split.
+    const unsigned int OcMaxDepth       = 20;   //!< The depth past which no cell can be split.
 
-class OLeafNode {
-    Surfel*         m_data;
-};
+    /*!
+     *  \brief  The geometry of a surfel, as tested by ray casts.
+     */
+    struct OcDisk {
+        Vec3Df          position;   //!< The center of the disk.
+        Vec3Df          normal;     //!< The normal of the disk's plane.
+        float           radius2;    //!< The squared radius of the disk.
+    };
 
-class Octree {
+    /*!
+     *  \brief  An octree over a point cloud, to cast rays against surfels and to
+     *          find the surfels around a point.
+     *
+     *  Surfels are sorted into the octree cells containing their centers. Each node
+     *  is bounded by the disks of its surfels rather than by its cell, so that rays
+     *  only visit nodes they may hit a disk in. The surfels' geometry is copied in
+     *  leaf order so that leaves are tested from contiguous memory.
+     */
+    class OcTree {
+    private:
+        std::vector< const Surfel* >    m_surfels;  //!< The indexed surfels, in their original order.
+        std::vector< OcNode >           m_nodes;    //!< The nodes of the tree, the root first.
+        std::vector< OcDisk >           m_disks;    //!< The geometry of the surfels, in leaf order.
+        std::vector< unsigned int >     m_order;    //!< The index of each surfel of m_disks in m_surfels.
+        unsigned int                    m_depth;    //!< The maximum depth of the tree.
 
-};
+        /*!
+         *  \brief  Builds a node and its descendants over a range of m_order.
+         *
+         *  \param  iNode       The index of the node in the node array.
+         *  \param  iCell       The octree cell of the node.
+         *  \param  iBegin      The first surfel of the node in m_order.
+         *  \param  iEnd        The end of the node's surfels in m_order.
+         *  \param  iBounds     The bounding box of every surfel's disk.
+         *  \param  iDepth      The depth of the node.
+         */
+        void BuildNode (
+            const unsigned int&                 iNode,
+            const BoundingBox&                  iCell,
+            const unsigned int&                 iBegin,
+            const unsigned int&                 iEnd,
+            const std::vector< BoundingBox >&   iBounds,
+            const unsigned int&                 iDepth
+        );
+
+    public:
+        /*!
+         *  \brief  Creates an octree over a set of surfels.
+         *
+         *  \param  iSurfels    The surfels to be indexed. They must outlive the tree,
+         *                      and their geometry must not change.
+         */
+        OcTree (
+            const std::vector< Surfel* >&   iSurfels
+        );
+
+        /*!
+         *  \return The indexed surfels, in their original order.
+         */
+        inline const std::vector< const Surfel* >& GetSurfels () const
+        {
+            return m_surfels;
+        }
+
+        /*!
+         *  \return The number of nodes of the tree.
+         */
+        inline unsigned int GetNodeCount () const
+        {
+            return m_nodes.size ();
+        }
+
+        /*!
+         *  \return The maximum depth of the tree.
+         */
+        inline const unsigned int& GetDepth () const
+        {
+            return m_depth;
+        }
+
+        /*!
+         *  \brief  Searches the closest surfel hit by a ray.
+         *
+         *  Surfels facing away from the ray are ignored. Distances are expressed in
+         *  multiples of the ray's direction.
+         *
+         *  \param  iRay        The ray to be tested.
+         *  \param  oSurfel     Where to place the index of the surfel hit.
+         *  \param  oDistance   Where to place the distance of the intersection.
+         *  \param  iNear       The minimum distance an intersection can occur (defaults to 0).
+         *  \param  iFar        The maximum distance an intersection can occur (defaults to infinity).
+         *  \return true iff there is an intersection.
+         */
+        bool Intersect (
+            const Ray&              iRay,
+            unsigned int&           oSurfel,
+            float&                  oDistance,
+            const float&            iNear=-1.0f,
+            const float&            iFar=-1.0f
+        ) const;
+
+        /*!
+         *  \brief  Finds the surfels whose centers lie within a distance of a point.
+         *
+         *  \param  iPoint      The center of the neighborhood.
+         *  \param  iRadius     The radius of the neighborhood.
+         *  \param  oSurfels    Where to append the indices of the surfels found, in no
+         *                      particular order.
+         */
+        void GetNeighbours (
+            const Vec3Df&                   iPoint,
+            const float&                    iRadius,
+            std::vector< unsigned int >&    oSurfels
+        ) const;
+
+    };
+
+}
 
 #endif // _OCTREE_H_
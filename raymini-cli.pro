@@ -0,0 +1,33 @@
+# Headless command-line renderer: renders a scene to an image file, with no
+# window nor OpenGL context. Run "./raymini-cli --help" for its settings.
+TEMPLATE = app
+TARGET   = raymini-cli
+CONFIG  += qt warn_on console release thread
+CONFIG  -= app_bundle
+QT       = core gui
+DEFINES += RAYMINI_HEADLESS
+
+include(raymini.pri)
+
+HEADERS +=  CameraPath.h \
+            FrameWriter.h
+
+SOURCES +=  CliMain.cpp \
+            CameraPath.cpp \
+            FrameWriter.cpp
+
+DESTDIR=.
+
+win32 {
+    INCLUDEPATH += '.'
+    LIBS += -static-libstdc++ \
+            -llibgomp
+    QMAKE_CXXFLAGS += -O3 -fopenmp -std=c++0x
+}
+unix {
+    LIBS += -lgomp \
+            -lm
+}
+
+# Objects are built without the GUI, apart from those of raymini.
+OBJECTS_DIR = .tmp-cli
@@ -0,0 +1,96 @@
+# The ray tracing core, shared by the GUI (raymini.pro) and the headless
+# command-line renderer (raymini-cli.pro). It uses no widget nor OpenGL
+# when RAYMINI_HEADLESS is defined.
+
+HEADERS +=  Vertex.h \
+            Triangle.h \
+            Mesh.h \
+            BoundingBox.h \
+            Material.h \
+            Object.h \
+            Light.h \
+            Scene.h \
+            RayTracer.h \
+            kd/KdTree.h \
+            Ray.h \
+            GuidedFilter.h \
+            ParameterHandler.h \
+            Surfel.h \
+            kd/KdNode.h \
+            kd/KdIntersectionData.h \
+            kd/KdPlane.h \
+            kd/KdLeafNode.h \
+            kd/KdMiddleNode.h \
+            kd/KdSAH.h \
+            kd/KdFlatNode.h \
+            kd/KdStatistics.h \
+            kd/KdHit.h \
+            kd/KdMailbox.h \
+            kd/KdRopes.h \
+            kd/LazyKdNode.h \
+            kd/LazyKdTree.h \
+            oc/OcNode.h \
+            oc/OcTree.h \
+            Accelerator.h \
+            AcceleratorCache.h \
+            MappedArray.h \
+            SimdFloat.h \
+            RayPacket.h \
+            CacheFile.h \
+            TriangleStore.h \
+            InstanceTree.h \
+            bvh/BvhNode.h \
+            bvh/BvhBuilder.h \
+            bvh/BvhTree.h \
+            bvh/QuantizedBvhNode.h \
+            bvh/QuantizedBvhTree.h \
+            MathUtils.h \
+            Vec3D.h \
+            Pbgi.h \
+            Edge.h \
+            RadianceCalculator.h \
+            TileScheduler.h \
+            FrameBuffer.h \
+            AdaptiveSampler.h
+
+SOURCES +=  kd/KdMiddleNode.cpp \
+            kd/KdTree.cpp \
+            Vertex.cpp \
+            Triangle.cpp \
+            Mesh.cpp \
+            BoundingBox.cpp \
+            Material.cpp \
+            Object.cpp \
+            Light.cpp \
+            Scene.cpp \
+            RayTracer.cpp \
+            Ray.cpp \
+            GuidedFilter.cpp \
+            ParameterHandler.cpp \
+            Surfel.cpp \
+            kd/KdPlane.cpp \
+            kd/KdSAH.cpp \
+            kd/KdStatistics.cpp \
+            kd/LazyKdTree.cpp \
+            oc/OcTree.cpp \
+            Accelerator.cpp \
+            AcceleratorCache.cpp \
+            CacheFile.cpp \
+            TriangleStore.cpp \
+            InstanceTree.cpp \
+            bvh/BvhBuilder.cpp \
+            bvh/BvhTree.cpp \
+            bvh/QuantizedBvhTree.cpp \
+            TileScheduler.cpp \
+            FrameBuffer.cpp \
+            AdaptiveSampler.cpp
+
+unix {
+    QMAKE_CFLAGS   += -O3 -fopenmp
+    QMAKE_CXXFLAGS += -O3 -std=c++0x -fopenmp
+}
+
+# Ray packets are 4-wide (SSE) by default, "qmake CONFIG+=avx" makes them 8-wide.
+avx {
+    QMAKE_CXXFLAGS += -mavx
+}
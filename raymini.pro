@@ -2,57 +2,19 @@ TEMPLATE = app
 TARGET   = raymini
 CONFIG  += qt opengl xml warn_on console release thread
 QT *= opengl xml
-HEADERS =   Window.h \
+
+include(raymini.pri)
+
+HEADERS +=  Window.h \
             GLViewer.h \
             QTUtils.h \
-            Vertex.h \
-            Triangle.h \
-            Mesh.h \
-            BoundingBox.h \
-            Material.h \
-            Object.h \
-            Light.h \
-            Scene.h \
-            RayTracer.h \
-            kd/KdTree.h \
-            Ray.h \
-            GuidedFilter.h \
-            ParameterHandler.h \
-            InteractiveRenderer.h \
-            Surfel.h \
-            kd/KdNode.h \
-            kd/KdData.h \
-            kd/KdIntersectionData.h \
-            kd/KdPlane.h \
-            kd/KdLeafNode.h \
-            kd/KdMiddleNode.h \
-            MathUtils.h \
-            Vec3D.h \
-            Pbgi.h \
-            Edge.h \
-            RadianceCalculator.h 
+            InteractiveRenderer.h
 
-SOURCES =   Window.cpp \
-            kd/KdMiddleNode.cpp \
-            kd/KdLeafNode.cpp \
+SOURCES +=  Window.cpp \
             GLViewer.cpp \
             QTUtils.cpp \
-            Vertex.cpp \
-            Triangle.cpp \
-            Mesh.cpp \
-            BoundingBox.cpp \
-            Material.cpp \
-            Object.cpp \
-            Light.cpp \
-            Scene.cpp \
-            RayTracer.cpp \
-            Ray.cpp \
             Main.cpp \
-            GuidedFilter.cpp \
-            ParameterHandler.cpp \
-            Surfel.cpp \
-            InteractiveRenderer.cpp \
-            kd/KdPlane.cpp
+            InteractiveRenderer.cpp
           
 DESTDIR=.
 
@@ -75,8 +37,6 @@ win32 {
     QMAKE_CXXFLAGS += -O3 -fopenmp -std=c++0x
 }
 unix {
-    QMAKE_CFLAGS   += -O3 -fopenmp
-    QMAKE_CXXFLAGS += -O3 -std=c++0x -fopenmp
         LIBS += -lGLEW \
             -lQGLViewer \
             -lgomp \